@@ -67,6 +67,7 @@ namespace libutf8
 {
 
 
+
 /** \var constexpr std::size_t MBS_MIN_BUFFER_LENGTH
  * \brief Minimum buffer length to support any UTF-8 characters.
  *
@@ -103,7 +104,7 @@ namespace libutf8
  *
  * The function does not encode invalid characters. When such is
  * passed to the function, the \p mb string is turned in a null
- * terminated string and the function returns 0. We avoid an
+ * terminated string and the function returns -1. We avoid an
  * exception here because that way you can quickly check whether
  * a string of `char32_t` characters is valid or not.
  *
@@ -112,10 +113,14 @@ namespace libutf8
  * Therefore this function encodes the character using 1 to 4 bytes plus
  * one for the null terminator.
  *
+ * \note
+ * The encoding itself is done by encode_utf8_char() which is constexpr
+ * and can be used at compile time.
+ *
  * \warning
  * The function does not raise an error if the input \p wc character
  * is considered invalid (a UTF-16 surrogate or larger than 0x10FFFF.)
- * Instead it returns 0 and sets the \p mb string to the empty string.
+ * Instead it returns -1 and sets the \p mb string to the empty string.
  *
  * \exception libutf8_logic_exception
  * The function raises this exception if the destination buffer is too
@@ -131,66 +136,25 @@ namespace libutf8
  */
 int wctombs(char * mb, char32_t wc, std::size_t len)
 {
-    auto verify_length = [&len](std::size_t required_len)
-    {
-        if(len < required_len)
-        {
-            throw libutf8_logic_exception("wctombs() called with an output buffer which is too small.");
-        }
-    };
-
-    if(wc < 0x80)
-    {
-        verify_length(2);
-
-        /* this will also encode '\0'... */
-        mb[0] = static_cast<char>(wc);
-        mb[1] = '\0';
-        return 1;
-    }
-    if(wc < 0x800)
+    int const size(utf8_char_length(wc));
+    if(len < static_cast<std::size_t>(size < 0 ? 1 : size + 1))
     {
-        verify_length(3);
-
-        mb[0] = static_cast<char>((wc >> 6) | 0xC0);
-        mb[1] = (wc & 0x3F) | 0x80;
-        mb[2] = '\0';
-        return 2;
+        throw libutf8_logic_exception("wctombs() called with an output buffer which is too small.");
     }
 
-    // avoid encoding the UTF-16 surrogate because those code points do not
-    // represent characters
-    //
-    if(wc < 0xD800 || wc > 0xDFFF)
+    if(size < 0)
     {
-        if(wc < 0x10000)
-        {
-            verify_length(4);
-
-            mb[0] = static_cast<char>((wc >> 12) | 0xE0);
-            mb[1] = ((wc >> 6) & 0x3F) | 0x80;
-            mb[2] = (wc & 0x3F) | 0x80;
-            mb[3] = '\0';
-            return 3;
-        }
-        if(wc < 0x110000)
-        {
-            verify_length(5);
-
-            mb[0] = static_cast<char>((wc >> 18) | 0xF0);
-            mb[1] = ((wc >> 12) & 0x3F) | 0x80;
-            mb[2] = ((wc >> 6) & 0x3F) | 0x80;
-            mb[3] = (wc & 0x3F) | 0x80;
-            mb[4] = '\0';
-            return 4;
-        }
+        // an invalid wide character (a UTF-16 surrogate or too large)
+        //
+        mb[0] = '\0';
+        return -1;
     }
 
-    verify_length(1);
-
-    /* an invalid wide character */
-    mb[0] = '\0';
-    return -1;
+    // this will also encode '\0'...
+    //
+    encode_utf8_char(mb, wc);
+    mb[size] = '\0';
+    return size;
 }
 
 
@@ -214,7 +178,9 @@ int wctombs(char * mb, char32_t wc, std::size_t len)
  *     bytes after an introducer.
  * \li The input ends too early and cannot accommodate the last
  *     encoded character.
- * \li The codes 0xF8 to 0xFF were found in the input string.
+ * \li The codes 0xC0, 0xC1, and 0xF5 to 0xFF were found in the input
+ *     string.
+ * \li The sequence is overlong (i.e. 0xE0 0x80 0x80 instead of 0x00).
  * \li The resulting \p wc value would be larger than 0x10FFFF.
  * \li The resulting \p wc value represents a UTF-16 surrogate
  *     value (a number between 0xD800 and 0xDFFF).
@@ -226,6 +192,27 @@ int wctombs(char * mb, char32_t wc, std::size_t len)
  * The function returns 0 and sets \p wc to the NUL character (`U'\0'`)
  * if the \p len parameter is zero (i.e. empty string.)
  *
+ * The decoding is done by decode_utf8_char() and the number of bytes
+ * skipped on errors by utf8_invalid_length(), so the constexpr functions
+ * and this function always agree. decode_utf8_char() uses a DFA: each
+ * byte is transformed in a class (see detail::g_utf8_class) and the class
+ * selects the next state (see detail::g_utf8_transition). The transitions only accept the second bytes
+ * which are valid for a given lead byte, which is how the overlong
+ * sequences, the surrogates, and the characters over 0x10FFFF get
+ * refused without additional tests.
+ *
+ * When a sequence is bad, the following bytes get skipped (the lead
+ * bytes 0xC0 and 0xC1 are viewed as the start of a 2 byte sequence):
+ *
+ * \li An invalid introducer (0x80 to 0xBF and 0xF5 to 0xFF) is skipped
+ *     along the 0x80 to 0xBF and 0xF5 to 0xFF bytes that follow it.
+ * \li A sequence longer than the rest of the input is skipped along
+ *     the 0x80 to 0xBF and 0xF5 to 0xFF bytes that follow its lead byte.
+ * \li A sequence which is complete but represents an invalid character
+ *     (overlong, surrogate, too large) is skipped as a whole.
+ * \li A sequence cut short by a byte other than 0x80 to 0xBF is
+ *     skipped up to that byte, which is not skipped.
+ *
  * \note
  * The function converts a NUL character (`'\0'`) in the
  * input string as a NUL wide character (`U'\0'`) and returns 1. It
@@ -245,13 +232,6 @@ int wctombs(char * mb, char32_t wc, std::size_t len)
  */
 int mbstowc(char32_t & wc, char const * & mb, std::size_t & len)
 {
-    auto skip = [](char const * & skip_mb, size_t & skip_len)
-    {
-        for(unsigned char b(0)
-            ; skip_len > 0 && (b = *skip_mb, (b >= 0x80 && b <= 0xBF) || b >= 0xF5)
-            ; ++skip_mb , --skip_len);
-    };
-
     // already done?
     //
     if(len <= 0)
@@ -260,85 +240,20 @@ int mbstowc(char32_t & wc, char const * & mb, std::size_t & len)
         return 0;
     }
 
-    // we eat one character from the source minimum
-    //
-    unsigned char c(*mb++);
-    --len;
-
-    if(c < 0x80)
-    {
-        wc = c;
-        return 1;
-    }
-
-    // by default return an invalid character
-    //
-    wc = NOT_A_CHARACTER;
-
-    // invalid stream?
-    //
-    if((c >= 0x80 && c <= 0xBF) || c >= 0xF5)
-    {
-        // this is bad UTF-8, skip all the invalid bytes
-        //
-        skip(mb, len);
-        return -1;
-    }
-
-    char32_t w(U'\0');
-    std::size_t cnt(0);
-
-    if(c >= 0xF0)
-    {
-        w = c & 0x07;
-        cnt = 3;
-    }
-    else if(c >= 0xE0)
+    int const size(decode_utf8_char(wc, mb, len));
+    if(size > 0)
     {
-        w = c & 0x0F;
-        cnt = 2;
-    }
-    else /*if(c >= 0xC0)*/    // always true so we don't have to check
-    {
-        w = c & 0x1F;
-        cnt = 1;
+        mb += size;
+        len -= size;
+        return size;
     }
 
-    // enough data in the input? if not, that's an error
+    // skip the bad sequence so only one error gets reported for it
     //
-    if(len < cnt)
-    {
-        skip(mb, len);
-        return -1;
-    }
-    len -= cnt;
-
-    for(std::size_t l(cnt); l > 0; --l, mb++)
-    {
-        c = *mb;
-        if(c < 0x80 || c > 0xBF)
-        {
-            // we got an invalid sequence!
-            // restore whatever is left in len
-            //
-            len += l;
-            return -1;
-        }
-        w = (w << 6) | (c & 0x3F);
-    }
-
-    if(w >= 0x110000
-    || (w >= 0x00D800 && w <= 0x00DFFF))
-    {
-        // character out of range or UTF-16 surrogate
-        // it can happen with sequences starting with 0xF7
-        //
-        return -1;
-    }
-
-    wc = w;
-
-    return static_cast<int>(cnt + 1);
+    std::size_t const skip(utf8_invalid_length(mb, len));
+    mb += skip;
+    len -= skip;
+    return -1;
 }
 
 
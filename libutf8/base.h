@@ -32,6 +32,8 @@
 // C++
 //
 #include    <cstddef>
+#include    <cstdint>
+#include    <string_view>
 
 
 namespace libutf8
@@ -41,6 +43,7 @@ namespace libutf8
 
 constexpr std::size_t       MBS_MIN_BUFFER_LENGTH = 5;
 constexpr char32_t const    BOM_CHAR = U'\U0000FEFF';
+constexpr char32_t const    REPLACEMENT_CHAR = U'\U0000FFFD';
 constexpr char32_t const    NOT_A_CHARACTER = static_cast<char32_t>(-2);
 
 int                     wctombs(char * mb, char32_t wc, std::size_t len);
@@ -49,5 +52,468 @@ int                     mbstowc(char32_t & wc, char * & mb, std::size_t & len);
 
 
 
+/** \brief Compute the number of bytes necessary to encode \p wc in UTF-8.
+ *
+ * This function returns the number of bytes that encode_utf8_char()
+ * writes for \p wc.
+ *
+ * \param[in] wc  The character to check.
+ *
+ * \return 1 to 4, or -1 if \p wc is a surrogate or is larger than 0x10FFFF.
+ */
+constexpr int utf8_char_length(char32_t wc) noexcept
+{
+    if(wc < 0x80)
+    {
+        return 1;
+    }
+    if(wc < 0x800)
+    {
+        return 2;
+    }
+    if(wc >= 0xD800 && wc <= 0xDFFF)
+    {
+        return -1;
+    }
+    if(wc < 0x10000)
+    {
+        return 3;
+    }
+    if(wc < 0x110000)
+    {
+        return 4;
+    }
+    return -1;
+}
+
+
+/** \brief Encode one character in UTF-8.
+ *
+ * This function is the constexpr version of wctombs(). It writes the
+ * UTF-8 bytes of \p wc to \p mb without a null terminator and it does
+ * not verify the size of the buffer: \p mb must have room for at least
+ * utf8_char_length(wc) bytes (4 bytes is always enough).
+ *
+ * Since it can be evaluated at compile time, it can be used to build
+ * static tables and constants:
+ *
+ * \code
+ *     constexpr auto e_acute([]()
+ *         {
+ *             std::array<char, 2> mb{};
+ *             libutf8::encode_utf8_char(mb.data(), U'\u00E9');
+ *             return mb;
+ *         }());
+ * \endcode
+ *
+ * \param[out] mb  The output buffer.
+ * \param[in] wc  The character to encode.
+ *
+ * \return The number of bytes written to \p mb, or -1 if \p wc is not
+ * a valid character, in which case \p mb is left untouched.
+ */
+constexpr int encode_utf8_char(char * mb, char32_t wc) noexcept
+{
+    int const size(utf8_char_length(wc));
+    switch(size)
+    {
+    case 1:
+        mb[0] = static_cast<char>(wc);
+        break;
+
+    case 2:
+        mb[0] = static_cast<char>((wc >> 6) | 0xC0);
+        mb[1] = static_cast<char>((wc & 0x3F) | 0x80);
+        break;
+
+    case 3:
+        mb[0] = static_cast<char>((wc >> 12) | 0xE0);
+        mb[1] = static_cast<char>(((wc >> 6) & 0x3F) | 0x80);
+        mb[2] = static_cast<char>((wc & 0x3F) | 0x80);
+        break;
+
+    case 4:
+        mb[0] = static_cast<char>((wc >> 18) | 0xF0);
+        mb[1] = static_cast<char>(((wc >> 12) & 0x3F) | 0x80);
+        mb[2] = static_cast<char>(((wc >> 6) & 0x3F) | 0x80);
+        mb[3] = static_cast<char>((wc & 0x3F) | 0x80);
+        break;
+
+    }
+    return size;
+}
+
+
+
+namespace detail
+{
+
+
+
+// UTF-8 DFA states, the values are offsets in g_utf8_transition
+//
+inline constexpr std::uint8_t const    UTF8_ACCEPT = 0;
+inline constexpr std::uint8_t const    UTF8_REJECT = 12;
+
+
+/** \brief The class of each byte.
+ *
+ * The UTF-8 decoder transforms each byte in one of 12 classes. The
+ * classes of the lead bytes are chosen so `0xFF >> class` is the mask
+ * of the data bits of that lead byte.
+ *
+ * \li 0 -- 0x00 to 0x7F (ASCII)
+ * \li 1 -- 0x80 to 0x8F (continuation)
+ * \li 2 -- 0xC2 to 0xDF (2 bytes)
+ * \li 3 -- 0xE1 to 0xEC and 0xEE to 0xEF (3 bytes)
+ * \li 4 -- 0xED (3 bytes, the second byte excludes the surrogates)
+ * \li 5 -- 0xF4 (4 bytes, the second byte excludes over 0x10FFFF)
+ * \li 6 -- 0xF1 to 0xF3 (4 bytes)
+ * \li 7 -- 0xA0 to 0xBF (continuation)
+ * \li 8 -- 0xC0, 0xC1, and 0xF5 to 0xFF (always invalid)
+ * \li 9 -- 0x90 to 0x9F (continuation)
+ * \li 10 -- 0xE0 (3 bytes, the second byte excludes overlongs)
+ * \li 11 -- 0xF0 (4 bytes, the second byte excludes overlongs)
+ *
+ * See "Flexible and Economical UTF-8 Decoder", Bjoern Hoehrmann.
+ */
+inline constexpr std::uint8_t const g_utf8_class[256] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 0x00
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     // 0x40
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // 0x80
+    9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,     // 0xC0
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+   10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3,
+   11, 6, 6, 6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+};
+
+
+/** \brief The transitions of the UTF-8 DFA.
+ *
+ * The table is indexed by the current state plus the class of the
+ * next byte. It returns the next state. The states are multiples of
+ * 12 so no multiplication is necessary:
+ *
+ * \li 0 -- accept, a character is complete
+ * \li 12 -- reject, the sequence is invalid
+ * \li 24 -- one continuation byte missing
+ * \li 36 -- two continuation bytes missing
+ * \li 48 -- after 0xE0, the next byte must be 0xA0 to 0xBF
+ * \li 60 -- after 0xED, the next byte must be 0x80 to 0x9F
+ * \li 72 -- after 0xF0, the next byte must be 0x90 to 0xBF
+ * \li 84 -- three continuation bytes missing
+ * \li 96 -- after 0xF4, the next byte must be 0x80 to 0x8F
+ */
+inline constexpr std::uint8_t const g_utf8_transition[108] =
+{
+     0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72,     // accept
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,     // reject
+    12,  0, 12, 12, 12, 12, 12,  0, 12,  0, 12, 12,     // 1 byte missing
+    12, 24, 12, 12, 12, 12, 12, 24, 12, 24, 12, 12,     // 2 bytes missing
+    12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12,     // after 0xE0
+    12, 24, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12,     // after 0xED
+    12, 12, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,     // after 0xF0
+    12, 36, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,     // 3 bytes missing
+    12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,     // after 0xF4
+};
+
+
+
+} // detail namespace
+
+
+
+/** \brief Decode one UTF-8 character.
+ *
+ * This function is the constexpr version of mbstowc(). It decodes the
+ * character at the start of \p mb and saves it in \p wc. Contrary to
+ * mbstowc(), the input pointer and length are not updated; use the
+ * returned size to move forward.
+ *
+ * mbstowc() is implemented with this function and utf8_invalid_length()
+ * so the two always agree. The function refuses continuation
+ * bytes without a lead byte, bytes 0xC0, 0xC1, and 0xF5 to 0xFF,
+ * overlong sequences, surrogates, characters over 0x10FFFF, and
+ * sequences cut short.
+ *
+ * \param[out] wc  The decoded character, NOT_A_CHARACTER on error and
+ * U'\0' when \p len is zero.
+ * \param[in] mb  The UTF-8 input.
+ * \param[in] len  The number of bytes available in \p mb.
+ *
+ * \return The number of bytes used (1 to 4), 0 if \p len is zero, or -1
+ * if the bytes do not represent a valid UTF-8 character.
+ */
+constexpr int decode_utf8_char(char32_t & wc, char const * mb, std::size_t len) noexcept
+{
+    if(len == 0)
+    {
+        wc = U'\0';
+        return 0;
+    }
+
+    unsigned char const c(static_cast<unsigned char>(mb[0]));
+    if(c < 0x80)
+    {
+        wc = c;
+        return 1;
+    }
+
+    // the class of the lead byte also gives us the mask of its data bits
+    //
+    std::uint8_t type(detail::g_utf8_class[c]);
+    char32_t w((0xFF >> type) & c);
+    std::uint8_t state(detail::g_utf8_transition[type]);
+    std::size_t idx(1);
+    while(state > detail::UTF8_REJECT && idx < len)
+    {
+        unsigned char const b(static_cast<unsigned char>(mb[idx]));
+        type = detail::g_utf8_class[b];
+        w = (w << 6) | (b & 0x3F);
+        state = detail::g_utf8_transition[state + type];
+        ++idx;
+    }
+
+    if(state != detail::UTF8_ACCEPT)
+    {
+        wc = NOT_A_CHARACTER;
+        return -1;
+    }
+
+    wc = w;
+    return static_cast<int>(idx);
+}
+
+
+/** \brief Compute the number of bytes of an invalid UTF-8 sequence.
+ *
+ * When decode_utf8_char() fails, this function returns the number of
+ * bytes to skip to get to the next character. It skips the same bytes
+ * as mbstowc() (the lead bytes 0xC0 and 0xC1 are viewed as the start
+ * of a 2 byte sequence):
+ *
+ * \li an invalid lead byte (0x80 to 0xBF and 0xF5 to 0xFF) is skipped
+ * along with the continuation bytes and bytes 0xF5 to 0xFF that follow;
+ * \li a sequence longer than the rest of the input is skipped along
+ * with the continuation bytes and bytes 0xF5 to 0xFF that follow its
+ * lead byte;
+ * \li an overlong sequence, a surrogate, or a character over 0x10FFFF
+ * is skipped entirely;
+ * \li otherwise the bytes up to the byte which is not a continuation
+ * byte are skipped.
+ *
+ * \param[in] mb  The UTF-8 input, which starts with an invalid sequence.
+ * \param[in] len  The number of bytes available in \p mb.
+ *
+ * \return The number of bytes to skip, at least 1 unless \p len is zero.
+ */
+constexpr std::size_t utf8_invalid_length(char const * mb, std::size_t len) noexcept
+{
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    auto const byte([mb](std::size_t idx) { return static_cast<unsigned char>(mb[idx]); });
+    auto const continuation([](unsigned char b) { return b >= 0x80 && b <= 0xBF; });
+
+    unsigned char const c(byte(0));
+    std::size_t const size(c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2));
+    std::size_t idx(1);
+    if(continuation(c) || c >= 0xF5 || len < size)
+    {
+        while(idx < len
+           && (continuation(byte(idx)) || byte(idx) >= 0xF5))
+        {
+            ++idx;
+        }
+    }
+    else
+    {
+        while(idx < size
+           && continuation(byte(idx)))
+        {
+            ++idx;
+        }
+    }
+
+    return idx;
+}
+
+
+/** \brief Compute the length of the maximal subpart of an invalid sequence.
+ *
+ * The maximal subpart is the longest sequence of bytes which is the start
+ * of a valid character, or just one byte if the first byte cannot start
+ * a valid character (Unicode 3.9 "U+FFFD Substitution of Maximal
+ * Subparts", also what the WHATWG Encoding Standard does).
+ *
+ * If \p mb starts with a valid character, the function returns its size.
+ *
+ * \param[in] mb  The UTF-8 input.
+ * \param[in] len  The number of bytes available in \p mb.
+ *
+ * \return The length of the maximal subpart, at least 1 unless \p len
+ * is zero.
+ */
+constexpr std::size_t utf8_maximal_subpart_length(char const * mb, std::size_t len) noexcept
+{
+    std::uint8_t state(detail::UTF8_ACCEPT);
+    std::size_t idx(0);
+    while(idx < len)
+    {
+        unsigned char const b(static_cast<unsigned char>(mb[idx]));
+        state = detail::g_utf8_transition[state + detail::g_utf8_class[b]];
+        if(state == detail::UTF8_REJECT)
+        {
+            return idx == 0 ? 1 : idx;
+        }
+        ++idx;
+        if(state == detail::UTF8_ACCEPT)
+        {
+            break;
+        }
+    }
+
+    return idx;
+}
+
+
+/** \brief Check whether the input ends in the middle of a character.
+ *
+ * This function returns true if all the bytes of \p mb are the start of
+ * a valid character which is not complete. This is the case of a buffer
+ * read from a stream which cuts a character in two: once more data is
+ * available, the character may turn out valid.
+ *
+ * \param[in] mb  The UTF-8 input.
+ * \param[in] len  The number of bytes available in \p mb.
+ *
+ * \return true if the input is the start of a valid character.
+ */
+constexpr bool utf8_is_truncated(char const * mb, std::size_t len) noexcept
+{
+    if(len == 0)
+    {
+        return false;
+    }
+
+    unsigned char const c(static_cast<unsigned char>(mb[0]));
+    if(detail::g_utf8_transition[detail::g_utf8_class[c]] <= detail::UTF8_REJECT)
+    {
+        // ASCII or invalid lead byte
+        //
+        return false;
+    }
+
+    return utf8_maximal_subpart_length(mb, len) == len
+        && len < (c >= 0xF0 ? 4U : (c >= 0xE0 ? 3U : 2U));
+}
+
+
+/** \brief Check whether \p str is valid UTF-8 at compile time.
+ *
+ * This function is the constexpr version of is_valid_utf8(). It is
+ * much slower than the SIMD implementation so only use it on constants.
+ *
+ * \param[in] str  The string to check.
+ *
+ * \return true if \p str only includes valid UTF-8 characters.
+ */
+constexpr bool is_valid_utf8_constexpr(std::string_view str) noexcept
+{
+    while(!str.empty())
+    {
+        char32_t wc(U'\0');
+        int const size(decode_utf8_char(wc, str.data(), str.length()));
+        if(size <= 0)
+        {
+            return false;
+        }
+        str.remove_prefix(size);
+    }
+    return true;
+}
+
+
+
+#ifdef __cpp_consteval
+namespace detail
+{
+
+// never defined: calling it from a consteval function fails the
+// compilation with an error mentioning this name
+//
+void invalid_utf8_literal();
+
+} // detail namespace
+
+
+/** \brief A string literal verified as UTF-8 at compile time.
+ *
+ * The constructor is consteval and refuses any literal which is not
+ * valid UTF-8, so a bad escape sequence such as `"\xC0\x80"` breaks
+ * the compilation instead of generating invalid strings at runtime.
+ *
+ * The class is mostly used through the `_utf8` literal operator.
+ */
+template<std::size_t N>
+struct utf8_literal_t
+{
+    consteval utf8_literal_t(char const (&str)[N])
+    {
+        if(!is_valid_utf8_constexpr(std::string_view(str, N - 1)))
+        {
+            detail::invalid_utf8_literal();
+        }
+        for(std::size_t idx(0); idx < N; ++idx)
+        {
+            f_str[idx] = str[idx];
+        }
+    }
+
+    constexpr std::string_view view() const
+    {
+        return std::string_view(f_str, N - 1);
+    }
+
+    char        f_str[N] = {};
+};
+
+
+namespace literals
+{
+
+/** \brief Create a string_view from a literal verified as UTF-8.
+ *
+ * \code
+ *     using namespace libutf8::literals;
+ *
+ *     constexpr std::string_view prefix("caf\u00E9: "_utf8);
+ * \endcode
+ *
+ * \return A view of the literal, which has static storage duration.
+ */
+template<utf8_literal_t str>
+consteval std::string_view operator ""_utf8()
+{
+    return str.view();
+}
+
+} // literals namespace
+#endif
+
+
+
 } // libutf8 namespace
 // vim: ts=4 sw=4 et
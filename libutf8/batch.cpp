@@ -0,0 +1,463 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the batch functions.
+ *
+ * Consecutive short strings get copied one after the other in a block.
+ * The block is validated (and converted) with a single call to the SIMD
+ * kernels. When the block is valid and each string starts on a character
+ * boundary (i.e. not with a continuation byte), each string is valid on
+ * its own: a string ending in the middle of a character would be followed
+ * by a byte which is not a continuation byte, which the validator flags.
+ *
+ * When a block includes an error, its strings get handled one by one to
+ * find which ones are invalid. Long strings are never copied.
+ */
+
+// self
+//
+#include    "libutf8/batch.h"
+
+#include    "libutf8/libutf8.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <cwctype>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::size_t       BATCH_BLOCK_SIZE = 4096;    // size of a block of packed strings
+constexpr std::size_t       BATCH_SHORT_STRING = 256;   // longer strings are not packed
+
+
+/** \brief Pack consecutive short strings in blocks.
+ *
+ * This function calls \p block_f with each block of packed strings and
+ * \p single_f with each string too long to be packed. The callbacks are
+ * called in the order of the strings.
+ *
+ * The \p block_f callback receives the block, the range of indexes of
+ * the strings in the block, and whether all the strings start on a
+ * character boundary.
+ */
+template<typename BlockF, typename SingleF>
+void pack_strings(std::string_view const * strs, std::size_t count, BlockF block_f, SingleF single_f)
+{
+    char buffer[BATCH_BLOCK_SIZE];
+    std::size_t used(0);
+    std::size_t first(0);
+    bool boundaries(true);
+
+    auto flush = [&](std::size_t end)
+        {
+            if(first < end)
+            {
+                block_f(std::string_view(buffer, used), first, end, boundaries);
+            }
+            used = 0;
+            boundaries = true;
+        };
+
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::string_view const & s(strs[idx]);
+        if(s.length() > BATCH_SHORT_STRING)
+        {
+            flush(idx);
+            single_f(idx);
+            first = idx + 1;
+            continue;
+        }
+
+        if(used + s.length() > BATCH_BLOCK_SIZE)
+        {
+            flush(idx);
+            first = idx;
+        }
+
+        // an empty view may have a null data() pointer, which memcpy()
+        // does not accept even with a size of zero
+        //
+        if(!s.empty())
+        {
+            if((static_cast<unsigned char>(s[0]) & 0xC0) == 0x80)
+            {
+                boundaries = false;
+            }
+            std::memcpy(buffer + used, s.data(), s.length());
+            used += s.length();
+        }
+    }
+    flush(count);
+}
+
+
+template<typename OutputT>
+std::size_t output_length(detail::kernels_t const & k, std::string_view str)
+{
+    if constexpr(sizeof(OutputT) == 2)
+    {
+        return k.f_utf16_length_from_utf8(str.data(), str.length());
+    }
+    else
+    {
+        return k.f_u8length_unchecked(str.data(), str.length());
+    }
+}
+
+
+/** \brief Compute the output length of the strings of a block.
+ *
+ * This function goes once over a block of packed strings and counts
+ * the characters of each string (plus one per 4 byte character when
+ * converting to UTF-16, since those need a surrogate pair). This avoids
+ * calling a length kernel once per short string.
+ *
+ * The length and offset of each string get saved in \p entries. The
+ * block is expected to be valid UTF-8, otherwise the lengths are
+ * meaningless and the caller converts the strings one by one.
+ *
+ * \return The total length of the strings of the block.
+ */
+template<typename OutputT>
+std::size_t block_lengths(
+          std::string_view block
+        , std::string_view const * strs
+        , std::size_t first
+        , std::size_t end
+        , std::size_t offset
+        , batch_entry_t * entries)
+{
+    unsigned char const * s(reinterpret_cast<unsigned char const *>(block.data()));
+    std::size_t length(0);
+    for(std::size_t idx(first); idx < end; ++idx)
+    {
+        unsigned char const * const e(s + strs[idx].length());
+        std::size_t l(0);
+        for(; s < e; ++s)
+        {
+            l += (*s & 0xC0) != 0x80;
+            if constexpr(sizeof(OutputT) == 2)
+            {
+                l += *s >= 0xF0;
+            }
+        }
+        entries[idx] = batch_entry_t();
+        entries[idx].f_error_position = strs[idx].length();
+        entries[idx].f_offset = offset + length;
+        entries[idx].f_length = l;
+        length += l;
+    }
+    return length;
+}
+
+
+template<typename OutputT>
+std::size_t length_batch(std::string_view const * strs, std::size_t count)
+{
+    detail::kernels_t const & k(detail::kernels());
+    std::size_t result(0);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        result += output_length<OutputT>(k, strs[idx]);
+    }
+    return result;
+}
+
+
+template<typename OutputT>
+std::size_t convert_batch(
+          std::string_view const * strs
+        , std::size_t count
+        , OutputT * arena
+        , std::size_t arena_cap
+        , batch_entry_t * entries)
+{
+    std::size_t written(0);
+    bool full(false);
+
+    auto const convert_one = [&](std::size_t idx)
+        {
+            batch_entry_t & e(entries[idx]);
+            e = batch_entry_t();
+            e.f_offset = written;
+            if(full)
+            {
+                // once a string did not fit, the following ones are
+                // not converted, so the arena remains in order
+                //
+                e.f_status = transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL;
+                return;
+            }
+
+            transcode_result_t const r(transcode<char, OutputT>(strs[idx], arena + written, arena_cap - written));
+            e.f_status = r.f_status;
+            e.f_error_position = r.f_error_position;
+            if(r.ok())
+            {
+                e.f_length = r.f_written;
+                written += r.f_written;
+            }
+            else if(r.f_status == transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL)
+            {
+                full = true;
+            }
+        };
+
+    pack_strings(
+          strs
+        , count
+        , [&](std::string_view block, std::size_t first, std::size_t end, bool boundaries)
+            {
+                if(!full && boundaries)
+                {
+                    std::size_t const length(block_lengths<OutputT>(block, strs, first, end, written, entries));
+                    if(length <= arena_cap - written
+                    && transcode<char, OutputT>(block, arena + written, length).ok())
+                    {
+                        written += length;
+                        return;
+                    }
+                }
+
+                for(std::size_t idx(first); idx < end; ++idx)
+                {
+                    convert_one(idx);
+                }
+            }
+        , convert_one);
+
+    return written;
+}
+
+
+/** \brief Compare two strings starting with ASCII characters.
+ *
+ * This function compares the ASCII characters at the start of both
+ * strings without decoding them, then lets u8casecmp() compare the
+ * rest. The result is the same as u8casecmp() with the whole strings.
+ */
+int ascii_casecmp(std::string_view lhs, std::string_view rhs)
+{
+    std::size_t const max(std::min(lhs.length(), rhs.length()));
+    std::size_t pos(0);
+    for(; pos < max; ++pos)
+    {
+        unsigned char const l(lhs[pos]);
+        unsigned char const r(rhs[pos]);
+        if(l >= 0x80 || r >= 0x80)
+        {
+            break;
+        }
+        if(l != r)
+        {
+            char32_t const ll(std::towlower(l));
+            char32_t const rl(std::towlower(r));
+            if(ll != rl)
+            {
+                return ll < rl ? -1 : 1;
+            }
+        }
+    }
+
+    return u8casecmp(lhs.substr(pos), rhs.substr(pos));
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Validate many UTF-8 strings.
+ *
+ * This function does the same as calling is_valid_utf8() on each string
+ * of \p strs. The result for each string is saved in \p valid.
+ *
+ * \param[in] strs  The strings to validate.
+ * \param[in] count  The number of strings in \p strs.
+ * \param[out] valid  An array of \p count booleans set to true for each
+ * valid string.
+ *
+ * \return The number of valid strings.
+ */
+std::size_t validate_utf8_batch(std::string_view const * strs, std::size_t count, bool * valid)
+{
+    detail::kernels_t const & k(detail::kernels());
+    std::size_t result(0);
+
+    auto const validate_one = [&](std::size_t idx)
+        {
+            valid[idx] = k.f_validate_utf8(strs[idx].data(), strs[idx].length()) == strs[idx].length();
+            result += valid[idx];
+        };
+
+    pack_strings(
+          strs
+        , count
+        , [&](std::string_view block, std::size_t first, std::size_t end, bool boundaries)
+            {
+                if(boundaries
+                && k.f_validate_utf8(block.data(), block.length()) == block.length())
+                {
+                    std::fill(valid + first, valid + end, true);
+                    result += end - first;
+                }
+                else
+                {
+                    for(std::size_t idx(first); idx < end; ++idx)
+                    {
+                        validate_one(idx);
+                    }
+                }
+            }
+        , validate_one);
+
+    return result;
+}
+
+
+/** \brief Compute the size of an arena to convert strings to UTF-16.
+ *
+ * This function returns the sum of utf16_length_from_utf8() of all the
+ * strings, which is the size of the arena convert_utf8_to_utf16_batch()
+ * needs when all the strings are valid.
+ *
+ * \param[in] strs  The strings to measure.
+ * \param[in] count  The number of strings in \p strs.
+ *
+ * \return The number of UTF-16 code units necessary to convert \p strs.
+ */
+std::size_t utf16_length_from_utf8_batch(std::string_view const * strs, std::size_t count)
+{
+    return length_batch<char16_t>(strs, count);
+}
+
+
+/** \brief Compute the size of an arena to convert strings to UTF-32.
+ *
+ * This function returns the sum of utf32_length_from_utf8() of all the
+ * strings, which is the size of the arena convert_utf8_to_utf32_batch()
+ * needs when all the strings are valid.
+ *
+ * \param[in] strs  The strings to measure.
+ * \param[in] count  The number of strings in \p strs.
+ *
+ * \return The number of characters necessary to convert \p strs.
+ */
+std::size_t utf32_length_from_utf8_batch(std::string_view const * strs, std::size_t count)
+{
+    return length_batch<char32_t>(strs, count);
+}
+
+
+/** \brief Convert many UTF-8 strings to UTF-16 in one arena.
+ *
+ * This function converts each string of \p strs to UTF-16 and saves the
+ * results one after the other in \p arena. The position and length of
+ * each result is saved in the corresponding entry of \p entries.
+ *
+ * An invalid string gets its status and error position set in its entry
+ * and nothing is added to the arena for it; the following strings still
+ * get converted. When a string does not fit in the arena, that string and
+ * all the following ones get their status set to
+ * TRANSCODE_STATUS_OUTPUT_TOO_SMALL. Use utf16_length_from_utf8_batch()
+ * to size the arena.
+ *
+ * \param[in] strs  The strings to convert.
+ * \param[in] count  The number of strings in \p strs.
+ * \param[out] arena  The output buffer receiving all the strings.
+ * \param[in] arena_cap  The number of code units available in \p arena.
+ * \param[out] entries  An array of \p count entries receiving the results.
+ *
+ * \return The number of code units written to \p arena.
+ */
+std::size_t convert_utf8_to_utf16_batch(std::string_view const * strs, std::size_t count, char16_t * arena, std::size_t arena_cap, batch_entry_t * entries)
+{
+    return convert_batch(strs, count, arena, arena_cap, entries);
+}
+
+
+/** \brief Convert many UTF-8 strings to UTF-32 in one arena.
+ *
+ * This function works like convert_utf8_to_utf16_batch() with a UTF-32
+ * output. Use utf32_length_from_utf8_batch() to size the arena.
+ *
+ * \param[in] strs  The strings to convert.
+ * \param[in] count  The number of strings in \p strs.
+ * \param[out] arena  The output buffer receiving all the strings.
+ * \param[in] arena_cap  The number of characters available in \p arena.
+ * \param[out] entries  An array of \p count entries receiving the results.
+ *
+ * \return The number of characters written to \p arena.
+ */
+std::size_t convert_utf8_to_utf32_batch(std::string_view const * strs, std::size_t count, char32_t * arena, std::size_t arena_cap, batch_entry_t * entries)
+{
+    return convert_batch(strs, count, arena, arena_cap, entries);
+}
+
+
+/** \brief Compare many pairs of strings in a case insensitive manner.
+ *
+ * This function saves the result of u8casecmp(lhs[i], rhs[i]) in
+ * results[i] for each pair of strings. The ASCII characters at the start
+ * of the strings are compared without being decoded.
+ *
+ * \exception libutf8_exception_decoding
+ * This function raises the decoding exception if one of the input strings
+ * includes an invalid UTF-8 sequence of characters. The results of the
+ * pairs before that one are already saved.
+ *
+ * \param[in] lhs  The left handside strings to compare.
+ * \param[in] rhs  The right handside strings to compare.
+ * \param[in] count  The number of strings in \p lhs and \p rhs.
+ * \param[out] results  An array of \p count integers set to -1, 0, or 1.
+ */
+void u8casecmp_batch(std::string_view const * lhs, std::string_view const * rhs, std::size_t count, int * results)
+{
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        results[idx] = ascii_casecmp(lhs[idx], rhs[idx]);
+    }
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,78 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the batch functions.
+ *
+ * The functions declared here validate, measure, convert, and compare
+ * many small strings in one call. The short strings get packed in
+ * blocks so the SIMD kernels run once per block instead of once per
+ * string. The converted strings are all saved in one output buffer
+ * (the arena) and the position of each one is returned in an array
+ * of batch_entry_t.
+ */
+
+// self
+//
+#include    <libutf8/transcode.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <string_view>
+
+
+
+namespace libutf8
+{
+
+
+
+/** \brief The result of the conversion of one string of a batch.
+ *
+ * When the string was converted, f_offset and f_length give the position
+ * of the result in the arena and f_error_position is the length of the
+ * input string. Otherwise f_status says why, f_error_position is the
+ * position of the invalid character in the input string, and f_length
+ * is zero.
+ */
+struct batch_entry_t
+{
+    bool                ok() const { return f_status == transcode_status_t::TRANSCODE_STATUS_SUCCESS; }
+
+    transcode_status_t  f_status = transcode_status_t::TRANSCODE_STATUS_SUCCESS;
+    std::size_t         f_error_position = 0;   // offset of the character that stopped the conversion
+    std::size_t         f_offset = 0;           // position of the output in the arena
+    std::size_t         f_length = 0;           // output code units
+};
+
+
+std::size_t         validate_utf8_batch(std::string_view const * strs, std::size_t count, bool * valid);
+std::size_t         utf16_length_from_utf8_batch(std::string_view const * strs, std::size_t count);
+std::size_t         utf32_length_from_utf8_batch(std::string_view const * strs, std::size_t count);
+std::size_t         convert_utf8_to_utf16_batch(std::string_view const * strs, std::size_t count, char16_t * arena, std::size_t arena_cap, batch_entry_t * entries);
+std::size_t         convert_utf8_to_utf32_batch(std::string_view const * strs, std::size_t count, char32_t * arena, std::size_t arena_cap, batch_entry_t * entries);
+void                u8casecmp_batch(std::string_view const * lhs, std::string_view const * rhs, std::size_t count, int * results);
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
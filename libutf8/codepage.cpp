@@ -0,0 +1,289 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the single byte codepage conversions.
+ *
+ * The conversion tables are generated from the mapping files found under
+ * `conf/codepages`. Latin-1 does not need a table: its bytes are the
+ * first 256 Unicode characters so the SIMD kernels convert it with a
+ * few bit manipulations. The other codepages go through the tables, one
+ * byte at a time, except for the runs of ASCII which get copied as is.
+ */
+
+// self
+//
+#include    "libutf8/codepage.h"
+
+#include    "libutf8/codepage_tables.h"
+#include    "libutf8/exception.h"
+#include    "libutf8/libutf8.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// snapdev
+//
+#include    <snapdev/hexadecimal_string.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+namespace
+{
+
+
+
+detail::codepage_table_t const & get_table(codepage_t codepage, char const * function)
+{
+    std::size_t const idx(static_cast<std::size_t>(codepage));
+    if(idx >= detail::g_codepage_tables_size)
+    {
+        throw libutf8_exception_invalid_parameter(
+                  std::string(function)
+                + "(): unknown codepage ("
+                + std::to_string(idx)
+                + ").");
+    }
+    return detail::g_codepage_tables[idx];
+}
+
+
+/** \brief Copy a run of ASCII characters.
+ *
+ * The bytes 0x00 to 0x7F are the same in all the codepages and in UTF-8
+ * so they get copied in bulk.
+ */
+void copy_ascii(std::string_view str, std::size_t & pos, char * & out)
+{
+    std::size_t const size(detail::kernels().f_validate_ascii(str.data() + pos, str.length() - pos, true));
+    std::memcpy(out, str.data() + pos, size);
+    out += size;
+    pos += size;
+}
+
+
+/** \brief Search the byte of a character in a codepage.
+ *
+ * \return The byte or -1 if the codepage does not include \p wc.
+ */
+int find_byte(detail::codepage_table_t const & table, char32_t wc)
+{
+    detail::codepage_char_t const * const end(table.f_from_unicode + table.f_from_unicode_size);
+    detail::codepage_char_t const * const it(std::lower_bound(
+              table.f_from_unicode
+            , end
+            , wc
+            , [](detail::codepage_char_t const & c, char32_t value)
+            {
+                return c.f_char < value;
+            }));
+    if(it == end
+    || it->f_char != wc)
+    {
+        return -1;
+    }
+    return it->f_byte;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Get the name of a codepage.
+ *
+ * This function returns the name of the codepage as found in the IANA
+ * character set registry (i.e. "ISO-8859-1" or "windows-1252").
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The function raises this exception if \p codepage is not valid.
+ *
+ * \param[in] codepage  The codepage to get the name of.
+ *
+ * \return The name of the codepage.
+ */
+char const * codepage_name(codepage_t codepage)
+{
+    return get_table(codepage, "codepage_name").f_name;
+}
+
+
+/** \brief Convert a string from a single byte codepage to UTF-8.
+ *
+ * This function converts \p str, encoded with \p codepage, to UTF-8 in
+ * one pass. It avoids widening the string to an std::u32string first.
+ *
+ * \exception libutf8_exception_decoding
+ * The function raises this exception if \p str includes a byte which is
+ * not defined in \p codepage (i.e. 0x81 in windows-1252).
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The function raises this exception if \p codepage is not valid.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] codepage  The codepage of \p str.
+ *
+ * \return The UTF-8 string.
+ */
+std::string codepage_to_u8string(std::string_view str, codepage_t codepage)
+{
+    detail::codepage_table_t const & table(get_table(codepage, "codepage_to_u8string"));
+
+    // Latin-1 characters over 0x7F are exactly 2 bytes in UTF-8, the
+    // characters of the other codepages are all in the Basic Plane (at
+    // most 3 bytes) so the size is exact for Latin-1 and a close upper
+    // bound for the others
+    //
+    std::size_t const latin1_length(utf8_length_from_latin1(str));
+    std::string result(codepage == codepage_t::CODEPAGE_ISO8859_1
+                ? latin1_length
+                : latin1_length * 2 - str.length(), '\0');
+    char * out(result.data());
+
+    std::size_t pos(0);
+    if(codepage == codepage_t::CODEPAGE_ISO8859_1)
+    {
+        detail::conversion_t const r(detail::kernels().f_latin1_to_utf8(str.data(), str.length(), out, result.length()));
+        pos = r.f_read;
+        out += r.f_written;
+    }
+
+    while(pos < str.length())
+    {
+        unsigned char const c(static_cast<unsigned char>(str[pos]));
+        if(c < 0x80)
+        {
+            copy_ascii(str, pos, out);
+            continue;
+        }
+
+        char32_t const wc(table.f_to_unicode[c]);
+        if(wc == NOT_A_CHARACTER)
+        {
+            throw libutf8_exception_decoding(
+                  "codepage_to_u8string(): byte 0x"
+                + snapdev::int_to_hex(c, true, 2)
+                + " at position "
+                + std::to_string(pos)
+                + " is not defined in "
+                + table.f_name
+                + ".");
+        }
+        out += encode_utf8_char(out, wc);
+        ++pos;
+    }
+
+    result.resize(out - result.data());
+    return result;
+}
+
+
+/** \brief Convert a UTF-8 string to a single byte codepage.
+ *
+ * This function converts \p str to \p codepage in one pass. The result
+ * has one byte per character.
+ *
+ * \exception libutf8_exception_decoding
+ * The function raises this exception if \p str is not valid UTF-8.
+ *
+ * \exception libutf8_exception_encoding
+ * The function raises this exception if \p str includes a character
+ * which is not available in \p codepage.
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The function raises this exception if \p codepage is not valid.
+ *
+ * \param[in] str  The UTF-8 string to convert.
+ * \param[in] codepage  The codepage of the result.
+ *
+ * \return The string encoded with \p codepage.
+ */
+std::string u8string_to_codepage(std::string_view str, codepage_t codepage)
+{
+    detail::codepage_table_t const & table(get_table(codepage, "u8string_to_codepage"));
+
+    std::string result(str.length(), '\0');
+    char * out(result.data());
+
+    std::size_t pos(0);
+    if(codepage == codepage_t::CODEPAGE_ISO8859_1)
+    {
+        detail::conversion_t const r(detail::kernels().f_utf8_to_latin1(str.data(), str.length(), out, result.length()));
+        pos = r.f_read;
+        out += r.f_written;
+    }
+
+    while(pos < str.length())
+    {
+        if(static_cast<unsigned char>(str[pos]) < 0x80)
+        {
+            copy_ascii(str, pos, out);
+            continue;
+        }
+
+        char32_t wc(U'\0');
+        char const * mb(str.data() + pos);
+        std::size_t len(str.length() - pos);
+        if(mbstowc(wc, mb, len) < 0)
+        {
+            throw libutf8_exception_decoding(
+                  "u8string_to_codepage(): the input includes an invalid UTF-8 character at position "
+                + std::to_string(pos)
+                + ".");
+        }
+        int const byte(find_byte(table, wc));
+        if(byte < 0)
+        {
+            throw libutf8_exception_encoding(
+                  "u8string_to_codepage(): character U+"
+                + snapdev::int_to_hex(wc, true, 4)
+                + " at position "
+                + std::to_string(pos)
+                + " is not available in "
+                + table.f_name
+                + ".");
+        }
+        *out++ = static_cast<char>(byte);
+        pos = mb - str.data();
+    }
+
+    result.resize(out - result.data());
+    return result;
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
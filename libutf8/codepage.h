@@ -0,0 +1,59 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the single byte codepage conversions.
+ *
+ * These functions convert between UTF-8 and legacy single byte
+ * encodings such as ISO-8859-1 (Latin-1) and Windows-1252 without going
+ * through an std::u32string.
+ */
+
+// C++
+//
+#include    <string>
+#include    <string_view>
+
+
+
+namespace libutf8
+{
+
+
+
+enum class codepage_t
+{
+    CODEPAGE_ISO8859_1,         // Latin-1
+    CODEPAGE_ISO8859_2,         // Latin-2 (Central Europe)
+    CODEPAGE_ISO8859_15,        // Latin-9 (Latin-1 with the Euro sign)
+    CODEPAGE_WINDOWS_1250,      // Central Europe
+    CODEPAGE_WINDOWS_1251,      // Cyrillic
+    CODEPAGE_WINDOWS_1252       // Western Europe
+};
+
+
+char const *        codepage_name(codepage_t codepage);
+std::string         codepage_to_u8string(std::string_view str, codepage_t codepage);
+std::string         u8string_to_codepage(std::string_view str, codepage_t codepage);
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
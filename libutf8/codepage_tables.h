@@ -0,0 +1,86 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the single byte codepage tables.
+ *
+ * The tables are generated at build time by the codepage-parser tool
+ * from the mapping files found under `conf/codepages`. The order of
+ * the tables matches the codepage_t enumeration.
+ *
+ * This file is considered private.
+ */
+
+// self
+//
+#include    <libutf8/base.h>
+
+
+// C++
+//
+#include    <cstddef>
+
+
+
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+/** \brief One entry of the reverse table of a codepage.
+ *
+ * The reverse tables are sorted by character so the encoder can use
+ * a binary search.
+ */
+struct codepage_char_t
+{
+    char32_t            f_char = U'\0';
+    unsigned char       f_byte = 0;
+};
+
+
+/** \brief The conversion tables of one single byte codepage.
+ *
+ * The bytes 0x00 to 0x7F are always ASCII. The f_to_unicode table gives
+ * the character of each byte or NOT_A_CHARACTER when the byte is not
+ * defined in that codepage. The f_from_unicode table lists the characters
+ * of the bytes 0x80 to 0xFF.
+ */
+struct codepage_table_t
+{
+    char const *                f_name = nullptr;
+    char32_t                    f_to_unicode[256] = {};
+    codepage_char_t const *     f_from_unicode = nullptr;
+    std::size_t                 f_from_unicode_size = 0;
+};
+
+
+extern codepage_table_t const   g_codepage_tables[];
+extern std::size_t const        g_codepage_tables_size;
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,158 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Functions kept for binary compatibility.
+ *
+ * The functions of the library used to take `std::string const &`,
+ * `std::u16string const &`, and `std::u32string const &` parameters.
+ * They now take string views. The functions defined here keep the
+ * previous symbols in the library so programs linked against an older
+ * version still run without being recompiled.
+ *
+ * These functions are not declared in the public headers: declaring
+ * both overloads would make calls with a string literal ambiguous.
+ * New code uses the std::string_view versions.
+ */
+
+// self
+//
+#include    "libutf8/libutf8.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+// the previous declarations; the definitions below need a declaration
+//
+bool                is_valid_ascii(std::string const & str, bool ctrl);
+bool                is_valid_utf8(std::string const & str);
+bool                is_valid_utf16(std::u16string const & str);
+bool                is_valid_unicode(std::u32string const & str, bool ctrl);
+std::string         to_u8string(std::u32string const & str);
+std::string         to_u8string(std::u16string const & str);
+std::string         to_u8string(std::wstring const & str);
+std::u16string      to_u16string(std::string const & str);
+std::u32string      to_u32string(std::string const & str);
+std::size_t         u8length(std::string const & str);
+ssize_t             u16length(std::u16string const & str);
+int                 u8casecmp(std::string const & lhs, std::string const & rhs);
+bool                make_u8string_valid(std::string & str, char32_t fix_char);
+
+
+bool is_valid_ascii(std::string const & str, bool ctrl)
+{
+    return is_valid_ascii(std::string_view(str), ctrl);
+}
+
+
+bool is_valid_utf8(std::string const & str)
+{
+    return is_valid_utf8(std::string_view(str));
+}
+
+
+bool is_valid_utf16(std::u16string const & str)
+{
+    return is_valid_utf16(std::u16string_view(str));
+}
+
+
+bool is_valid_unicode(std::u32string const & str, bool ctrl)
+{
+    return is_valid_unicode(std::u32string_view(str), ctrl);
+}
+
+
+std::string to_u8string(std::u32string const & str)
+{
+    return to_u8string(std::u32string_view(str));
+}
+
+
+std::string to_u8string(std::u16string const & str)
+{
+    return to_u8string(std::u16string_view(str));
+}
+
+
+std::string to_u8string(std::wstring const & str)
+{
+    return to_u8string(std::wstring_view(str));
+}
+
+
+std::u16string to_u16string(std::string const & str)
+{
+    return to_u16string(std::string_view(str));
+}
+
+
+std::u32string to_u32string(std::string const & str)
+{
+    return to_u32string(std::string_view(str));
+}
+
+
+std::size_t u8length(std::string const & str)
+{
+    return u8length(std::string_view(str));
+}
+
+
+ssize_t u16length(std::u16string const & str)
+{
+    return u16length(std::u16string_view(str));
+}
+
+
+int u8casecmp(std::string const & lhs, std::string const & rhs)
+{
+    return u8casecmp(std::string_view(lhs), std::string_view(rhs));
+}
+
+
+bool make_u8string_valid(std::string & str, char32_t fix_char)
+{
+    return make_u8string_valid(str, fix_char, replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+}
+
+
+// is_surrogate() and is_valid_unicode(char32_t) are now constexpr in the
+// header; taking their address makes the compiler emit them so the
+// symbols remain available to older programs
+//
+extern surrogate_t (* const g_is_surrogate)(char32_t) noexcept;
+extern bool (* const g_is_valid_unicode)(char32_t, bool) noexcept;
+
+surrogate_t (* const g_is_surrogate)(char32_t) noexcept = &is_surrogate;
+bool (* const g_is_valid_unicode)(char32_t, bool) noexcept = &is_valid_unicode;
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
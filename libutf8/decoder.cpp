@@ -0,0 +1,395 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the incremental UTF-8 decoder.
+ *
+ * The decoder converts each chunk with the exception free conversion
+ * functions (and thus the SIMD kernels). Only the few bytes of a
+ * character cut at the end of a chunk get copied in the decoder.
+ */
+
+// self
+//
+#include    "libutf8/decoder.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+namespace
+{
+
+
+
+transcode_result_t convert_utf8(std::string_view in, char16_t * out, std::size_t out_cap)
+{
+    return convert_utf8_to_utf16(in, out, out_cap);
+}
+
+
+transcode_result_t convert_utf8(std::string_view in, char32_t * out, std::size_t out_cap)
+{
+    return convert_utf8_to_utf32(in, out, out_cap);
+}
+
+
+/** \brief Get the size of a sequence from its lead byte.
+ *
+ * The pending bytes always start with a valid lead byte so this function
+ * does not have to handle other bytes.
+ */
+std::size_t sequence_size(char lead)
+{
+    unsigned char const c(static_cast<unsigned char>(lead));
+    return c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2);
+}
+
+
+
+} // no name namespace
+
+
+
+/** \class utf8_decoder
+ * \brief Decode a UTF-8 stream received in chunks.
+ *
+ * This class decodes UTF-8 data as it arrives, one chunk at a time,
+ * directly from your receive buffers. When a chunk ends in the middle of
+ * a character, the decoder keeps those bytes (at most 3) and completes
+ * the character with the start of the next chunk.
+ *
+ * \code
+ *     libutf8::utf8_decoder decoder;
+ *     std::u32string text;
+ *     while(...read a chunk in buf...)
+ *     {
+ *         libutf8::transcode_result_t const r(decoder.feed(buf, size, text));
+ *         if(!r.ok())
+ *         {
+ *             // r.f_error_position is the offset in the whole stream
+ *         }
+ *     }
+ *     if(!decoder.finish().ok())
+ *     {
+ *         // the stream ends in the middle of a character
+ *     }
+ * \endcode
+ *
+ * The decoding is strict (see convert_utf8_to_utf16()). Once an invalid
+ * sequence is found, the decoder stops and feed() returns the same error
+ * until finish() or reset() gets called.
+ */
+
+
+
+/** \brief Decode a chunk of UTF-8 to UTF-16.
+ *
+ * This function decodes \p str and saves the result in \p out.
+ *
+ * The returned structure includes the status, the number of bytes of
+ * \p str read, and the number of code units written to \p out. The
+ * bytes at the end of \p str which do not form a complete character are
+ * counted as read: they are kept in the decoder.
+ *
+ * The f_error_position is an offset in the whole stream. On an error, it
+ * is the position of the invalid character. Otherwise it is the position
+ * of the end of the last character decoded.
+ *
+ * When the status is TRANSCODE_STATUS_OUTPUT_TOO_SMALL, call the function
+ * again with the bytes which were not read and a new output buffer.
+ *
+ * \param[in] str  The chunk of UTF-8 data.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of code units available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t utf8_decoder::feed(char const * str, std::size_t len, char16_t * out, std::size_t out_cap)
+{
+    return feed_buffer(str, len, out, out_cap);
+}
+
+
+/** \brief Decode a chunk of UTF-8 to UTF-32.
+ *
+ * This function works like the UTF-16 version, only it outputs code
+ * points.
+ *
+ * \param[in] str  The chunk of UTF-8 data.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of characters available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t utf8_decoder::feed(char const * str, std::size_t len, char32_t * out, std::size_t out_cap)
+{
+    return feed_buffer(str, len, out, out_cap);
+}
+
+
+/** \brief Decode a chunk of UTF-8 and append it to a UTF-16 string.
+ *
+ * This function makes room for the whole chunk at the end of \p out,
+ * decodes it, and then resizes \p out to what was actually written. The
+ * status is never TRANSCODE_STATUS_OUTPUT_TOO_SMALL.
+ *
+ * \param[in] str  The chunk of UTF-8 data.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[in,out] out  The string where the characters get appended.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t utf8_decoder::feed(char const * str, std::size_t len, std::u16string & out)
+{
+    return feed_string(str, len, out);
+}
+
+
+/** \brief Decode a chunk of UTF-8 and append it to a UTF-32 string.
+ *
+ * This function works like the UTF-16 version, only it appends code
+ * points.
+ *
+ * \param[in] str  The chunk of UTF-8 data.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[in,out] out  The string where the characters get appended.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t utf8_decoder::feed(char const * str, std::size_t len, std::u32string & out)
+{
+    return feed_string(str, len, out);
+}
+
+
+/** \brief Mark the end of the stream.
+ *
+ * This function checks whether the stream ended in the middle of a
+ * character. If so, the status is TRANSCODE_STATUS_TRUNCATED and the
+ * f_error_position is the position of that character in the stream.
+ * It also returns the error found by feed(), if any.
+ *
+ * The decoder is then reset so it can be used with a new stream.
+ *
+ * \return The final status of the stream.
+ */
+transcode_result_t utf8_decoder::finish()
+{
+    transcode_result_t result(f_error);
+    if(result.ok())
+    {
+        result.f_error_position = f_offset - f_pending_size;
+        if(f_pending_size > 0)
+        {
+            result.f_status = transcode_status_t::TRANSCODE_STATUS_TRUNCATED;
+        }
+    }
+    reset();
+    return result;
+}
+
+
+/** \brief Reset the decoder.
+ *
+ * This function clears the pending bytes, the error, and the offset so
+ * the decoder can be used with a new stream.
+ */
+void utf8_decoder::reset()
+{
+    f_offset = 0;
+    f_pending_size = 0;
+    f_error = transcode_result_t();
+}
+
+
+/** \brief Get the number of bytes read so far.
+ *
+ * This function returns the number of bytes of the stream that were
+ * read, including the pending bytes.
+ *
+ * \return The current offset in the stream.
+ */
+std::size_t utf8_decoder::offset() const
+{
+    return f_offset;
+}
+
+
+/** \brief Get the number of pending bytes.
+ *
+ * This function returns the number of bytes of an incomplete character
+ * kept by the decoder (0 to 3).
+ *
+ * \return The number of pending bytes.
+ */
+std::size_t utf8_decoder::pending() const
+{
+    return f_pending_size;
+}
+
+
+/** \brief Save the error returned by the following calls to feed().
+ *
+ * Once an invalid sequence was found, feed() returns that error without
+ * reading its input. Only the status and the position are kept: the
+ * counters are reset so callers see that nothing was read nor written.
+ *
+ * \param[in] result  The result of the call which found the error.
+ */
+void utf8_decoder::save_error(transcode_result_t const & result)
+{
+    f_error = result;
+    f_error.f_read = 0;
+    f_error.f_written = 0;
+}
+
+
+template<typename OutputT>
+transcode_result_t utf8_decoder::feed_buffer(char const * str, std::size_t len, OutputT * out, std::size_t out_cap)
+{
+    if(!f_error.ok())
+    {
+        return f_error;
+    }
+
+    transcode_result_t result;
+    if(f_pending_size > 0)
+    {
+        // complete the character started in a previous chunk
+        //
+        std::size_t const missing(std::min(sequence_size(f_pending[0]) - f_pending_size, len));
+        char seq[4];
+        std::memcpy(seq, f_pending, f_pending_size);
+        if(missing > 0)
+        {
+            // str may be nullptr when len is 0
+            //
+            std::memcpy(seq + f_pending_size, str, missing);
+        }
+        OutputT units[2];
+        transcode_result_t const r(convert_utf8(std::string_view(seq, f_pending_size + missing), units, 2));
+        switch(r.f_status)
+        {
+        case transcode_status_t::TRANSCODE_STATUS_SUCCESS:
+            if(out_cap < r.f_written)
+            {
+                result.f_status = transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL;
+                result.f_error_position = f_offset - f_pending_size;
+                return result;
+            }
+            std::copy(units, units + r.f_written, out);
+            result.f_read = missing;
+            result.f_written = r.f_written;
+            f_offset += missing;
+            f_pending_size = 0;
+            break;
+
+        case transcode_status_t::TRANSCODE_STATUS_TRUNCATED:
+            // the chunk is too small to complete the character
+            //
+            if(missing > 0)
+            {
+                std::memcpy(f_pending + f_pending_size, str, missing);
+            }
+            f_pending_size += missing;
+            f_offset += missing;
+            result.f_read = missing;
+            result.f_error_position = f_offset - f_pending_size;
+            return result;
+
+        default:
+            result.f_status = transcode_status_t::TRANSCODE_STATUS_INVALID;
+            result.f_error_position = f_offset - f_pending_size;
+            f_pending_size = 0;
+            save_error(result);
+            return result;
+
+        }
+    }
+
+    transcode_result_t const r(convert_utf8(
+              std::string_view(str + result.f_read, len - result.f_read)
+            , out + result.f_written
+            , out_cap - result.f_written));
+    result.f_status = r.f_status;
+    result.f_read += r.f_read;
+    result.f_written += r.f_written;
+    f_offset += r.f_read;
+    result.f_error_position = f_offset;
+
+    switch(r.f_status)
+    {
+    case transcode_status_t::TRANSCODE_STATUS_TRUNCATED:
+        // keep the start of the last character for the next chunk
+        //
+        f_pending_size = len - result.f_read;
+        std::memcpy(f_pending, str + result.f_read, f_pending_size);
+        f_offset += f_pending_size;
+        result.f_read = len;
+        result.f_status = transcode_status_t::TRANSCODE_STATUS_SUCCESS;
+        break;
+
+    case transcode_status_t::TRANSCODE_STATUS_INVALID:
+        save_error(result);
+        break;
+
+    default:
+        break;
+
+    }
+
+    return result;
+}
+
+
+template<typename OutputT>
+transcode_result_t utf8_decoder::feed_string(char const * str, std::size_t len, std::basic_string<OutputT> & out)
+{
+    // each byte generates at most one code unit, a 4 byte character
+    // generates 2 UTF-16 code units, and a pending character adds one
+    // more unit
+    //
+    std::size_t const size(out.length());
+    out.resize(size + len + 1);
+    transcode_result_t const result(feed_buffer(str, len, out.data() + size, len + 1));
+    out.resize(size + result.f_written);
+    return result;
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,74 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the incremental UTF-8 decoder.
+ *
+ * The utf8_decoder class decodes a stream of UTF-8 received in chunks
+ * (i.e. from a socket or a pipe). A character cut at the end of a chunk
+ * is kept in the decoder and completed with the next chunk.
+ */
+
+// self
+//
+#include    <libutf8/transcode.h>
+
+
+// C++
+//
+#include    <string>
+
+
+
+namespace libutf8
+{
+
+
+
+class utf8_decoder
+{
+public:
+    transcode_result_t          feed(char const * str, std::size_t len, char16_t * out, std::size_t out_cap);
+    transcode_result_t          feed(char const * str, std::size_t len, char32_t * out, std::size_t out_cap);
+    transcode_result_t          feed(char const * str, std::size_t len, std::u16string & out);
+    transcode_result_t          feed(char const * str, std::size_t len, std::u32string & out);
+    transcode_result_t          finish();
+    void                        reset();
+
+    std::size_t                 offset() const;
+    std::size_t                 pending() const;
+
+private:
+    void                        save_error(transcode_result_t const & result);
+    template<typename OutputT>
+    transcode_result_t          feed_buffer(char const * str, std::size_t len, OutputT * out, std::size_t out_cap);
+    template<typename OutputT>
+    transcode_result_t          feed_string(char const * str, std::size_t len, std::basic_string<OutputT> & out);
+
+    std::size_t                 f_offset = 0;
+    char                        f_pending[4] = {};
+    std::size_t                 f_pending_size = 0;
+    transcode_result_t          f_error = transcode_result_t();
+};
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
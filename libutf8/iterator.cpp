@@ -237,62 +237,30 @@ bool operator != (std::string::const_iterator it, utf8_iterator const & rhs)
 
 void utf8_iterator::increment()
 {
-    auto skip = [&]()
-    {
-        for(unsigned char b(0)
-            ; f_pos < f_str->length()
-                && (b = static_cast<unsigned char>(f_str[0][f_pos]),
-                            (b >= 0x80 && b <= 0xBF) || b >= 0xF5)
-            ; ++f_pos);
-        f_good = false;
-    };
-
     if(f_pos >= f_str->length())
     {
         return;
     }
 
-    // increment is easy we can just get the current character and we know
-    // the size of the character in UTF-8
+    // ASCII is the most common case, avoid the function call
     //
-    unsigned char c(static_cast<unsigned char>(f_str[0][f_pos]));
-
-    if(c < 0x80)
+    if(static_cast<unsigned char>(f_str[0][f_pos]) < 0x80)
     {
         ++f_pos;
+        return;
     }
-    else if(c <= 0xBF || c >= 0xF5)
-    {
-        // ?! invalid UTF-8 ?!
-        //
-        skip();
-    }
-    else if(c >= 0xF0)
-    {
-        f_pos += 4;
-        if(c == 0xF4 && f_pos - 3 < f_str->length())
-        {
-            c = static_cast<unsigned char>(f_str[0][f_pos - 3]);
-            if(c >= 0x90)
-            {
-                f_pos -= 3;
-                skip();
-            }
-        }
-    }
-    else if(c >= 0xE0)
-    {
-        f_pos += 3;
-    }
-    else /*if(c >= 0xC0)*/    // always true so we don't have to check
-    {
-        f_pos += 2;
-    }
-    if(f_pos > f_str->length())
+
+    // use the same decoder as operator * () so the iterator skips
+    // exactly the bytes of an invalid sequence
+    //
+    char const * s(f_str->c_str() + f_pos);
+    std::size_t len(f_str->length() - f_pos);
+    char32_t wc(U'\0');
+    if(mbstowc(wc, s, len) < 0)
     {
-        f_pos = f_str->length();
         f_good = false;
     }
+    f_pos = f_str->length() - len;
 }
 
 
@@ -374,6 +342,53 @@ utf8_iterator::difference_type operator - (std::string::const_iterator it, utf8_
 }
 
 
+/** \brief Move the iterator by \p n characters.
+ *
+ * This function has the same effect as `++it` repeated \p n times (or
+ * `--it` repeated -\p n times when \p n is negative) but it moves
+ * forward using the SIMD kernels: byte_offset_of() finds the position
+ * of the character and is_valid_utf8() makes sure the characters
+ * skipped that way are the ones the increment would have skipped. If
+ * that part of the string is not valid, the function falls back to
+ * one increment per character so the good flag gets updated as
+ * expected.
+ *
+ * The function is found by argument dependent lookup:
+ *
+ * \code
+ *     libutf8::utf8_iterator it(str);
+ *     advance(it, 1000);
+ * \endcode
+ *
+ * \param[in,out] it  The iterator to move.
+ * \param[in] n  The number of characters to move by.
+ */
+void advance(utf8_iterator & it, utf8_iterator::difference_type n)
+{
+    if(n < 0)
+    {
+        for(; n < 0 && it.f_pos > 0; ++n)
+        {
+            it.decrement();
+        }
+        return;
+    }
+
+    std::string_view const str(std::string_view(*it.f_str).substr(it.f_pos));
+    std::size_t const offset(byte_offset_of(str, n));
+    if(is_valid_utf8(str.substr(0, offset)))
+    {
+        it.f_pos += offset;
+        return;
+    }
+
+    for(; n > 0; --n)
+    {
+        it.increment();
+    }
+}
+
+
 /** \brief Restart  the iterator.
  *
  * The iterator started at 0 or the end of the string, then you moved it
@@ -25,9 +25,19 @@
  * functions used to convert a string from one format to another.
  */
 
+// self
+//
+#include    <libutf8/base.h>
+#include    <libutf8/libutf8.h>
+
+
 // C++
 //
+#include    <cstdio>
+#include    <iterator>
 #include    <string>
+#include    <string_view>
+#include    <type_traits>
 
 
 
@@ -69,6 +79,7 @@ public:
     difference_type             operator - (utf8_iterator const & rhs) const;
     difference_type             operator - (std::string::const_iterator it) const;
     friend difference_type      operator - (std::string::const_iterator it, utf8_iterator const & rhs);
+    friend void                 advance(utf8_iterator & it, difference_type n);
 
     void                        rewind();
     void                        clear();
@@ -87,5 +98,309 @@ private:
 
 
 
+/** \brief An inline Unicode iterator over a contiguous buffer.
+ *
+ * This iterator walks the characters of any contiguous buffer of UTF-8
+ * (`char`), UTF-16 (`char16_t`), or UTF-32 (`char32_t`) code units: an
+ * std::basic_string_view, the data of an std::vector or std::span, or
+ * raw pointers. Contrary to the utf8_iterator, it is entirely defined
+ * inline and decodes each character once: the character and its size
+ * get cached when the iterator moves to a new position, so the
+ * dereference is just a read and the increment a pointer addition.
+ *
+ * At the end of the buffer, the dereference returns libutf8::EOS. An
+ * invalid sequence returns libutf8::NOT_A_CHARACTER and is skipped in
+ * one increment. In UTF-8, the bytes skipped are the same as with
+ * mbstowc(). In UTF-16, a lone surrogate is skipped. In UTF-32,
+ * surrogates and values over 0x10FFFF are skipped. The good() flag gets
+ * set to false when the iterator moves to an invalid sequence.
+ *
+ * \code
+ *     libutf8::utf8_view_iterator it(str);
+ *     libutf8::utf8_view_iterator const end(str, true);
+ *     for(; it != end; ++it)
+ *     {
+ *         f(*it);
+ *     }
+ *     if(it.bad())
+ *     {
+ *         // str included invalid sequences
+ *     }
+ * \endcode
+ *
+ * \tparam CharT  The type of the code units.
+ */
+template<typename CharT>
+class basic_view_iterator
+{
+public:
+    static_assert(std::is_same_v<CharT, char>
+               || std::is_same_v<CharT, char16_t>
+               || std::is_same_v<CharT, char32_t>
+                , "basic_view_iterator only supports char, char16_t, and char32_t");
+
+    // Iterator traits
+    //
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef char32_t                        value_type;
+    typedef std::ptrdiff_t                  difference_type;
+    typedef char32_t const *                pointer;
+    typedef char32_t                        reference;
+
+    constexpr                   basic_view_iterator() noexcept = default;
+
+    constexpr                   basic_view_iterator(CharT const * begin, CharT const * end, CharT const * pos) noexcept
+                                    : f_begin(begin)
+                                    , f_end(end)
+                                    , f_pos(pos)
+                                {
+                                    decode();
+                                }
+
+    constexpr                   basic_view_iterator(std::basic_string_view<CharT> str, bool end = false) noexcept
+                                    : basic_view_iterator(
+                                              str.data()
+                                            , str.data() + str.length()
+                                            , str.data() + (end ? str.length() : 0))
+                                {
+                                }
+
+    constexpr basic_view_iterator &
+                                operator ++ () noexcept
+                                {
+                                    f_pos += f_size;
+                                    decode();
+                                    return *this;
+                                }
+
+    constexpr basic_view_iterator
+                                operator ++ (int) noexcept
+                                {
+                                    basic_view_iterator it(*this);
+                                    ++*this;
+                                    return it;
+                                }
+
+    /** \brief Move to the previous character.
+     *
+     * The iterator moves back to the position where the previous
+     * increment started, so `--` undoes `++` even over invalid
+     * sequences. In UTF-8, the bytes 0x00 to 0x7F and 0xC0 to 0xF4
+     * always start a character or an invalid sequence, so the iterator
+     * backs up to the nearest one of those bytes and walks forward from
+     * there as `++` does. In UTF-16, it backs up over a surrogate pair
+     * or one code unit.
+     */
+    constexpr basic_view_iterator &
+                                operator -- () noexcept
+                                {
+                                    if constexpr(std::is_same_v<CharT, char>)
+                                    {
+                                        if(f_pos > f_begin)
+                                        {
+                                            CharT const * const pos(f_pos);
+                                            CharT const * s(f_pos - 1);
+                                            while(s > f_begin
+                                               && ((static_cast<unsigned char>(*s) >= 0x80 && static_cast<unsigned char>(*s) <= 0xBF)
+                                                        || static_cast<unsigned char>(*s) >= 0xF5))
+                                            {
+                                                --s;
+                                            }
+                                            for(;;)
+                                            {
+                                                std::size_t const size(step_size(s, f_end - s));
+                                                if(s + size >= pos)
+                                                {
+                                                    break;
+                                                }
+                                                s += size;
+                                            }
+                                            f_pos = s;
+                                        }
+                                    }
+                                    else if(f_pos > f_begin)
+                                    {
+                                        --f_pos;
+                                        if constexpr(std::is_same_v<CharT, char16_t>)
+                                        {
+                                            if(f_pos > f_begin
+                                            && (f_pos[0] & 0xFC00) == 0xDC00
+                                            && (f_pos[-1] & 0xFC00) == 0xD800)
+                                            {
+                                                --f_pos;
+                                            }
+                                        }
+                                    }
+                                    decode();
+                                    return *this;
+                                }
+
+    constexpr basic_view_iterator
+                                operator -- (int) noexcept
+                                {
+                                    basic_view_iterator it(*this);
+                                    --*this;
+                                    return it;
+                                }
+
+    constexpr reference         operator * () const noexcept { return f_char; }
+    constexpr bool              operator == (basic_view_iterator const & rhs) const noexcept { return f_pos == rhs.f_pos; }
+    constexpr bool              operator != (basic_view_iterator const & rhs) const noexcept { return f_pos != rhs.f_pos; }
+    constexpr difference_type   operator - (basic_view_iterator const & rhs) const noexcept { return f_pos - rhs.f_pos; }
+
+    /** \brief Move the iterator by \p n characters.
+     *
+     * This function has the same effect as `++it` repeated \p n times
+     * (or `--it` repeated -\p n times) and is found by argument
+     * dependent lookup. In UTF-8, the iterator moves forward using
+     * byte_offset_of() as long as is_valid_utf8() says the characters
+     * skipped are valid, otherwise it increments one character at a
+     * time.
+     */
+    friend void                 advance(basic_view_iterator & it, difference_type n)
+                                {
+                                    if constexpr(std::is_same_v<CharT, char>)
+                                    {
+                                        if(n > 0)
+                                        {
+                                            std::string_view const str(it.f_pos, it.f_end - it.f_pos);
+                                            std::size_t const offset(byte_offset_of(str, n));
+                                            if(is_valid_utf8(str.substr(0, offset)))
+                                            {
+                                                it.f_pos += offset;
+                                                it.decode();
+                                                return;
+                                            }
+                                        }
+                                    }
+
+                                    for(; n > 0 && it.f_pos != it.f_end; --n)
+                                    {
+                                        ++it;
+                                    }
+                                    for(; n < 0 && it.f_pos != it.f_begin; ++n)
+                                    {
+                                        --it;
+                                    }
+                                }
+
+    constexpr CharT const *     base() const noexcept { return f_pos; }
+    constexpr std::size_t       position() const noexcept { return f_pos - f_begin; }
+    constexpr std::size_t       size() const noexcept { return f_size; }
+    constexpr bool              at_end() const noexcept { return f_pos == f_end; }
+    constexpr void              clear() noexcept { f_good = true; }
+    constexpr bool              good() const noexcept { return f_good; }
+    constexpr bool              bad() const noexcept { return !f_good; }
+
+private:
+    static constexpr std::size_t
+                                step_size(char const * s, std::size_t len) noexcept
+                                {
+                                    if(static_cast<unsigned char>(*s) < 0x80)
+                                    {
+                                        return 1;
+                                    }
+                                    char32_t wc(U'\0');
+                                    int const r(decode_utf8_char(wc, s, len));
+                                    if(r > 0)
+                                    {
+                                        return static_cast<std::size_t>(r);
+                                    }
+                                    return utf8_invalid_length(s, len);
+                                }
+
+    constexpr void              decode() noexcept
+                                {
+                                    std::size_t const len(f_end - f_pos);
+                                    if(len == 0)
+                                    {
+                                        f_char = EOS;
+                                        f_size = 0;
+                                        return;
+                                    }
+
+                                    if constexpr(std::is_same_v<CharT, char>)
+                                    {
+                                        // ASCII is the most common case
+                                        //
+                                        if(static_cast<unsigned char>(*f_pos) < 0x80)
+                                        {
+                                            f_char = static_cast<unsigned char>(*f_pos);
+                                            f_size = 1;
+                                            return;
+                                        }
+
+                                        int const r(decode_utf8_char(f_char, f_pos, len));
+                                        if(r > 0)
+                                        {
+                                            f_size = static_cast<std::size_t>(r);
+                                            return;
+                                        }
+                                        f_size = utf8_invalid_length(f_pos, len);
+                                    }
+                                    else if constexpr(std::is_same_v<CharT, char16_t>)
+                                    {
+                                        char16_t const c(*f_pos);
+                                        f_size = 1;
+                                        if((c & 0xF800) != 0xD800)
+                                        {
+                                            f_char = c;
+                                            return;
+                                        }
+                                        if((c & 0xFC00) == 0xD800
+                                        && len >= 2
+                                        && (f_pos[1] & 0xFC00) == 0xDC00)
+                                        {
+                                            f_char = (((c & 0x03FF) << 10) | (f_pos[1] & 0x03FF)) + 0x10000;
+                                            f_size = 2;
+                                            return;
+                                        }
+                                    }
+                                    else
+                                    {
+                                        char32_t const c(*f_pos);
+                                        f_size = 1;
+                                        if(c < 0xD800 || (c > 0xDFFF && c < 0x110000))
+                                        {
+                                            f_char = c;
+                                            return;
+                                        }
+                                    }
+
+                                    f_char = NOT_A_CHARACTER;
+                                    f_good = false;
+                                }
+
+    CharT const *               f_begin = nullptr;
+    CharT const *               f_end = nullptr;
+    CharT const *               f_pos = nullptr;
+    char32_t                    f_char = EOS;
+    std::size_t                 f_size = 0;
+    bool                        f_good = true;
+};
+
+
+typedef basic_view_iterator<char>       utf8_view_iterator;
+typedef basic_view_iterator<char16_t>   utf16_view_iterator;
+typedef basic_view_iterator<char32_t>   utf32_view_iterator;
+
+
+
 } // libutf8 namespace
+
+
+
+#ifdef __cpp_lib_ranges
+/** \brief The difference of two view iterators is not a character count.
+ *
+ * The `-` operator of the basic_view_iterator returns a number of code
+ * units, so the iterators must not be viewed as sized sentinels by the
+ * std::ranges algorithms (i.e. std::ranges::distance() has to count the
+ * characters).
+ */
+template<typename CharT>
+inline constexpr bool std::disable_sized_sentinel_for<
+          libutf8::basic_view_iterator<CharT>
+        , libutf8::basic_view_iterator<CharT>> = true;
+#endif
 // vim: ts=4 sw=4 et
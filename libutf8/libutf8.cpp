@@ -42,6 +42,8 @@
 
 #include    "libutf8/base.h"
 #include    "libutf8/exception.h"
+#include    "libutf8/simd_kernels.h"
+#include    "libutf8/transcode.h"
 
 
 // snapdev
@@ -51,6 +53,8 @@
 
 // C++
 //
+#include    <algorithm>
+#include    <cstring>
 #include    <cwctype>
 
 
@@ -115,34 +119,57 @@ bool is_valid_ascii(char c, bool ctrl)
  */
 bool is_valid_ascii(char const *str, bool ctrl)
 {
-    if(str != nullptr)
+    if(str == nullptr)
     {
-        for(; *str != '\0'; ++str)
-        {
-            if(!is_valid_ascii(*str, ctrl))
-            {
-                return false;
-            }
-        }
+        return true;
     }
 
-    return true;
+    return is_valid_ascii(std::string_view(str), ctrl);
 }
 
 
 /** \brief Validate a string as ASCII characters.
  *
- * This function is an overload which accepts an std::string as input.
+ * This function is an overload which accepts an std::string_view as input.
+ *
+ * The string is checked up to its length. A NUL character (`'\0'`) is
+ * viewed as a control character, not as the end of the string.
  *
  * \param[in] str  The string to be validated.
  * \param[in] ctrl  Set to true to also accept controls.
  *
- * \return true if the string is empty, nullptr, or only includes ASCII
- *         characters.
+ * \return true if the string is empty or only includes ASCII characters.
+ */
+bool is_valid_ascii(std::string_view str, bool ctrl)
+{
+    return detail::kernels().f_validate_ascii(str.data(), str.length(), ctrl) == str.length();
+}
+
+
+/** \brief Get the length of the ASCII run at the start of a string.
+ *
+ * This function returns the offset of the first byte which is not ASCII
+ * (0x80 to 0xFF) in \p str. If the whole string is ASCII, then the function
+ * returns the length of \p str.
+ *
+ * Controls, including the NUL character, are viewed as ASCII.
+ *
+ * This is useful to copy or skip the ASCII part of a string in bulk
+ * before decoding the rest one character at a time:
+ *
+ * \code
+ *     std::size_t const ascii(libutf8::ascii_prefix_length(str));
+ *     result.append(str.data(), ascii);
+ *     ...decode str.substr(ascii)...
+ * \endcode
+ *
+ * \param[in] str  The string to check.
+ *
+ * \return The number of ASCII bytes at the start of \p str.
  */
-bool is_valid_ascii(std::string const & str, bool ctrl)
+std::size_t ascii_prefix_length(std::string_view str)
 {
-    return is_valid_ascii(str.c_str(), ctrl);
+    return detail::kernels().f_validate_ascii(str.data(), str.length(), true);
 }
 
 
@@ -195,6 +222,14 @@ bool is_valid_ascii(std::string const & str, bool ctrl)
  * for the UTF-8 representation of a QString should always be considered
  * valid UTF-8 (although some surrogates, etc. may be wrong!)
  *
+ * \note
+ * The actual validation is done by the best kernel available on the
+ * running CPU (SSE4.2, AVX2, or AVX-512 on x86). These kernels classify
+ * the high and low nibbles of each byte and of the byte before it with
+ * lookup tables and check blocks of 64 bytes at once. Blocks of ASCII
+ * characters are skipped with a single test. When no SIMD instructions
+ * are available, each byte gets checked one at a time.
+ *
  * \param[in] string  The NUL terminated string to scan.
  *
  * \return true if the string is valid UTF-8
@@ -207,66 +242,8 @@ bool is_valid_utf8(char const * str)
         return true;
     }
 
-    // use unsigned characters so it works even if char is signed
-    unsigned char const *s(reinterpret_cast<unsigned char const *>(str));
-    while(*s != '\0')
-    {
-        if(s[0] <= 0x7F)
-        {
-            ++s;
-        }
-        else if(s[0] >= 0xC2 && s[0] <= 0xDF // non-overlong 2-byte
-             && s[1] >= 0x80 && s[1] <= 0xBF)
-        {
-            s += 2;
-        }
-        else if(s[0] == 0xE0 // excluding overlongs
-             && s[1] >= 0xA0 && s[1] <= 0xBF
-             && s[2] >= 0x80 && s[2] <= 0xBF)
-        {
-            s += 3;
-        }
-        else if(((0xE1 <= s[0] && s[0] <= 0xEC) || s[0] == 0xEE || s[0] == 0xEF) // straight 3-byte
-             && s[1] >= 0x80 && s[1] <= 0xBF
-             && s[2] >= 0x80 && s[2] <= 0xBF)
-        {
-            s += 3;
-        }
-        else if(s[0] == 0xED // excluding surrogates
-             && s[1] >= 0x80 && s[1] <= 0x9F
-             && s[2] >= 0x80 && s[2] <= 0xBF)
-        {
-            s += 3;
-        }
-        else if(s[0] == 0xF0 // planes 1-3
-             && s[1] >= 0x90 && s[1] <= 0xBF
-             && s[2] >= 0x80 && s[2] <= 0xBF
-             && s[3] >= 0x80 && s[3] <= 0xBF)
-        {
-            s += 4;
-        }
-        else if(s[0] >= 0xF1 && s[0] <= 0xF3 // planes 4-15
-             && s[1] >= 0x80 && s[1] <= 0xBF
-             && s[2] >= 0x80 && s[2] <= 0xBF
-             && s[3] >= 0x80 && s[3] <= 0xBF)
-        {
-            s += 4;
-        }
-        else if(s[0] == 0xF4 // plane 16
-             && s[1] >= 0x80 && s[1] <= 0x8F
-             && s[2] >= 0x80 && s[2] <= 0xBF
-             && s[3] >= 0x80 && s[3] <= 0xBF)
-        {
-            s += 4;
-        }
-        else
-        {
-            // not a supported character
-            return false;
-        }
-    }
-
-    return true;
+    std::size_t const len(strlen(str));
+    return detail::kernels().f_validate_utf8(str, len) == len;
 }
 
 
@@ -287,94 +264,35 @@ bool is_valid_utf8(char const * str)
  * finds a low surrogate without a high first, or if a high surrogate
  * is not followed by a low surrogate, then the function fails.
  *
- * \param[in] string  The UTF-16 string to scan.
+ * The string is checked up to its length. A NUL character (`u'\0'`) is
+ * valid and does not end the string.
+ *
+ * \param[in] str  The UTF-16 string to scan.
  *
  * \return true if the string is valid UTF-16.
  */
-bool is_valid_utf16(std::u16string const & str)
+bool is_valid_utf16(std::u16string_view str)
 {
-    for(std::u16string::value_type const * s(str.c_str());
-        *s != L'\0';
-        ++s)
-    {
-        surrogate_t const high_surrogate(is_surrogate(*s));
-        if(high_surrogate == surrogate_t::SURROGATE_LOW)
-        {
-            // missing HIGH surrogate before LOW surrogate
-            //
-            return false;
-        }
-        if(high_surrogate == surrogate_t::SURROGATE_HIGH)
-        {
-            ++s;
-            if(*s == L'\0')
-            {
-                // missing LOW surrogate after HIGH surrogate
-                //
-                return false;
-            }
-            surrogate_t const low_surrogate(is_surrogate(*s));
-            if(low_surrogate != surrogate_t::SURROGATE_LOW)
-            {
-                // missing LOW surrogate after HIGH surrogate
-                //
-                return false;
-            }
-        }
-    }
-    return true;
+    return detail::kernels().f_validate_utf16(str.data(), str.length()) == str.length();
 }
 
 
 /** \brief Check whether a string is valid UTF-8 or not.
  *
  * This function is an overload of the is_valid_utf8(char const *) with
- * an std::string.
- *
- * \param[in] str  The std::string to scan.
- *
- * \return true if the string is valid UTF-8
- */
-bool is_valid_utf8(std::string const & str)
-{
-    return is_valid_utf8(str.c_str());
-}
-
-
-/** \brief Validate a Unicode character.
- *
- * This function checks the specified character. If it looks like a valid
- * Unicode character, the function returns true.
- *
- * Valid characters are between 0 and 0x10FFFF inclusive. However, the
- * code points between 0xD800 and 0xDFFF are considered invalid. They
- * are not supported in UTF-32.
+ * an std::string_view. This allows you to check a slice of a larger
+ * buffer without first copying it in an std::string.
  *
- * When the \p ctrl flag is set to false, then control characters are not
- * included so code points 0x00 to 0x1F and 0x7F to 0x9F are considered
- * invalid even those they are valid UTF-32 code points.
+ * The string is checked up to its length. A NUL character (`'\0'`) is
+ * valid UTF-8 and does not end the string.
  *
- * \note
- * Many code pointers are not yet defined in Unicode. If you want to
- * test the code point itself, use the get_unicode_character() function
- * and use the unicode_character::is_defined() function instead.
- *
- * \param[in] wc  The character to validate.
- * \param[in] ctrl  Whether the character can be a control or not.
+ * \param[in] str  The std::string_view to scan.
  *
- * \return true if wc is considered valid.
+ * \return true if the string is valid UTF-8
  */
-bool is_valid_unicode(char32_t wc, bool ctrl)
+bool is_valid_utf8(std::string_view str)
 {
-    if(ctrl)
-    {
-        return wc < 0x110000 && (wc < 0x00D800 || wc > 0x00DFFF);
-    }
-
-    return  wc <  0x110000
-        &&  wc >= 0x000020
-        && (wc <  0x00007F || wc > 0x00009F)
-        && (wc <  0x00D800 || wc > 0x00DFFF);
+    return detail::kernels().f_validate_utf8(str.data(), str.length()) == str.length();
 }
 
 
@@ -399,63 +317,32 @@ bool is_valid_unicode(char32_t wc, bool ctrl)
  */
 bool is_valid_unicode(char32_t const *str, bool ctrl)
 {
-    if(str != nullptr)
+    if(str == nullptr)
     {
-        for(; *str != '\0'; ++str)
-        {
-            if(!is_valid_unicode(*str, ctrl))
-            {
-                return false;
-            }
-        }
+        return true;
     }
 
-    return true;
+    return is_valid_unicode(std::u32string_view(str), ctrl);
 }
 
 
-/** \brief Validate a string as ASCII characters.
+/** \brief Validate a string as Unicode characters.
+ *
+ * This function is an overload which accepts an std::u32string_view as
+ * input.
  *
- * This function is an overload which accepts an std::u32string as input.
+ * The string is checked up to its length. A NUL character (`U'\0'`) is
+ * viewed as a control character, not as the end of the string.
  *
  * \param[in] str  The string to be validated.
  * \param[in] ctrl  Set to true to also accept controls.
  *
- * \return true if the string is empty, nullptr, or only includes ASCII
+ * \return true if the string is empty or only includes valid Unicode
  *         characters.
  */
-bool is_valid_unicode(std::u32string const & str, bool ctrl)
-{
-    return is_valid_unicode(str.c_str(), ctrl);
-}
-
-
-/** \brief Check whether a wide character represents a surrogate or not.
- *
- * This function checks whether \p wc represents a surrogate, either
- * the low, the high or not a surrogate. The function returns a
- * surrogate_t enumeration:
- *
- * \li SURROGATE_NO -- not a surrogate
- * \li SURROGATE_HIGH -- a high surrogate (0xD800 to 0xDBFF)
- * \li SURROGATE_LOW -- a low surrogate (0xDC00 to 0xDFFF)
- *
- * \param[in] wc  The wide character to be checked.
- *
- * \return The surrogate category.
- */
-surrogate_t is_surrogate(char32_t wc)
+bool is_valid_unicode(std::u32string_view str, bool ctrl)
 {
-    wc &= 0xFFFFFC00;
-    if(wc == 0xD800)
-    {
-        return surrogate_t::SURROGATE_HIGH;
-    }
-    if(wc == 0xDC00)
-    {
-        return surrogate_t::SURROGATE_LOW;
-    }
-    return surrogate_t::SURROGATE_NO;
+    return detail::kernels().f_validate_utf32(str.data(), str.length(), ctrl) == str.length();
 }
 
 
@@ -548,53 +435,155 @@ bom_t start_with_bom(char const * str, size_t len)
 }
 
 
-/** \brief Converts a UTF-32 string to a UTF-8 string.
- *
- * This function converts a UTF-32 character string (char32_t) to a
- * UTF-8 string.
- *
- * \note
- * The input string may include '\0' characters.
+namespace
+{
+
+
+
+/** \brief Get the BOM bytes of an encoding.
  *
- * \exception libutf8_exception_encoding
- * The input character must be a valid UTF-32 character or this exception
- * gets raised.
+ * This function returns the bytes of the BOM of \p encoding so the
+ * decoder can check whether the buffer starts with it.
+ */
+std::string_view bom_bytes(bom_t encoding)
+{
+    switch(encoding)
+    {
+    case bom_t::BOM_UTF8:
+        return std::string_view("\xEF\xBB\xBF", 3);
+
+    case bom_t::BOM_UTF16_LE:
+        return std::string_view("\xFF\xFE", 2);
+
+    case bom_t::BOM_UTF16_BE:
+        return std::string_view("\xFE\xFF", 2);
+
+    case bom_t::BOM_UTF32_LE:
+        return std::string_view("\xFF\xFE\x00\x00", 4);
+
+    case bom_t::BOM_UTF32_BE:
+        return std::string_view("\x00\x00\xFE\xFF", 4);
+
+    default:
+        return std::string_view();
+
+    }
+}
+
+
+transcode_result_t convert_to_utf8(std::u16string_view in, char * out, std::size_t out_cap)
+{
+    return convert_utf16_to_utf8(in, out, out_cap);
+}
+
+
+transcode_result_t convert_to_utf8(std::u32string_view in, char * out, std::size_t out_cap)
+{
+    return convert_utf32_to_utf8(in, out, out_cap);
+}
+
+
+std::size_t utf8_length_from_units(std::u16string_view in)
+{
+    return utf8_length_from_utf16(in);
+}
+
+
+std::size_t utf8_length_from_units(std::u32string_view in)
+{
+    return utf8_length_from_utf32(in);
+}
+
+
+void load_units(char const * in, std::size_t count, char16_t * out, bool swap)
+{
+    if(swap)
+    {
+        detail::kernels().f_swap_bytes16(in, count, out);
+    }
+    else
+    {
+        std::memcpy(out, in, count * sizeof(char16_t));
+    }
+}
+
+
+void load_units(char const * in, std::size_t count, char32_t * out, bool swap)
+{
+    if(swap)
+    {
+        detail::kernels().f_swap_bytes32(in, count, out);
+    }
+    else
+    {
+        std::memcpy(out, in, count * sizeof(char32_t));
+    }
+}
+
+
+/** \brief Convert a buffer of UTF-16 or UTF-32 code units to UTF-8.
  *
- * \param[in] str  The wide character string to convert to UTF-8.
+ * The code units are loaded (and byte swapped if necessary) one block
+ * at a time in an aligned buffer and converted to UTF-8 right away so
+ * the input is only read once. A surrogate pair cut by the end of a
+ * block is moved to the start of the next block.
  *
- * \return The converted string.
+ * The \p offset parameter is the number of bytes of the caller's buffer
+ * found before \p data (i.e. the size of the BOM) so the errors report
+ * positions and sizes of the caller's buffer.
  */
-std::string to_u8string(std::u32string const & str)
+template<typename CharT>
+std::string decode_units(char const * data, std::size_t len, bool swap, std::size_t offset)
 {
-    std::string result;
+    if(len % sizeof(CharT) != 0)
+    {
+        throw libutf8_exception_decoding(
+                  "decode_bytes(): the input size ("
+                + std::to_string(offset + len)
+                + ") is not a multiple of "
+                + std::to_string(sizeof(CharT))
+                + ".");
+    }
 
-    char mb[MBS_MIN_BUFFER_LENGTH];
-    std::u32string::size_type const max(str.length());
-    result.reserve(max * 2);  // TODO: calculate correct resulting string size?
-    std::u32string::value_type const * s(str.c_str());
-    for(std::u32string::size_type idx(0); idx < max; ++idx)
+    std::string result;
+    std::size_t const count(len / sizeof(CharT));
+    CharT units[1024];
+    std::size_t pending(0);
+    for(std::size_t pos(0); pos < count;)
     {
-        std::u32string::value_type const wc(s[idx]);
-        if(wc < 0x80)
+        std::size_t const size(std::min(std::size(units) - pending, count - pos));
+        load_units(data + pos * sizeof(CharT), size, units + pending, swap);
+        pos += size;
+
+        // the block is in the L1 cache, computing the exact size of
+        // the output is cheap compared to over-allocating
+        //
+        std::basic_string_view<CharT> const block(units, pending + size);
+        std::size_t const available(block.length());
+        std::size_t const length(utf8_length_from_units(block));
+        std::size_t const start(result.length());
+        result.resize(start + length);
+        transcode_result_t const r(convert_to_utf8(
+                  block
+                , result.data() + start
+                , length));
+        result.resize(start + r.f_written);
+
+        pending = 0;
+        if(r.f_status == transcode_status_t::TRANSCODE_STATUS_TRUNCATED
+        && pos < count)
         {
-            // using the `mb` string below would not work for '\0'
-            // (i.e. mb would look like an empty string)
-            //
-            // and since all code bytes below 0x80 can be copied as
-            // is we do that here (much faster 99% of the time!)
-            //
-            result += static_cast<std::string::value_type>(wc);
+            pending = available - r.f_read;
+            std::copy(units + r.f_read, units + available, units);
         }
-        else
+        else if(!r.ok())
         {
-            if(wctombs(mb, wc, sizeof(mb)) < 0)
-            {
-                throw libutf8_exception_encoding(
-                          "to_u8string(u32string): the input wide character with code "
-                        + std::to_string(static_cast<std::uint32_t>(wc))
-                        + " is not a valid UTF-32 character.");
-            }
-            result += mb;
+            throw libutf8_exception_decoding(
+                      "decode_bytes(): the input includes an invalid UTF-"
+                    + std::to_string(sizeof(CharT) * 8)
+                    + " character at byte "
+                    + std::to_string(offset + (pos - available + r.f_error_position) * sizeof(CharT))
+                    + ".");
         }
     }
 
@@ -602,162 +591,509 @@ std::string to_u8string(std::u32string const & str)
 }
 
 
-/** \brief Converts a UTF-16 string to a UTF-8 string.
+
+} // no name namespace
+
+
+
+/** \brief Decode a buffer of bytes to UTF-8.
  *
- * This function converts a UTF-16 string (char16_t) to a
- * UTF-8 string.
+ * This function converts a raw buffer of bytes, such as the content of a
+ * file, to a UTF-8 string. The buffer can be UTF-8, UTF-16, or UTF-32 in
+ * little or big endian. The bytes do not need to be aligned.
  *
- * \note
- * The input string may include '\0' characters.
+ * When \p hint is bom_t::BOM_NONE, the encoding is determined with
+ * start_with_bom(). A buffer without a BOM is viewed as UTF-8. Otherwise
+ * \p hint is the encoding of the buffer whether or not it starts with a
+ * BOM.
  *
- * \exception libutf8_exception_decoding
- * The input string must be a valid UTF-16 string or this exception
- * gets raised.
+ * The BOM, if present, is not included in the result. The errors give
+ * positions in \p data, BOM included.
  *
- * \exception libutf8_exception_encoding
- * This exception should not occur since all UTF-16 characters are supported
- * in UTF-8.
+ * The code units which are not in the byte order of the processor get
+ * swapped with the SIMD kernels as they are loaded. The result is
+ * allocated once per block of input and the input is read only once.
  *
- * \param[in] str  The wide character string to convert to UTF-8.
+ * \exception libutf8_exception_decoding
+ * The function raises this exception if the input is not valid in the
+ * selected encoding or if its size is not a multiple of the size of the
+ * code units.
  *
- * \return The converted string.
+ * \param[in] data  The buffer of bytes to decode.
+ * \param[in] len  The number of bytes in \p data.
+ * \param[in] hint  The encoding of \p data or bom_t::BOM_NONE.
+ *
+ * \return The UTF-8 string.
  */
-std::string to_u8string(std::u16string const & str)
+std::string decode_bytes(char const * data, std::size_t len, bom_t hint)
 {
-    std::string result;
+    bom_t const encoding(hint == bom_t::BOM_NONE
+                ? start_with_bom(data, len)
+                : hint);
+
+    std::string_view const bom(bom_bytes(encoding));
+    std::size_t offset(0);
+    if(!bom.empty()
+    && len >= bom.length()
+    && std::memcmp(data, bom.data(), bom.length()) == 0)
+    {
+        offset = bom.length();
+        data += offset;
+        len -= offset;
+    }
 
-    char mb[MBS_MIN_BUFFER_LENGTH];
-    std::u16string::size_type const max(str.length());
-    result.reserve(max * 2);  // TODO: calculate correct resulting string size?
-    std::u16string::value_type const * s(str.c_str());
-    for(std::u32string::size_type idx(0); idx < max; ++idx)
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    bool const little_endian(true);
+#else
+    bool const little_endian(false);
+#endif
+
+    switch(encoding)
     {
-        char32_t wc(static_cast<char32_t>(s[idx]));
-        if(wc < 0x80)
-        {
-            // using the `mb` string below would not work for '\0'
-            // (i.e. mb would look like an empty string)
-            //
-            // and since all code bytes below 0x80 can be copied as
-            // is we do that here (much faster 99% of the time!)
-            //
-            result += static_cast<std::string::value_type>(wc);
-        }
-        else
-        {
-            // convert the UTF-16 character in a UTF-32 character
-            //
-            surrogate_t const high_surrogate(is_surrogate(wc));
-            if(high_surrogate != surrogate_t::SURROGATE_NO)
-            {
-                // large character, verify that the two surrogates are correct
-                //
-                if(high_surrogate != surrogate_t::SURROGATE_HIGH)
-                {
-                    // 0xDC00 to 0xDFFF; introducer missing
-                    //
-                    throw libutf8_exception_decoding("to_u8string(): found a high UTF-16 surrogate without the low surrogate.");
-                }
-                ++idx;
-                if(idx >= max)
-                {
-                    // must be followed by a code between 0xDC00 and 0xDFFF
-                    //
-                    throw libutf8_exception_decoding("to_u8string(): the high UTF-16 surrogate is not followed by the low surrogate.");
-                }
-                surrogate_t const low_surrogate(is_surrogate(s[idx]));
-                if(low_surrogate != surrogate_t::SURROGATE_LOW)
-                {
-                    if(low_surrogate == surrogate_t::SURROGATE_HIGH)
-                    {
-                        throw libutf8_exception_decoding("to_u8string(): found two high UTF-16 surrogates in a row.");
-                    }
-                    else
-                    {
-                        throw libutf8_exception_decoding("to_u8string(): found a high UTF-16 surrogate without a low surrogate afterward.");
-                    }
-                }
-
-                wc = ((wc << 10)
-                   + static_cast<char32_t>(s[idx]))
-                   + (static_cast<char32_t>(0x10000)
-                   - (static_cast<char32_t>(0xD800) << 10)
-                   - static_cast<char32_t>(0xDC00));
-            }
+    case bom_t::BOM_UTF16_LE:
+        return decode_units<char16_t>(data, len, !little_endian, offset);
+
+    case bom_t::BOM_UTF16_BE:
+        return decode_units<char16_t>(data, len, little_endian, offset);
 
-            if(wctombs(mb, wc, sizeof(mb)) < 0)
+    case bom_t::BOM_UTF32_LE:
+        return decode_units<char32_t>(data, len, !little_endian, offset);
+
+    case bom_t::BOM_UTF32_BE:
+        return decode_units<char32_t>(data, len, little_endian, offset);
+
+    default:
+        {
+            std::string_view const str(data, len);
+            std::size_t const pos(detail::kernels().f_validate_utf8(str.data(), str.length()));
+            if(pos != len)
             {
-                // this should not happen since all UTF-16 characters are
-                // considered valid when surrogates are valid
-                //
-                throw libutf8_exception_encoding("to_u8string(u16string): the input wide character is not a valid UTF-32 character."); // LCOV_EXCL_LINE
+                throw libutf8_exception_decoding(
+                          "decode_bytes(): the input includes an invalid UTF-8 character at byte "
+                        + std::to_string(offset + pos)
+                        + ".");
             }
-            result += mb;
+            return std::string(str);
         }
-    }
 
-    return result;
+    }
 }
 
 
-/** \brief Converts an std::wstring to a UTF-8 string.
+/** \brief Converts a UTF-32 string to a UTF-8 string.
+ *
+ * This function converts a UTF-32 character string (char32_t) to a
+ * UTF-8 string.
+ *
+ * The size of the output is computed first (see utf8_length_from_utf32())
+ * so the result gets allocated exactly once.
  *
- * This function converts an std::wstring to UTF-8. The function first
- * determines whether `wchar_t` represents 16 or 32 bits and then
- * calls the corresponding `char16_t` or `char32_t` function.
+ * \note
+ * The input string may include '\0' characters.
+ *
+ * \exception libutf8_exception_encoding
+ * The input character must be a valid UTF-32 character or this exception
+ * gets raised.
  *
  * \param[in] str  The wide character string to convert to UTF-8.
  *
  * \return The converted string.
  */
-std::string to_u8string(std::wstring const & str)
+std::string to_u8string(std::u32string_view str)
 {
-    switch(sizeof(wchar_t))
-    {
-    case 2:
-        return to_u8string(std::u16string(str.begin(), str.end()));
-
-    case 4:
-        return to_u8string(std::u32string(str.begin(), str.end()));
-
-    }
-
-    throw libutf8_exception_unsupported("wchar_t has an unsupported size.");
+    std::string result(utf8_length_from_utf32(str), '\0');
+    to_u8string(str, result.data(), result.length());
+    return result;
 }
 
 
-/** \brief Converts a wchar_t character to a UTF-8 string.
+/** \brief Converts a UTF-32 string to UTF-8 in a caller buffer.
  *
- * This function converts a wide character (wchar_t) to a
- * UTF-8 std::string. If the wchar_t type is 4 bytes, it gets
- * converted to a char32_t. If the wchar_t type is 2 bytes,
- * it gets converted to char16_t and the \p two parameter
- * also gets forwarded to the to_u8string(char16_t, char16_t);
- * function.
+ * This function converts a UTF-32 character string (char32_t) to UTF-8
+ * and saves the result in \p out. The function does not add a null
+ * terminator.
  *
- * \note
- * This means that a wchar_t of 4 bytes cannot ever be a
- * surrogate.
+ * The buffer needs to be at least utf8_length_from_utf32() bytes.
  *
- * \param[in] one  The wchar_t character or high surrogate.
- * \param[in] two  The low surrogate if \p one is a high surrogate and wchar_t
- *                 is 2 bytes.
+ * \exception libutf8_exception_encoding
+ * The input character must be a valid UTF-32 character or this exception
+ * gets raised.
  *
- * \return The converted string.
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The wide character string to convert to UTF-8.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in bytes.
+ *
+ * \return The number of bytes written to \p out.
  */
-std::string to_u8string(wchar_t one, wchar_t two)
+std::size_t to_u8string(std::u32string_view str, char * out, std::size_t out_len)
 {
-    switch(sizeof(wchar_t))
-    {
-    case 2:
-        return to_u8string(static_cast<char16_t>(one), static_cast<char16_t>(two));
-
-    case 4:
-        return to_u8string(static_cast<char32_t>(one));
-
-    }
-
-    throw libutf8_exception_unsupported("wchar_t has an unsupported size.");
+    return transcode<char32_t, char, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_u8string").f_written;
+}
+
+
+/** \brief Converts a UTF-16 string to a UTF-8 string.
+ *
+ * This function converts a UTF-16 character string (char16_t) to a
+ * UTF-8 string.
+ *
+ * The size of the output is computed first (see utf8_length_from_utf16())
+ * so the result gets allocated exactly once.
+ *
+ * \note
+ * The input string may include '\0' characters.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string must be a valid UTF-16 string or this exception
+ * gets raised.
+ *
+ * \param[in] str  The wide character string to convert to UTF-8.
+ *
+ * \return The converted string.
+ */
+std::string to_u8string(std::u16string_view str)
+{
+    std::string result(utf8_length_from_utf16(str), '\0');
+    to_u8string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Converts a UTF-16 string to UTF-8 in a caller buffer.
+ *
+ * This function converts a UTF-16 character string (char16_t) to UTF-8
+ * and saves the result in \p out. The function does not add a null
+ * terminator.
+ *
+ * The buffer needs to be at least utf8_length_from_utf16() bytes.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string must be a valid UTF-16 string or this exception
+ * gets raised.
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The wide character string to convert to UTF-8.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in bytes.
+ *
+ * \return The number of bytes written to \p out.
+ */
+std::size_t to_u8string(std::u16string_view str, char * out, std::size_t out_len)
+{
+    return transcode<char16_t, char, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_u8string").f_written;
+}
+
+
+/** \brief Compute the length of a UTF-32 string once converted to UTF-8.
+ *
+ * This function returns the exact number of bytes that to_u8string()
+ * generates for the specified UTF-32 string. It is used to allocate
+ * the output buffer once.
+ *
+ * Invalid characters are not detected by this function.
+ *
+ * \param[in] str  The UTF-32 string to check.
+ *
+ * \return The number of UTF-8 bytes necessary to encode \p str.
+ */
+std::size_t utf8_length_from_utf32(std::u32string_view str)
+{
+    return detail::kernels().f_utf8_length_from_utf32(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a UTF-16 string once converted to UTF-8.
+ *
+ * This function returns the exact number of bytes that to_u8string()
+ * generates for the specified UTF-16 string. It is used to allocate
+ * the output buffer once.
+ *
+ * Invalid surrogates are not detected by this function.
+ *
+ * \param[in] str  The UTF-16 string to check.
+ *
+ * \return The number of UTF-8 bytes necessary to encode \p str.
+ */
+std::size_t utf8_length_from_utf16(std::u16string_view str)
+{
+    return detail::kernels().f_utf8_length_from_utf16(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a UTF-8 string once converted to UTF-16.
+ *
+ * This function returns the number of code units that to_u16string()
+ * generates for the specified UTF-8 string: one per character plus one
+ * for each character which requires a surrogate pair.
+ *
+ * Invalid sequences are not detected by this function.
+ *
+ * \param[in] str  The UTF-8 string to check.
+ *
+ * \return The number of UTF-16 code units necessary to encode \p str.
+ */
+std::size_t utf16_length_from_utf8(std::string_view str)
+{
+    return detail::kernels().f_utf16_length_from_utf8(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a UTF-32 string once converted to UTF-16.
+ *
+ * This function returns the number of code units that a conversion to
+ * UTF-16 generates for the specified UTF-32 string: one per character
+ * plus one for each character over 0xFFFF (a surrogate pair).
+ *
+ * Invalid characters are not detected by this function.
+ *
+ * \param[in] str  The UTF-32 string to check.
+ *
+ * \return The number of UTF-16 code units necessary to encode \p str.
+ */
+std::size_t utf16_length_from_utf32(std::u32string_view str)
+{
+    return detail::kernels().f_utf16_length_from_utf32(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a UTF-8 string once converted to UTF-32.
+ *
+ * This function returns the number of characters that to_u32string()
+ * generates for the specified UTF-8 string. It counts the bytes which
+ * are not continuation bytes.
+ *
+ * Invalid sequences are not detected by this function. The result is
+ * never smaller than the number of characters decoded before the first
+ * invalid sequence so it can be used to size the output buffer.
+ *
+ * \param[in] str  The UTF-8 string to check.
+ *
+ * \return The number of UTF-32 characters necessary to encode \p str.
+ */
+std::size_t utf32_length_from_utf8(std::string_view str)
+{
+    return detail::kernels().f_u8length_unchecked(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a UTF-16 string once converted to UTF-32.
+ *
+ * This function returns the number of characters that a conversion to
+ * UTF-32 generates for the specified UTF-16 string. It counts the code
+ * units which are not low surrogates.
+ *
+ * Invalid surrogates are not detected by this function.
+ *
+ * \param[in] str  The UTF-16 string to check.
+ *
+ * \return The number of UTF-32 characters necessary to encode \p str.
+ */
+std::size_t utf32_length_from_utf16(std::u16string_view str)
+{
+    return detail::kernels().f_u16length_unchecked(str.data(), str.length());
+}
+
+
+/** \brief Compute the length of a Latin-1 string once converted to UTF-8.
+ *
+ * This function returns the exact number of bytes that
+ * codepage_to_u8string() generates for an ISO-8859-1 string: one byte
+ * per ASCII character and two bytes per other character.
+ *
+ * \param[in] str  The Latin-1 string to check.
+ *
+ * \return The number of UTF-8 bytes necessary to encode \p str.
+ */
+std::size_t utf8_length_from_latin1(std::string_view str)
+{
+    return detail::kernels().f_utf8_length_from_latin1(str.data(), str.length());
+}
+
+
+/** \brief Converts an std::wstring_view to a UTF-8 string.
+ *
+ * This function converts an std::wstring_view to UTF-8. The characters
+ * are viewed as UTF-16 or UTF-32 depending on the size of `wchar_t` and
+ * converted in place by transcode(), without first being copied to an
+ * std::u16string or std::u32string.
+ *
+ * \param[in] str  The wide character string to convert to UTF-8.
+ *
+ * \return The converted string.
+ */
+std::string to_u8string(std::wstring_view str)
+{
+    std::string result(utf8_length_from_wchar(str), '\0');
+    to_u8string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Converts an std::wstring_view to UTF-8 in a caller buffer.
+ *
+ * This function converts the wide characters to UTF-8 and saves the
+ * result in \p out. The function does not add a null terminator.
+ *
+ * The buffer needs to be at least utf8_length_from_wchar() bytes.
+ *
+ * \exception libutf8_exception_decoding
+ * With a 2 byte `wchar_t`, the input string must be a valid UTF-16 string
+ * or this exception gets raised.
+ *
+ * \exception libutf8_exception_encoding
+ * With a 4 byte `wchar_t`, the input characters must be valid UTF-32
+ * characters or this exception gets raised.
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The wide character string to convert to UTF-8.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in bytes.
+ *
+ * \return The number of bytes written to \p out.
+ */
+std::size_t to_u8string(std::wstring_view str, char * out, std::size_t out_len)
+{
+    return transcode<wchar_t, char, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_u8string").f_written;
+}
+
+
+/** \brief Transform a UTF-8 string to a wide character string.
+ *
+ * This function converts \p str to `wchar_t` characters: UTF-32 when
+ * `wchar_t` is 4 bytes (Unices) and UTF-16 when it is 2 bytes
+ * (MS-Windows). The characters are written directly in the result with
+ * the same kernels as to_u32string() and to_u16string() so there is no
+ * intermediate std::u32string or std::u16string.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \param[in] str  The string to convert.
+ *
+ * \return The wide character string.
+ */
+std::wstring to_wstring(std::string_view str)
+{
+    std::wstring result(wchar_length_from_utf8(str), L'\0');
+    result.resize(to_wstring(str, result.data(), result.length()));
+    return result;
+}
+
+
+/** \brief Transform a UTF-8 string to wide characters in a caller buffer.
+ *
+ * This function converts the UTF-8 string \p str to `wchar_t` characters
+ * and saves the result in \p out. The function does not add a null
+ * terminator.
+ *
+ * The buffer needs to be at least wchar_length_from_utf8() characters.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in `wchar_t`.
+ *
+ * \return The number of `wchar_t` written to \p out.
+ */
+std::size_t to_wstring(std::string_view str, wchar_t * out, std::size_t out_len)
+{
+    return transcode<char, wchar_t, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_wstring").f_written;
+}
+
+
+/** \brief Compute the length of a wide string once converted to UTF-8.
+ *
+ * This function returns the exact number of bytes that to_u8string()
+ * generates for the specified wide string. The characters are viewed as
+ * UTF-16 or UTF-32 depending on the size of `wchar_t`.
+ *
+ * Invalid characters are not detected by this function.
+ *
+ * \param[in] str  The wide string to check.
+ *
+ * \return The number of UTF-8 bytes necessary to encode \p str.
+ */
+std::size_t utf8_length_from_wchar(std::wstring_view str)
+{
+    if constexpr(sizeof(wchar_t) == 2)
+    {
+        return utf8_length_from_utf16(std::u16string_view(reinterpret_cast<char16_t const *>(str.data()), str.length()));
+    }
+    else
+    {
+        return utf8_length_from_utf32(std::u32string_view(reinterpret_cast<char32_t const *>(str.data()), str.length()));
+    }
+}
+
+
+/** \brief Compute the length of a UTF-8 string once converted to wchar_t.
+ *
+ * This function returns the number of `wchar_t` that to_wstring()
+ * generates for the specified UTF-8 string.
+ *
+ * Invalid sequences are not detected by this function.
+ *
+ * \param[in] str  The UTF-8 string to check.
+ *
+ * \return The number of `wchar_t` necessary to encode \p str.
+ */
+std::size_t wchar_length_from_utf8(std::string_view str)
+{
+    if constexpr(sizeof(wchar_t) == 2)
+    {
+        return utf16_length_from_utf8(str);
+    }
+    else
+    {
+        return utf32_length_from_utf8(str);
+    }
+}
+
+
+
+/** \brief Converts a wchar_t character to a UTF-8 string.
+ *
+ * This function converts a wide character (wchar_t) to a
+ * UTF-8 std::string. If the wchar_t type is 4 bytes, it gets
+ * converted to a char32_t. If the wchar_t type is 2 bytes,
+ * it gets converted to char16_t and the \p two parameter
+ * also gets forwarded to the to_u8string(char16_t, char16_t);
+ * function.
+ *
+ * \note
+ * This means that a wchar_t of 4 bytes cannot ever be a
+ * surrogate.
+ *
+ * \param[in] one  The wchar_t character or high surrogate.
+ * \param[in] two  The low surrogate if \p one is a high surrogate and wchar_t
+ *                 is 2 bytes.
+ *
+ * \return The converted string.
+ */
+std::string to_u8string(wchar_t one, wchar_t two)
+{
+    switch(sizeof(wchar_t))
+    {
+    case 2:
+        return to_u8string(static_cast<char16_t>(one), static_cast<char16_t>(two));
+
+    case 4:
+        return to_u8string(static_cast<char32_t>(one));
+
+    }
+
+    throw libutf8_exception_unsupported("wchar_t has an unsupported size.");
 }
 
 
@@ -788,27 +1124,17 @@ std::string to_u8string(wchar_t one, wchar_t two)
  */
 std::string to_u8string(char16_t one, char16_t two)
 {
+    char16_t const pair[2] = { one, two };
     surrogate_t const a(is_surrogate(one));
     if(a == surrogate_t::SURROGATE_NO)
     {
-        std::u16string s;
-        s += one;
-        return to_u8string(s);
+        return to_u8string(std::u16string_view(pair, 1));
     }
 
-    if(a == surrogate_t::SURROGATE_HIGH)
+    if(a == surrogate_t::SURROGATE_HIGH
+    && is_surrogate(two) == surrogate_t::SURROGATE_LOW)
     {
-        surrogate_t const b(is_surrogate(two));
-        if(b == surrogate_t::SURROGATE_LOW)
-        {
-            // the to_u8string() of the u16string will determine the valid order
-            // for us
-            //
-            std::u16string s;
-            s += one;
-            s += two;
-            return to_u8string(s);
-        }
+        return to_u8string(std::u16string_view(pair, 2));
     }
 
     throw libutf8_exception_decoding("to_u8string(char16_t, char16_t): the input did not represent a valid surrogate sequence.");
@@ -834,22 +1160,128 @@ std::string to_u8string(char16_t one, char16_t two)
  */
 std::string to_u8string(char32_t const wc)
 {
-    // TODO: calculate resulting string size and preallocate buffer (reserve)
-    //
-    std::string result;
-    char mb[MBS_MIN_BUFFER_LENGTH];
-    int const r(wctombs(mb, wc, sizeof(mb)));
-    if(r < 0)
-    {
-        throw libutf8_exception_encoding(
-              "to_u8string(char32_t): the input wide character (\\U"
-            + snapdev::int_to_hex(wc, false, 6)
-            + ") is not a valid UTF-32 character.");
-    }
-    return std::string(mb, r);
+    return std::string(to_u8char(wc));
+}
+
+
+/** \brief Converts a wide character to a UTF-8 character.
+ *
+ * This function converts a wide character (char32_t) to a u8char
+ * object. Contrary to to_u8string(char32_t), the result is held in
+ * a small fixed buffer so no memory gets allocated.
+ *
+ * \exception libutf8_exception_encoding
+ * The input character must be a valid UTF-32 character or this exception
+ * gets raised.
+ *
+ * \param[in] wc  The wide character to convert to UTF-8.
+ *
+ * \return The UTF-8 encoded character.
+ */
+u8char to_u8char(char32_t const wc)
+{
+    u8char const result(wc);
+    if(result.empty())
+    {
+        detail::invalid_utf32_character("to_u8string(char32_t)", wc);
+    }
+    return result;
+}
+
+
+/** \brief Append a UTF-32 string to a UTF-8 string.
+ *
+ * This function converts \p str to UTF-8 directly at the end of \p dst.
+ * The size of the output is computed first so \p dst grows at most once
+ * and no temporary string gets created.
+ *
+ * \exception libutf8_exception_encoding
+ * The input string must only include valid UTF-32 characters or this
+ * exception gets raised. In that case \p dst is restored.
+ *
+ * \param[in,out] dst  The string receiving the characters.
+ * \param[in] str  The characters to append.
+ *
+ * \return A reference to \p dst.
+ */
+std::string & append_utf8(std::string & dst, std::u32string_view str)
+{
+    std::string::size_type const size(dst.length());
+    dst.resize(size + utf8_length_from_utf32(str));
+    try
+    {
+        to_u8string(str, dst.data() + size, dst.length() - size);
+    }
+    catch(...)
+    {
+        dst.resize(size);
+        throw;
+    }
+    return dst;
+}
+
+
+/** \brief Append a UTF-16 string to a UTF-8 string.
+ *
+ * This function converts \p str to UTF-8 directly at the end of \p dst.
+ * The size of the output is computed first so \p dst grows at most once
+ * and no temporary string gets created.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string must be a valid UTF-16 string or this exception
+ * gets raised. In that case \p dst is restored.
+ *
+ * \param[in,out] dst  The string receiving the characters.
+ * \param[in] str  The characters to append.
+ *
+ * \return A reference to \p dst.
+ */
+std::string & append_utf8(std::string & dst, std::u16string_view str)
+{
+    std::string::size_type const size(dst.length());
+    dst.resize(size + utf8_length_from_utf16(str));
+    try
+    {
+        to_u8string(str, dst.data() + size, dst.length() - size);
+    }
+    catch(...)
+    {
+        dst.resize(size);
+        throw;
+    }
+    return dst;
+}
+
+
+namespace detail
+{
+
+
+/** \brief Raise the error of an invalid UTF-32 character.
+ *
+ * The inline functions encoding characters, such as append_utf8(), call
+ * this function when the character cannot be encoded. This way the
+ * header does not need to know about the exceptions.
+ *
+ * \exception libutf8_exception_encoding
+ * This function always raises this exception.
+ *
+ * \param[in] function  The name of the function that failed.
+ * \param[in] wc  The invalid character.
+ */
+void invalid_utf32_character(char const * function, char32_t wc)
+{
+    throw libutf8_exception_encoding(
+          std::string(function)
+        + ": the input wide character (\\U"
+        + snapdev::int_to_hex(wc, false, 6)
+        + ") is not a valid UTF-32 character.");
 }
 
 
+} // detail namespace
+
+
 /** \brief Transform a UTF-8 string to a wide character string.
  *
  * This function transforms the specified string, \p str, from the
@@ -861,28 +1293,50 @@ std::string to_u8string(char32_t const wc)
  * the conversion under Microsoft Windows is not the same as under
  * Unices.
  *
+ * The output is allocated once with utf32_length_from_utf8() characters.
+ * Counting is much faster than decoding and it avoids allocating up to
+ * four times the necessary memory. The SIMD kernels validate and decode
+ * most of the input in one pass. The scalar loop converts what remains
+ * and raises the error if any.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
  * \param[in] str  The string to convert to a wide string.
  *
  * \return A wide string which is a representation of the UTF-8 input string.
  */
-std::u32string to_u32string(std::string const & str)
+std::u32string to_u32string(std::string_view str)
 {
-    std::u32string result;
-    result.reserve(u8length(str));  // avoid realloc(), in some cases this ends up being a little slower, with larger strings, much faster
-
-    size_t len(str.length());
-    for(std::string::value_type const * mb(str.c_str()); len > 0; )
-    {
-        char32_t wc;
-        if(mbstowc(wc, mb, len) < 0)
-        {
-            throw libutf8_exception_decoding("to_u32string(): a UTF-8 character could not be extracted.");
-        }
+    std::u32string result(utf32_length_from_utf8(str), U'\0');
+    result.resize(to_u32string(str, result.data(), result.length()));
+    return result;
+}
 
-        result += wc;
-    }
 
-    return result;
+/** \brief Transform a UTF-8 string to UTF-32 in a caller buffer.
+ *
+ * This function converts the UTF-8 string \p str to UTF-32 and saves
+ * the result in \p out. The function does not add a null terminator.
+ *
+ * The buffer needs to be at least u8length() characters. Using
+ * `str.length()` is always enough.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The string to convert to UTF-32.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in characters.
+ *
+ * \return The number of characters written to \p out.
+ */
+std::size_t to_u32string(std::string_view str, char32_t * out, std::size_t out_len)
+{
+    return transcode<char, char32_t, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_u32string").f_written;
 }
 
 
@@ -929,43 +1383,56 @@ std::u16string to_u16string(char32_t const wc)
  * This function transforms the specified string, \p str, from the
  * UTF-8 encoding to the UTF-16 encoding.
  *
+ * The output is allocated once with utf16_length_from_utf8() code units.
+ * The SIMD kernels validate and convert most of the input. The scalar
+ * loop converts what remains (the end of the input or the part starting
+ * with an invalid sequence) and raises the error if any.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
  * \param[in] str  The string to convert to a UTF-16 string.
  *
  * \return A wide string which is a representation of the UTF-8 input string.
  */
-std::u16string to_u16string(std::string const & str)
+std::u16string to_u16string(std::string_view str)
 {
-    std::u16string result;
-    result.reserve(u8length(str));  // avoid realloc(), works in most cases, but really we need a u8length() if converted to u16 characters
-
-    std::string::size_type len(str.length());
-    for(std::string::value_type const * mb(str.c_str()); len > 0; )
-    {
-        char32_t wc;
-        if(mbstowc(wc, mb, len) < 0)
-        {
-            throw libutf8_exception_decoding("to_u16string(): a UTF-8 character could not be extracted.");
-        }
+    std::u16string result(utf16_length_from_utf8(str), u'\0');
+    to_u16string(str, result.data(), result.length());
+    return result;
+}
 
-        if(wc >= 0x10000)
-        {
-            result += static_cast<std::u16string::value_type>((wc >> 10) + (0xD800 - (0x10000 >> 10)));
-            result += static_cast<std::u16string::value_type>(((wc & 0x03FF) + 0xDC00));
-        }
-        else
-        {
-            result += static_cast<std::u16string::value_type>(wc);
-        }
-    }
 
-    return result;
+/** \brief Transform a UTF-8 string to UTF-16 in a caller buffer.
+ *
+ * This function converts the UTF-8 string \p str to UTF-16 and saves
+ * the result in \p out. The function does not add a null terminator.
+ *
+ * The buffer needs to be at least utf16_length_from_utf8() code units.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small.
+ *
+ * \param[in] str  The string to convert to UTF-16.
+ * \param[out] out  The output buffer.
+ * \param[in] out_len  The size of \p out in code units.
+ *
+ * \return The number of code units written to \p out.
+ */
+std::size_t to_u16string(std::string_view str, char16_t * out, std::size_t out_len)
+{
+    return transcode<char, char16_t, error_policy_t::ERROR_POLICY_THROW>(str, out, out_len, "to_u16string").f_written;
 }
 
 
 /** \brief Determine the length of the UTF-8 string.
  *
  * This function counts the number of characters in the specified UTF-8
- * string. It is optimized for speed for the UTF-8 encoding.
+ * string. It is optimized for speed for the UTF-8 encoding. On x86-64,
+ * the bytes are counted 16 to 64 at a time using the SIMD kernels.
  *
  * \note
  * The function currently ignores 0xF8 to 0xFF bytes even though those are
@@ -973,73 +1440,106 @@ std::u16string to_u16string(std::string const & str)
  * sequence represents a character more than 0x10FFFF or a surrogate.
  * That being said, it works beautifully for valid UTF-8 strings.
  *
+ * The string is counted up to its length. A NUL character (`'\0'`)
+ * counts as one character and does not end the string.
+ *
  * \param[in] str  The string to compute the length in characters of.
  *
  * \return The number of characters in the UTF-8 string.
  */
-size_t u8length(std::string const & str)
+size_t u8length(std::string_view str)
 {
-    size_t result(0);
-    for(std::string::value_type const *s(str.c_str()); *s != '\0'; ++s)
-    {
-        unsigned char c(*s);
-        if((c < 0x80 || c > 0xBF) && c < 0xF8)
-        {
-            ++result;
-        }
-    }
-    return result;
+    return detail::kernels().f_u8length(str.data(), str.length());
+}
+
+
+/** \brief Determine the length of a valid UTF-8 string.
+ *
+ * This function counts the number of characters in the specified UTF-8
+ * string assuming it is valid. Only the continuation bytes (0x80 to 0xBF)
+ * are ignored. This is slightly faster than u8length() and it returns the
+ * same result for valid UTF-8 strings. Use it on strings you already
+ * validated or which you created yourself.
+ *
+ * \param[in] str  The valid UTF-8 string to compute the length of.
+ *
+ * \return The number of characters in the UTF-8 string.
+ *
+ * \sa u8length()
+ */
+std::size_t u8length_unchecked(std::string_view str)
+{
+    return detail::kernels().f_u8length_unchecked(str.data(), str.length());
+}
+
+
+/** \brief Find the byte offset of a character in a valid UTF-8 string.
+ *
+ * This function returns the offset of the byte which starts the
+ * character at index \p cp_index. Instead of decoding one character at
+ * a time, the SIMD kernels count the bytes which start a character a
+ * whole block at a time, so skipping a long string costs about the same
+ * as u8length_unchecked().
+ *
+ * Like u8length_unchecked(), the function expects a valid UTF-8 string.
+ * With invalid input, every byte which is not a continuation byte
+ * counts as one character.
+ *
+ * \param[in] str  The valid UTF-8 string to search.
+ * \param[in] cp_index  The index of the character to search.
+ *
+ * \return The offset of the character in bytes or str.length() when the
+ * string does not have more than \p cp_index characters.
+ *
+ * \sa u8length_unchecked()
+ */
+std::size_t byte_offset_of(std::string_view str, std::size_t cp_index)
+{
+    return detail::kernels().f_utf8_offset_of(str.data(), str.length(), cp_index);
 }
 
 
 /** \brief Determine the length of the UTF-16 string.
  *
  * This function counts the number of characters in the specified UTF-16
- * string. It is optimized for speed for the UTF-16 encoding.
+ * string. It is optimized for speed for the UTF-16 encoding. On x86-64,
+ * the surrogates are checked 16 to 32 code units at a time using the
+ * SIMD kernels.
  *
  * In UTF-16, the surrogates have to appear in the correct order. This
  * function returns -1 instead of the length if it detects an invalid
  * surrogate.
  *
- * \param[in] str  The null terminated string to compute the length in
- * characters of.
+ * The string is counted up to its length. A NUL character (`u'\0'`)
+ * counts as one character and does not end the string.
+ *
+ * \param[in] str  The string to compute the length in characters of.
  *
  * \return The number of characters in the UTF-16 string or -1 if the string
  * is considered invalid.
  */
-ssize_t u16length(std::u16string const & str)
+ssize_t u16length(std::u16string_view str)
 {
-    ssize_t result(0);
-    for(std::u16string::value_type const * s(str.c_str());
-        *s != L'\0';
-        ++result, ++s)
-    {
-        surrogate_t const high_surrogate(is_surrogate(*s));
-        if(high_surrogate == surrogate_t::SURROGATE_LOW)
-        {
-            // missing HIGH surrogate before LOW surrogate
-            //
-            return -1;
-        }
-        if(high_surrogate == surrogate_t::SURROGATE_HIGH)
-        {
-            ++s;
-            if(*s == L'\0')
-            {
-                // missing LOW surrogate after HIGH surrogate
-                //
-                return -1;
-            }
-            surrogate_t const low_surrogate(is_surrogate(*s));
-            if(low_surrogate != surrogate_t::SURROGATE_LOW)
-            {
-                // missing LOW surrogate after HIGH surrogate
-                //
-                return -1;
-            }
-        }
-    }
-    return result;
+    return detail::kernels().f_u16length(str.data(), str.length());
+}
+
+
+/** \brief Determine the length of a valid UTF-16 string.
+ *
+ * This function counts the number of characters in the specified UTF-16
+ * string assuming it is valid. It counts all the code units except the
+ * low surrogates, without checking that the surrogates are properly
+ * paired.
+ *
+ * \param[in] str  The valid UTF-16 string to compute the length of.
+ *
+ * \return The number of characters in the UTF-16 string.
+ *
+ * \sa u16length()
+ */
+std::size_t u16length_unchecked(std::u16string_view str)
+{
+    return detail::kernels().f_u16length_unchecked(str.data(), str.length());
 }
 
 
@@ -1070,13 +1570,13 @@ ssize_t u16length(std::u16string const & str)
  *
  * \sa case_insensitive_basic_string
  */
-int u8casecmp(std::string const & lhs, std::string const & rhs)
+int u8casecmp(std::string_view lhs, std::string_view rhs)
 {
-    std::string::size_type llen(lhs.length());
-    std::string::value_type const * lmb(lhs.c_str());
+    std::string_view::size_type llen(lhs.length());
+    std::string_view::value_type const * lmb(lhs.data());
 
-    std::string::size_type rlen(rhs.length());
-    std::string::value_type const * rmb(rhs.c_str());
+    std::string_view::size_type rlen(rhs.length());
+    std::string_view::value_type const * rmb(rhs.data());
 
     while(llen > 0 && rlen > 0)
     {
@@ -1115,44 +1615,320 @@ int u8casecmp(std::string const & lhs, std::string const & rhs)
 }
 
 
+namespace
+{
+
+
+
+std::size_t find_invalid(std::string_view str)
+{
+    return detail::kernels().f_validate_utf8(str.data(), str.length());
+}
+
+
+std::size_t find_invalid(std::u16string_view str)
+{
+    return detail::kernels().f_validate_utf16(str.data(), str.length());
+}
+
+
+std::size_t find_invalid(std::u32string_view str)
+{
+    return detail::kernels().f_validate_utf32(str.data(), str.length(), true);
+}
+
+
+/** \brief Get the number of invalid bytes to replace at once.
+ *
+ * The \p str string starts with an invalid sequence. This function
+ * returns the number of bytes that one \p fix_char replaces depending
+ * on the \p policy.
+ *
+ * The maximal subpart is the longest sequence of bytes which is the start
+ * of a valid character, or just one byte if the first byte cannot start
+ * a valid character (Unicode 3.9 "U+FFFD Substitution of Maximal
+ * Subparts", also what the WHATWG Encoding Standard does).
+ */
+std::size_t invalid_length(std::string_view str, replacement_policy_t policy)
+{
+    switch(policy)
+    {
+    case replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE:
+        return utf8_invalid_length(str.data(), str.length());
+
+    case replacement_policy_t::REPLACEMENT_POLICY_BYTE:
+        return 1;
+
+    default:
+        return utf8_maximal_subpart_length(str.data(), str.length());
+
+    }
+}
+
+
+/** \brief In UTF-16 and UTF-32, each invalid code unit is replaced.
+ *
+ * A lone surrogate or a value out of range is a maximal subpart by
+ * itself, so all the policies replace one code unit at a time.
+ */
+template<typename CharT>
+std::size_t invalid_length(std::basic_string_view<CharT>, replacement_policy_t)
+{
+    return 1;
+}
+
+
+std::string fix_string(char const *, char32_t fix_char)
+{
+    return to_u8string(fix_char);
+}
+
+
+std::u16string fix_string(char16_t const *, char32_t fix_char)
+{
+    return to_u16string(fix_char);
+}
+
+
+std::u32string fix_string(char32_t const *, char32_t fix_char)
+{
+    if(!is_valid_unicode(fix_char, true))
+    {
+        throw libutf8_exception_invalid_parameter(
+              "make_u32string_valid(): the fix character \\U"
+            + snapdev::int_to_hex(fix_char, true, 6)
+            + " is not a valid Unicode character.");
+    }
+    return std::u32string(1, fix_char);
+}
+
+
+/** \brief Copy \p str to \p result replacing the invalid characters.
+ *
+ * This function copies \p str to \p result. The valid runs are copied
+ * as is and the invalid sequences are replaced by \p fix_char or
+ * dropped, depending on \p policy.
+ *
+ * The caller already found the first invalid character, at \p pos.
+ *
+ * The string is built in a local buffer and swapped with \p result at
+ * the end since \p str may be a view of \p result.
+ */
+template<typename CharT>
+void repair_string(
+      std::basic_string_view<CharT> str
+    , std::size_t pos
+    , std::basic_string<CharT> & result
+    , char32_t fix_char
+    , replacement_policy_t policy)
+{
+    std::basic_string<CharT> fix;
+    if(policy != replacement_policy_t::REPLACEMENT_POLICY_DROP)
+    {
+        fix = fix_string(str.data(), fix_char);
+    }
+
+    std::basic_string<CharT> repaired;
+    repaired.reserve(str.length());
+    std::size_t start(0);
+    for(;;)
+    {
+        repaired.append(str.data() + start, pos - start);
+        if(pos >= str.length())
+        {
+            break;
+        }
+        repaired += fix;
+        start = pos + invalid_length(str.substr(pos), policy);
+        pos = start + find_invalid(str.substr(start));
+    }
+    result.swap(repaired);
+}
+
+
+template<typename CharT>
+bool make_string_valid(std::basic_string<CharT> & str, char32_t fix_char, replacement_policy_t policy)
+{
+    std::size_t const pos(find_invalid(std::basic_string_view<CharT>(str)));
+    if(pos == str.length())
+    {
+        return true;
+    }
+
+    repair_string(std::basic_string_view<CharT>(str), pos, str, fix_char, policy);
+    return false;
+}
+
+
+template<typename CharT>
+bool make_string_valid(std::basic_string_view<CharT> str, std::basic_string<CharT> & result, char32_t fix_char, replacement_policy_t policy)
+{
+    std::size_t const pos(find_invalid(str));
+    if(pos == str.length())
+    {
+        result.assign(str.data(), str.length());
+        return true;
+    }
+
+    repair_string(str, pos, result, fix_char, policy);
+    return false;
+}
+
+
+
+} // no name namespace
+
+
 /** \brief Make sure a string is considered valid UTF-8.
  *
  * This function goes through a UTF-8 string and replace any invalid bytes
  * with the \p fix_char character.
  *
+ * The string is first checked with the SIMD validator. When it is valid,
+ * which is expected in most cases, the function returns immediately
+ * without modifying or copying the string. Otherwise, the valid runs
+ * are copied as is to a new string and the invalid bytes are replaced
+ * as defined by the \p policy:
+ *
+ * \li REPLACEMENT_POLICY_SEQUENCE -- one \p fix_char for each invalid
+ *     sequence as skipped by mbstowc(); this is the default
+ * \li REPLACEMENT_POLICY_MAXIMAL_SUBPART -- one \p fix_char for each
+ *     maximal subpart, which is what the WHATWG Encoding Standard and
+ *     the Unicode best practice require when \p fix_char is
+ *     REPLACEMENT_CHAR (U+FFFD)
+ * \li REPLACEMENT_POLICY_BYTE -- one \p fix_char for each invalid byte
+ * \li REPLACEMENT_POLICY_DROP -- the invalid bytes are removed and
+ *     \p fix_char is ignored
+ *
+ * \exception libutf8_exception_encoding
+ * The \p fix_char is not a valid character.
+ *
  * \param[in,out] str  The string to validate.
  * \param[in] fix_char  The character used to replace invalid bytes.
+ * \param[in] policy  How the invalid bytes get replaced.
  *
  * \return true if the input string was valid.
  */
-bool make_u8string_valid(std::string & str, char32_t fix_char)
+bool make_u8string_valid(std::string & str, char32_t fix_char, replacement_policy_t policy)
 {
-    bool valid(true);
-    std::string result;
-    char const * mb(str.c_str());
-    std::size_t len(str.length());
-    while(len > 0)
-    {
-        char32_t wc(U'\0');
-        int const r(mbstowc(wc, mb, len));
-        if(r == -1)
-        {
-            result += fix_char;
-            valid = false;
-        }
-        else
-        {
-            char buf[MBS_MIN_BUFFER_LENGTH];
-            int const l(wctombs(buf, wc, sizeof(buf)));
-            if(l < 1)
-            {
-                throw libutf8_logic_exception("the mbstowc() function returned what it thinks is a valid unicode character yet the wctombs() failed converting it back."); // LCOV_EXCL_LINE
-            }
-            result += std::string(buf, l);
-        }
-    }
-    str.swap(result);
-    return valid;
+    return make_string_valid(str, fix_char, policy);
+}
+
+
+/** \brief Make a valid UTF-8 copy of a string.
+ *
+ * This function goes through the UTF-8 string \p str and saves a copy
+ * in \p result where any invalid bytes were replaced by the \p fix_char
+ * character (see the other make_u8string_valid() for the policies).
+ *
+ * The input string is not modified so it can be a slice of a larger
+ * buffer. It is read up to its length; a NUL character (`'\0'`) is
+ * copied as is. When the input is valid, it gets copied to \p result
+ * at once.
+ *
+ * \exception libutf8_exception_encoding
+ * The \p fix_char is not a valid character.
+ *
+ * \param[in] str  The string to validate.
+ * \param[out] result  The valid version of \p str.
+ * \param[in] fix_char  The character used to replace invalid bytes.
+ * \param[in] policy  How the invalid bytes get replaced.
+ *
+ * \return true if the input string was valid.
+ */
+bool make_u8string_valid(std::string_view str, std::string & result, char32_t fix_char, replacement_policy_t policy)
+{
+    return make_string_valid(str, result, fix_char, policy);
+}
+
+
+/** \brief Make sure a string is considered valid UTF-16.
+ *
+ * This function replaces the lone surrogates of \p str with
+ * \p fix_char, or removes them with REPLACEMENT_POLICY_DROP. The other
+ * policies all replace one code unit at a time.
+ *
+ * When the string is valid, it is not modified nor copied.
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The \p fix_char is not a valid character.
+ *
+ * \param[in,out] str  The string to validate.
+ * \param[in] fix_char  The character used to replace invalid code units.
+ * \param[in] policy  How the invalid code units get replaced.
+ *
+ * \return true if the input string was valid.
+ */
+bool make_u16string_valid(std::u16string & str, char32_t fix_char, replacement_policy_t policy)
+{
+    return make_string_valid(str, fix_char, policy);
+}
+
+
+/** \brief Make a valid UTF-16 copy of a string.
+ *
+ * This function saves a copy of \p str in \p result where the lone
+ * surrogates were replaced by \p fix_char (see the other
+ * make_u16string_valid()).
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The \p fix_char is not a valid character.
+ *
+ * \param[in] str  The string to validate.
+ * \param[out] result  The valid version of \p str.
+ * \param[in] fix_char  The character used to replace invalid code units.
+ * \param[in] policy  How the invalid code units get replaced.
+ *
+ * \return true if the input string was valid.
+ */
+bool make_u16string_valid(std::u16string_view str, std::u16string & result, char32_t fix_char, replacement_policy_t policy)
+{
+    return make_string_valid(str, result, fix_char, policy);
+}
+
+
+/** \brief Make sure a string is considered valid UTF-32.
+ *
+ * This function replaces the surrogates and the values over 0x10FFFF
+ * found in \p str with \p fix_char, or removes them with
+ * REPLACEMENT_POLICY_DROP.
+ *
+ * When the string is valid, it is not modified nor copied.
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The \p fix_char is not a valid character.
+ *
+ * \param[in,out] str  The string to validate.
+ * \param[in] fix_char  The character used to replace invalid characters.
+ * \param[in] policy  How the invalid characters get replaced.
+ *
+ * \return true if the input string was valid.
+ */
+bool make_u32string_valid(std::u32string & str, char32_t fix_char, replacement_policy_t policy)
+{
+    return make_string_valid(str, fix_char, policy);
+}
+
+
+/** \brief Make a valid UTF-32 copy of a string.
+ *
+ * This function saves a copy of \p str in \p result where the invalid
+ * characters were replaced by \p fix_char (see the other
+ * make_u32string_valid()).
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The \p fix_char is not a valid character.
+ *
+ * \param[in] str  The string to validate.
+ * \param[out] result  The valid version of \p str.
+ * \param[in] fix_char  The character used to replace invalid characters.
+ * \param[in] policy  How the invalid characters get replaced.
+ *
+ * \return true if the input string was valid.
+ */
+bool make_u32string_valid(std::u32string_view str, std::u32string & result, char32_t fix_char, replacement_policy_t policy)
+{
+    return make_string_valid(str, result, fix_char, policy);
 }
 
 
@@ -27,7 +27,15 @@
 
 // C++
 //
+#include    <cstdint>
+#include    <memory>
 #include    <string>
+#include    <string_view>
+
+
+// self
+//
+#include    <libutf8/base.h>
 
 
 
@@ -54,32 +62,342 @@ enum class surrogate_t
 };
 
 
+enum class replacement_policy_t
+{
+    REPLACEMENT_POLICY_SEQUENCE,        // one fix_char per sequence skipped by mbstowc()
+    REPLACEMENT_POLICY_MAXIMAL_SUBPART, // one fix_char per maximal subpart (WHATWG)
+    REPLACEMENT_POLICY_BYTE,            // one fix_char per invalid byte
+    REPLACEMENT_POLICY_DROP             // remove the invalid bytes
+};
+
+
+
+/** \brief Validate a Unicode character.
+ *
+ * This function checks the specified character. If it looks like a valid
+ * Unicode character, the function returns true.
+ *
+ * Valid characters are between 0 and 0x10FFFF inclusive. However, the
+ * code points between 0xD800 and 0xDFFF are considered invalid. They
+ * are not supported in UTF-32.
+ *
+ * When the \p ctrl flag is set to false, then control characters are not
+ * included so code points 0x00 to 0x1F and 0x7F to 0x9F are considered
+ * invalid even those they are valid UTF-32 code points.
+ *
+ * The function is constexpr so it can be used in static assertions and
+ * when building tables at compile time.
+ *
+ * \note
+ * Many code pointers are not yet defined in Unicode. If you want to
+ * test the code point itself, use the get_unicode_character() function
+ * and use the unicode_character::is_defined() function instead.
+ *
+ * \param[in] wc  The character to validate.
+ * \param[in] ctrl  Whether the character can be a control or not.
+ *
+ * \return true if wc is considered valid.
+ */
+constexpr bool is_valid_unicode(char32_t const wc, bool ctrl = true) noexcept
+{
+    if(ctrl)
+    {
+        return wc < 0x110000 && (wc < 0x00D800 || wc > 0x00DFFF);
+    }
+
+    return  wc <  0x110000
+        &&  wc >= 0x000020
+        && (wc <  0x00007F || wc > 0x00009F)
+        && (wc <  0x00D800 || wc > 0x00DFFF);
+}
+
+
+/** \brief Check whether a wide character represents a surrogate or not.
+ *
+ * This function checks whether \p wc represents a surrogate, either
+ * the low, the high or not a surrogate. The function returns a
+ * surrogate_t enumeration:
+ *
+ * \li SURROGATE_NO -- not a surrogate
+ * \li SURROGATE_HIGH -- a high surrogate (0xD800 to 0xDBFF)
+ * \li SURROGATE_LOW -- a low surrogate (0xDC00 to 0xDFFF)
+ *
+ * \param[in] wc  The wide character to be checked.
+ *
+ * \return The surrogate category.
+ */
+constexpr surrogate_t is_surrogate(char32_t wc) noexcept
+{
+    wc &= 0xFFFFFC00;
+    if(wc == 0xD800)
+    {
+        return surrogate_t::SURROGATE_HIGH;
+    }
+    if(wc == 0xDC00)
+    {
+        return surrogate_t::SURROGATE_LOW;
+    }
+    return surrogate_t::SURROGATE_NO;
+}
+
+
+
+/** \brief One character encoded in UTF-8.
+ *
+ * This class holds the UTF-8 bytes of one character in a fixed buffer.
+ * It is returned by to_u8char() so converting a single character does
+ * not require a memory allocation.
+ *
+ * The object can be used wherever an `std::string_view` is expected.
+ * An invalid character creates an empty object.
+ */
+class u8char
+{
+public:
+    constexpr               u8char() noexcept = default;
+
+    constexpr explicit      u8char(char32_t wc) noexcept
+    {
+        int const size(encode_utf8_char(f_bytes, wc));
+        if(size > 0)
+        {
+            f_size = static_cast<std::uint8_t>(size);
+        }
+    }
+
+    constexpr bool          empty() const noexcept { return f_size == 0; }
+    constexpr std::size_t   size() const noexcept { return f_size; }
+    constexpr std::size_t   length() const noexcept { return f_size; }
+    constexpr char const *  data() const noexcept { return f_bytes; }
+    constexpr std::string_view
+                            view() const noexcept { return std::string_view(f_bytes, f_size); }
+    constexpr               operator std::string_view () const noexcept { return view(); }
+
+    friend constexpr bool   operator == (u8char const & lhs, u8char const & rhs) noexcept { return lhs.view() == rhs.view(); }
+    friend constexpr bool   operator != (u8char const & lhs, u8char const & rhs) noexcept { return lhs.view() != rhs.view(); }
+
+private:
+    char                    f_bytes[4] = {};
+    std::uint8_t            f_size = 0;
+};
+
+
 
 
 bool                is_valid_ascii(char c, bool ctrl = true);
 bool                is_valid_ascii(char const * str, bool ctrl = true);
-bool                is_valid_ascii(std::string const & str, bool ctrl = true);
+bool                is_valid_ascii(std::string_view str, bool ctrl = true);
+std::size_t         ascii_prefix_length(std::string_view str);
 bool                is_valid_utf8(char const * str);
-bool                is_valid_utf8(std::string const & str);
-bool                is_valid_utf16(std::u16string const & str);
-bool                is_valid_unicode(char32_t const wc, bool ctrl = true);
+bool                is_valid_utf8(std::string_view str);
+bool                is_valid_utf16(std::u16string_view str);
 bool                is_valid_unicode(char32_t const * str, bool ctrl = true);
-bool                is_valid_unicode(std::u32string const & str, bool ctrl = true);
-surrogate_t         is_surrogate(char32_t wc);
+bool                is_valid_unicode(std::u32string_view str, bool ctrl = true);
 bom_t               start_with_bom(char const * str, size_t len);
-std::string         to_u8string(std::u32string const & str);
-std::string         to_u8string(std::u16string const & str);
-std::string         to_u8string(std::wstring const & str);
+std::string         decode_bytes(char const * data, std::size_t len, bom_t hint = bom_t::BOM_NONE);
+std::string         to_u8string(std::u32string_view str);
+std::string         to_u8string(std::u16string_view str);
+std::size_t         to_u8string(std::u32string_view str, char * out, std::size_t out_len);
+std::size_t         to_u8string(std::u16string_view str, char * out, std::size_t out_len);
+std::string         to_u8string(std::wstring_view str);
+std::size_t         to_u8string(std::wstring_view str, char * out, std::size_t out_len);
 std::string         to_u8string(wchar_t one, wchar_t two = L'\0');
 std::string         to_u8string(char16_t one, char16_t two = u'\0');
 std::string         to_u8string(char32_t const wc);
+u8char              to_u8char(char32_t const wc);
+std::string &       append_utf8(std::string & dst, std::u32string_view str);
+std::string &       append_utf8(std::string & dst, std::u16string_view str);
 std::u16string      to_u16string(char32_t const wc);
-std::u16string      to_u16string(std::string const & str);
-std::u32string      to_u32string(std::string const & str);
-std::size_t         u8length(std::string const & str);
-ssize_t             u16length(std::u16string const & str);
-int                 u8casecmp(std::string const & lhs, std::string const & rhs);
-bool                make_u8string_valid(std::string & str, char32_t fix_char = U'?');
+std::u16string      to_u16string(std::string_view str);
+std::size_t         to_u16string(std::string_view str, char16_t * out, std::size_t out_len);
+std::u32string      to_u32string(std::string_view str);
+std::size_t         to_u32string(std::string_view str, char32_t * out, std::size_t out_len);
+std::wstring        to_wstring(std::string_view str);
+std::size_t         to_wstring(std::string_view str, wchar_t * out, std::size_t out_len);
+std::size_t         u8length(std::string_view str);
+std::size_t         u8length_unchecked(std::string_view str);
+std::size_t         byte_offset_of(std::string_view str, std::size_t cp_index);
+ssize_t             u16length(std::u16string_view str);
+std::size_t         u16length_unchecked(std::u16string_view str);
+std::size_t         utf8_length_from_utf16(std::u16string_view str);
+std::size_t         utf8_length_from_utf32(std::u32string_view str);
+std::size_t         utf16_length_from_utf8(std::string_view str);
+std::size_t         utf16_length_from_utf32(std::u32string_view str);
+std::size_t         utf32_length_from_utf8(std::string_view str);
+std::size_t         utf32_length_from_utf16(std::u16string_view str);
+std::size_t         utf8_length_from_latin1(std::string_view str);
+std::size_t         utf8_length_from_wchar(std::wstring_view str);
+std::size_t         wchar_length_from_utf8(std::string_view str);
+int                 u8casecmp(std::string_view lhs, std::string_view rhs);
+bool                make_u8string_valid(std::string & str, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+bool                make_u8string_valid(std::string_view str, std::string & result, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+bool                make_u16string_valid(std::u16string & str, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+bool                make_u16string_valid(std::u16string_view str, std::u16string & result, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+bool                make_u32string_valid(std::u32string & str, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+bool                make_u32string_valid(std::u32string_view str, std::u32string & result, char32_t fix_char = U'?', replacement_policy_t policy = replacement_policy_t::REPLACEMENT_POLICY_SEQUENCE);
+
+
+
+/** \brief The string type used to return a conversion using \p Alloc.
+ *
+ * The allocator gets rebound to \p CharT so you can pass the same
+ * allocator (i.e. an `std::pmr::polymorphic_allocator<>`) to all the
+ * conversion functions.
+ */
+template<typename CharT, typename Alloc>
+using basic_string_with_t = std::basic_string<
+          CharT
+        , std::char_traits<CharT>
+        , typename std::allocator_traits<Alloc>::template rebind_alloc<CharT>>;
+
+
+/** \brief Converts a UTF-32 string to UTF-8 using \p alloc.
+ *
+ * This function is the same as to_u8string(std::u32string_view) except
+ * that the result gets allocated with \p alloc. For example, it can
+ * be placed in an `std::pmr::monotonic_buffer_resource` arena:
+ *
+ * \code
+ *     std::pmr::monotonic_buffer_resource arena;
+ *     std::pmr::string const s(libutf8::to_u8string(
+ *               str
+ *             , std::pmr::polymorphic_allocator<>(&arena)));
+ * \endcode
+ *
+ * The size of the output is computed first so the buffer gets allocated
+ * exactly once.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] alloc  The allocator used to allocate the result.
+ *
+ * \return The converted string.
+ */
+template<typename Alloc>
+basic_string_with_t<char, Alloc> to_u8string(std::u32string_view str, Alloc const & alloc)
+{
+    basic_string_with_t<char, Alloc> result(utf8_length_from_utf32(str), '\0', alloc);
+    to_u8string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Converts a UTF-16 string to UTF-8 using \p alloc.
+ *
+ * This function is the same as to_u8string(std::u16string_view) except
+ * that the result gets allocated with \p alloc.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] alloc  The allocator used to allocate the result.
+ *
+ * \return The converted string.
+ */
+template<typename Alloc>
+basic_string_with_t<char, Alloc> to_u8string(std::u16string_view str, Alloc const & alloc)
+{
+    basic_string_with_t<char, Alloc> result(utf8_length_from_utf16(str), '\0', alloc);
+    to_u8string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Transform a UTF-8 string to UTF-16 using \p alloc.
+ *
+ * This function is the same as to_u16string(std::string_view) except
+ * that the result gets allocated with \p alloc.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] alloc  The allocator used to allocate the result.
+ *
+ * \return The converted string.
+ */
+template<typename Alloc>
+basic_string_with_t<char16_t, Alloc> to_u16string(std::string_view str, Alloc const & alloc)
+{
+    basic_string_with_t<char16_t, Alloc> result(utf16_length_from_utf8(str), u'\0', alloc);
+    to_u16string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Transform a UTF-8 string to UTF-32 using \p alloc.
+ *
+ * This function is the same as to_u32string(std::string_view) except
+ * that the result gets allocated with \p alloc.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] alloc  The allocator used to allocate the result.
+ *
+ * \return The converted string.
+ */
+template<typename Alloc>
+basic_string_with_t<char32_t, Alloc> to_u32string(std::string_view str, Alloc const & alloc)
+{
+    basic_string_with_t<char32_t, Alloc> result(utf32_length_from_utf8(str), U'\0', alloc);
+    to_u32string(str, result.data(), result.length());
+    return result;
+}
+
+
+/** \brief Transform a UTF-8 string to wide characters using \p alloc.
+ *
+ * This function is the same as to_wstring(std::string_view) except
+ * that the result gets allocated with \p alloc.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] alloc  The allocator used to allocate the result.
+ *
+ * \return The converted string.
+ */
+template<typename Alloc>
+basic_string_with_t<wchar_t, Alloc> to_wstring(std::string_view str, Alloc const & alloc)
+{
+    basic_string_with_t<wchar_t, Alloc> result(wchar_length_from_utf8(str), L'\0', alloc);
+    to_wstring(str, result.data(), result.length());
+    return result;
+}
+
+
+
+namespace detail
+{
+
+[[noreturn]] void   invalid_utf32_character(char const * function, char32_t wc);
+
+} // detail namespace
+
+
+/** \brief Append one character to a UTF-8 string.
+ *
+ * This function encodes \p wc directly at the end of \p dst. No
+ * temporary string gets created.
+ *
+ * \exception libutf8_exception_encoding
+ * The input character must be a valid UTF-32 character or this exception
+ * gets raised. In that case \p dst is not modified.
+ *
+ * \param[in,out] dst  The string receiving the character.
+ * \param[in] wc  The character to append.
+ * \param[in] function  The name of the function used in the exception
+ * message, so the operators report the same error as before.
+ *
+ * \return A reference to \p dst.
+ */
+inline std::string & append_utf8(std::string & dst, char32_t wc, char const * function = "append_utf8(char32_t)")
+{
+    if(wc < 0x80)
+    {
+        dst += static_cast<char>(wc);
+        return dst;
+    }
+
+    char mb[4];
+    int const size(encode_utf8_char(mb, wc));
+    if(size < 0)
+    {
+        detail::invalid_utf32_character(function, wc);
+    }
+    return dst.append(mb, size);
+}
 
 
 
@@ -89,22 +407,43 @@ bool                make_u8string_valid(std::string & str, char32_t fix_char = U
 inline std::string operator + (char32_t wc, std::string const & rhs)
 {
     std::string v;
-    v = libutf8::to_u8string(wc);
-    return v + rhs;
+    v.reserve(4 + rhs.length());
+    libutf8::append_utf8(v, wc, "to_u8string(char32_t)");
+    return v += rhs;
+}
+
+
+inline std::string operator + (char32_t wc, std::string && rhs)
+{
+    libutf8::u8char const c(wc);
+    if(c.empty())
+    {
+        libutf8::detail::invalid_utf32_character("to_u8string(char32_t)", wc);
+    }
+    rhs.insert(0, c.data(), c.size());
+    return std::move(rhs);
 }
 
 
 inline std::string operator + (std::string const & lhs, char32_t wc)
 {
     std::string v;
-    v = libutf8::to_u8string(wc);
-    return lhs + v;
+    v.reserve(lhs.length() + 4);
+    v += lhs;
+    return libutf8::append_utf8(v, wc, "to_u8string(char32_t)");
+}
+
+
+inline std::string operator + (std::string && lhs, char32_t wc)
+{
+    libutf8::append_utf8(lhs, wc, "to_u8string(char32_t)");
+    return std::move(lhs);
 }
 
 
 inline std::string & operator += (std::string & lhs, char32_t wc)
 {
-    return lhs += libutf8::to_u8string(wc);
+    return libutf8::append_utf8(lhs, wc, "to_u8string(char32_t)");
 }
 
 
@@ -0,0 +1,590 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the multi-threaded functions.
+ *
+ * The input gets split in one chunk per thread. Since a UTF-8 lead byte
+ * is never a continuation byte, a chunk boundary is found by backing up
+ * over at most 3 continuation bytes.
+ *
+ * The conversions work in two passes. The first pass validates each
+ * chunk and computes the size of its output. A prefix sum of those
+ * sizes gives the offset where each chunk gets saved in the output
+ * buffer. The second pass converts the chunks at those offsets.
+ */
+
+// self
+//
+#include    "libutf8/parallel.h"
+
+#include    "libutf8/exception.h"
+#include    "libutf8/libutf8.h"
+#include    "libutf8/parallel_chunks.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <condition_variable>
+#include    <deque>
+#include    <mutex>
+#include    <system_error>
+#include    <thread>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The default executor.
+ *
+ * The pool keeps its threads between calls so a parallel function does
+ * not pay for starting threads each time it gets called. The threads
+ * get started the first time they are needed; the pool grows to the
+ * largest number of tasks run at once, minus one since the calling
+ * thread runs tasks too.
+ *
+ * The calling thread runs the first task and then helps with the tasks
+ * of its own call which were not yet picked up by a thread of the pool.
+ * So a call always completes, even when all the threads of the pool
+ * are busy with the tasks of another call.
+ */
+class thread_pool
+{
+public:
+    typedef std::function<void(std::size_t index)> task_t;
+
+    thread_pool() = default;
+    thread_pool(thread_pool const &) = delete;
+    thread_pool & operator = (thread_pool const &) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(f_mutex);
+            f_stop = true;
+        }
+        f_wakeup.notify_all();
+        for(auto & t : f_threads)
+        {
+            t.join();
+        }
+    }
+
+    void run(std::size_t count, task_t const & task)
+    {
+        job_t job;
+        job.f_task = &task;
+        job.f_pending = count - 1;
+        {
+            std::lock_guard<std::mutex> lock(f_mutex);
+            try
+            {
+                while(f_threads.size() < count - 1)
+                {
+                    f_threads.emplace_back(&thread_pool::worker, this);
+                }
+            }
+            catch(std::system_error const &)
+            {
+                // not enough resources for more threads, the calling
+                // thread runs the tasks no other thread picks up
+            }
+            for(std::size_t idx(1); idx < count; ++idx)
+            {
+                f_queue.push_back(item_t{ &job, idx });
+            }
+        }
+        f_wakeup.notify_all();
+
+        task(0);
+
+        std::unique_lock<std::mutex> lock(f_mutex);
+        for(;;)
+        {
+            auto it(std::find_if(
+                      f_queue.begin()
+                    , f_queue.end()
+                    , [&job](item_t const & item) { return item.f_job == &job; }));
+            if(it == f_queue.end())
+            {
+                break;
+            }
+            std::size_t const index(it->f_index);
+            f_queue.erase(it);
+            lock.unlock();
+            task(index);
+            lock.lock();
+            --job.f_pending;
+        }
+        f_done.wait(lock, [&job]() { return job.f_pending == 0; });
+    }
+
+private:
+    struct job_t
+    {
+        task_t const *          f_task = nullptr;
+        std::size_t             f_pending = 0;
+    };
+
+    struct item_t
+    {
+        job_t *                 f_job = nullptr;
+        std::size_t             f_index = 0;
+    };
+
+    void worker()
+    {
+        std::unique_lock<std::mutex> lock(f_mutex);
+        for(;;)
+        {
+            f_wakeup.wait(lock, [this]() { return f_stop || !f_queue.empty(); });
+            if(f_queue.empty())
+            {
+                return;
+            }
+            item_t const item(f_queue.front());
+            f_queue.pop_front();
+            lock.unlock();
+            (*item.f_job->f_task)(item.f_index);
+            lock.lock();
+            if(--item.f_job->f_pending == 0)
+            {
+                f_done.notify_all();
+            }
+        }
+    }
+
+    std::mutex                  f_mutex = std::mutex();
+    std::condition_variable     f_wakeup = std::condition_variable();
+    std::condition_variable     f_done = std::condition_variable();
+    std::deque<item_t>          f_queue = std::deque<item_t>();
+    std::vector<std::thread>    f_threads = std::vector<std::thread>();
+    bool                        f_stop = false;
+};
+
+
+/** \brief Run the tasks in the default thread pool.
+ *
+ * This function is the default executor. It runs the first task in the
+ * calling thread and the others in the threads of a pool shared by all
+ * the parallel functions.
+ */
+void run_in_threads(std::size_t count, std::function<void(std::size_t index)> const & task)
+{
+    static thread_pool g_pool;
+    g_pool.run(count, task);
+}
+
+
+
+} // no name namespace
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Split the input in chunks.
+ *
+ * The number of chunks is the number of threads unless the chunks would
+ * then be smaller than the minimum chunk size.
+ */
+std::vector<chunk_t> split_chunks(std::string_view str, parallel_options_t const & options)
+{
+    std::size_t threads(options.f_threads);
+    if(threads == 0)
+    {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    std::size_t const count(std::clamp<std::size_t>(
+                  str.length() / std::max<std::size_t>(options.f_min_chunk_size, 1)
+                , 1
+                , threads));
+
+    std::vector<chunk_t> chunks(count);
+    std::size_t start(0);
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::size_t const end(idx + 1 == count
+                    ? str.length()
+                    : std::max(start, utf8_split_point(str, str.length() / count * (idx + 1))));
+        chunks[idx].f_start = start;
+        chunks[idx].f_end = end;
+        start = end;
+    }
+    return chunks;
+}
+
+
+/** \brief Run one task per chunk.
+ */
+void run_chunks(std::size_t count, parallel_options_t const & options, std::function<void(std::size_t index)> const & task)
+{
+    if(count == 1)
+    {
+        task(0);
+    }
+    else if(options.f_executor)
+    {
+        options.f_executor(count, task);
+    }
+    else
+    {
+        run_in_threads(count, task);
+    }
+}
+
+
+
+} // detail namespace
+
+
+
+namespace
+{
+
+
+
+template<typename OutputT>
+std::size_t output_length(std::string_view str)
+{
+    if constexpr(sizeof(OutputT) == 2)
+    {
+        return utf16_length_from_utf8(str);
+    }
+    else
+    {
+        return utf32_length_from_utf8(str);
+    }
+}
+
+
+/** \brief Validate the chunks and compute the output offsets.
+ *
+ * This is the first pass of a conversion. On return, the chunks after
+ * the first one including an error are removed since nothing gets
+ * converted past that error.
+ *
+ * \return The size of the output of the valid part of the input.
+ */
+template<typename OutputT>
+std::size_t measure_chunks(std::string_view str, std::vector<detail::chunk_t> & chunks, parallel_options_t const & options)
+{
+    detail::kernels_t const & k(detail::kernels());
+    detail::run_chunks(chunks.size(), options, [&str, &chunks, &k](std::size_t index)
+        {
+            detail::chunk_t & c(chunks[index]);
+            std::string_view const part(str.substr(c.f_start, c.f_end - c.f_start));
+            c.f_valid = k.f_validate_utf8(part.data(), part.length());
+            c.f_length = output_length<OutputT>(part.substr(0, c.f_valid));
+        });
+
+    std::size_t offset(0);
+    for(std::size_t idx(0); idx < chunks.size(); ++idx)
+    {
+        detail::chunk_t & c(chunks[idx]);
+        c.f_offset = offset;
+        offset += c.f_length;
+        if(c.f_start + c.f_valid != c.f_end)
+        {
+            chunks.resize(idx + 1);
+            break;
+        }
+    }
+    return offset;
+}
+
+
+/** \brief Convert the chunks in the output buffer.
+ *
+ * This is the second pass of a conversion. Only the last chunk can
+ * stop early, either because it includes an error or because the
+ * output buffer is too small. When the output buffer is too small,
+ * the chunks which do not fit at all are ignored.
+ */
+template<typename OutputT>
+transcode_result_t convert_chunks(std::string_view str, std::vector<detail::chunk_t> & chunks, OutputT * out, std::size_t out_cap, parallel_options_t const & options)
+{
+    auto const too_small(std::find_if(
+              chunks.begin()
+            , chunks.end()
+            , [out_cap](detail::chunk_t const & c)
+                {
+                    return c.f_offset + c.f_length > out_cap;
+                }));
+    if(too_small != chunks.end())
+    {
+        chunks.erase(too_small + 1, chunks.end());
+    }
+
+    std::size_t const last_chunk(chunks.size() - 1);
+    transcode_result_t last;
+    detail::run_chunks(chunks.size(), options, [&str, &chunks, out, out_cap, last_chunk, &last](std::size_t index)
+        {
+            detail::chunk_t const & c(chunks[index]);
+            std::string_view const part(str.substr(c.f_start, c.f_end - c.f_start));
+            if(index == last_chunk)
+            {
+                last = transcode<char, OutputT>(part, out + c.f_offset, out_cap - c.f_offset);
+            }
+            else
+            {
+                transcode<char, OutputT>(part, out + c.f_offset, c.f_length);
+            }
+        });
+
+    detail::chunk_t const & c(chunks[last_chunk]);
+    transcode_result_t result(last);
+    result.f_error_position += c.f_start;
+    result.f_read += c.f_start;
+    result.f_written += c.f_offset;
+    if(result.f_status == transcode_status_t::TRANSCODE_STATUS_TRUNCATED
+    && c.f_end != str.length())
+    {
+        // the character is cut by the end of the chunk, not of the input
+        //
+        result.f_status = transcode_status_t::TRANSCODE_STATUS_INVALID;
+    }
+    return result;
+}
+
+
+template<typename OutputT>
+transcode_result_t convert_parallel(std::string_view in, OutputT * out, std::size_t out_cap, parallel_options_t const & options)
+{
+    std::vector<detail::chunk_t> chunks(detail::split_chunks(in, options));
+    measure_chunks<OutputT>(in, chunks, options);
+    return convert_chunks(in, chunks, out, out_cap, options);
+}
+
+
+template<typename OutputT>
+std::basic_string<OutputT> to_string_parallel(char const * function, std::string_view str, parallel_options_t const & options)
+{
+    std::vector<detail::chunk_t> chunks(detail::split_chunks(str, options));
+    std::basic_string<OutputT> result(measure_chunks<OutputT>(str, chunks, options), OutputT());
+    transcode_result_t const r(convert_chunks(str, chunks, result.data(), result.length(), options));
+    if(!r.ok())
+    {
+        throw libutf8_exception_decoding(
+                  std::string(function)
+                + ": the input includes an invalid UTF-8 character at position "
+                + std::to_string(r.f_error_position)
+                + ".");
+    }
+    return result;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Find a character boundary in a UTF-8 string.
+ *
+ * This function returns the position of the character which includes
+ * the byte at \p pos. Since a character is at most 4 bytes, the function
+ * backs up over at most 3 continuation bytes.
+ *
+ * If the byte at \p pos is preceded by 3 or more continuation bytes, it
+ * can't be part of a valid character so \p pos is returned as is. When
+ * \p pos is at or after the end of the string, the function returns the
+ * length of the string.
+ *
+ * Cutting a string at the returned position never cuts a valid character
+ * in half, so the two parts can be validated or converted separately.
+ *
+ * \param[in] str  The UTF-8 string to split.
+ * \param[in] pos  The position where the string is to be split.
+ *
+ * \return The position of the character including \p pos.
+ */
+std::size_t utf8_split_point(std::string_view str, std::size_t pos)
+{
+    if(pos >= str.length())
+    {
+        return str.length();
+    }
+
+    for(std::size_t back(0); back < 4 && back <= pos; ++back)
+    {
+        if((static_cast<unsigned char>(str[pos - back]) & 0xC0) != 0x80)
+        {
+            return pos - back;
+        }
+    }
+
+    return pos;
+}
+
+
+/** \brief Validate a large UTF-8 buffer using several threads.
+ *
+ * This function does the same as is_valid_utf8() with one thread per
+ * chunk of the input. The number of threads and the minimum size of a
+ * chunk are defined in \p options. By default, the function uses one
+ * thread per CPU and does not split buffers under 1Mb.
+ *
+ * When the buffer is valid, the function returns a successful result
+ * with f_read and f_error_position set to the length of \p str.
+ * Otherwise the status is set to TRANSCODE_STATUS_INVALID, or
+ * TRANSCODE_STATUS_TRUNCATED if the buffer ends in the middle of a
+ * character, and the f_error_position and f_read fields are set to the
+ * offset of the first invalid sequence in the whole buffer. This is the
+ * same status as the one of convert_utf8_to_utf16_parallel().
+ *
+ * \param[in] str  The buffer to validate.
+ * \param[in] options  The threading options.
+ *
+ * \return The status of the validation.
+ */
+transcode_result_t validate_utf8_parallel(std::string_view str, parallel_options_t const & options)
+{
+    std::vector<detail::chunk_t> chunks(detail::split_chunks(str, options));
+    detail::kernels_t const & k(detail::kernels());
+    detail::run_chunks(chunks.size(), options, [&str, &chunks, &k](std::size_t index)
+        {
+            detail::chunk_t & c(chunks[index]);
+            c.f_valid = k.f_validate_utf8(str.data() + c.f_start, c.f_end - c.f_start);
+        });
+
+    transcode_result_t result;
+    result.f_read = str.length();
+    for(auto const & c : chunks)
+    {
+        if(c.f_start + c.f_valid != c.f_end)
+        {
+            // as with convert_chunks(), the input of the last chunk may
+            // end in the middle of a character
+            //
+            result.f_read = c.f_start + c.f_valid;
+            result.f_status = c.f_end == str.length()
+                           && utf8_is_truncated(str.data() + result.f_read, str.length() - result.f_read)
+                        ? transcode_status_t::TRANSCODE_STATUS_TRUNCATED
+                        : transcode_status_t::TRANSCODE_STATUS_INVALID;
+            break;
+        }
+    }
+    result.f_error_position = result.f_read;
+    return result;
+}
+
+
+/** \brief Convert a large UTF-8 buffer to UTF-16 using several threads.
+ *
+ * This function does the same as convert_utf8_to_utf16() with one thread
+ * per chunk of the input. The first pass validates the chunks and
+ * computes the size of their output; the second pass converts them in
+ * the output buffer.
+ *
+ * The returned positions and counters are relative to the whole
+ * input and output buffers, so the result is the same as the one of
+ * convert_utf8_to_utf16().
+ *
+ * \param[in] in  The UTF-8 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of code units available in \p out.
+ * \param[in] options  The threading options.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf8_to_utf16_parallel(std::string_view in, char16_t * out, std::size_t out_cap, parallel_options_t const & options)
+{
+    return convert_parallel(in, out, out_cap, options);
+}
+
+
+/** \brief Convert a large UTF-8 buffer to UTF-32 using several threads.
+ *
+ * This function works like convert_utf8_to_utf16_parallel() with a
+ * UTF-32 output.
+ *
+ * \param[in] in  The UTF-8 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of characters available in \p out.
+ * \param[in] options  The threading options.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf8_to_utf32_parallel(std::string_view in, char32_t * out, std::size_t out_cap, parallel_options_t const & options)
+{
+    return convert_parallel(in, out, out_cap, options);
+}
+
+
+/** \brief Transform a large UTF-8 buffer to UTF-16 using several threads.
+ *
+ * This function does the same as to_u16string() with one thread per
+ * chunk of the input.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] options  The threading options.
+ *
+ * \return The converted string.
+ */
+std::u16string to_u16string_parallel(std::string_view str, parallel_options_t const & options)
+{
+    return to_string_parallel<char16_t>("to_u16string_parallel()", str, options);
+}
+
+
+/** \brief Transform a large UTF-8 buffer to UTF-32 using several threads.
+ *
+ * This function does the same as to_u32string() with one thread per
+ * chunk of the input.
+ *
+ * \exception libutf8_exception_decoding
+ * The input string is not valid UTF-8.
+ *
+ * \param[in] str  The string to convert.
+ * \param[in] options  The threading options.
+ *
+ * \return The converted string.
+ */
+std::u32string to_u32string_parallel(std::string_view str, parallel_options_t const & options)
+{
+    return to_string_parallel<char32_t>("to_u32string_parallel()", str, options);
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,80 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the multi-threaded functions.
+ *
+ * The functions declared here validate and convert very large UTF-8
+ * buffers using several threads. The input gets split in chunks at
+ * character boundaries, each chunk is handled by the SIMD kernels in
+ * its own thread, and the results are merged as if the whole buffer
+ * had been handled at once (i.e. the offset of the first error is an
+ * offset in the whole buffer).
+ */
+
+// self
+//
+#include    <libutf8/transcode.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <functional>
+#include    <string>
+#include    <string_view>
+
+
+
+namespace libutf8
+{
+
+
+
+/** \brief Function used to run the tasks of a parallel function.
+ *
+ * The executor is called with the number of tasks to run and the task
+ * function. It has to call `task(0)` to `task(count - 1)` exactly once
+ * each, in any order and in any thread, and return once all of them
+ * are done. The tasks do not throw.
+ */
+typedef std::function<void(std::size_t count, std::function<void(std::size_t index)> const & task)>
+                                    parallel_executor_t;
+
+
+struct parallel_options_t
+{
+    std::size_t                     f_threads = 0;                      // 0 means std::thread::hardware_concurrency()
+    std::size_t                     f_min_chunk_size = 1024 * 1024;     // smaller buffers are not split any further
+    parallel_executor_t             f_executor = parallel_executor_t(); // when not set, use a pool of std::thread shared by all calls
+};
+
+
+std::size_t         utf8_split_point(std::string_view str, std::size_t pos);
+transcode_result_t  validate_utf8_parallel(std::string_view str, parallel_options_t const & options = parallel_options_t());
+transcode_result_t  convert_utf8_to_utf16_parallel(std::string_view in, char16_t * out, std::size_t out_cap, parallel_options_t const & options = parallel_options_t());
+transcode_result_t  convert_utf8_to_utf32_parallel(std::string_view in, char32_t * out, std::size_t out_cap, parallel_options_t const & options = parallel_options_t());
+std::u16string      to_u16string_parallel(std::string_view str, parallel_options_t const & options = parallel_options_t());
+std::u32string      to_u32string_parallel(std::string_view str, parallel_options_t const & options = parallel_options_t());
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
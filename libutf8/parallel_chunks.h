@@ -0,0 +1,74 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the chunk functions.
+ *
+ * The functions declared here split a UTF-8 buffer in chunks at
+ * character boundaries and run one task per chunk, in parallel. They
+ * are shared by the parallel functions and the utf8_index.
+ *
+ * This file is considered private.
+ */
+
+// self
+//
+#include    <libutf8/parallel.h>
+
+
+// C++
+//
+#include    <vector>
+
+
+
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+/** \brief One chunk of the input of a parallel function.
+ *
+ * The f_valid field is the number of valid bytes at the start of the
+ * chunk and f_length the size of the output of those bytes. The
+ * f_offset is the position of the output in the output buffer.
+ */
+struct chunk_t
+{
+    std::size_t         f_start = 0;
+    std::size_t         f_end = 0;
+    std::size_t         f_valid = 0;
+    std::size_t         f_length = 0;
+    std::size_t         f_offset = 0;
+};
+
+
+std::vector<chunk_t>    split_chunks(std::string_view str, parallel_options_t const & options);
+void                    run_chunks(std::size_t count, parallel_options_t const & options, std::function<void(std::size_t index)> const & task);
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,444 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The C++20 ranges views of the library.
+ *
+ * The views declared here decode UTF-8, UTF-16, or UTF-32 code units to
+ * characters and encode characters back to code units lazily, so they
+ * can be combined with the std::ranges views without building an
+ * intermediate std::u32string:
+ *
+ * \code
+ *     std::string_view const str(...);
+ *     auto lower(str
+ *             | libutf8::views::utf8_decode
+ *             | std::views::transform([](char32_t c) { return static_cast<char32_t>(std::towlower(c)); })
+ *             | libutf8::views::utf8_encode);
+ *     std::string result(lower.begin(), lower.end());
+ * \endcode
+ *
+ * The adaptors can also be composed before being applied to a range,
+ * as in `utf8_decode | std::views::transform(f) | utf8_encode`.
+ *
+ * The views are only available when the standard library supports
+ * ranges (i.e. `__cpp_lib_ranges` is defined).
+ */
+
+// self
+//
+#include    <libutf8/iterator.h>
+
+
+// C++
+//
+#include    <version>
+
+#ifdef __cpp_lib_ranges
+#include    <concepts>
+#include    <cstdint>
+#include    <iterator>
+#include    <ranges>
+#include    <type_traits>
+#include    <utility>
+
+
+
+namespace libutf8
+{
+
+
+
+/** \brief A view decoding a contiguous range of code units.
+ *
+ * This view iterates the characters of a contiguous range of UTF-8
+ * (`char`), UTF-16 (`char16_t`), or UTF-32 (`char32_t`) code units
+ * using a basic_view_iterator. The view is a bidirectional and common
+ * range, so it works with `std::views::reverse`.
+ *
+ * Invalid sequences are returned as libutf8::NOT_A_CHARACTER.
+ *
+ * \tparam V  The underlying view.
+ * \tparam CharT  The type of the code units.
+ */
+template<std::ranges::view V, typename CharT>
+    requires std::ranges::contiguous_range<V const>
+          && std::ranges::sized_range<V const>
+          && std::same_as<std::ranges::range_value_t<V const>, CharT>
+class decode_view
+    : public std::ranges::view_interface<decode_view<V, CharT>>
+{
+public:
+    typedef basic_view_iterator<CharT>      iterator;
+
+    constexpr                   decode_view() requires std::default_initializable<V> = default;
+    constexpr explicit          decode_view(V base) : f_base(std::move(base)) {}
+
+    constexpr V                 base() const & requires std::copy_constructible<V> { return f_base; }
+    constexpr V                 base() && { return std::move(f_base); }
+
+    constexpr iterator          begin() const
+                                {
+                                    CharT const * const data(std::ranges::data(f_base));
+                                    return iterator(data, data + std::ranges::size(f_base), data);
+                                }
+
+    constexpr iterator          end() const
+                                {
+                                    CharT const * const data(std::ranges::data(f_base));
+                                    std::size_t const size(std::ranges::size(f_base));
+                                    return iterator(data, data + size, data + size);
+                                }
+
+private:
+    V                           f_base = V();
+};
+
+
+/** \brief A view encoding a range of characters to code units.
+ *
+ * This view converts each character of the underlying range to UTF-8
+ * (`char`), UTF-16 (`char16_t`), or UTF-32 (`char32_t`) code units.
+ * The underlying range can be any forward range of values convertible
+ * to `char32_t`, such as a decode_view followed by a
+ * `std::views::transform`. The view is bidirectional when the
+ * underlying range is bidirectional and common when it is common.
+ *
+ * Invalid characters (i.e. libutf8::NOT_A_CHARACTER, surrogates, or
+ * values over 0x10FFFF) are encoded as libutf8::REPLACEMENT_CHAR so the
+ * output is always valid.
+ *
+ * \tparam V  The underlying view.
+ * \tparam CharT  The type of the code units to generate.
+ */
+template<std::ranges::view V, typename CharT>
+    requires std::ranges::forward_range<V>
+          && std::convertible_to<std::ranges::range_reference_t<V>, char32_t>
+class encode_view
+    : public std::ranges::view_interface<encode_view<V, CharT>>
+{
+public:
+    class iterator
+    {
+    public:
+        typedef std::conditional_t<
+                      std::ranges::bidirectional_range<V>
+                    , std::bidirectional_iterator_tag
+                    , std::forward_iterator_tag>    iterator_concept;
+        typedef std::input_iterator_tag             iterator_category;
+        typedef CharT                               value_type;
+        typedef std::ptrdiff_t                      difference_type;
+
+        constexpr               iterator() = default;
+
+        constexpr               iterator(std::ranges::iterator_t<V> current, std::ranges::sentinel_t<V> end)
+                                    : f_current(std::move(current))
+                                    , f_end(std::move(end))
+                                {
+                                    load();
+                                }
+
+        constexpr CharT         operator * () const { return f_units[f_index]; }
+
+        constexpr iterator &    operator ++ ()
+                                {
+                                    ++f_index;
+                                    if(f_index >= f_size)
+                                    {
+                                        ++f_current;
+                                        f_index = 0;
+                                        load();
+                                    }
+                                    return *this;
+                                }
+
+        constexpr iterator      operator ++ (int)
+                                {
+                                    iterator it(*this);
+                                    ++*this;
+                                    return it;
+                                }
+
+        constexpr iterator &    operator -- () requires std::ranges::bidirectional_range<V>
+                                {
+                                    if(f_index > 0)
+                                    {
+                                        --f_index;
+                                    }
+                                    else
+                                    {
+                                        --f_current;
+                                        load();
+                                        f_index = f_size - 1;
+                                    }
+                                    return *this;
+                                }
+
+        constexpr iterator      operator -- (int) requires std::ranges::bidirectional_range<V>
+                                {
+                                    iterator it(*this);
+                                    --*this;
+                                    return it;
+                                }
+
+        friend constexpr bool   operator == (iterator const & lhs, iterator const & rhs)
+                                {
+                                    return lhs.f_current == rhs.f_current
+                                        && lhs.f_index == rhs.f_index;
+                                }
+
+        friend constexpr bool   operator == (iterator const & lhs, std::default_sentinel_t)
+                                {
+                                    return lhs.f_current == lhs.f_end;
+                                }
+
+    private:
+        constexpr void          load()
+                                {
+                                    if(f_current == f_end)
+                                    {
+                                        f_size = 0;
+                                        return;
+                                    }
+
+                                    char32_t wc(static_cast<char32_t>(*f_current));
+                                    if(wc >= 0x110000 || (wc >= 0xD800 && wc <= 0xDFFF))
+                                    {
+                                        wc = REPLACEMENT_CHAR;
+                                    }
+                                    if constexpr(std::is_same_v<CharT, char>)
+                                    {
+                                        f_size = static_cast<std::uint8_t>(encode_utf8_char(f_units, wc));
+                                    }
+                                    else if constexpr(std::is_same_v<CharT, char16_t>)
+                                    {
+                                        if(wc >= 0x10000)
+                                        {
+                                            wc -= 0x10000;
+                                            f_units[0] = static_cast<char16_t>((wc >> 10) | 0xD800);
+                                            f_units[1] = static_cast<char16_t>((wc & 0x03FF) | 0xDC00);
+                                            f_size = 2;
+                                        }
+                                        else
+                                        {
+                                            f_units[0] = static_cast<char16_t>(wc);
+                                            f_size = 1;
+                                        }
+                                    }
+                                    else
+                                    {
+                                        f_units[0] = wc;
+                                        f_size = 1;
+                                    }
+                                }
+
+        std::ranges::iterator_t<V>  f_current = std::ranges::iterator_t<V>();
+        std::ranges::sentinel_t<V>  f_end = std::ranges::sentinel_t<V>();
+        CharT                       f_units[4 / sizeof(CharT)] = {};
+        std::uint8_t                f_size = 0;
+        std::uint8_t                f_index = 0;
+    };
+
+    constexpr                   encode_view() requires std::default_initializable<V> = default;
+    constexpr explicit          encode_view(V base) : f_base(std::move(base)) {}
+
+    constexpr V                 base() const & requires std::copy_constructible<V> { return f_base; }
+    constexpr V                 base() && { return std::move(f_base); }
+
+    constexpr iterator          begin()
+                                {
+                                    return iterator(std::ranges::begin(f_base), std::ranges::end(f_base));
+                                }
+
+    constexpr auto              end()
+                                {
+                                    if constexpr(std::ranges::common_range<V>)
+                                    {
+                                        return iterator(std::ranges::end(f_base), std::ranges::end(f_base));
+                                    }
+                                    else
+                                    {
+                                        return std::default_sentinel;
+                                    }
+                                }
+
+private:
+    V                           f_base = V();
+};
+
+
+
+namespace views
+{
+namespace detail
+{
+
+
+
+template<typename T>
+struct is_closure
+    : std::false_type
+{
+};
+
+
+template<typename T>
+inline constexpr bool is_closure_v = is_closure<std::remove_cvref_t<T>>::value;
+
+
+/** \brief Two range adaptors applied one after the other.
+ *
+ * This closure is the result of the `|` operator between a libutf8
+ * adaptor and another adaptor (from libutf8 or the standard library)
+ * without a range, as in:
+ *
+ * \code
+ *     auto lower(libutf8::views::utf8_decode
+ *             | std::views::transform(my_casefold)
+ *             | libutf8::views::utf8_encode);
+ *     auto result(str | lower);
+ * \endcode
+ *
+ * Applying it to a range applies \p Lhs and then \p Rhs.
+ */
+template<typename Lhs, typename Rhs>
+struct pipe_fn
+{
+    template<std::ranges::viewable_range R>
+        requires std::invocable<Lhs const &, R>
+              && std::invocable<Rhs const &, std::invoke_result_t<Lhs const &, R>>
+    constexpr auto operator () (R && r) const
+    {
+        return f_rhs(f_lhs(std::forward<R>(r)));
+    }
+
+    template<std::ranges::viewable_range R>
+        requires std::invocable<pipe_fn const &, R>
+    friend constexpr auto operator | (R && r, pipe_fn const & f)
+    {
+        return f(std::forward<R>(r));
+    }
+
+    Lhs                         f_lhs;
+    Rhs                         f_rhs;
+};
+
+
+template<typename Lhs, typename Rhs>
+struct is_closure<pipe_fn<Lhs, Rhs>>
+    : std::true_type
+{
+};
+
+
+/** \brief The range adaptor creating a decode_view.
+ *
+ * The adaptor can be called with a range or used with the `|` operator.
+ */
+template<typename CharT>
+struct decode_fn
+{
+    template<std::ranges::viewable_range R>
+    constexpr auto operator () (R && r) const
+    {
+        return decode_view<std::views::all_t<R>, CharT>(std::views::all(std::forward<R>(r)));
+    }
+
+    template<std::ranges::viewable_range R>
+    friend constexpr auto operator | (R && r, decode_fn const & f)
+    {
+        return f(std::forward<R>(r));
+    }
+};
+
+
+template<typename CharT>
+struct is_closure<decode_fn<CharT>>
+    : std::true_type
+{
+};
+
+
+/** \brief The range adaptor creating an encode_view.
+ *
+ * The adaptor can be called with a range or used with the `|` operator.
+ */
+template<typename CharT>
+struct encode_fn
+{
+    template<std::ranges::viewable_range R>
+    constexpr auto operator () (R && r) const
+    {
+        return encode_view<std::views::all_t<R>, CharT>(std::views::all(std::forward<R>(r)));
+    }
+
+    template<std::ranges::viewable_range R>
+    friend constexpr auto operator | (R && r, encode_fn const & f)
+    {
+        return f(std::forward<R>(r));
+    }
+};
+
+
+template<typename CharT>
+struct is_closure<encode_fn<CharT>>
+    : std::true_type
+{
+};
+
+
+/** \brief Compose two range adaptors.
+ *
+ * The standard adaptors only compose with each other (in C++20, the
+ * std::ranges::range_adaptor_closure base class is not available). This
+ * operator composes a libutf8 adaptor with any other adaptor, on either
+ * side, so a pipeline can be built before it gets applied to a range.
+ * It is found by argument dependent lookup.
+ */
+template<typename Lhs, typename Rhs>
+    requires (is_closure_v<Lhs> || is_closure_v<Rhs>)
+          && (!std::ranges::range<std::remove_cvref_t<Lhs>>)
+          && (!std::ranges::range<std::remove_cvref_t<Rhs>>)
+constexpr auto operator | (Lhs && lhs, Rhs && rhs)
+{
+    return pipe_fn<std::decay_t<Lhs>, std::decay_t<Rhs>>{ std::forward<Lhs>(lhs), std::forward<Rhs>(rhs) };
+}
+
+
+
+} // detail namespace
+
+
+inline constexpr detail::decode_fn<char>        utf8_decode;
+inline constexpr detail::decode_fn<char16_t>    utf16_decode;
+inline constexpr detail::decode_fn<char32_t>    utf32_decode;
+
+inline constexpr detail::encode_fn<char>        utf8_encode;
+inline constexpr detail::encode_fn<char16_t>    utf16_encode;
+inline constexpr detail::encode_fn<char32_t>    utf32_encode;
+
+
+} // views namespace
+
+
+
+} // libutf8 namespace
+#endif
+// vim: ts=4 sw=4 et
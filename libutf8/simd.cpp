@@ -0,0 +1,723 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the kernel selection and scalar kernels.
+ *
+ * This file detects the SIMD instructions supported by the running CPU
+ * and fills the table of kernels accordingly. It also includes the
+ * scalar (plain C++) version of each kernel which is used when no SIMD
+ * instructions are available and to finish the work of the SIMD kernels
+ * (i.e. the last few bytes of a buffer or to determine the exact position
+ * of an error).
+ */
+
+// self
+//
+#include    "libutf8/simd_kernels.h"
+
+#include    "libutf8/base.h"
+#include    "libutf8/exception.h"
+#include    "libutf8/libutf8.h"
+
+
+// C++
+//
+#include    <atomic>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+namespace
+{
+
+
+
+simd_t detect_simd()
+{
+#if LIBUTF8_X86_SIMD
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx512f")
+    && __builtin_cpu_supports("avx512bw")
+    && __builtin_cpu_supports("avx512vl")
+    && __builtin_cpu_supports("avx512vbmi")
+    && __builtin_cpu_supports("avx512vbmi2")
+    && __builtin_cpu_supports("bmi")
+    && __builtin_cpu_supports("bmi2")
+    && __builtin_cpu_supports("popcnt"))
+    {
+        return simd_t::SIMD_AVX512;
+    }
+
+    if(__builtin_cpu_supports("avx2")
+    && __builtin_cpu_supports("bmi")
+    && __builtin_cpu_supports("bmi2")
+    && __builtin_cpu_supports("popcnt"))
+    {
+        return simd_t::SIMD_AVX2;
+    }
+
+    if(__builtin_cpu_supports("sse4.2")
+    && __builtin_cpu_supports("popcnt"))
+    {
+        return simd_t::SIMD_SSE4_2;
+    }
+#endif
+
+    return simd_t::SIMD_NONE;
+}
+
+
+/** \brief The tables of kernels.
+ *
+ * This structure holds one table of kernels per SIMD level. Each level
+ * starts as a copy of the previous level and then overwrites the kernels
+ * it has a better implementation for.
+ *
+ * The object is created the first time it is needed and also when the
+ * library gets loaded (see g_load_time_tables below).
+ */
+struct kernel_tables_t
+{
+    kernel_tables_t()
+        : f_best(detect_simd())
+    {
+        kernels_t & scalar(f_tables[static_cast<int>(simd_t::SIMD_NONE)]);
+        scalar.f_validate_ascii = validate_ascii_scalar;
+        scalar.f_validate_utf8 = validate_utf8_scalar;
+        scalar.f_validate_utf16 = validate_utf16_scalar;
+        scalar.f_validate_utf32 = validate_utf32_scalar;
+        scalar.f_u8length = u8length_scalar;
+        scalar.f_u8length_unchecked = u8length_unchecked_scalar;
+        scalar.f_utf8_offset_of = utf8_offset_of_scalar;
+        scalar.f_u16length = u16length_scalar;
+        scalar.f_u16length_unchecked = u16length_unchecked_scalar;
+        scalar.f_utf8_length_from_utf16 = utf8_length_from_utf16_scalar;
+        scalar.f_utf8_length_from_utf32 = utf8_length_from_utf32_scalar;
+        scalar.f_utf16_length_from_utf8 = utf16_length_from_utf8_scalar;
+        scalar.f_utf16_length_from_utf32 = utf16_length_from_utf32_scalar;
+        scalar.f_utf8_length_from_latin1 = utf8_length_from_latin1_scalar;
+        scalar.f_utf8_to_utf16 = convert_none<char, char16_t>;
+        scalar.f_utf16_to_utf8 = convert_none<char16_t, char>;
+        scalar.f_utf8_to_utf32 = convert_none<char, char32_t>;
+        scalar.f_latin1_to_utf8 = convert_none<char, char>;
+        scalar.f_utf8_to_latin1 = convert_none<char, char>;
+        scalar.f_swap_bytes16 = swap_bytes_scalar<char16_t>;
+        scalar.f_swap_bytes32 = swap_bytes_scalar<char32_t>;
+
+#if LIBUTF8_X86_SIMD
+        f_tables[static_cast<int>(simd_t::SIMD_SSE4_2)] = scalar;
+        sse4_2_kernels(f_tables[static_cast<int>(simd_t::SIMD_SSE4_2)]);
+
+        f_tables[static_cast<int>(simd_t::SIMD_AVX2)] = f_tables[static_cast<int>(simd_t::SIMD_SSE4_2)];
+        avx2_kernels(f_tables[static_cast<int>(simd_t::SIMD_AVX2)]);
+
+        f_tables[static_cast<int>(simd_t::SIMD_AVX512)] = f_tables[static_cast<int>(simd_t::SIMD_AVX2)];
+        avx512_kernels(f_tables[static_cast<int>(simd_t::SIMD_AVX512)]);
+#endif
+
+        f_current.store(f_tables + static_cast<int>(f_best));
+    }
+
+    simd_t const                    f_best;
+    kernels_t                       f_tables[4] = {};
+    std::atomic<kernels_t const *>  f_current = nullptr;
+};
+
+
+kernel_tables_t & tables()
+{
+    static kernel_tables_t g_tables;
+    return g_tables;
+}
+
+
+// select the kernels at load time
+//
+kernel_tables_t const & g_load_time_tables(tables());
+
+
+
+} // no name namespace
+
+
+
+/** \brief Get the table of kernels to use.
+ *
+ * This function returns the table of kernels that the library functions
+ * call to do the actual work. By default, this is the best set of
+ * kernels for the running CPU.
+ *
+ * \return A reference to the current table of kernels.
+ */
+kernels_t const & kernels()
+{
+    return *tables().f_current.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Validate an ASCII buffer one byte at a time.
+ *
+ * This function returns the offset of the first byte which is not ASCII
+ * (0x80 to 0xFF). When \p ctrl is false, the controls (0x00 to 0x1F and
+ * 0x7F) are also invalid. If the whole buffer is valid, then the function
+ * returns \p len.
+ *
+ * \param[in] str  The buffer to validate.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[in] ctrl  Whether controls are accepted.
+ *
+ * \return The offset of the first invalid byte or \p len.
+ */
+std::size_t validate_ascii_scalar(char const * str, std::size_t len, bool ctrl)
+{
+    for(std::size_t pos(0); pos < len; ++pos)
+    {
+        unsigned char const c(static_cast<unsigned char>(str[pos]));
+        if(c >= 0x80
+        || (!ctrl && (c < 0x20 || c == 0x7F)))
+        {
+            return pos;
+        }
+    }
+    return len;
+}
+
+
+/** \brief Validate a UTF-8 buffer one byte at a time.
+ *
+ * This function checks each byte of \p str and returns the offset of the
+ * first byte which is not part of a valid UTF-8 sequence. If the whole
+ * buffer is valid, then the function returns \p len.
+ *
+ * The function follows the definition of UTF-8 found in RFC 3629: no
+ * overlong sequences, no UTF-16 surrogates, and no characters over
+ * 0x10FFFF. The characters are decoded with decode_utf8_char() so it
+ * accepts exactly what mbstowc() accepts.
+ *
+ * \param[in] str  The buffer to validate.
+ * \param[in] len  The number of bytes in \p str.
+ *
+ * \return The offset of the first invalid sequence or \p len.
+ */
+std::size_t validate_utf8_scalar(char const * str, std::size_t len)
+{
+    std::size_t pos(0);
+    while(pos < len)
+    {
+        if(static_cast<unsigned char>(str[pos]) < 0x80)
+        {
+            ++pos;
+            continue;
+        }
+
+        char32_t wc(U'\0');
+        int const size(decode_utf8_char(wc, str + pos, len - pos));
+        if(size < 0)
+        {
+            // not a supported character
+            //
+            return pos;
+        }
+        pos += size;
+    }
+
+    return len;
+}
+
+
+/** \brief Finish a validation with the scalar kernel.
+ *
+ * The SIMD kernels validate blocks of bytes. When a block includes an
+ * error, or when the end of the buffer is reached, they call this function
+ * to find the exact position of the error.
+ *
+ * All the bytes before \p pos are expected to be valid except for the
+ * last UTF-8 sequence which may not be complete. This function backs up
+ * to the start of that sequence (at most 3 bytes) and validates the rest
+ * of the buffer one byte at a time from there.
+ *
+ * \param[in] str  The buffer being validated.
+ * \param[in] len  The total number of bytes in \p str.
+ * \param[in] pos  The position of the block which failed validation.
+ *
+ * \return The offset of the first invalid sequence or \p len.
+ */
+std::size_t validate_utf8_from(char const * str, std::size_t len, std::size_t pos)
+{
+    std::size_t start(pos);
+    for(std::size_t back(1); back <= 3 && back <= pos; ++back)
+    {
+        unsigned char const c(static_cast<unsigned char>(str[pos - back]));
+        if(c >= 0xC0)
+        {
+            // a lead byte, its sequence may continue in the failing block
+            //
+            start = pos - back;
+            break;
+        }
+        if(c < 0x80)
+        {
+            // ASCII, nothing is pending
+            //
+            break;
+        }
+    }
+
+    return start + validate_utf8_scalar(str + start, len - start);
+}
+
+
+/** \brief Validate a UTF-16 buffer one code unit at a time.
+ *
+ * This function returns the offset of the first code unit which is not
+ * part of a valid UTF-16 character: a low surrogate without a high
+ * surrogate or a high surrogate without a low surrogate. If the whole
+ * buffer is valid, then the function returns \p len.
+ *
+ * \param[in] str  The buffer to validate.
+ * \param[in] len  The number of code units in \p str.
+ *
+ * \return The offset of the first invalid code unit or \p len.
+ */
+std::size_t validate_utf16_scalar(char16_t const * str, std::size_t len)
+{
+    for(std::size_t pos(0); pos < len; ++pos)
+    {
+        if((str[pos] & 0xF800) == 0xD800)
+        {
+            if(str[pos] >= 0xDC00
+            || pos + 1 >= len
+            || (str[pos + 1] & 0xFC00) != 0xDC00)
+            {
+                return pos;
+            }
+            ++pos;
+        }
+    }
+    return len;
+}
+
+
+/** \brief Validate a UTF-32 buffer.
+ *
+ * This function returns the offset of the first character which is a
+ * UTF-16 surrogate or is larger than 0x10FFFF. When \p ctrl is false,
+ * the controls (0x00 to 0x1F and 0x7F to 0x9F) are also invalid. If the
+ * whole buffer is valid, then the function returns \p len.
+ *
+ * \param[in] str  The buffer to validate.
+ * \param[in] len  The number of characters in \p str.
+ * \param[in] ctrl  Whether controls are accepted.
+ *
+ * \return The offset of the first invalid character or \p len.
+ */
+std::size_t validate_utf32_scalar(char32_t const * str, std::size_t len, bool ctrl)
+{
+    for(std::size_t pos(0); pos < len; ++pos)
+    {
+        if(str[pos] > 0x10FFFF
+        || (str[pos] >= 0xD800 && str[pos] <= 0xDFFF)
+        || (!ctrl && (str[pos] < 0x20 || (str[pos] >= 0x7F && str[pos] <= 0x9F))))
+        {
+            return pos;
+        }
+    }
+    return len;
+}
+
+
+/** \brief Count the characters of a UTF-8 buffer one byte at a time.
+ *
+ * This function counts the bytes which are not continuation bytes
+ * (0x80 to 0xBF) and not invalid lead bytes (0xF8 to 0xFF). For a valid
+ * UTF-8 buffer, this is the number of characters.
+ *
+ * \param[in] str  The buffer to count the characters of.
+ * \param[in] len  The number of bytes in \p str.
+ *
+ * \return The number of characters in \p str.
+ */
+std::size_t u8length_scalar(char const * str, std::size_t len)
+{
+    std::size_t result(0);
+    for(char const * const end(str + len); str < end; ++str)
+    {
+        unsigned char const c(*str);
+        if((c < 0x80 || c > 0xBF) && c < 0xF8)
+        {
+            ++result;
+        }
+    }
+    return result;
+}
+
+
+/** \brief Count the characters of a valid UTF-8 buffer.
+ *
+ * This function counts the bytes which are not continuation bytes. It
+ * does not ignore the invalid bytes (0xF8 to 0xFF) so it only returns
+ * the same result as u8length_scalar() for valid UTF-8 buffers.
+ *
+ * \param[in] str  The buffer to count the characters of.
+ * \param[in] len  The number of bytes in \p str.
+ *
+ * \return The number of characters in \p str.
+ */
+std::size_t u8length_unchecked_scalar(char const * str, std::size_t len)
+{
+    std::size_t result(0);
+    for(char const * const end(str + len); str < end; ++str)
+    {
+        // continuation bytes are -128 to -65 when viewed as signed
+        //
+        if(static_cast<signed char>(*str) > -65)
+        {
+            ++result;
+        }
+    }
+    return result;
+}
+
+
+/** \brief Find the offset of a character in a valid UTF-8 buffer.
+ *
+ * This function skips \p n characters and returns the offset of the
+ * next one. Like u8length_unchecked_scalar(), it counts the bytes which
+ * are not continuation bytes, so the offset is only meaningful for valid
+ * UTF-8 buffers.
+ *
+ * \param[in] str  The buffer to search.
+ * \param[in] len  The number of bytes in \p str.
+ * \param[in] n  The number of characters to skip.
+ *
+ * \return The offset of character \p n or \p len if \p str does not
+ * have more than \p n characters.
+ */
+std::size_t utf8_offset_of_scalar(char const * str, std::size_t len, std::size_t n)
+{
+    for(std::size_t pos(0); pos < len; ++pos)
+    {
+        if(static_cast<signed char>(str[pos]) > -65)
+        {
+            if(n == 0)
+            {
+                return pos;
+            }
+            --n;
+        }
+    }
+    return len;
+}
+
+
+/** \brief Count the characters of a UTF-16 buffer one unit at a time.
+ *
+ * This function counts the characters of a UTF-16 buffer. A surrogate
+ * pair counts as one character. If a surrogate is not part of a valid
+ * pair, then the function returns -1.
+ *
+ * \param[in] str  The buffer to count the characters of.
+ * \param[in] len  The number of code units in \p str.
+ *
+ * \return The number of characters in \p str or -1.
+ */
+ssize_t u16length_scalar(char16_t const * str, std::size_t len)
+{
+    ssize_t result(0);
+    char16_t const * const end(str + len);
+    for(; str < end; ++result, ++str)
+    {
+        surrogate_t const high_surrogate(is_surrogate(*str));
+        if(high_surrogate == surrogate_t::SURROGATE_LOW)
+        {
+            // missing HIGH surrogate before LOW surrogate
+            //
+            return -1;
+        }
+        if(high_surrogate == surrogate_t::SURROGATE_HIGH)
+        {
+            ++str;
+            if(str >= end
+            || is_surrogate(*str) != surrogate_t::SURROGATE_LOW)
+            {
+                // missing LOW surrogate after HIGH surrogate
+                //
+                return -1;
+            }
+        }
+    }
+    return result;
+}
+
+
+/** \brief Count the characters of a valid UTF-16 buffer.
+ *
+ * This function counts the code units which are not low surrogates.
+ * For a valid UTF-16 buffer, this is the number of characters.
+ *
+ * \param[in] str  The buffer to count the characters of.
+ * \param[in] len  The number of code units in \p str.
+ *
+ * \return The number of characters in \p str.
+ */
+std::size_t u16length_unchecked_scalar(char16_t const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(char16_t const * const end(str + len); str < end; ++str)
+    {
+        if((*str & 0xFC00) == 0xDC00)
+        {
+            --result;
+        }
+    }
+    return result;
+}
+
+
+
+/** \brief Compute the number of UTF-8 bytes of a UTF-16 buffer.
+ *
+ * This function computes the number of bytes necessary to encode the
+ * UTF-16 buffer in UTF-8. A surrogate pair becomes 4 bytes. A lone
+ * surrogate is counted as 2 bytes; it can't be converted anyway.
+ *
+ * \param[in] str  The UTF-16 buffer.
+ * \param[in] len  The number of code units in \p str.
+ *
+ * \return The number of UTF-8 bytes.
+ */
+std::size_t utf8_length_from_utf16_scalar(char16_t const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(char16_t const * const end(str + len); str < end; ++str)
+    {
+        char16_t const c(*str);
+        result += (c >= 0x80) + (c >= 0x800) - ((c & 0xF800) == 0xD800);
+    }
+    return result;
+}
+
+
+/** \brief Compute the number of UTF-8 bytes of a UTF-32 buffer.
+ *
+ * This function computes the number of bytes necessary to encode the
+ * UTF-32 buffer in UTF-8. Invalid characters are not detected. They
+ * can't be converted anyway.
+ *
+ * \param[in] str  The UTF-32 buffer.
+ * \param[in] len  The number of characters in \p str.
+ *
+ * \return The number of UTF-8 bytes.
+ */
+std::size_t utf8_length_from_utf32_scalar(char32_t const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(char32_t const * const end(str + len); str < end; ++str)
+    {
+        char32_t const c(*str);
+        result += (c >= 0x80) + (c >= 0x800) + (c >= 0x10000);
+    }
+    return result;
+}
+
+
+
+/** \brief Compute the number of UTF-16 code units of a UTF-8 buffer.
+ *
+ * This function computes the number of code units necessary to convert
+ * the UTF-8 buffer to UTF-16. This is the number of characters plus one
+ * for each 4 byte sequence (those become surrogate pairs.) Invalid input
+ * is not detected.
+ *
+ * \param[in] str  The UTF-8 buffer.
+ * \param[in] len  The number of bytes in \p str.
+ *
+ * \return The number of UTF-16 code units.
+ */
+std::size_t utf16_length_from_utf8_scalar(char const * str, std::size_t len)
+{
+    std::size_t result(0);
+    for(char const * const end(str + len); str < end; ++str)
+    {
+        unsigned char const c(*str);
+        result += (c < 0x80 || c >= 0xC0) + (c >= 0xF0);
+    }
+    return result;
+}
+
+
+/** \brief Compute the number of UTF-16 code units of a UTF-32 buffer.
+ *
+ * This function computes the number of code units necessary to convert
+ * the UTF-32 buffer to UTF-16. This is the number of characters plus one
+ * for each character over the Basic Plane (those become surrogate pairs.)
+ * Invalid characters are not detected.
+ *
+ * \param[in] str  The UTF-32 buffer.
+ * \param[in] len  The number of characters in \p str.
+ *
+ * \return The number of UTF-16 code units.
+ */
+std::size_t utf16_length_from_utf32_scalar(char32_t const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(char32_t const * const end(str + len); str < end; ++str)
+    {
+        result += *str >= 0x10000;
+    }
+    return result;
+}
+
+
+/** \brief Compute the number of UTF-8 bytes of a Latin-1 buffer.
+ *
+ * This function computes the number of bytes necessary to convert the
+ * Latin-1 (ISO-8859-1) buffer to UTF-8: one byte per ASCII character
+ * and two bytes for the others.
+ *
+ * \param[in] str  The Latin-1 buffer.
+ * \param[in] len  The number of bytes in \p str.
+ *
+ * \return The number of UTF-8 bytes.
+ */
+std::size_t utf8_length_from_latin1_scalar(char const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(char const * const end(str + len); str < end; ++str)
+    {
+        result += static_cast<unsigned char>(*str) >= 0x80;
+    }
+    return result;
+}
+
+
+
+} // detail namespace
+
+
+
+/** \brief Retrieve the best SIMD level supported by this CPU.
+ *
+ * This function returns the best SIMD level that the running CPU supports
+ * and which the library has kernels for. This is what the library uses
+ * by default.
+ *
+ * \return The best supported SIMD level.
+ */
+simd_t get_best_simd()
+{
+    return detail::tables().f_best;
+}
+
+
+/** \brief Retrieve the SIMD level currently in use.
+ *
+ * This function returns the SIMD level of the kernels currently used by
+ * the library. This is get_best_simd() unless you called set_simd()
+ * with a lower level.
+ *
+ * \return The SIMD level currently in use.
+ */
+simd_t get_simd()
+{
+    detail::kernel_tables_t const & t(detail::tables());
+    return static_cast<simd_t>(t.f_current.load() - t.f_tables);
+}
+
+
+/** \brief Change the SIMD level used by the library.
+ *
+ * This function forces the library to use the kernels of the specified
+ * SIMD level. This is mainly useful to test and benchmark all the
+ * implementations on one computer. The results of all the levels are
+ * expected to be exactly the same.
+ *
+ * \note
+ * The change is not synchronized with other threads. Calls already
+ * running in other threads continue with the kernels they already
+ * selected.
+ *
+ * \exception libutf8_exception_unsupported
+ * The running CPU does not support the requested level.
+ *
+ * \param[in] simd  The SIMD level to use from now on.
+ */
+void set_simd(simd_t simd)
+{
+    detail::kernel_tables_t & t(detail::tables());
+    if(static_cast<int>(simd) < static_cast<int>(simd_t::SIMD_NONE)
+    || static_cast<int>(simd) > static_cast<int>(t.f_best))
+    {
+        throw libutf8_exception_unsupported(
+                  "set_simd(): this CPU does not support \""
+                + simd_to_string(simd)
+                + "\".");
+    }
+    t.f_current.store(t.f_tables + static_cast<int>(simd));
+}
+
+
+/** \brief Convert a SIMD level to a string.
+ *
+ * This function returns the name of the specified SIMD level. This is
+ * useful for log and error messages.
+ *
+ * \param[in] simd  The SIMD level to convert.
+ *
+ * \return The name of the SIMD level.
+ */
+std::string simd_to_string(simd_t simd)
+{
+    switch(simd)
+    {
+    case simd_t::SIMD_NONE:
+        return "none";
+
+    case simd_t::SIMD_SSE4_2:
+        return "sse4.2";
+
+    case simd_t::SIMD_AVX2:
+        return "avx2";
+
+    case simd_t::SIMD_AVX512:
+        return "avx512";
+
+    }
+
+    return "unknown";
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
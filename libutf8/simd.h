@@ -0,0 +1,59 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the SIMD selection functions.
+ *
+ * The heavy functions of the library (validation, length computation,
+ * conversions) have several implementations. At load time, the library
+ * selects the best one supported by the CPU it is running on. These
+ * functions let you check which one was selected and, mainly for tests
+ * and benchmarks, force the use of a lower level.
+ */
+
+// C++
+//
+#include    <string>
+
+
+
+namespace libutf8
+{
+
+
+
+enum class simd_t
+{
+    SIMD_NONE,          // plain C++ (scalar) implementation
+    SIMD_SSE4_2,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+
+simd_t              get_best_simd();
+simd_t              get_simd();
+void                set_simd(simd_t simd);
+std::string         simd_to_string(simd_t simd);
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,756 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the AVX2 kernels.
+ *
+ * This file implements the kernels using 256 bit registers. They are
+ * used on CPUs which support AVX2 (Haswell and newer) but not the
+ * AVX-512 extensions we need.
+ */
+
+// self
+//
+#include    "libutf8/simd_kernels.h"
+#include    "libutf8/simd_transcode.h"
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#if LIBUTF8_X86_SIMD
+#include    <immintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+#if LIBUTF8_X86_SIMD
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+namespace
+{
+
+
+
+template<int N>
+LIBUTF8_TARGET_AVX2
+inline __m256i prev(__m256i input, __m256i previous)
+{
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+
+LIBUTF8_TARGET_AVX2
+inline __m256i broadcast_table(std::uint8_t const * table)
+{
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(table)));
+}
+
+
+/** \brief Validate UTF-8 relationships in a 32 byte register.
+ *
+ * This class is the AVX2 version of the UTF-8 checker. See the SSE4.2
+ * version for details.
+ */
+class utf8_checker_avx2
+{
+public:
+    LIBUTF8_TARGET_AVX2
+    utf8_checker_avx2()
+        : f_byte_1_high(broadcast_table(g_utf8_byte_1_high))
+        , f_byte_1_low(broadcast_table(g_utf8_byte_1_low))
+        , f_byte_2_high(broadcast_table(g_utf8_byte_2_high))
+    {
+    }
+
+    LIBUTF8_TARGET_AVX2
+    void check(__m256i input)
+    {
+        __m256i const nibble_mask(_mm256_set1_epi8(0x0F));
+
+        __m256i const prev1(prev<1>(input, f_prev_input));
+        __m256i const prev2(prev<2>(input, f_prev_input));
+        __m256i const prev3(prev<3>(input, f_prev_input));
+
+        __m256i const byte_1_high(_mm256_shuffle_epi8(f_byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask)));
+        __m256i const byte_1_low(_mm256_shuffle_epi8(f_byte_1_low, _mm256_and_si256(prev1, nibble_mask)));
+        __m256i const byte_2_high(_mm256_shuffle_epi8(f_byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask)));
+        __m256i const special_cases(_mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high));
+
+        __m256i const is_third_byte(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))));
+        __m256i const is_fourth_byte(_mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+        __m256i const must_be_continuation(_mm256_and_si256(_mm256_or_si256(is_third_byte, is_fourth_byte), _mm256_set1_epi8(static_cast<char>(0x80))));
+
+        f_error = _mm256_or_si256(f_error, _mm256_xor_si256(must_be_continuation, special_cases));
+        f_prev_input = input;
+    }
+
+    LIBUTF8_TARGET_AVX2
+    void check_block(__m256i const * input)
+    {
+        if(_mm256_movemask_epi8(_mm256_or_si256(input[0], input[1])) == 0)
+        {
+            // all ASCII, only make sure the previous block was complete
+            //
+            f_error = _mm256_or_si256(f_error, f_prev_incomplete);
+            f_prev_incomplete = _mm256_setzero_si256();
+            f_prev_input = input[1];
+        }
+        else
+        {
+            check(input[0]);
+            check(input[1]);
+
+            // a lead byte in the last 3 bytes is incomplete
+            //
+            f_prev_incomplete = _mm256_subs_epu8(input[1], _mm256_setr_epi8(
+                      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                    , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                    , static_cast<char>(0xF0 - 1)
+                    , static_cast<char>(0xE0 - 1)
+                    , static_cast<char>(0xC0 - 1)));
+        }
+    }
+
+    LIBUTF8_TARGET_AVX2
+    bool has_error() const
+    {
+        return _mm256_testz_si256(f_error, f_error) == 0;
+    }
+
+private:
+    __m256i const       f_byte_1_high;
+    __m256i const       f_byte_1_low;
+    __m256i const       f_byte_2_high;
+    __m256i             f_prev_input = _mm256_setzero_si256();
+    __m256i             f_prev_incomplete = _mm256_setzero_si256();
+    __m256i             f_error = _mm256_setzero_si256();
+};
+
+
+/** \brief Search the first byte which is not valid ASCII.
+ *
+ * See the SSE4.2 version for details.
+ */
+template<bool ctrl>
+LIBUTF8_TARGET_AVX2
+std::size_t validate_ascii_avx2(char const * str, std::size_t len)
+{
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        std::uint32_t mask(0);
+        if constexpr(ctrl)
+        {
+            mask = _mm256_movemask_epi8(input);
+        }
+        else
+        {
+            mask = _mm256_movemask_epi8(_mm256_or_si256(
+                      _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), input)
+                    , _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x7F))));
+        }
+        if(mask != 0)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+
+    return pos + validate_ascii_scalar(str + pos, len - pos, ctrl);
+}
+
+
+std::size_t validate_ascii_avx2(char const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_ascii_avx2<true>(str, len)
+        : validate_ascii_avx2<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t validate_utf8_avx2(char const * str, std::size_t len)
+{
+    utf8_checker_avx2 checker;
+    __m256i input[2];
+
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        input[0] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos +  0));
+        input[1] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + 32));
+        checker.check_block(input);
+        if(checker.has_error())
+        {
+            return validate_utf8_from(str, len, pos);
+        }
+    }
+
+    // the last block gets padded with zeroes, a sequence cut short by
+    // the end of the buffer is then followed by '\0' which is an error
+    //
+    alignas(32) char tail[64] = {};
+    if(pos < len)
+    {
+        memcpy(tail, str + pos, len - pos);
+    }
+    input[0] = _mm256_load_si256(reinterpret_cast<__m256i const *>(tail +  0));
+    input[1] = _mm256_load_si256(reinterpret_cast<__m256i const *>(tail + 32));
+    checker.check_block(input);
+    if(checker.has_error())
+    {
+        return validate_utf8_from(str, len, pos);
+    }
+
+    return len;
+}
+
+
+
+template<bool checked>
+LIBUTF8_TARGET_AVX2
+std::size_t u8length_avx2(char const * str, std::size_t len)
+{
+    __m256i const continuation(_mm256_set1_epi8(-64));
+    __m256i const invalid(_mm256_set1_epi8(static_cast<char>(0xF8)));
+
+    std::size_t skip(0);
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        for(int idx(0); idx < 64; idx += 32)
+        {
+            __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + idx)));
+            __m256i mask(_mm256_cmpgt_epi8(continuation, input));
+            if constexpr(checked)
+            {
+                mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(_mm256_max_epu8(input, invalid), input));
+            }
+            skip += _mm_popcnt_u32(_mm256_movemask_epi8(mask));
+        }
+    }
+
+    if constexpr(checked)
+    {
+        return pos - skip + u8length_scalar(str + pos, len - pos);
+    }
+    else
+    {
+        return pos - skip + u8length_unchecked_scalar(str + pos, len - pos);
+    }
+}
+
+
+/** \brief Find the offset of a character in a valid UTF-8 buffer.
+ *
+ * This function computes the mask of the bytes which start a character
+ * 64 at a time. When the block has more than \p n such bytes, the
+ * position of the character is found with a deposit of bit \p n in the
+ * mask. The last few bytes are searched by the scalar version.
+ */
+LIBUTF8_TARGET_AVX2
+std::size_t utf8_offset_of_avx2(char const * str, std::size_t len, std::size_t n)
+{
+    __m256i const continuation(_mm256_set1_epi8(-64));
+
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        __m256i const lo(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        __m256i const hi(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + 32)));
+        std::uint64_t const lead(~(static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(continuation, lo))))
+                            | static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(continuation, hi)))) << 32));
+        std::size_t const count(_mm_popcnt_u64(lead));
+        if(count > n)
+        {
+            return pos + _tzcnt_u64(_pdep_u64(1ULL << n, lead));
+        }
+        n -= count;
+    }
+
+    return pos + utf8_offset_of_scalar(str + pos, len - pos, n);
+}
+
+
+/** \brief Compute the surrogate masks of 32 UTF-16 code units.
+ *
+ * This function is the AVX2 version of the surrogate masks. See the
+ * SSE4.2 version for details.
+ */
+LIBUTF8_TARGET_AVX2
+inline void surrogate_masks(char16_t const * str, std::uint32_t & high, std::uint32_t & low)
+{
+    __m256i const surrogate_mask(_mm256_set1_epi16(static_cast<short>(0xFC00)));
+    __m256i const high_surrogate(_mm256_set1_epi16(static_cast<short>(0xD800)));
+    __m256i const low_surrogate(_mm256_set1_epi16(static_cast<short>(0xDC00)));
+
+    __m256i const input0(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str +  0)), surrogate_mask));
+    __m256i const input1(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + 16)), surrogate_mask));
+
+    // the pack works within each 128 bit lane, the permute puts the
+    // 64 bit words back in order
+    //
+    high = _mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(
+                  _mm256_cmpeq_epi16(input0, high_surrogate)
+                , _mm256_cmpeq_epi16(input1, high_surrogate)), 0xD8));
+    low = _mm256_movemask_epi8(_mm256_permute4x64_epi64(_mm256_packs_epi16(
+                  _mm256_cmpeq_epi16(input0, low_surrogate)
+                , _mm256_cmpeq_epi16(input1, low_surrogate)), 0xD8));
+}
+
+
+LIBUTF8_TARGET_AVX2
+ssize_t u16length_avx2(char16_t const * str, std::size_t len)
+{
+    std::uint32_t carry(0);
+    std::size_t low_count(0);
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        if(((high << 1) | carry) != low)
+        {
+            return -1;
+        }
+        carry = high >> 31;
+        low_count += _mm_popcnt_u32(low);
+    }
+
+    pos -= carry;
+    ssize_t const tail(u16length_scalar(str + pos, len - pos));
+    if(tail < 0)
+    {
+        return -1;
+    }
+    return static_cast<ssize_t>(pos - low_count) + tail;
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t u16length_unchecked_avx2(char16_t const * str, std::size_t len)
+{
+    std::size_t low_count(0);
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        low_count += _mm_popcnt_u32(low);
+    }
+
+    return pos - low_count + u16length_unchecked_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t validate_utf16_avx2(char16_t const * str, std::size_t len)
+{
+    std::uint32_t carry(0);
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        if(((high << 1) | carry) != low)
+        {
+            break;
+        }
+        carry = high >> 31;
+    }
+
+    // the scalar version finds the exact position of an error and
+    // verifies the pair cut by the end of the blocks
+    //
+    pos -= carry;
+    return pos + validate_utf16_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t utf8_length_from_utf16_avx2(char16_t const * str, std::size_t len)
+{
+    __m256i const zero(_mm256_setzero_si256());
+    __m256i const ascii_mask(_mm256_set1_epi16(static_cast<short>(0xFF80)));
+    __m256i const two_bytes_mask(_mm256_set1_epi16(static_cast<short>(0xF800)));
+    __m256i const surrogate(_mm256_set1_epi16(static_cast<short>(0xD800)));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        __m256i const high_bits(_mm256_and_si256(input, two_bytes_mask));
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(input, ascii_mask), zero)))
+               + _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi16(high_bits, zero)))
+               + _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi16(high_bits, surrogate)));
+    }
+
+    return pos * 3 - count / 2 + utf8_length_from_utf16_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t utf8_length_from_utf32_avx2(char32_t const * str, std::size_t len)
+{
+    __m256i const two_bytes(_mm256_set1_epi32(0x80));
+    __m256i const three_bytes(_mm256_set1_epi32(0x800));
+    __m256i const four_bytes(_mm256_set1_epi32(0x10000));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 8 <= len; pos += 8)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(input, two_bytes), input)))
+               + _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(input, three_bytes), input)))
+               + _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(input, four_bytes), input)));
+    }
+
+    return pos + count / 4 + utf8_length_from_utf32_scalar(str + pos, len - pos);
+}
+
+
+/** \brief Search invalid characters in 8 UTF-32 characters.
+ *
+ * See the SSE4.2 version for details.
+ */
+template<bool ctrl>
+LIBUTF8_TARGET_AVX2
+inline __m256i invalid_unicode(__m256i input)
+{
+    __m256i result(_mm256_or_si256(
+              _mm256_cmpeq_epi32(_mm256_max_epu32(input, _mm256_set1_epi32(0x110000)), input)
+            , _mm256_cmpeq_epi32(_mm256_and_si256(input, _mm256_set1_epi32(static_cast<int>(0xFFFFF800))), _mm256_set1_epi32(0xD800))));
+    if constexpr(!ctrl)
+    {
+        __m256i const c1(_mm256_sub_epi32(input, _mm256_set1_epi32(0x7F)));
+        result = _mm256_or_si256(result, _mm256_or_si256(
+                  _mm256_cmpeq_epi32(_mm256_min_epu32(input, _mm256_set1_epi32(0x1F)), input)
+                , _mm256_cmpeq_epi32(_mm256_min_epu32(c1, _mm256_set1_epi32(0x20)), c1)));
+    }
+    return result;
+}
+
+
+template<bool ctrl>
+LIBUTF8_TARGET_AVX2
+std::size_t validate_utf32_avx2(char32_t const * str, std::size_t len)
+{
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        __m256i const invalid(_mm256_or_si256(
+                  invalid_unicode<ctrl>(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + 0)))
+                , invalid_unicode<ctrl>(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + 8)))));
+        if(!_mm256_testz_si256(invalid, invalid))
+        {
+            break;
+        }
+    }
+
+    return pos + validate_utf32_scalar(str + pos, len - pos, ctrl);
+}
+
+
+std::size_t validate_utf32_avx2(char32_t const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_utf32_avx2<true>(str, len)
+        : validate_utf32_avx2<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t utf16_length_from_utf8_avx2(char const * str, std::size_t len)
+{
+    __m256i const continuation(_mm256_set1_epi8(-64));
+    __m256i const four_bytes(_mm256_set1_epi8(static_cast<char>(0xF0)));
+
+    std::size_t skip(0);
+    std::size_t extra(0);
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        skip += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpgt_epi8(continuation, input)));
+        extra += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(input, four_bytes), input)));
+    }
+
+    return pos - skip + extra + utf16_length_from_utf8_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t utf16_length_from_utf32_avx2(char32_t const * str, std::size_t len)
+{
+    __m256i const four_bytes(_mm256_set1_epi32(0x10000));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 8 <= len; pos += 8)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_max_epu32(input, four_bytes), input)));
+    }
+
+    return pos + count / 4 + utf16_length_from_utf32_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_AVX2
+std::size_t utf8_length_from_latin1_avx2(char const * str, std::size_t len)
+{
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 32 <= len; pos += 32)
+    {
+        count += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos))));
+    }
+
+    return pos + count + utf8_length_from_latin1_scalar(str + pos, len - pos);
+}
+
+
+template<typename CharT>
+LIBUTF8_TARGET_AVX2
+conversion_t utf8_to_wide_avx2(char const * str, std::size_t len, CharT * out, std::size_t out_len)
+{
+    utf8_checker_avx2 checker;
+    __m256i input[2];
+
+    CharT * o(out);
+    std::size_t converted(0);
+    for(std::size_t pos(0); pos + 64 <= len; pos += 64)
+    {
+        if(out_len - static_cast<std::size_t>(o - out) < pos + 64 - converted + 16)
+        {
+            break;
+        }
+
+        input[0] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos +  0));
+        input[1] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos + 32));
+        checker.check_block(input);
+        if(checker.has_error())
+        {
+            break;
+        }
+
+        if(converted == pos
+        && _mm256_movemask_epi8(_mm256_or_si256(input[0], input[1])) == 0)
+        {
+            // 64 ASCII characters
+            //
+            for(int idx(0); idx < 64; idx += 16)
+            {
+                __m128i const ascii(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + idx)));
+                if constexpr(sizeof(CharT) == 2)
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + idx), _mm256_cvtepu8_epi16(ascii));
+                }
+                else
+                {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + idx + 0), _mm256_cvtepu8_epi32(ascii));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(o + idx + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(ascii, 8)));
+                }
+            }
+            o += 64;
+            converted += 64;
+            continue;
+        }
+
+        std::size_t const limit(complete_utf8(str, pos + 64));
+        while(converted + 16 <= limit)
+        {
+            converted += decode_utf8_window(str + converted, o);
+        }
+    }
+
+    return conversion_t{ converted, static_cast<std::size_t>(o - out) };
+}
+
+
+/** \brief Encode eight characters of the Basic Plane to UTF-8.
+ *
+ * This function is the AVX2 version of encode_utf8_4(). It writes up to
+ * 28 bytes and moves \p out by the number of valid bytes.
+ */
+LIBUTF8_TARGET_AVX2
+inline void encode_utf8_8(__m256i input, char * & out)
+{
+    __m256i const lead_2(_mm256_or_si256(_mm256_srli_epi32(input, 6), _mm256_set1_epi32(0xC0)));
+    __m256i const trail_1(_mm256_or_si256(_mm256_and_si256(input, _mm256_set1_epi32(0x3F)), _mm256_set1_epi32(0x80)));
+    __m256i const encoded_2(_mm256_or_si256(lead_2, _mm256_slli_epi32(trail_1, 8)));
+
+    __m256i const lead_3(_mm256_or_si256(_mm256_srli_epi32(input, 12), _mm256_set1_epi32(0xE0)));
+    __m256i const trail_2(_mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(input, 6), _mm256_set1_epi32(0x3F)), _mm256_set1_epi32(0x80)));
+    __m256i const encoded_3(_mm256_or_si256(
+              _mm256_or_si256(lead_3, _mm256_slli_epi32(trail_2, 8))
+            , _mm256_slli_epi32(trail_1, 16)));
+
+    __m256i const two_bytes(_mm256_cmpgt_epi32(input, _mm256_set1_epi32(0x7F)));
+    __m256i const three_bytes(_mm256_cmpgt_epi32(input, _mm256_set1_epi32(0x7FF)));
+    __m256i const encoded(_mm256_blendv_epi8(
+              _mm256_blendv_epi8(input, encoded_2, two_bytes)
+            , encoded_3
+            , three_bytes));
+
+    int const m2(_mm256_movemask_ps(_mm256_castsi256_ps(two_bytes)));
+    int const m3(_mm256_movemask_ps(_mm256_castsi256_ps(three_bytes)));
+    utf16_to_utf8_shuffle_t const & e0(g_utf16_to_utf8.f_entries[(m2 & 0x0F) | ((m3 & 0x0F) << 4)]);
+    utf16_to_utf8_shuffle_t const & e1(g_utf16_to_utf8.f_entries[(m2 >> 4) | (m3 & 0xF0)]);
+    __m256i const shuffle(_mm256_inserti128_si256(
+              _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(e0.f_shuffle)))
+            , _mm_loadu_si128(reinterpret_cast<__m128i const *>(e1.f_shuffle))
+            , 1));
+    __m256i const packed(_mm256_shuffle_epi8(encoded, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+    out += e0.f_length;
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_extracti128_si256(packed, 1));
+    out += e1.f_length;
+}
+
+
+LIBUTF8_TARGET_AVX2
+conversion_t utf16_to_utf8_avx2(char16_t const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    char * o(out);
+    char const * const out_end(out + out_len);
+    std::size_t pos(0);
+    while(pos + 16 <= len && out_end - o >= 64)
+    {
+        __m256i const input(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(str + pos)));
+        if(_mm256_testz_si256(input, _mm256_set1_epi16(static_cast<short>(0xFF80))))
+        {
+            // 16 ASCII characters, the pack works within each 128 bit
+            // lane so we need to put the two 64 bit results together
+            //
+            __m256i const packed(_mm256_permute4x64_epi64(_mm256_packus_epi16(input, input), 0x08));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), _mm256_castsi256_si128(packed));
+            o += 16;
+            pos += 16;
+            continue;
+        }
+
+        __m256i const surrogates(_mm256_cmpeq_epi16(
+                  _mm256_and_si256(input, _mm256_set1_epi16(static_cast<short>(0xF800)))
+                , _mm256_set1_epi16(static_cast<short>(0xD800))));
+        if(_mm256_testz_si256(surrogates, surrogates))
+        {
+            encode_utf8_8(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(input)), o);
+            encode_utf8_8(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(input, 1)), o);
+            pos += 16;
+            continue;
+        }
+
+        std::size_t const next(utf16_to_utf8_units(str, pos, pos + 16, len, o));
+        if(next < pos + 16)
+        {
+            pos = next;
+            break;
+        }
+        pos = next;
+    }
+
+    return conversion_t{ pos, static_cast<std::size_t>(o - out) };
+}
+
+
+template<typename CharT>
+LIBUTF8_TARGET_AVX2
+void swap_bytes_avx2(char const * in, std::size_t count, CharT * out)
+{
+    // the shuffle works within each 128 bit lane so we can use the same
+    // pattern twice
+    //
+    __m256i const shuffle(sizeof(CharT) == 2
+            ? _mm256_setr_epi8(
+                  1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+                , 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+            : _mm256_setr_epi8(
+                  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+                , 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    std::size_t const units(32 / sizeof(CharT));
+
+    std::size_t pos(0);
+    for(; pos + units <= count; pos += units)
+    {
+        _mm256_storeu_si256(
+                  reinterpret_cast<__m256i *>(out + pos)
+                , _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(in + pos * sizeof(CharT))), shuffle));
+    }
+
+    swap_bytes_scalar(in + pos * sizeof(CharT), count - pos, out + pos);
+}
+
+
+
+} // no name namespace
+
+
+
+void avx2_kernels(kernels_t & k)
+{
+    k.f_validate_ascii = validate_ascii_avx2;
+    k.f_validate_utf8 = validate_utf8_avx2;
+    k.f_validate_utf16 = validate_utf16_avx2;
+    k.f_validate_utf32 = validate_utf32_avx2;
+    k.f_u8length = u8length_avx2<true>;
+    k.f_u8length_unchecked = u8length_avx2<false>;
+    k.f_utf8_offset_of = utf8_offset_of_avx2;
+    k.f_u16length = u16length_avx2;
+    k.f_u16length_unchecked = u16length_unchecked_avx2;
+    k.f_utf8_length_from_utf16 = utf8_length_from_utf16_avx2;
+    k.f_utf8_length_from_utf32 = utf8_length_from_utf32_avx2;
+    k.f_utf16_length_from_utf8 = utf16_length_from_utf8_avx2;
+    k.f_utf16_length_from_utf32 = utf16_length_from_utf32_avx2;
+    k.f_utf8_length_from_latin1 = utf8_length_from_latin1_avx2;
+    k.f_utf8_to_utf16 = utf8_to_wide_avx2<char16_t>;
+    k.f_utf16_to_utf8 = utf16_to_utf8_avx2;
+    k.f_utf8_to_utf32 = utf8_to_wide_avx2<char32_t>;
+    k.f_swap_bytes16 = swap_bytes_avx2<char16_t>;
+    k.f_swap_bytes32 = swap_bytes_avx2<char32_t>;
+}
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+#endif
+// vim: ts=4 sw=4 et
@@ -0,0 +1,969 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the AVX-512 kernels.
+ *
+ * This file implements the kernels using 512 bit registers. They require
+ * the Ice Lake set of AVX-512 extensions (F, BW, VL, VBMI, and VBMI2).
+ *
+ * The masked loads let us process the last few bytes of a buffer
+ * without a copy and without reading past the end of the buffer.
+ */
+
+// self
+//
+#include    "libutf8/simd_kernels.h"
+#include    "libutf8/simd_transcode.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// C
+//
+#if LIBUTF8_X86_SIMD
+// GCC 12 views the _mm512_undefined_epi32() used by many of the AVX-512
+// intrinsics as uninitialized variables
+//
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#include    <immintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+#if LIBUTF8_X86_SIMD
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+namespace
+{
+
+
+
+template<int N>
+LIBUTF8_TARGET_AVX512
+inline __m512i prev(__m512i input, __m512i previous)
+{
+    // move the last 16 bytes of previous in front of the first 48 bytes
+    // of input, then shift each lane by N bytes
+    //
+    __m512i const rotated(_mm512_permutex2var_epi32(
+              input
+            , _mm512_setr_epi32(28, 29, 30, 31, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11)
+            , previous));
+    return _mm512_alignr_epi8(input, rotated, 16 - N);
+}
+
+
+LIBUTF8_TARGET_AVX512
+inline __m512i broadcast_table(std::uint8_t const * table)
+{
+    return _mm512_maskz_broadcast_i32x4(0xFFFF, _mm_load_si128(reinterpret_cast<__m128i const *>(table)));
+}
+
+
+/** \brief Validate UTF-8 relationships in a 64 byte register.
+ *
+ * This class is the AVX-512 version of the UTF-8 checker. See the SSE4.2
+ * version for details.
+ */
+class utf8_checker_avx512
+{
+public:
+    LIBUTF8_TARGET_AVX512
+    utf8_checker_avx512()
+        : f_byte_1_high(broadcast_table(g_utf8_byte_1_high))
+        , f_byte_1_low(broadcast_table(g_utf8_byte_1_low))
+        , f_byte_2_high(broadcast_table(g_utf8_byte_2_high))
+    {
+    }
+
+    LIBUTF8_TARGET_AVX512
+    void check_block(__m512i input)
+    {
+        if(_mm512_movepi8_mask(input) == 0)
+        {
+            // all ASCII, only make sure the previous block was complete
+            //
+            f_error = _mm512_or_si512(f_error, f_prev_incomplete);
+            f_prev_incomplete = _mm512_setzero_si512();
+            f_prev_input = input;
+            return;
+        }
+
+        __m512i const nibble_mask(_mm512_set1_epi8(0x0F));
+
+        __m512i const prev1(prev<1>(input, f_prev_input));
+        __m512i const prev2(prev<2>(input, f_prev_input));
+        __m512i const prev3(prev<3>(input, f_prev_input));
+
+        __m512i const byte_1_high(_mm512_shuffle_epi8(f_byte_1_high, _mm512_and_si512(_mm512_srli_epi16(prev1, 4), nibble_mask)));
+        __m512i const byte_1_low(_mm512_shuffle_epi8(f_byte_1_low, _mm512_and_si512(prev1, nibble_mask)));
+        __m512i const byte_2_high(_mm512_shuffle_epi8(f_byte_2_high, _mm512_and_si512(_mm512_srli_epi16(input, 4), nibble_mask)));
+
+        // (a & b & c) is ternary logic function 0x80
+        //
+        __m512i const special_cases(_mm512_ternarylogic_epi32(byte_1_high, byte_1_low, byte_2_high, 0x80));
+
+        __m512i const is_third_byte(_mm512_subs_epu8(prev2, _mm512_set1_epi8(static_cast<char>(0xE0 - 0x80))));
+        __m512i const is_fourth_byte(_mm512_subs_epu8(prev3, _mm512_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+        __m512i const must_be_continuation(_mm512_and_si512(_mm512_or_si512(is_third_byte, is_fourth_byte), _mm512_set1_epi8(static_cast<char>(0x80))));
+
+        f_error = _mm512_or_si512(f_error, _mm512_xor_si512(must_be_continuation, special_cases));
+        f_prev_input = input;
+
+        // a lead byte in the last 3 bytes is incomplete
+        //
+        f_prev_incomplete = _mm512_subs_epu8(input, _mm512_set_epi8(
+                  static_cast<char>(0xC0 - 1)
+                , static_cast<char>(0xE0 - 1)
+                , static_cast<char>(0xF0 - 1)
+                , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                , -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    }
+
+    LIBUTF8_TARGET_AVX512
+    bool has_error() const
+    {
+        return _mm512_test_epi8_mask(f_error, f_error) != 0;
+    }
+
+private:
+    __m512i const       f_byte_1_high;
+    __m512i const       f_byte_1_low;
+    __m512i const       f_byte_2_high;
+    __m512i             f_prev_input = _mm512_setzero_si512();
+    __m512i             f_prev_incomplete = _mm512_setzero_si512();
+    __m512i             f_error = _mm512_setzero_si512();
+};
+
+
+template<bool ctrl>
+LIBUTF8_TARGET_AVX512
+std::size_t validate_ascii_avx512(char const * str, std::size_t len)
+{
+    for(std::size_t pos(0); pos < len; pos += 64)
+    {
+        // the lanes past the end are not compared since a zero is a control
+        //
+        __mmask64 const load_mask(len - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi8(load_mask, str + pos));
+        std::uint64_t mask(0);
+        if constexpr(ctrl)
+        {
+            mask = _mm512_movepi8_mask(input);
+        }
+        else
+        {
+            mask = _mm512_mask_cmplt_epi8_mask(load_mask, input, _mm512_set1_epi8(0x20))
+                 | _mm512_mask_cmpeq_epi8_mask(load_mask, input, _mm512_set1_epi8(0x7F));
+        }
+        if(mask != 0)
+        {
+            return pos + _tzcnt_u64(mask);
+        }
+    }
+
+    return len;
+}
+
+
+std::size_t validate_ascii_avx512(char const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_ascii_avx512<true>(str, len)
+        : validate_ascii_avx512<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t validate_utf8_avx512(char const * str, std::size_t len)
+{
+    utf8_checker_avx512 checker;
+
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        checker.check_block(_mm512_loadu_si512(str + pos));
+        if(checker.has_error())
+        {
+            return validate_utf8_from(str, len, pos);
+        }
+    }
+
+    // the masked load fills the rest of the register with zeroes, a
+    // sequence cut short by the end of the buffer is then followed
+    // by '\0' which is an error
+    //
+    __mmask64 const mask(_bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+    checker.check_block(_mm512_maskz_loadu_epi8(mask, str + pos));
+    if(checker.has_error())
+    {
+        return validate_utf8_from(str, len, pos);
+    }
+
+    return len;
+}
+
+
+
+template<bool checked>
+LIBUTF8_TARGET_AVX512
+std::size_t u8length_avx512(char const * str, std::size_t len)
+{
+    __m512i const continuation(_mm512_set1_epi8(-64));
+    __m512i const invalid(_mm512_set1_epi8(static_cast<char>(0xF8)));
+
+    // the masked load of the last block reads zeroes which count as
+    // ASCII characters and thus do not need to be skipped
+    //
+    std::size_t skip(0);
+    for(std::size_t pos(0); pos < len; pos += 64)
+    {
+        __mmask64 const load_mask(len - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi8(load_mask, str + pos));
+        __mmask64 mask(_mm512_cmplt_epi8_mask(input, continuation));
+        if constexpr(checked)
+        {
+            mask |= _mm512_cmpge_epu8_mask(input, invalid);
+        }
+        skip += _mm_popcnt_u64(mask);
+    }
+
+    return len - skip;
+}
+
+
+/** \brief Find the offset of a character in a valid UTF-8 buffer.
+ *
+ * This function is the AVX-512 version of the character search. See
+ * the AVX2 version for details. The bytes past \p len are removed from
+ * the mask of the last block.
+ */
+LIBUTF8_TARGET_AVX512
+std::size_t utf8_offset_of_avx512(char const * str, std::size_t len, std::size_t n)
+{
+    __m512i const continuation(_mm512_set1_epi8(-64));
+
+    for(std::size_t pos(0); pos < len; pos += 64)
+    {
+        __mmask64 const load_mask(len - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi8(load_mask, str + pos));
+        std::uint64_t const lead(_mm512_mask_cmpge_epi8_mask(load_mask, input, continuation));
+        std::size_t const count(_mm_popcnt_u64(lead));
+        if(count > n)
+        {
+            return pos + _tzcnt_u64(_pdep_u64(1ULL << n, lead));
+        }
+        n -= count;
+    }
+
+    return len;
+}
+
+
+/** \brief Compute the surrogate masks of up to 32 UTF-16 code units.
+ *
+ * This function is the AVX-512 version of the surrogate masks. See the
+ * SSE4.2 version for details. The code units past \p len are viewed as
+ * zeroes.
+ */
+LIBUTF8_TARGET_AVX512
+inline void surrogate_masks(char16_t const * str, std::size_t len, std::uint32_t & high, std::uint32_t & low)
+{
+    __mmask32 const load_mask(len >= 32
+                ? ~0U
+                : _bzhi_u32(~0U, static_cast<unsigned int>(len)));
+    __m512i const input(_mm512_and_si512(
+                  _mm512_maskz_loadu_epi16(load_mask, str)
+                , _mm512_set1_epi16(static_cast<short>(0xFC00))));
+
+    high = _mm512_cmpeq_epi16_mask(input, _mm512_set1_epi16(static_cast<short>(0xD800)));
+    low = _mm512_cmpeq_epi16_mask(input, _mm512_set1_epi16(static_cast<short>(0xDC00)));
+}
+
+
+LIBUTF8_TARGET_AVX512
+ssize_t u16length_avx512(char16_t const * str, std::size_t len)
+{
+    // a high surrogate at the very end expects a low surrogate in the
+    // zeroes read past the end which fails the test as expected
+    //
+    std::uint32_t carry(0);
+    std::size_t low_count(0);
+    for(std::size_t pos(0); pos < len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, len - pos, high, low);
+        if(((high << 1) | carry) != low)
+        {
+            return -1;
+        }
+        carry = high >> 31;
+        low_count += _mm_popcnt_u32(low);
+    }
+    if(carry != 0)
+    {
+        return -1;
+    }
+
+    return static_cast<ssize_t>(len - low_count);
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t u16length_unchecked_avx512(char16_t const * str, std::size_t len)
+{
+    std::size_t low_count(0);
+    for(std::size_t pos(0); pos < len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, len - pos, high, low);
+        low_count += _mm_popcnt_u32(low);
+    }
+
+    return len - low_count;
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t validate_utf16_avx512(char16_t const * str, std::size_t len)
+{
+    // a high surrogate at the very end of a partial block expects a low
+    // surrogate in the zeroes read past the end so it gets detected too
+    //
+    std::uint32_t carry(0);
+    for(std::size_t pos(0); pos < len; pos += 32)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, len - pos, high, low);
+        if(((high << 1) | carry) != low)
+        {
+            pos -= carry;
+            return pos + validate_utf16_scalar(str + pos, len - pos);
+        }
+        carry = high >> 31;
+    }
+
+    return len - carry;
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t utf8_length_from_utf16_avx512(char16_t const * str, std::size_t len)
+{
+    // the zeroes of the masked load are ASCII and do not add anything
+    //
+    __m512i const two_bytes(_mm512_set1_epi16(0x80));
+    __m512i const three_bytes(_mm512_set1_epi16(0x800));
+    __m512i const surrogate_mask(_mm512_set1_epi16(static_cast<short>(0xF800)));
+    __m512i const surrogate(_mm512_set1_epi16(static_cast<short>(0xD800)));
+
+    std::size_t result(len);
+    for(std::size_t pos(0); pos < len; pos += 32)
+    {
+        __mmask32 const load_mask(len - pos >= 32
+                    ? ~0U
+                    : _bzhi_u32(~0U, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi16(load_mask, str + pos));
+        result += _mm_popcnt_u32(_mm512_cmpge_epu16_mask(input, two_bytes))
+                + _mm_popcnt_u32(_mm512_cmpge_epu16_mask(input, three_bytes))
+                - _mm_popcnt_u32(_mm512_cmpeq_epi16_mask(_mm512_and_si512(input, surrogate_mask), surrogate));
+    }
+
+    return result;
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t utf8_length_from_utf32_avx512(char32_t const * str, std::size_t len)
+{
+    __m512i const two_bytes(_mm512_set1_epi32(0x80));
+    __m512i const three_bytes(_mm512_set1_epi32(0x800));
+    __m512i const four_bytes(_mm512_set1_epi32(0x10000));
+
+    std::size_t result(len);
+    for(std::size_t pos(0); pos < len; pos += 16)
+    {
+        __mmask16 const load_mask(len - pos >= 16
+                    ? 0xFFFF
+                    : _bzhi_u32(0xFFFF, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi32(load_mask, str + pos));
+        result += _mm_popcnt_u32(_mm512_cmpge_epu32_mask(input, two_bytes))
+                + _mm_popcnt_u32(_mm512_cmpge_epu32_mask(input, three_bytes))
+                + _mm_popcnt_u32(_mm512_cmpge_epu32_mask(input, four_bytes));
+    }
+
+    return result;
+}
+
+
+template<bool ctrl>
+LIBUTF8_TARGET_AVX512
+std::size_t validate_utf32_avx512(char32_t const * str, std::size_t len)
+{
+    __m512i const too_large(_mm512_set1_epi32(0x110000));
+    __m512i const surrogate_mask(_mm512_set1_epi32(static_cast<int>(0xFFFFF800)));
+    __m512i const surrogate(_mm512_set1_epi32(0xD800));
+
+    for(std::size_t pos(0); pos < len; pos += 16)
+    {
+        // the lanes past the end are not compared since a zero is a control
+        //
+        __mmask16 const load_mask(len - pos >= 16
+                    ? 0xFFFF
+                    : _bzhi_u32(0xFFFF, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi32(load_mask, str + pos));
+        std::uint32_t invalid(_mm512_mask_cmpge_epu32_mask(load_mask, input, too_large)
+                            | _mm512_mask_cmpeq_epi32_mask(load_mask, _mm512_and_si512(input, surrogate_mask), surrogate));
+        if constexpr(!ctrl)
+        {
+            invalid |= _mm512_mask_cmplt_epu32_mask(load_mask, input, _mm512_set1_epi32(0x20))
+                     | _mm512_mask_cmple_epu32_mask(load_mask, _mm512_sub_epi32(input, _mm512_set1_epi32(0x7F)), _mm512_set1_epi32(0x20));
+        }
+        if(invalid != 0)
+        {
+            return pos + _tzcnt_u32(invalid);
+        }
+    }
+
+    return len;
+}
+
+
+std::size_t validate_utf32_avx512(char32_t const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_utf32_avx512<true>(str, len)
+        : validate_utf32_avx512<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t utf16_length_from_utf8_avx512(char const * str, std::size_t len)
+{
+    // the zeroes of the masked load are neither continuation bytes nor
+    // 4 byte lead bytes so they do not change the counters
+    //
+    __m512i const continuation(_mm512_set1_epi8(-64));
+    __m512i const four_bytes(_mm512_set1_epi8(static_cast<char>(0xF0)));
+
+    std::size_t skip(0);
+    std::size_t extra(0);
+    for(std::size_t pos(0); pos < len; pos += 64)
+    {
+        __mmask64 const load_mask(len - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi8(load_mask, str + pos));
+        skip += _mm_popcnt_u64(_mm512_cmplt_epi8_mask(input, continuation));
+        extra += _mm_popcnt_u64(_mm512_cmpge_epu8_mask(input, four_bytes));
+    }
+
+    return len - skip + extra;
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t utf16_length_from_utf32_avx512(char32_t const * str, std::size_t len)
+{
+    __m512i const four_bytes(_mm512_set1_epi32(0x10000));
+
+    std::size_t result(len);
+    for(std::size_t pos(0); pos < len; pos += 16)
+    {
+        __mmask16 const load_mask(len - pos >= 16
+                    ? 0xFFFF
+                    : _bzhi_u32(0xFFFF, static_cast<unsigned int>(len - pos)));
+        __m512i const input(_mm512_maskz_loadu_epi32(load_mask, str + pos));
+        result += _mm_popcnt_u32(_mm512_cmpge_epu32_mask(input, four_bytes));
+    }
+
+    return result;
+}
+
+
+LIBUTF8_TARGET_AVX512
+std::size_t utf8_length_from_latin1_avx512(char const * str, std::size_t len)
+{
+    std::size_t result(len);
+    for(std::size_t pos(0); pos < len; pos += 64)
+    {
+        __mmask64 const load_mask(len - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(len - pos)));
+        result += _mm_popcnt_u64(_mm512_movepi8_mask(_mm512_maskz_loadu_epi8(load_mask, str + pos)));
+    }
+
+    return result;
+}
+
+
+/** \brief Load 16 bytes in 32 bit lanes without reading past \p len.
+ */
+LIBUTF8_TARGET_AVX512
+inline __m512i load_bytes_epi32(char const * str, std::size_t pos, std::size_t len)
+{
+    __mmask16 const load_mask(pos >= len
+                ? 0
+                : len - pos >= 16
+                    ? 0xFFFF
+                    : _bzhi_u32(0xFFFF, static_cast<unsigned int>(len - pos)));
+    return _mm512_cvtepu8_epi32(_mm_maskz_loadu_epi8(load_mask, str + pos));
+}
+
+
+/** \brief Decode the characters starting in 16 bytes of valid UTF-8.
+ *
+ * Each 32 bit lane receives the byte at its position and the following
+ * three bytes. The lanes holding a lead byte compute the character. The
+ * characters are then compressed together and saved in \p out.
+ *
+ * \param[in] str  The UTF-8 buffer.
+ * \param[in] pos  The position of the 16 bytes to decode.
+ * \param[in] count  The number of positions to decode (1 to 16).
+ * \param[in] len  The total size of \p str.
+ * \param[in,out] out  The output buffer, moved after the characters.
+ */
+template<typename CharT>
+LIBUTF8_TARGET_AVX512
+inline void decode_utf8_16(char const * str, std::size_t pos, std::size_t count, std::size_t len, CharT * & out)
+{
+    __m512i const b0(load_bytes_epi32(str, pos + 0, len));
+    __m512i const b1(load_bytes_epi32(str, pos + 1, len));
+    __m512i const b2(load_bytes_epi32(str, pos + 2, len));
+    __m512i const b3(load_bytes_epi32(str, pos + 3, len));
+
+    __m512i const low_6_bits(_mm512_set1_epi32(0x3F));
+    __mmask16 const valid(_bzhi_u32(0xFFFF, static_cast<unsigned int>(count)));
+    __mmask16 const lead(valid
+                & (_mm512_cmplt_epu32_mask(b0, _mm512_set1_epi32(0x80))
+                 | _mm512_cmpge_epu32_mask(b0, _mm512_set1_epi32(0xC0))));
+    __mmask16 const two_bytes(_mm512_cmpge_epu32_mask(b0, _mm512_set1_epi32(0xC0)));
+    __mmask16 const three_bytes(_mm512_cmpge_epu32_mask(b0, _mm512_set1_epi32(0xE0)));
+    __mmask16 const four_bytes(_mm512_cmpge_epu32_mask(b0, _mm512_set1_epi32(0xF0)));
+
+    __m512i const t1(_mm512_and_si512(b1, low_6_bits));
+    __m512i const t2(_mm512_and_si512(b2, low_6_bits));
+    __m512i const t3(_mm512_and_si512(b3, low_6_bits));
+
+    __m512i const wc2(_mm512_or_si512(
+              _mm512_slli_epi32(_mm512_and_si512(b0, _mm512_set1_epi32(0x1F)), 6)
+            , t1));
+    __m512i const wc3(_mm512_or_si512(
+              _mm512_or_si512(
+                      _mm512_slli_epi32(_mm512_and_si512(b0, _mm512_set1_epi32(0x0F)), 12)
+                    , _mm512_slli_epi32(t1, 6))
+            , t2));
+    __m512i const wc4(_mm512_or_si512(
+              _mm512_or_si512(
+                      _mm512_slli_epi32(_mm512_and_si512(b0, _mm512_set1_epi32(0x07)), 18)
+                    , _mm512_slli_epi32(t1, 12))
+            , _mm512_or_si512(_mm512_slli_epi32(t2, 6), t3)));
+
+    __m512i wc(_mm512_mask_blend_epi32(two_bytes, b0, wc2));
+    wc = _mm512_mask_blend_epi32(three_bytes, wc, wc3);
+    wc = _mm512_mask_blend_epi32(four_bytes, wc, wc4);
+
+    if constexpr(sizeof(CharT) == 2)
+    {
+        // characters of 4 bytes become a surrogate pair in their lane
+        //
+        __m512i const high(_mm512_add_epi32(_mm512_srli_epi32(wc, 10), _mm512_set1_epi32(0xD800 - (0x10000 >> 10))));
+        __m512i const low(_mm512_or_si512(_mm512_and_si512(wc, _mm512_set1_epi32(0x3FF)), _mm512_set1_epi32(0xDC00)));
+        __m512i const units(_mm512_mask_blend_epi32(
+                  four_bytes
+                , wc
+                , _mm512_or_si512(high, _mm512_slli_epi32(low, 16))));
+
+        std::uint32_t const unit_mask(
+                  _pdep_u32(lead, 0x55555555)
+                | _pdep_u32(lead & four_bytes, 0xAAAAAAAA));
+        unsigned int const n(_mm_popcnt_u32(unit_mask));
+        _mm512_mask_storeu_epi16(out, _bzhi_u32(~0U, n), _mm512_maskz_compress_epi16(unit_mask, units));
+        out += n;
+    }
+    else
+    {
+        unsigned int const n(_mm_popcnt_u32(lead));
+        _mm512_mask_storeu_epi32(out, _bzhi_u32(0xFFFF, n), _mm512_maskz_compress_epi32(lead, wc));
+        out += n;
+    }
+}
+
+
+template<typename CharT>
+LIBUTF8_TARGET_AVX512
+conversion_t utf8_to_wide_avx512(char const * str, std::size_t len, CharT * out, std::size_t out_len)
+{
+    utf8_checker_avx512 checker;
+
+    CharT * o(out);
+    std::size_t converted(0);
+    for(std::size_t pos(0); pos + 64 <= len; pos += 64)
+    {
+        // the masked stores write exactly the number of characters
+        // generated, at most one per byte
+        //
+        if(out_len - static_cast<std::size_t>(o - out) < pos + 64 - converted)
+        {
+            break;
+        }
+
+        __m512i const input(_mm512_loadu_si512(str + pos));
+        checker.check_block(input);
+        if(checker.has_error())
+        {
+            break;
+        }
+
+        if(converted == pos
+        && _mm512_movepi8_mask(input) == 0)
+        {
+            // 64 ASCII characters
+            //
+            if constexpr(sizeof(CharT) == 2)
+            {
+                _mm512_storeu_si512(o +  0, _mm512_cvtepu8_epi16(_mm512_castsi512_si256(input)));
+                _mm512_storeu_si512(o + 32, _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(input, 1)));
+            }
+            else
+            {
+                _mm512_storeu_si512(o +  0, _mm512_cvtepu8_epi32(_mm512_castsi512_si128(input)));
+                _mm512_storeu_si512(o + 16, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(input, 1)));
+                _mm512_storeu_si512(o + 32, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(input, 2)));
+                _mm512_storeu_si512(o + 48, _mm512_cvtepu8_epi32(_mm512_extracti32x4_epi32(input, 3)));
+            }
+            o += 64;
+            converted += 64;
+            continue;
+        }
+
+        std::size_t const limit(complete_utf8(str, pos + 64));
+        for(; converted < limit; converted += 16)
+        {
+            decode_utf8_16(str, converted, std::min<std::size_t>(16, limit - converted), len, o);
+        }
+        converted = limit;
+    }
+
+    return conversion_t{ converted, static_cast<std::size_t>(o - out) };
+}
+
+
+/** \brief Convert UTF-16 to UTF-8.
+ *
+ * This function converts 16 code units at a time. Each 32 bit lane
+ * computes the 1 to 4 bytes of its character and the bytes get
+ * compressed together. A high surrogate lane computes the 4 bytes of
+ * the pair and the low surrogate lane that follows generates nothing.
+ *
+ * The function stops on the first invalid surrogate or when the output
+ * buffer is too small for the next 16 code units.
+ */
+LIBUTF8_TARGET_AVX512
+conversion_t utf16_to_utf8_avx512(char16_t const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    std::size_t written(0);
+    std::size_t pos(0);
+    while(pos < len)
+    {
+        std::size_t count(std::min<std::size_t>(32, len - pos));
+        __mmask32 const load_mask(_bzhi_u32(~0U, static_cast<unsigned int>(count)));
+        __m512i const input(_mm512_maskz_loadu_epi16(load_mask, str + pos));
+        if(_mm512_cmpge_epu16_mask(input, _mm512_set1_epi16(0x80)) == 0)
+        {
+            // up to 32 ASCII characters
+            //
+            if(out_len - written < count)
+            {
+                break;
+            }
+            _mm256_mask_storeu_epi8(out + written, load_mask, _mm512_cvtepi16_epi8(input));
+            written += count;
+            pos += count;
+            continue;
+        }
+
+        count = std::min<std::size_t>(16, count);
+        __m512i const wc(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(input)));
+        __m512i const next(_mm512_cvtepu16_epi32(_mm256_maskz_loadu_epi16(
+                  pos + 1 >= len
+                    ? 0
+                    : _bzhi_u32(0xFFFF, static_cast<unsigned int>(std::min<std::size_t>(16, len - pos - 1)))
+                , str + pos + 1)));
+
+        __m512i const surrogate_bits(_mm512_and_si512(wc, _mm512_set1_epi32(0xFC00)));
+        __mmask16 high(_mm512_cmpeq_epi32_mask(surrogate_bits, _mm512_set1_epi32(0xD800)));
+        __mmask16 low(_mm512_cmpeq_epi32_mask(surrogate_bits, _mm512_set1_epi32(0xDC00)));
+
+        // a high surrogate in the last lane gets converted with the
+        // next code units
+        //
+        if(((high >> (count - 1)) & 1) != 0)
+        {
+            --count;
+            if(count == 0)
+            {
+                break;
+            }
+        }
+        __mmask16 const valid(_bzhi_u32(0xFFFF, static_cast<unsigned int>(count)));
+        high &= valid;
+        low &= valid;
+        if(static_cast<__mmask16>(high << 1) != low)
+        {
+            // invalid surrogate, the caller finds out which one
+            //
+            break;
+        }
+
+        __m512i const low_6_bits(_mm512_set1_epi32(0x3F));
+        __m512i const continuation(_mm512_set1_epi32(0x80));
+
+        __mmask16 const two_bytes(_mm512_cmpge_epu32_mask(wc, _mm512_set1_epi32(0x80)));
+        __mmask16 const three_bytes(_mm512_cmpge_epu32_mask(wc, _mm512_set1_epi32(0x800)));
+
+        __m512i const trail_1(_mm512_or_si512(_mm512_and_si512(wc, low_6_bits), continuation));
+        __m512i const trail_2(_mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(wc, 6), low_6_bits), continuation));
+        __m512i const encoded_2(_mm512_or_si512(
+                  _mm512_or_si512(_mm512_srli_epi32(wc, 6), _mm512_set1_epi32(0xC0))
+                , _mm512_slli_epi32(trail_1, 8)));
+        __m512i const encoded_3(_mm512_or_si512(
+                  _mm512_or_si512(_mm512_srli_epi32(wc, 12), _mm512_set1_epi32(0xE0))
+                , _mm512_or_si512(_mm512_slli_epi32(trail_2, 8), _mm512_slli_epi32(trail_1, 16))));
+
+        __m512i const pair(_mm512_add_epi32(
+                  _mm512_add_epi32(_mm512_slli_epi32(wc, 10), next)
+                , _mm512_set1_epi32(0x10000 - (0xD800 << 10) - 0xDC00)));
+        __m512i const encoded_4(_mm512_or_si512(
+                  _mm512_or_si512(
+                          _mm512_or_si512(_mm512_srli_epi32(pair, 18), _mm512_set1_epi32(0xF0))
+                        , _mm512_slli_epi32(_mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(pair, 12), low_6_bits), continuation), 8))
+                , _mm512_or_si512(
+                          _mm512_slli_epi32(_mm512_or_si512(_mm512_and_si512(_mm512_srli_epi32(pair, 6), low_6_bits), continuation), 16)
+                        , _mm512_slli_epi32(_mm512_or_si512(_mm512_and_si512(pair, low_6_bits), continuation), 24))));
+
+        __m512i encoded(_mm512_mask_blend_epi32(two_bytes, wc, encoded_2));
+        encoded = _mm512_mask_blend_epi32(three_bytes, encoded, encoded_3);
+        encoded = _mm512_mask_blend_epi32(high, encoded, encoded_4);
+
+        // bytes 0 to 3 of each lane; the low surrogate lanes have no bytes
+        //
+        std::uint32_t const keep(valid & ~low);
+        std::uint64_t const byte_mask(
+                  _pdep_u64(keep, 0x1111111111111111ULL)
+                | _pdep_u64(keep & two_bytes, 0x2222222222222222ULL)
+                | _pdep_u64(keep & three_bytes, 0x4444444444444444ULL)
+                | _pdep_u64(high, 0x8888888888888888ULL));
+        std::size_t const n(_mm_popcnt_u64(byte_mask));
+        if(out_len - written < n)
+        {
+            break;
+        }
+        _mm512_mask_storeu_epi8(out + written, _bzhi_u64(~0ULL, static_cast<unsigned int>(n)), _mm512_maskz_compress_epi8(byte_mask, encoded));
+        written += n;
+        pos += count;
+    }
+
+    return conversion_t{ pos, written };
+}
+
+
+LIBUTF8_TARGET_AVX512
+conversion_t latin1_to_utf8_avx512(char const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    // each character is expanded to 16 bits, the ASCII characters keep
+    // only their low byte, the others become two UTF-8 bytes
+    //
+    std::size_t o(0);
+    std::size_t pos(0);
+    while(pos < len && o + 64 <= out_len)
+    {
+        std::size_t const size(std::min<std::size_t>(len - pos, 32));
+        __mmask32 const load_mask(_bzhi_u32(~0U, static_cast<unsigned int>(size)));
+        __m512i const input(_mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(load_mask, str + pos)));
+        __mmask32 const two_bytes(_mm512_cmpge_epu16_mask(input, _mm512_set1_epi16(0x80)));
+        __m512i const encoded(_mm512_or_si512(
+                  _mm512_or_si512(_mm512_srli_epi16(input, 6), _mm512_set1_epi16(0xC0))
+                , _mm512_slli_epi16(_mm512_or_si512(_mm512_and_si512(input, _mm512_set1_epi16(0x3F)), _mm512_set1_epi16(0x80)), 8)));
+        __m512i const words(_mm512_mask_blend_epi16(two_bytes, input, encoded));
+        std::uint64_t const keep(_pdep_u64(load_mask, 0x5555555555555555ULL)
+                               | _pdep_u64(two_bytes, 0xAAAAAAAAAAAAAAAAULL));
+        unsigned int const count(static_cast<unsigned int>(_mm_popcnt_u64(keep)));
+        _mm512_mask_storeu_epi8(
+                  out + o
+                , _bzhi_u64(~0ULL, count)
+                , _mm512_maskz_compress_epi8(keep, words));
+        o += count;
+        pos += size;
+    }
+
+    return conversion_t{ pos, o };
+}
+
+
+LIBUTF8_TARGET_AVX512
+conversion_t utf8_to_latin1_avx512(char const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    char * o(out);
+    char * const out_end(out + out_len);
+    std::size_t pos(0);
+    while(pos < len && out_end - o >= 64)
+    {
+        std::size_t const size(std::min<std::size_t>(len - pos, 64));
+        __mmask64 const load_mask(_bzhi_u64(~0ULL, static_cast<unsigned int>(size)));
+        __m512i const input(_mm512_maskz_loadu_epi8(load_mask, str + pos));
+        std::uint64_t const high(_mm512_movepi8_mask(input));
+        if(high == 0)
+        {
+            _mm512_mask_storeu_epi8(o, load_mask, input);
+            o += size;
+            pos += size;
+            continue;
+        }
+
+        // a lead byte in the last lane would lose its bit in the shift
+        //
+        __mmask64 const lead(_mm512_cmpeq_epi8_mask(
+                  _mm512_and_si512(input, _mm512_set1_epi8(static_cast<char>(0xFE)))
+                , _mm512_set1_epi8(static_cast<char>(0xC2))));
+        __mmask64 const continuation(_mm512_cmpeq_epi8_mask(
+                  _mm512_and_si512(input, _mm512_set1_epi8(static_cast<char>(0xC0)))
+                , _mm512_set1_epi8(static_cast<char>(0x80))));
+        if((lead | continuation) != high
+        || (lead << 1) != continuation
+        || (lead >> 63) != 0)
+        {
+            std::size_t const next(utf8_to_latin1_units(str, pos, pos + size, len, o));
+            if(next < pos + size)
+            {
+                pos = next;
+                break;
+            }
+            pos = next;
+            continue;
+        }
+
+        __m512i const following(_mm512_maskz_loadu_epi8(load_mask >> 1, str + pos + 1));
+        __m512i const value(_mm512_or_si512(
+                  _mm512_slli_epi16(_mm512_and_si512(input, _mm512_set1_epi8(0x03)), 6)
+                , _mm512_and_si512(following, _mm512_set1_epi8(0x3F))));
+        __m512i const bytes(_mm512_mask_blend_epi8(lead, input, value));
+        std::uint64_t const keep(load_mask & ~continuation);
+        unsigned int const count(static_cast<unsigned int>(_mm_popcnt_u64(keep)));
+        _mm512_mask_storeu_epi8(
+                  o
+                , _bzhi_u64(~0ULL, count)
+                , _mm512_maskz_compress_epi8(keep, bytes));
+        o += count;
+        pos += size;
+    }
+
+    return conversion_t{ pos, static_cast<std::size_t>(o - out) };
+}
+
+
+template<typename CharT>
+LIBUTF8_TARGET_AVX512
+void swap_bytes_avx512(char const * in, std::size_t count, CharT * out)
+{
+    __m512i const shuffle(_mm512_broadcast_i32x4(sizeof(CharT) == 2
+            ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+            : _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)));
+
+    std::size_t const bytes(count * sizeof(CharT));
+    char * o(reinterpret_cast<char *>(out));
+    for(std::size_t pos(0); pos < bytes; pos += 64)
+    {
+        __mmask64 const mask(bytes - pos >= 64
+                    ? ~0ULL
+                    : _bzhi_u64(~0ULL, static_cast<unsigned int>(bytes - pos)));
+        _mm512_mask_storeu_epi8(
+                  o + pos
+                , mask
+                , _mm512_shuffle_epi8(_mm512_maskz_loadu_epi8(mask, in + pos), shuffle));
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+void avx512_kernels(kernels_t & k)
+{
+    k.f_validate_ascii = validate_ascii_avx512;
+    k.f_validate_utf8 = validate_utf8_avx512;
+    k.f_validate_utf16 = validate_utf16_avx512;
+    k.f_validate_utf32 = validate_utf32_avx512;
+    k.f_u8length = u8length_avx512<true>;
+    k.f_u8length_unchecked = u8length_avx512<false>;
+    k.f_utf8_offset_of = utf8_offset_of_avx512;
+    k.f_u16length = u16length_avx512;
+    k.f_u16length_unchecked = u16length_unchecked_avx512;
+    k.f_utf8_length_from_utf16 = utf8_length_from_utf16_avx512;
+    k.f_utf8_length_from_utf32 = utf8_length_from_utf32_avx512;
+    k.f_utf16_length_from_utf8 = utf16_length_from_utf8_avx512;
+    k.f_utf16_length_from_utf32 = utf16_length_from_utf32_avx512;
+    k.f_utf8_length_from_latin1 = utf8_length_from_latin1_avx512;
+    k.f_utf8_to_utf16 = utf8_to_wide_avx512<char16_t>;
+    k.f_utf16_to_utf8 = utf16_to_utf8_avx512;
+    k.f_utf8_to_utf32 = utf8_to_wide_avx512<char32_t>;
+    k.f_latin1_to_utf8 = latin1_to_utf8_avx512;
+    k.f_utf8_to_latin1 = utf8_to_latin1_avx512;
+    k.f_swap_bytes16 = swap_bytes_avx512<char16_t>;
+    k.f_swap_bytes32 = swap_bytes_avx512<char32_t>;
+}
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+#pragma GCC diagnostic pop
+#endif
+// vim: ts=4 sw=4 et
@@ -0,0 +1,278 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the SIMD kernels.
+ *
+ * This file declares the table of kernels used by the library functions.
+ * Each kernel has a scalar implementation and, on x86, zero or more SIMD
+ * implementations. The table gets filled once with the best version
+ * supported by the running CPU.
+ *
+ * The SIMD implementations are compiled with the GCC `target` attribute
+ * instead of command line flags. This way the rest of the library (and
+ * especially the inline functions from the C++ headers) never gets
+ * compiled with instructions the running CPU may not support.
+ *
+ * This file is considered private.
+ */
+
+// self
+//
+#include    <libutf8/simd.h>
+
+
+// C++
+//
+#include    <cstddef>
+#include    <cstdint>
+#include    <cstring>
+
+
+// C
+//
+#include    <sys/types.h>
+
+
+
+#if defined(__x86_64__)
+#define LIBUTF8_X86_SIMD        1
+#define LIBUTF8_TARGET_SSE4_2   __attribute__((target("sse4.2,popcnt")))
+#define LIBUTF8_TARGET_AVX2     __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define LIBUTF8_TARGET_AVX512   __attribute__((target("avx512f,avx512bw,avx512vl,avx512vbmi,avx512vbmi2,avx2,bmi,bmi2,popcnt")))
+#else
+#define LIBUTF8_X86_SIMD        0
+#endif
+
+
+
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+/** \brief Result of a conversion kernel.
+ *
+ * The conversion kernels convert as much of the input as they can and
+ * return the number of input code units read and output code units
+ * written. They stop early on an error or when the output buffer gets
+ * full. The caller finishes the work with the scalar code which also
+ * generates the proper error.
+ */
+struct conversion_t
+{
+    std::size_t         f_read = 0;
+    std::size_t         f_written = 0;
+};
+
+
+struct kernels_t
+{
+    std::size_t         (*f_validate_ascii)(char const * str, std::size_t len, bool ctrl) = nullptr;
+    std::size_t         (*f_validate_utf8)(char const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_validate_utf16)(char16_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_validate_utf32)(char32_t const * str, std::size_t len, bool ctrl) = nullptr;
+    std::size_t         (*f_u8length)(char const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_u8length_unchecked)(char const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf8_offset_of)(char const * str, std::size_t len, std::size_t n) = nullptr;
+    ssize_t             (*f_u16length)(char16_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_u16length_unchecked)(char16_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf8_length_from_utf16)(char16_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf8_length_from_utf32)(char32_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf16_length_from_utf8)(char const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf16_length_from_utf32)(char32_t const * str, std::size_t len) = nullptr;
+    std::size_t         (*f_utf8_length_from_latin1)(char const * str, std::size_t len) = nullptr;
+    conversion_t        (*f_utf8_to_utf16)(char const * str, std::size_t len, char16_t * out, std::size_t out_len) = nullptr;
+    conversion_t        (*f_utf16_to_utf8)(char16_t const * str, std::size_t len, char * out, std::size_t out_len) = nullptr;
+    conversion_t        (*f_utf8_to_utf32)(char const * str, std::size_t len, char32_t * out, std::size_t out_len) = nullptr;
+    conversion_t        (*f_latin1_to_utf8)(char const * str, std::size_t len, char * out, std::size_t out_len) = nullptr;
+    conversion_t        (*f_utf8_to_latin1)(char const * str, std::size_t len, char * out, std::size_t out_len) = nullptr;
+    void                (*f_swap_bytes16)(char const * in, std::size_t count, char16_t * out) = nullptr;
+    void                (*f_swap_bytes32)(char const * in, std::size_t count, char32_t * out) = nullptr;
+};
+
+
+kernels_t const &       kernels();
+
+std::size_t             validate_ascii_scalar(char const * str, std::size_t len, bool ctrl);
+std::size_t             validate_utf8_scalar(char const * str, std::size_t len);
+std::size_t             validate_utf8_from(char const * str, std::size_t len, std::size_t pos);
+std::size_t             validate_utf16_scalar(char16_t const * str, std::size_t len);
+std::size_t             validate_utf32_scalar(char32_t const * str, std::size_t len, bool ctrl);
+std::size_t             u8length_scalar(char const * str, std::size_t len);
+std::size_t             u8length_unchecked_scalar(char const * str, std::size_t len);
+std::size_t             utf8_offset_of_scalar(char const * str, std::size_t len, std::size_t n);
+ssize_t                 u16length_scalar(char16_t const * str, std::size_t len);
+std::size_t             u16length_unchecked_scalar(char16_t const * str, std::size_t len);
+std::size_t             utf8_length_from_utf16_scalar(char16_t const * str, std::size_t len);
+std::size_t             utf8_length_from_utf32_scalar(char32_t const * str, std::size_t len);
+std::size_t             utf16_length_from_utf8_scalar(char const * str, std::size_t len);
+std::size_t             utf16_length_from_utf32_scalar(char32_t const * str, std::size_t len);
+std::size_t             utf8_length_from_latin1_scalar(char const * str, std::size_t len);
+
+/** \brief The scalar version of a conversion kernel.
+ *
+ * The scalar conversion is done by the library function itself, so the
+ * scalar kernel does not convert anything.
+ */
+template<typename InputT, typename OutputT>
+conversion_t convert_none(InputT const *, std::size_t, OutputT *, std::size_t)
+{
+    return conversion_t();
+}
+
+/** \brief Load code units with their bytes swapped.
+ *
+ * This function reads \p count code units from the unaligned buffer
+ * \p in, swaps their bytes (i.e. converts between little and big endian)
+ * and saves them in \p out.
+ *
+ * \param[in] in  The buffer of bytes to read.
+ * \param[in] count  The number of code units to load.
+ * \param[out] out  The buffer receiving the code units.
+ */
+template<typename CharT>
+void swap_bytes_scalar(char const * in, std::size_t count, CharT * out)
+{
+    for(std::size_t pos(0); pos < count; ++pos)
+    {
+        CharT c;
+        std::memcpy(&c, in + pos * sizeof(CharT), sizeof(CharT));
+        if constexpr(sizeof(CharT) == 2)
+        {
+            out[pos] = static_cast<CharT>(__builtin_bswap16(c));
+        }
+        else
+        {
+            out[pos] = static_cast<CharT>(__builtin_bswap32(c));
+        }
+    }
+}
+
+#if LIBUTF8_X86_SIMD
+void                    sse4_2_kernels(kernels_t & k);
+void                    avx2_kernels(kernels_t & k);
+void                    avx512_kernels(kernels_t & k);
+#endif
+
+
+// UTF-8 validation lookup tables (one entry per nibble)
+//
+// see "Validating UTF-8 In Less Than One Instruction Per Byte",
+// John Keiser and Daniel Lemire, 2021
+//
+constexpr std::uint8_t const    UTF8_TOO_SHORT      = 1 << 0;   // 11______ 0_______ or 11______ 11______
+constexpr std::uint8_t const    UTF8_TOO_LONG       = 1 << 1;   // 0_______ 10______
+constexpr std::uint8_t const    UTF8_OVERLONG_3     = 1 << 2;   // 11100000 100_____
+constexpr std::uint8_t const    UTF8_TOO_LARGE      = 1 << 3;   // 11110100 1001____ and up
+constexpr std::uint8_t const    UTF8_SURROGATE      = 1 << 4;   // 11101101 101_____
+constexpr std::uint8_t const    UTF8_OVERLONG_2     = 1 << 5;   // 1100000_ 10______
+constexpr std::uint8_t const    UTF8_TOO_LARGE_1000 = 1 << 6;   // 11110101 1000____ and up
+constexpr std::uint8_t const    UTF8_OVERLONG_4     = 1 << 6;   // 11110000 1000____
+constexpr std::uint8_t const    UTF8_TWO_CONTS      = 1 << 7;   // 10______ 10______
+constexpr std::uint8_t const    UTF8_CARRY          = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS;
+
+alignas(16) inline constexpr std::uint8_t const g_utf8_byte_1_high[16] =
+{
+    // 0_______ ________  (ASCII)
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+
+    // 10______ ________  (continuation)
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+
+    // 1100____ ________  (2 byte lead)
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+
+    // 1101____ ________  (2 byte lead)
+    UTF8_TOO_SHORT,
+
+    // 1110____ ________  (3 byte lead)
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+
+    // 1111____ ________  (4+ byte lead)
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+};
+
+alignas(16) inline constexpr std::uint8_t const g_utf8_byte_1_low[16] =
+{
+    // ____0000 ________
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+
+    // ____0001 ________
+    UTF8_CARRY | UTF8_OVERLONG_2,
+
+    // ____001_ ________
+    UTF8_CARRY,
+    UTF8_CARRY,
+
+    // ____0100 ________
+    UTF8_CARRY | UTF8_TOO_LARGE,
+
+    // ____0101 ________
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+
+    // ____011_ ________
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+
+    // ____1___ ________
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+
+    // ____1101 ________
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+};
+
+alignas(16) inline constexpr std::uint8_t const g_utf8_byte_2_high[16] =
+{
+    // ________ 0_______  (ASCII)
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+
+    // ________ 1000____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+
+    // ________ 1001____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE,
+
+    // ________ 101_____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,
+
+    // ________ 11______  (lead)
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+};
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
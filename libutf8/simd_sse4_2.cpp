@@ -0,0 +1,838 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the SSE4.2 kernels.
+ *
+ * This file implements the kernels using 128 bit registers. They are
+ * used on CPUs which support SSE4.2 but not AVX2.
+ */
+
+// self
+//
+#include    "libutf8/simd_kernels.h"
+#include    "libutf8/simd_transcode.h"
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#if LIBUTF8_X86_SIMD
+#include    <immintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+#if LIBUTF8_X86_SIMD
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Validate UTF-8 relationships in a 16 byte register.
+ *
+ * This class keeps the state of the UTF-8 validation between blocks
+ * of 16 bytes. The check() function accumulates errors in f_error and
+ * the caller tests that value once per block of 64 bytes.
+ */
+class utf8_checker_sse4_2
+{
+public:
+    LIBUTF8_TARGET_SSE4_2
+    utf8_checker_sse4_2()
+        : f_byte_1_high(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_high)))
+        , f_byte_1_low(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_1_low)))
+        , f_byte_2_high(_mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_byte_2_high)))
+    {
+    }
+
+    LIBUTF8_TARGET_SSE4_2
+    void check(__m128i input)
+    {
+        __m128i const nibble_mask(_mm_set1_epi8(0x0F));
+
+        __m128i const prev1(_mm_alignr_epi8(input, f_prev_input, 16 - 1));
+        __m128i const prev2(_mm_alignr_epi8(input, f_prev_input, 16 - 2));
+        __m128i const prev3(_mm_alignr_epi8(input, f_prev_input, 16 - 3));
+
+        __m128i const byte_1_high(_mm_shuffle_epi8(f_byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)));
+        __m128i const byte_1_low(_mm_shuffle_epi8(f_byte_1_low, _mm_and_si128(prev1, nibble_mask)));
+        __m128i const byte_2_high(_mm_shuffle_epi8(f_byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask)));
+        __m128i const special_cases(_mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high));
+
+        __m128i const is_third_byte(_mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80))));
+        __m128i const is_fourth_byte(_mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+        __m128i const must_be_continuation(_mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8(static_cast<char>(0x80))));
+
+        f_error = _mm_or_si128(f_error, _mm_xor_si128(must_be_continuation, special_cases));
+        f_prev_input = input;
+    }
+
+    LIBUTF8_TARGET_SSE4_2
+    void check_block(__m128i const * input)
+    {
+        __m128i const any(_mm_or_si128(_mm_or_si128(input[0], input[1]), _mm_or_si128(input[2], input[3])));
+        if(_mm_movemask_epi8(any) == 0)
+        {
+            // all ASCII, only make sure the previous block was complete
+            //
+            f_error = _mm_or_si128(f_error, f_prev_incomplete);
+            f_prev_incomplete = _mm_setzero_si128();
+            f_prev_input = input[3];
+        }
+        else
+        {
+            check(input[0]);
+            check(input[1]);
+            check(input[2]);
+            check(input[3]);
+
+            // a lead byte in the last 3 bytes is incomplete
+            //
+            f_prev_incomplete = _mm_subs_epu8(input[3], _mm_setr_epi8(
+                      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+                    , static_cast<char>(0xF0 - 1)
+                    , static_cast<char>(0xE0 - 1)
+                    , static_cast<char>(0xC0 - 1)));
+        }
+    }
+
+    LIBUTF8_TARGET_SSE4_2
+    bool has_error() const
+    {
+        return _mm_testz_si128(f_error, f_error) == 0;
+    }
+
+private:
+    __m128i const       f_byte_1_high;
+    __m128i const       f_byte_1_low;
+    __m128i const       f_byte_2_high;
+    __m128i             f_prev_input = _mm_setzero_si128();
+    __m128i             f_prev_incomplete = _mm_setzero_si128();
+    __m128i             f_error = _mm_setzero_si128();
+};
+
+
+/** \brief Search the first byte which is not valid ASCII.
+ *
+ * The signed comparison against 0x20 catches the controls and the bytes
+ * 0x80 to 0xFF at once, the second comparison catches 0x7F.
+ */
+template<bool ctrl>
+LIBUTF8_TARGET_SSE4_2
+std::size_t validate_ascii_sse4_2(char const * str, std::size_t len)
+{
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        int mask(0);
+        if constexpr(ctrl)
+        {
+            mask = _mm_movemask_epi8(input);
+        }
+        else
+        {
+            mask = _mm_movemask_epi8(_mm_or_si128(
+                      _mm_cmplt_epi8(input, _mm_set1_epi8(0x20))
+                    , _mm_cmpeq_epi8(input, _mm_set1_epi8(0x7F))));
+        }
+        if(mask != 0)
+        {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+
+    return pos + validate_ascii_scalar(str + pos, len - pos, ctrl);
+}
+
+
+std::size_t validate_ascii_sse4_2(char const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_ascii_sse4_2<true>(str, len)
+        : validate_ascii_sse4_2<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t validate_utf8_sse4_2(char const * str, std::size_t len)
+{
+    utf8_checker_sse4_2 checker;
+    __m128i input[4];
+
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        input[0] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos +  0));
+        input[1] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 16));
+        input[2] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 32));
+        input[3] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 48));
+        checker.check_block(input);
+        if(checker.has_error())
+        {
+            return validate_utf8_from(str, len, pos);
+        }
+    }
+
+    // the last block gets padded with zeroes, a sequence cut short by
+    // the end of the buffer is then followed by '\0' which is an error
+    //
+    alignas(16) char tail[64] = {};
+    if(pos < len)
+    {
+        memcpy(tail, str + pos, len - pos);
+    }
+    input[0] = _mm_load_si128(reinterpret_cast<__m128i const *>(tail +  0));
+    input[1] = _mm_load_si128(reinterpret_cast<__m128i const *>(tail + 16));
+    input[2] = _mm_load_si128(reinterpret_cast<__m128i const *>(tail + 32));
+    input[3] = _mm_load_si128(reinterpret_cast<__m128i const *>(tail + 48));
+    checker.check_block(input);
+    if(checker.has_error())
+    {
+        return validate_utf8_from(str, len, pos);
+    }
+
+    return len;
+}
+
+
+
+/** \brief Count the characters of a UTF-8 buffer.
+ *
+ * This function counts the bytes which do not start a character, 64 bytes
+ * at a time, and subtracts that number from the length. Those are the
+ * continuation bytes (0x80 to 0xBF) and, when \p checked is true, the
+ * invalid bytes (0xF8 to 0xFF). The last few bytes are counted by the
+ * scalar version.
+ */
+template<bool checked>
+LIBUTF8_TARGET_SSE4_2
+std::size_t u8length_sse4_2(char const * str, std::size_t len)
+{
+    // as signed bytes, the continuation bytes are -128 to -65, the
+    // invalid bytes are found with an unsigned compare
+    //
+    __m128i const continuation(_mm_set1_epi8(-64));
+    __m128i const invalid(_mm_set1_epi8(static_cast<char>(0xF8)));
+
+    std::size_t skip(0);
+    std::size_t pos(0);
+    for(; pos + 64 <= len; pos += 64)
+    {
+        for(int idx(0); idx < 64; idx += 16)
+        {
+            __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + idx)));
+            __m128i mask(_mm_cmplt_epi8(input, continuation));
+            if constexpr(checked)
+            {
+                mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_max_epu8(input, invalid), input));
+            }
+            skip += _mm_popcnt_u32(_mm_movemask_epi8(mask));
+        }
+    }
+
+    if constexpr(checked)
+    {
+        return pos - skip + u8length_scalar(str + pos, len - pos);
+    }
+    else
+    {
+        return pos - skip + u8length_unchecked_scalar(str + pos, len - pos);
+    }
+}
+
+
+/** \brief Find the offset of a character in a valid UTF-8 buffer.
+ *
+ * This function counts the bytes which start a character 16 at a time
+ * and skips the whole block when it has \p n such bytes or less. The
+ * block which includes the character and the last few bytes are
+ * searched by the scalar version.
+ */
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf8_offset_of_sse4_2(char const * str, std::size_t len, std::size_t n)
+{
+    __m128i const continuation(_mm_set1_epi8(-64));
+
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        std::size_t const count(16 - _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmplt_epi8(input, continuation))));
+        if(count > n)
+        {
+            break;
+        }
+        n -= count;
+    }
+
+    return pos + utf8_offset_of_scalar(str + pos, len - pos, n);
+}
+
+
+/** \brief Compute the surrogate masks of 16 UTF-16 code units.
+ *
+ * This function sets bit N of \p high and \p low when the code unit N
+ * is a high or a low surrogate respectively.
+ */
+LIBUTF8_TARGET_SSE4_2
+inline void surrogate_masks(char16_t const * str, std::uint32_t & high, std::uint32_t & low)
+{
+    __m128i const surrogate_mask(_mm_set1_epi16(static_cast<short>(0xFC00)));
+    __m128i const high_surrogate(_mm_set1_epi16(static_cast<short>(0xD800)));
+    __m128i const low_surrogate(_mm_set1_epi16(static_cast<short>(0xDC00)));
+
+    __m128i const input0(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + 0)), surrogate_mask));
+    __m128i const input1(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + 8)), surrogate_mask));
+
+    high = _mm_movemask_epi8(_mm_packs_epi16(
+                  _mm_cmpeq_epi16(input0, high_surrogate)
+                , _mm_cmpeq_epi16(input1, high_surrogate)));
+    low = _mm_movemask_epi8(_mm_packs_epi16(
+                  _mm_cmpeq_epi16(input0, low_surrogate)
+                , _mm_cmpeq_epi16(input1, low_surrogate)));
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+ssize_t u16length_sse4_2(char16_t const * str, std::size_t len)
+{
+    // each low surrogate must follow a high surrogate, and vice versa
+    // so the low mask must be the high mask shifted by one code unit
+    //
+    std::uint32_t carry(0);
+    std::size_t low_count(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        if((((high << 1) | carry) & 0xFFFF) != low)
+        {
+            return -1;
+        }
+        carry = high >> 15;
+        low_count += _mm_popcnt_u32(low);
+    }
+
+    // let the scalar version verify the pair cut by the end of the blocks
+    //
+    pos -= carry;
+    ssize_t const tail(u16length_scalar(str + pos, len - pos));
+    if(tail < 0)
+    {
+        return -1;
+    }
+    return static_cast<ssize_t>(pos - low_count) + tail;
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t u16length_unchecked_sse4_2(char16_t const * str, std::size_t len)
+{
+    std::size_t low_count(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        low_count += _mm_popcnt_u32(low);
+    }
+
+    return pos - low_count + u16length_unchecked_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t validate_utf16_sse4_2(char16_t const * str, std::size_t len)
+{
+    std::uint32_t carry(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        std::uint32_t high(0);
+        std::uint32_t low(0);
+        surrogate_masks(str + pos, high, low);
+        if((((high << 1) | carry) & 0xFFFF) != low)
+        {
+            break;
+        }
+        carry = high >> 15;
+    }
+
+    // the scalar version finds the exact position of an error and
+    // verifies the pair cut by the end of the blocks
+    //
+    pos -= carry;
+    return pos + validate_utf16_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf8_length_from_utf16_sse4_2(char16_t const * str, std::size_t len)
+{
+    // the result is 3 bytes per code unit minus one for each code unit
+    // under 0x80, under 0x800, or a surrogate; the movemask gives us two
+    // bits per code unit which we divide by two at the end
+    //
+    __m128i const zero(_mm_setzero_si128());
+    __m128i const ascii_mask(_mm_set1_epi16(static_cast<short>(0xFF80)));
+    __m128i const two_bytes_mask(_mm_set1_epi16(static_cast<short>(0xF800)));
+    __m128i const surrogate(_mm_set1_epi16(static_cast<short>(0xD800)));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 8 <= len; pos += 8)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        __m128i const high_bits(_mm_and_si128(input, two_bytes_mask));
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(input, ascii_mask), zero)))
+               + _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, zero)))
+               + _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi16(high_bits, surrogate)));
+    }
+
+    return pos * 3 - count / 2 + utf8_length_from_utf16_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf8_length_from_utf32_sse4_2(char32_t const * str, std::size_t len)
+{
+    // one byte per character plus one for each character at or over
+    // 0x80, 0x800, and 0x10000; the movemask gives us four bits per
+    // character which we divide by four at the end
+    //
+    __m128i const two_bytes(_mm_set1_epi32(0x80));
+    __m128i const three_bytes(_mm_set1_epi32(0x800));
+    __m128i const four_bytes(_mm_set1_epi32(0x10000));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 4 <= len; pos += 4)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_max_epu32(input, two_bytes), input)))
+               + _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_max_epu32(input, three_bytes), input)))
+               + _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_max_epu32(input, four_bytes), input)));
+    }
+
+    return pos + count / 4 + utf8_length_from_utf32_scalar(str + pos, len - pos);
+}
+
+
+/** \brief Search invalid characters in 4 UTF-32 characters.
+ *
+ * The returned vector has all the bits of a lane set when the
+ * corresponding character is over 0x10FFFF, is a surrogate, or, if
+ * \p ctrl is false, is a control. The comparisons are unsigned so
+ * negative values are viewed as too large.
+ */
+template<bool ctrl>
+LIBUTF8_TARGET_SSE4_2
+inline __m128i invalid_unicode(__m128i input)
+{
+    __m128i result(_mm_or_si128(
+              _mm_cmpeq_epi32(_mm_max_epu32(input, _mm_set1_epi32(0x110000)), input)
+            , _mm_cmpeq_epi32(_mm_and_si128(input, _mm_set1_epi32(static_cast<int>(0xFFFFF800))), _mm_set1_epi32(0xD800))));
+    if constexpr(!ctrl)
+    {
+        // 0x00 to 0x1F and 0x7F to 0x9F
+        //
+        __m128i const c1(_mm_sub_epi32(input, _mm_set1_epi32(0x7F)));
+        result = _mm_or_si128(result, _mm_or_si128(
+                  _mm_cmpeq_epi32(_mm_min_epu32(input, _mm_set1_epi32(0x1F)), input)
+                , _mm_cmpeq_epi32(_mm_min_epu32(c1, _mm_set1_epi32(0x20)), c1)));
+    }
+    return result;
+}
+
+
+template<bool ctrl>
+LIBUTF8_TARGET_SSE4_2
+std::size_t validate_utf32_sse4_2(char32_t const * str, std::size_t len)
+{
+    std::size_t pos(0);
+    for(; pos + 8 <= len; pos += 8)
+    {
+        __m128i const invalid(_mm_or_si128(
+                  invalid_unicode<ctrl>(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 0)))
+                , invalid_unicode<ctrl>(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 4)))));
+        if(!_mm_testz_si128(invalid, invalid))
+        {
+            break;
+        }
+    }
+
+    return pos + validate_utf32_scalar(str + pos, len - pos, ctrl);
+}
+
+
+std::size_t validate_utf32_sse4_2(char32_t const * str, std::size_t len, bool ctrl)
+{
+    return ctrl
+        ? validate_utf32_sse4_2<true>(str, len)
+        : validate_utf32_sse4_2<false>(str, len);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf16_length_from_utf8_sse4_2(char const * str, std::size_t len)
+{
+    // one code unit per byte which is not a continuation byte plus one
+    // for each 4 byte sequence
+    //
+    __m128i const continuation(_mm_set1_epi8(-64));
+    __m128i const four_bytes(_mm_set1_epi8(static_cast<char>(0xF0)));
+
+    std::size_t skip(0);
+    std::size_t extra(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        skip += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmplt_epi8(input, continuation)));
+        extra += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(input, four_bytes), input)));
+    }
+
+    return pos - skip + extra + utf16_length_from_utf8_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf16_length_from_utf32_sse4_2(char32_t const * str, std::size_t len)
+{
+    // one code unit per character plus one for each character at or
+    // over 0x10000; the movemask gives us four bits per character
+    //
+    __m128i const four_bytes(_mm_set1_epi32(0x10000));
+
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 4 <= len; pos += 4)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_max_epu32(input, four_bytes), input)));
+    }
+
+    return pos + count / 4 + utf16_length_from_utf32_scalar(str + pos, len - pos);
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+std::size_t utf8_length_from_latin1_sse4_2(char const * str, std::size_t len)
+{
+    // the movemask directly gives us the bytes with bit 7 set
+    //
+    std::size_t count(0);
+    std::size_t pos(0);
+    for(; pos + 16 <= len; pos += 16)
+    {
+        count += _mm_popcnt_u32(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos))));
+    }
+
+    return pos + count + utf8_length_from_latin1_scalar(str + pos, len - pos);
+}
+
+
+/** \brief Convert UTF-8 to UTF-16 or UTF-32.
+ *
+ * This function validates the input 64 bytes at a time with the UTF-8
+ * checker. The characters of a valid block are then decoded with the
+ * shuffle windows (see decode_utf8_window()). A character which
+ * continues in the next block is decoded with the next block.
+ *
+ * The function stops on the first block with an error, when the output
+ * buffer is nearly full, or when less than 64 bytes remain. The caller
+ * converts the rest.
+ */
+template<typename CharT>
+LIBUTF8_TARGET_SSE4_2
+conversion_t utf8_to_wide_sse4_2(char const * str, std::size_t len, CharT * out, std::size_t out_len)
+{
+    utf8_checker_sse4_2 checker;
+    __m128i input[4];
+
+    CharT * o(out);
+    std::size_t converted(0);
+    for(std::size_t pos(0); pos + 64 <= len; pos += 64)
+    {
+        // this block generates at most one character per byte and the
+        // windows write up to 16 characters at once
+        //
+        if(out_len - static_cast<std::size_t>(o - out) < pos + 64 - converted + 16)
+        {
+            break;
+        }
+
+        input[0] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos +  0));
+        input[1] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 16));
+        input[2] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 32));
+        input[3] = _mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos + 48));
+        checker.check_block(input);
+        if(checker.has_error())
+        {
+            break;
+        }
+
+        std::size_t const limit(complete_utf8(str, pos + 64));
+        while(converted + 16 <= limit)
+        {
+            converted += decode_utf8_window(str + converted, o);
+        }
+    }
+
+    return conversion_t{ converted, static_cast<std::size_t>(o - out) };
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+conversion_t utf16_to_utf8_sse4_2(char16_t const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    char * o(out);
+    char const * const out_end(out + out_len);
+    std::size_t pos(0);
+    while(pos + 8 <= len && out_end - o >= 32)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        if(_mm_testz_si128(input, _mm_set1_epi16(static_cast<short>(0xFF80))))
+        {
+            // 8 ASCII characters
+            //
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(o), _mm_packus_epi16(input, input));
+            o += 8;
+            pos += 8;
+            continue;
+        }
+
+        __m128i const surrogates(_mm_cmpeq_epi16(
+                  _mm_and_si128(input, _mm_set1_epi16(static_cast<short>(0xF800)))
+                , _mm_set1_epi16(static_cast<short>(0xD800))));
+        if(_mm_testz_si128(surrogates, surrogates))
+        {
+            encode_utf8_4(_mm_cvtepu16_epi32(input), o);
+            encode_utf8_4(_mm_cvtepu16_epi32(_mm_srli_si128(input, 8)), o);
+            pos += 8;
+            continue;
+        }
+
+        // surrogates are rare, check and convert them one at a time
+        //
+        std::size_t const next(utf16_to_utf8_units(str, pos, pos + 8, len, o));
+        if(next < pos + 8)
+        {
+            pos = next;
+            break;
+        }
+        pos = next;
+    }
+
+    return conversion_t{ pos, static_cast<std::size_t>(o - out) };
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+conversion_t latin1_to_utf8_sse4_2(char const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    // 16 Latin-1 characters give up to 32 bytes and encode_utf8_4()
+    // stores 16 bytes at a time
+    //
+    char * o(out);
+    char * const out_end(out + out_len);
+    std::size_t pos(0);
+    for(; pos + 16 <= len && out_end - o >= 48; pos += 16)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        if(_mm_movemask_epi8(input) == 0)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), input);
+            o += 16;
+            continue;
+        }
+
+        encode_utf8_4(_mm_cvtepu8_epi32(input), o);
+        encode_utf8_4(_mm_cvtepu8_epi32(_mm_srli_si128(input, 4)), o);
+        encode_utf8_4(_mm_cvtepu8_epi32(_mm_srli_si128(input, 8)), o);
+        encode_utf8_4(_mm_cvtepu8_epi32(_mm_srli_si128(input, 12)), o);
+    }
+
+    return conversion_t{ pos, static_cast<std::size_t>(o - out) };
+}
+
+
+LIBUTF8_TARGET_SSE4_2
+conversion_t utf8_to_latin1_sse4_2(char const * str, std::size_t len, char * out, std::size_t out_len)
+{
+    // the two compressed halves get stored with 16 byte stores
+    //
+    char * o(out);
+    char * const out_end(out + out_len);
+    std::size_t pos(0);
+    while(pos + 16 <= len && out_end - o >= 24)
+    {
+        __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(str + pos)));
+        std::uint32_t const high(_mm_movemask_epi8(input));
+        if(high == 0)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(o), input);
+            o += 16;
+            pos += 16;
+            continue;
+        }
+
+        // each C2 or C3 lead byte must be followed by exactly one
+        // continuation byte, anything else is handled one at a time
+        //
+        __m128i const is_lead(_mm_cmpeq_epi8(
+                  _mm_and_si128(input, _mm_set1_epi8(static_cast<char>(0xFE)))
+                , _mm_set1_epi8(static_cast<char>(0xC2))));
+        std::uint32_t const lead(_mm_movemask_epi8(is_lead));
+        std::uint32_t const continuation(_mm_movemask_epi8(_mm_cmpeq_epi8(
+                  _mm_and_si128(input, _mm_set1_epi8(static_cast<char>(0xC0)))
+                , _mm_set1_epi8(static_cast<char>(0x80)))));
+        if((lead | continuation) != high
+        || (lead << 1) != continuation)
+        {
+            std::size_t const next(utf8_to_latin1_units(str, pos, pos + 16, len, o));
+            if(next < pos + 16)
+            {
+                pos = next;
+                break;
+            }
+            pos = next;
+            continue;
+        }
+
+        // compute the character at the position of each lead byte and
+        // then remove the continuation bytes
+        //
+        __m128i const value(_mm_or_si128(
+                  _mm_slli_epi16(_mm_and_si128(input, _mm_set1_epi8(0x03)), 6)
+                , _mm_and_si128(_mm_srli_si128(input, 1), _mm_set1_epi8(0x3F))));
+        __m128i const bytes(_mm_blendv_epi8(input, value, is_lead));
+        std::uint32_t const keep(~continuation);
+        _mm_storeu_si128(
+                  reinterpret_cast<__m128i *>(o)
+                , _mm_shuffle_epi8(bytes, _mm_loadl_epi64(reinterpret_cast<__m128i const *>(g_compress_8.f_shuffle[keep & 0xFF]))));
+        o += g_compress_8.f_length[keep & 0xFF];
+        _mm_storeu_si128(
+                  reinterpret_cast<__m128i *>(o)
+                , _mm_shuffle_epi8(_mm_srli_si128(bytes, 8), _mm_loadl_epi64(reinterpret_cast<__m128i const *>(g_compress_8.f_shuffle[(keep >> 8) & 0xFF]))));
+        o += g_compress_8.f_length[(keep >> 8) & 0xFF];
+        pos += 16;
+    }
+
+    return conversion_t{ pos, static_cast<std::size_t>(o - out) };
+}
+
+
+/** \brief Get the shuffle swapping the bytes of each code unit.
+ *
+ * The vector selects the bytes of 2 or 4 byte code units in reverse order.
+ */
+template<typename CharT>
+LIBUTF8_TARGET_SSE4_2
+inline __m128i swap_shuffle()
+{
+    if constexpr(sizeof(CharT) == 2)
+    {
+        return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    }
+    else
+    {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+}
+
+
+template<typename CharT>
+LIBUTF8_TARGET_SSE4_2
+void swap_bytes_sse4_2(char const * in, std::size_t count, CharT * out)
+{
+    __m128i const shuffle(swap_shuffle<CharT>());
+    std::size_t const units(16 / sizeof(CharT));
+
+    std::size_t pos(0);
+    for(; pos + units <= count; pos += units)
+    {
+        _mm_storeu_si128(
+                  reinterpret_cast<__m128i *>(out + pos)
+                , _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(in + pos * sizeof(CharT))), shuffle));
+    }
+
+    swap_bytes_scalar(in + pos * sizeof(CharT), count - pos, out + pos);
+}
+
+
+
+} // no name namespace
+
+
+
+void sse4_2_kernels(kernels_t & k)
+{
+    k.f_validate_ascii = validate_ascii_sse4_2;
+    k.f_validate_utf8 = validate_utf8_sse4_2;
+    k.f_validate_utf16 = validate_utf16_sse4_2;
+    k.f_validate_utf32 = validate_utf32_sse4_2;
+    k.f_u8length = u8length_sse4_2<true>;
+    k.f_u8length_unchecked = u8length_sse4_2<false>;
+    k.f_utf8_offset_of = utf8_offset_of_sse4_2;
+    k.f_u16length = u16length_sse4_2;
+    k.f_u16length_unchecked = u16length_unchecked_sse4_2;
+    k.f_utf8_length_from_utf16 = utf8_length_from_utf16_sse4_2;
+    k.f_utf8_length_from_utf32 = utf8_length_from_utf32_sse4_2;
+    k.f_utf16_length_from_utf8 = utf16_length_from_utf8_sse4_2;
+    k.f_utf16_length_from_utf32 = utf16_length_from_utf32_sse4_2;
+    k.f_utf8_length_from_latin1 = utf8_length_from_latin1_sse4_2;
+    k.f_utf8_to_utf16 = utf8_to_wide_sse4_2<char16_t>;
+    k.f_utf16_to_utf8 = utf16_to_utf8_sse4_2;
+    k.f_utf8_to_utf32 = utf8_to_wide_sse4_2<char32_t>;
+    k.f_latin1_to_utf8 = latin1_to_utf8_sse4_2;
+    k.f_utf8_to_latin1 = utf8_to_latin1_sse4_2;
+    k.f_swap_bytes16 = swap_bytes_sse4_2<char16_t>;
+    k.f_swap_bytes32 = swap_bytes_sse4_2<char32_t>;
+}
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+#endif
+// vim: ts=4 sw=4 et
@@ -0,0 +1,636 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The shuffle tables and helpers of the SIMD transcoders.
+ *
+ * The SSE4.2 and AVX2 transcoders use shuffles to move the bytes of
+ * each character in place. The shuffle masks depend on the length of
+ * the characters found in the input and are computed at compile time
+ * in the tables defined here.
+ *
+ * The helper functions are compiled for SSE4.2. The AVX2 kernels call
+ * them as well since AVX2 is a superset of SSE4.2.
+ *
+ * This file is considered private.
+ */
+
+// self
+//
+#include    "libutf8/base.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// C
+//
+#if LIBUTF8_X86_SIMD
+#include    <immintrin.h>
+#endif
+
+
+
+namespace libutf8
+{
+
+namespace detail
+{
+
+
+
+/** \brief Shuffle used to encode four UTF-16 code units to UTF-8.
+ *
+ * The encoder computes the UTF-8 bytes of four characters in four 32 bit
+ * lanes (first byte in the lowest byte of the lane). The shuffle then
+ * packs the 1 to 3 bytes of each lane together. Bytes set to 0x80 are
+ * cleared by the shuffle.
+ */
+struct utf16_to_utf8_shuffle_t
+{
+    std::uint8_t        f_shuffle[16] = {};
+    std::uint8_t        f_length = 0;
+};
+
+
+/** \brief Shuffles to encode four UTF-16 code units to UTF-8.
+ *
+ * The table is indexed with a mask of the characters which are 0x80 or
+ * more (bits 0 to 3) and a mask of the characters which are 0x800 or
+ * more (bits 4 to 7). Combinations where a character is 0x800 or more
+ * without being 0x80 or more do not happen.
+ */
+struct utf16_to_utf8_table_t
+{
+    constexpr utf16_to_utf8_table_t()
+    {
+        for(int idx(0); idx < 256; ++idx)
+        {
+            utf16_to_utf8_shuffle_t & e(f_entries[idx]);
+            int o(0);
+            for(int lane(0); lane < 4; ++lane)
+            {
+                int const length(1 + ((idx >> lane) & 1) + ((idx >> (lane + 4)) & 1));
+                for(int b(0); b < length; ++b)
+                {
+                    e.f_shuffle[o] = static_cast<std::uint8_t>(lane * 4 + b);
+                    ++o;
+                }
+            }
+            e.f_length = static_cast<std::uint8_t>(o);
+            for(; o < 16; ++o)
+            {
+                e.f_shuffle[o] = 0x80;
+            }
+        }
+    }
+
+    alignas(16) utf16_to_utf8_shuffle_t f_entries[256] = {};
+};
+
+
+inline constexpr utf16_to_utf8_table_t const    g_utf16_to_utf8{};
+
+
+/** \brief Shuffles to keep some of eight bytes.
+ *
+ * The table is indexed with a mask of the bytes to keep. Each entry
+ * moves those bytes at the start of the vector and gives their number.
+ */
+struct compress_8_table_t
+{
+    constexpr compress_8_table_t()
+    {
+        for(int idx(0); idx < 256; ++idx)
+        {
+            int o(0);
+            for(int b(0); b < 8; ++b)
+            {
+                if((idx & (1 << b)) != 0)
+                {
+                    f_shuffle[idx][o] = static_cast<std::uint8_t>(b);
+                    ++o;
+                }
+            }
+            f_length[idx] = static_cast<std::uint8_t>(o);
+            for(; o < 8; ++o)
+            {
+                f_shuffle[idx][o] = 0x80;
+            }
+        }
+    }
+
+    alignas(8) std::uint8_t     f_shuffle[256][8] = {};
+    std::uint8_t                f_length[256] = {};
+};
+
+
+inline constexpr compress_8_table_t const       g_compress_8{};
+
+
+/** \brief How to decode a window of UTF-8 bytes.
+ *
+ * The UTF-8 decoder looks at 12 bytes at a time. The mask of the bytes
+ * which end a character is used as the index in a table of 4096 windows.
+ * Each entry tells which shuffle to use and how many bytes of input get
+ * consumed:
+ *
+ * \li f_shuffle < 64 -- six characters of 1 or 2 bytes, the shuffle puts
+ * each character in a 16 bit lane; bit N of f_shuffle is set if character
+ * N is 2 bytes;
+ * \li f_shuffle < 64 + 81 -- four characters of 1 to 3 bytes, the shuffle
+ * puts each character in a 32 bit lane; f_shuffle - 64 represents the
+ * length minus one of each character in base 3;
+ * \li otherwise -- the window includes a 4 byte character, the characters
+ * up to and including that character are decoded one by one.
+ *
+ * In the lanes, the last byte of the character is put in the lowest byte
+ * and the lead byte in the highest byte used.
+ */
+struct utf8_window_t
+{
+    std::uint8_t        f_shuffle = 0;
+    std::uint8_t        f_consumed = 0;
+};
+
+
+constexpr std::uint8_t const    UTF8_WINDOW_TWO_BYTES = 0;
+constexpr std::uint8_t const    UTF8_WINDOW_THREE_BYTES = 64;
+constexpr std::uint8_t const    UTF8_WINDOW_SCALAR = 64 + 81;
+
+
+struct utf8_window_table_t
+{
+    constexpr utf8_window_table_t()
+    {
+        for(int mask(0); mask < 4096; ++mask)
+        {
+            // compute the length of each character ending in the window
+            //
+            int lengths[12] = {};
+            int count(0);
+            int start(0);
+            for(int bit(0); bit < 12; ++bit)
+            {
+                if((mask & (1 << bit)) != 0)
+                {
+                    lengths[count] = bit + 1 - start;
+                    ++count;
+                    start = bit + 1;
+                }
+            }
+
+            utf8_window_t & w(f_windows[mask]);
+            if(count >= 6
+            && lengths[0] <= 2 && lengths[1] <= 2 && lengths[2] <= 2
+            && lengths[3] <= 2 && lengths[4] <= 2 && lengths[5] <= 2)
+            {
+                int pattern(0);
+                int consumed(0);
+                for(int c(0); c < 6; ++c)
+                {
+                    pattern |= (lengths[c] - 1) << c;
+                    consumed += lengths[c];
+                }
+                w.f_shuffle = static_cast<std::uint8_t>(UTF8_WINDOW_TWO_BYTES + pattern);
+                w.f_consumed = static_cast<std::uint8_t>(consumed);
+            }
+            else if(count >= 4
+                 && lengths[0] <= 3 && lengths[1] <= 3
+                 && lengths[2] <= 3 && lengths[3] <= 3)
+            {
+                int pattern(0);
+                int consumed(0);
+                for(int c(3); c >= 0; --c)
+                {
+                    pattern = pattern * 3 + lengths[c] - 1;
+                    consumed += lengths[c];
+                }
+                w.f_shuffle = static_cast<std::uint8_t>(UTF8_WINDOW_THREE_BYTES + pattern);
+                w.f_consumed = static_cast<std::uint8_t>(consumed);
+            }
+            else
+            {
+                // a 4 byte character (or an invalid mask which never
+                // happens with valid UTF-8)
+                //
+                int consumed(0);
+                for(int c(0); c < count; ++c)
+                {
+                    consumed += lengths[c];
+                    if(lengths[c] >= 4)
+                    {
+                        break;
+                    }
+                }
+                w.f_shuffle = UTF8_WINDOW_SCALAR;
+                w.f_consumed = static_cast<std::uint8_t>(consumed);
+            }
+        }
+
+        // six characters of 1 or 2 bytes in 16 bit lanes
+        //
+        for(int pattern(0); pattern < 64; ++pattern)
+        {
+            std::uint8_t * s(f_shuffles[UTF8_WINDOW_TWO_BYTES + pattern]);
+            int offset(0);
+            for(int c(0); c < 8; ++c)
+            {
+                if(c >= 6)
+                {
+                    s[c * 2 + 0] = 0x80;
+                    s[c * 2 + 1] = 0x80;
+                }
+                else if((pattern & (1 << c)) == 0)
+                {
+                    s[c * 2 + 0] = static_cast<std::uint8_t>(offset);
+                    s[c * 2 + 1] = 0x80;
+                    offset += 1;
+                }
+                else
+                {
+                    s[c * 2 + 0] = static_cast<std::uint8_t>(offset + 1);
+                    s[c * 2 + 1] = static_cast<std::uint8_t>(offset);
+                    offset += 2;
+                }
+            }
+        }
+
+        // four characters of 1 to 3 bytes in 32 bit lanes
+        //
+        for(int pattern(0); pattern < 81; ++pattern)
+        {
+            std::uint8_t * s(f_shuffles[UTF8_WINDOW_THREE_BYTES + pattern]);
+            int offset(0);
+            int p(pattern);
+            for(int c(0); c < 4; ++c)
+            {
+                int const length(p % 3 + 1);
+                p /= 3;
+                for(int b(0); b < 4; ++b)
+                {
+                    s[c * 4 + b] = b < length
+                            ? static_cast<std::uint8_t>(offset + length - 1 - b)
+                            : 0x80;
+                }
+                offset += length;
+            }
+        }
+    }
+
+    utf8_window_t               f_windows[4096] = {};
+    alignas(16) std::uint8_t    f_shuffles[64 + 81][16] = {};
+};
+
+
+inline constexpr utf8_window_table_t const      g_utf8_window{};
+
+
+/** \brief Decode one character of a valid UTF-8 buffer.
+ *
+ * This function decodes one character from \p in and moves the pointer
+ * to the next character. The input must already be validated.
+ *
+ * \param[in,out] in  The pointer to the UTF-8 character.
+ *
+ * \return The decoded character.
+ */
+inline char32_t decode_valid_utf8(char const * & in)
+{
+    unsigned char const * s(reinterpret_cast<unsigned char const *>(in));
+    char32_t wc(s[0]);
+    if(wc < 0x80)
+    {
+        in += 1;
+    }
+    else if(wc < 0xE0)
+    {
+        wc = ((wc & 0x1F) << 6) | (s[1] & 0x3F);
+        in += 2;
+    }
+    else if(wc < 0xF0)
+    {
+        wc = ((wc & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        in += 3;
+    }
+    else
+    {
+        wc = ((wc & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        in += 4;
+    }
+    return wc;
+}
+
+
+/** \brief Save one character in UTF-16.
+ *
+ * \param[in,out] out  The output pointer, moved after the code units.
+ * \param[in] wc  The valid character to save.
+ */
+inline void put_char(char16_t * & out, char32_t wc)
+{
+    if(wc >= 0x10000)
+    {
+        *out++ = static_cast<char16_t>((wc >> 10) + (0xD800 - (0x10000 >> 10)));
+        *out++ = static_cast<char16_t>((wc & 0x03FF) + 0xDC00);
+    }
+    else
+    {
+        *out++ = static_cast<char16_t>(wc);
+    }
+}
+
+
+/** \brief Save one character in UTF-32.
+ *
+ * \param[in,out] out  The output pointer, moved after the character.
+ * \param[in] wc  The valid character to save.
+ */
+inline void put_char(char32_t * & out, char32_t wc)
+{
+    *out++ = wc;
+}
+
+
+/** \brief Convert UTF-16 code units to UTF-8 one at a time.
+ *
+ * This function converts the code units from \p pos up to \p stop. If
+ * the last code unit is a high surrogate, then the low surrogate that
+ * follows is also converted (if \p len allows it). The function stops
+ * on the first invalid surrogate.
+ *
+ * \param[in] str  The UTF-16 buffer.
+ * \param[in] pos  The position of the first code unit to convert.
+ * \param[in] stop  The position where to stop.
+ * \param[in] len  The total number of code units in \p str.
+ * \param[in,out] out  The output buffer, moved after the bytes written.
+ *
+ * \return The position reached, it is less than \p stop on an error.
+ */
+inline std::size_t utf16_to_utf8_units(
+      char16_t const * str
+    , std::size_t pos
+    , std::size_t stop
+    , std::size_t len
+    , char * & out)
+{
+    while(pos < stop)
+    {
+        char32_t wc(str[pos]);
+        if((wc & 0xF800) == 0xD800)
+        {
+            if(wc >= 0xDC00
+            || pos + 1 >= len
+            || (str[pos + 1] & 0xFC00) != 0xDC00)
+            {
+                return pos;
+            }
+            wc = (wc << 10) + str[pos + 1] + (0x10000 - (0xD800 << 10) - 0xDC00);
+            ++pos;
+        }
+        out += encode_utf8_char(out, wc);
+        ++pos;
+    }
+    return pos;
+}
+
+
+/** \brief Convert UTF-8 characters to Latin-1 one at a time.
+ *
+ * This function converts the characters from \p pos up to \p stop. The
+ * last character may end after \p stop (if \p len allows it). The
+ * function stops on the first character which is not valid or does not
+ * fit in Latin-1 (i.e. is 0x100 or more).
+ *
+ * \param[in] str  The UTF-8 buffer.
+ * \param[in] pos  The position of the first byte to convert.
+ * \param[in] stop  The position where to stop.
+ * \param[in] len  The total number of bytes in \p str.
+ * \param[in,out] out  The output buffer, moved after the bytes written.
+ *
+ * \return The position reached, it is less than \p stop on an error.
+ */
+inline std::size_t utf8_to_latin1_units(
+      char const * str
+    , std::size_t pos
+    , std::size_t stop
+    , std::size_t len
+    , char * & out)
+{
+    while(pos < stop)
+    {
+        unsigned char const c(static_cast<unsigned char>(str[pos]));
+        if(c >= 0x80)
+        {
+            // only the C2 and C3 lead bytes give characters under 0x100
+            //
+            if((c & 0xFE) != 0xC2
+            || pos + 1 >= len
+            || (str[pos + 1] & 0xC0) != 0x80)
+            {
+                return pos;
+            }
+            *out++ = static_cast<char>(((c & 0x03) << 6) | (str[pos + 1] & 0x3F));
+            pos += 2;
+        }
+        else
+        {
+            *out++ = static_cast<char>(c);
+            ++pos;
+        }
+    }
+    return pos;
+}
+
+
+/** \brief Find the end of the last complete character of a block.
+ *
+ * The SIMD kernels validate blocks of 64 bytes. The last character of a
+ * block may continue in the next block. This function returns \p end
+ * minus the bytes of that incomplete character, if any. The block must
+ * be valid and at least 3 bytes.
+ *
+ * \param[in] str  The UTF-8 buffer.
+ * \param[in] end  The end of the block.
+ *
+ * \return The position right after the last complete character.
+ */
+inline std::size_t complete_utf8(char const * str, std::size_t end)
+{
+    unsigned char const * s(reinterpret_cast<unsigned char const *>(str));
+    if(s[end - 1] >= 0xC0)
+    {
+        return end - 1;
+    }
+    if(s[end - 2] >= 0xE0)
+    {
+        return end - 2;
+    }
+    if(s[end - 3] >= 0xF0)
+    {
+        return end - 3;
+    }
+    return end;
+}
+
+
+#if LIBUTF8_X86_SIMD
+/** \brief Encode four characters of the Basic Plane to UTF-8.
+ *
+ * This function takes four characters (no surrogates) in 32 bit lanes
+ * and saves their UTF-8 encoding at \p out. The function writes 16 bytes
+ * but only moves \p out by the number of valid bytes (4 to 12).
+ *
+ * \param[in] input  The four characters to encode.
+ * \param[in,out] out  The output buffer.
+ */
+LIBUTF8_TARGET_SSE4_2
+inline void encode_utf8_4(__m128i input, char * & out)
+{
+    __m128i const lead_2(_mm_or_si128(_mm_srli_epi32(input, 6), _mm_set1_epi32(0xC0)));
+    __m128i const trail_1(_mm_or_si128(_mm_and_si128(input, _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80)));
+    __m128i const encoded_2(_mm_or_si128(lead_2, _mm_slli_epi32(trail_1, 8)));
+
+    __m128i const lead_3(_mm_or_si128(_mm_srli_epi32(input, 12), _mm_set1_epi32(0xE0)));
+    __m128i const trail_2(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(input, 6), _mm_set1_epi32(0x3F)), _mm_set1_epi32(0x80)));
+    __m128i const encoded_3(_mm_or_si128(
+              _mm_or_si128(lead_3, _mm_slli_epi32(trail_2, 8))
+            , _mm_slli_epi32(trail_1, 16)));
+
+    __m128i const two_bytes(_mm_cmpgt_epi32(input, _mm_set1_epi32(0x7F)));
+    __m128i const three_bytes(_mm_cmpgt_epi32(input, _mm_set1_epi32(0x7FF)));
+    __m128i const encoded(_mm_blendv_epi8(
+              _mm_blendv_epi8(input, encoded_2, two_bytes)
+            , encoded_3
+            , three_bytes));
+
+    int const idx(_mm_movemask_ps(_mm_castsi128_ps(two_bytes))
+               | (_mm_movemask_ps(_mm_castsi128_ps(three_bytes)) << 4));
+    utf16_to_utf8_shuffle_t const & e(g_utf16_to_utf8.f_entries[idx]);
+    _mm_storeu_si128(
+              reinterpret_cast<__m128i *>(out)
+            , _mm_shuffle_epi8(encoded, _mm_loadu_si128(reinterpret_cast<__m128i const *>(e.f_shuffle))));
+    out += e.f_length;
+}
+
+
+/** \brief Decode a window of valid UTF-8 bytes.
+ *
+ * This function decodes the characters found at the start of \p in.
+ * It reads 16 bytes and decodes 4 to 16 characters depending on their
+ * length. The input must be valid and start with a lead byte.
+ *
+ * The function writes up to 16 characters at \p out but only moves it
+ * by the number of characters decoded.
+ *
+ * \param[in] in  The input buffer, at least 16 bytes.
+ * \param[in,out] out  The output buffer.
+ *
+ * \return The number of bytes consumed.
+ */
+template<typename CharT>
+LIBUTF8_TARGET_SSE4_2
+inline std::size_t decode_utf8_window(char const * in, CharT * & out)
+{
+    __m128i const input(_mm_loadu_si128(reinterpret_cast<__m128i const *>(in)));
+    if(_mm_movemask_epi8(input) == 0)
+    {
+        // 16 ASCII characters
+        //
+        if constexpr(sizeof(CharT) == 2)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 0), _mm_cvtepu8_epi16(input));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_cvtepu8_epi16(_mm_srli_si128(input, 8)));
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out +  0), _mm_cvtepu8_epi32(input));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out +  4), _mm_cvtepu8_epi32(_mm_srli_si128(input, 4)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out +  8), _mm_cvtepu8_epi32(_mm_srli_si128(input, 8)));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 12), _mm_cvtepu8_epi32(_mm_srli_si128(input, 12)));
+        }
+        out += 16;
+        return 16;
+    }
+
+    // a byte ends a character when the next byte is not a continuation
+    //
+    int const continuation(_mm_movemask_epi8(_mm_cmplt_epi8(input, _mm_set1_epi8(-64))));
+    int const end_mask((~continuation >> 1) & 0xFFF);
+    utf8_window_t const & w(g_utf8_window.f_windows[end_mask]);
+
+    if(w.f_shuffle < UTF8_WINDOW_THREE_BYTES)
+    {
+        // six characters of 1 or 2 bytes in 16 bit lanes
+        //
+        __m128i const perm(_mm_shuffle_epi8(input, _mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_window.f_shuffles[w.f_shuffle]))));
+        __m128i const ascii(_mm_and_si128(perm, _mm_set1_epi16(0x7F)));
+        __m128i const high(_mm_and_si128(perm, _mm_set1_epi16(0x1F00)));
+        __m128i const composed(_mm_or_si128(ascii, _mm_srli_epi16(high, 2)));
+        if constexpr(sizeof(CharT) == 2)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), composed);
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 0), _mm_cvtepu16_epi32(composed));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4), _mm_cvtepu16_epi32(_mm_srli_si128(composed, 8)));
+        }
+        out += 6;
+    }
+    else if(w.f_shuffle < UTF8_WINDOW_SCALAR)
+    {
+        // four characters of 1 to 3 bytes in 32 bit lanes
+        //
+        __m128i const perm(_mm_shuffle_epi8(input, _mm_load_si128(reinterpret_cast<__m128i const *>(g_utf8_window.f_shuffles[w.f_shuffle]))));
+        __m128i const ascii(_mm_and_si128(perm, _mm_set1_epi32(0x7F)));
+        __m128i const middle(_mm_and_si128(perm, _mm_set1_epi32(0x3F00)));
+        __m128i const high(_mm_and_si128(perm, _mm_set1_epi32(0x0F0000)));
+        __m128i const composed(_mm_or_si128(
+                  _mm_or_si128(ascii, _mm_srli_epi32(middle, 2))
+                , _mm_srli_epi32(high, 4)));
+        if constexpr(sizeof(CharT) == 2)
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi32(composed, composed));
+        }
+        else
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), composed);
+        }
+        out += 4;
+    }
+    else
+    {
+        char const * s(in);
+        char const * const end(in + w.f_consumed);
+        while(s < end)
+        {
+            put_char(out, decode_valid_utf8(s));
+        }
+    }
+
+    return w.f_consumed;
+}
+#endif
+
+
+
+} // detail namespace
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,597 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the exception free conversion functions.
+ *
+ * These functions convert between UTF-8, UTF-16, and UTF-32 in a buffer
+ * supplied by the caller. The SIMD kernels convert the valid part of the
+ * input and a strict scalar loop converts the rest and determines the
+ * status. Like with mbstowc(), overlong sequences, surrogates, and
+ * characters over 0x10FFFF are all refused.
+ *
+ * The transcode() template is the one engine behind all the conversions
+ * between those encodings, including the ones raising exceptions.
+ */
+
+// self
+//
+#include    "libutf8/transcode.h"
+
+#include    "libutf8/base.h"
+#include    "libutf8/exception.h"
+#include    "libutf8/libutf8.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// C++
+//
+#include    <cstdint>
+#include    <cstring>
+#include    <string>
+#include    <type_traits>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief Decode one UTF-8 character.
+ *
+ * This function decodes the character at the start of \p str. It returns
+ * the number of bytes used (1 to 4), 0 if the input ends before the
+ * end of an otherwise valid sequence, or -1 if the sequence is not valid.
+ */
+int decode_char(char const * str, std::size_t left, char32_t & wc)
+{
+    int const size(decode_utf8_char(wc, str, left));
+    if(size < 0
+    && utf8_is_truncated(str, left))
+    {
+        return 0;
+    }
+    return size;
+}
+
+
+/** \brief Decode one UTF-16 character.
+ *
+ * Same as the UTF-8 version, a lone surrogate is invalid and a high
+ * surrogate at the very end of the input is truncated.
+ */
+int decode_char(char16_t const * s, std::size_t left, char32_t & wc)
+{
+    if((s[0] & 0xF800) != 0xD800)
+    {
+        wc = s[0];
+        return 1;
+    }
+    if(s[0] >= 0xDC00)
+    {
+        return -1;
+    }
+    if(left < 2)
+    {
+        return 0;
+    }
+    if((s[1] & 0xFC00) != 0xDC00)
+    {
+        return -1;
+    }
+    wc = (static_cast<char32_t>(s[0] & 0x03FF) << 10) + (s[1] & 0x03FF) + 0x10000;
+    return 2;
+}
+
+
+/** \brief Decode one UTF-32 character.
+ *
+ * The surrogates and the values over 0x10FFFF are invalid.
+ */
+int decode_char(char32_t const * s, std::size_t, char32_t & wc)
+{
+    wc = s[0];
+    if(wc > 0x10FFFF
+    || (wc >= 0xD800 && wc <= 0xDFFF))
+    {
+        return -1;
+    }
+    return 1;
+}
+
+
+std::size_t encoded_size(char, char32_t wc)
+{
+    return utf8_char_length(wc);
+}
+
+
+std::size_t encoded_size(char16_t, char32_t wc)
+{
+    return wc < 0x10000 ? 1 : 2;
+}
+
+
+std::size_t encoded_size(char32_t, char32_t)
+{
+    return 1;
+}
+
+
+void encode_char(char * & out, char32_t wc)
+{
+    out += encode_utf8_char(out, wc);
+}
+
+
+void encode_char(char16_t * & out, char32_t wc)
+{
+    if(wc >= 0x10000)
+    {
+        *out++ = static_cast<char16_t>((wc >> 10) + (0xD800 - (0x10000 >> 10)));
+        *out++ = static_cast<char16_t>((wc & 0x03FF) + 0xDC00);
+    }
+    else
+    {
+        *out++ = static_cast<char16_t>(wc);
+    }
+}
+
+
+void encode_char(char32_t * & out, char32_t wc)
+{
+    *out++ = wc;
+}
+
+
+/** \brief Convert the input one character at a time.
+ *
+ * This function converts \p in starting at \p result.f_read and writing
+ * at \p result.f_written. It stops on the first invalid or truncated
+ * character or when the next character does not fit in the output
+ * buffer. On return, \p result holds the final status.
+ */
+template<typename InputT, typename OutputT>
+transcode_result_t transcode_scalar(
+      std::basic_string_view<InputT> in
+    , OutputT * out
+    , std::size_t out_cap
+    , transcode_result_t result)
+{
+    InputT const * s(in.data() + result.f_read);
+    InputT const * const end(in.data() + in.length());
+    OutputT * o(out + result.f_written);
+    OutputT * const out_end(out + out_cap);
+    while(s < end)
+    {
+        char32_t wc(U'\0');
+        int const size(decode_char(s, end - s, wc));
+        if(size <= 0)
+        {
+            result.f_status = size == 0
+                    ? transcode_status_t::TRANSCODE_STATUS_TRUNCATED
+                    : transcode_status_t::TRANSCODE_STATUS_INVALID;
+            break;
+        }
+        if(static_cast<std::size_t>(out_end - o) < encoded_size(OutputT(), wc))
+        {
+            result.f_status = transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL;
+            break;
+        }
+        encode_char(o, wc);
+        s += size;
+    }
+
+    result.f_read = s - in.data();
+    result.f_written = o - out;
+    result.f_error_position = result.f_read;
+    return result;
+}
+
+
+/** \brief Start the result with what a SIMD kernel converted.
+ *
+ * The kernels only convert valid characters so the scalar loop can
+ * continue where they stopped.
+ */
+transcode_result_t from_kernel(detail::conversion_t const & r)
+{
+    transcode_result_t result;
+    result.f_read = r.f_read;
+    result.f_written = r.f_written;
+    return result;
+}
+
+
+/** \brief The code unit used to process a type of character.
+ *
+ * The `wchar_t` strings are processed as UTF-16 or UTF-32 depending on
+ * the size of `wchar_t` so they get converted in place, without a copy.
+ */
+template<typename CharT>
+struct unit_type
+{
+    typedef CharT       type;
+};
+
+
+template<>
+struct unit_type<wchar_t>
+{
+    typedef std::conditional_t<sizeof(wchar_t) == 2, char16_t, char32_t> type;
+};
+
+
+/** \brief Run the SIMD kernel of a pair of encodings.
+ *
+ * The kernel is selected at compile time. When the input and output
+ * encodings are the same, the validation kernel is used and the valid
+ * part gets copied as is. The pairs without a kernel start with
+ * nothing converted and the scalar loop does all the work.
+ */
+template<typename InputT, typename OutputT>
+detail::conversion_t convert_simd(std::basic_string_view<InputT> in, OutputT * out, std::size_t out_cap)
+{
+    detail::kernels_t const & k(detail::kernels());
+    if constexpr(std::is_same_v<InputT, char> && std::is_same_v<OutputT, char16_t>)
+    {
+        return k.f_utf8_to_utf16(in.data(), in.length(), out, out_cap);
+    }
+    else if constexpr(std::is_same_v<InputT, char> && std::is_same_v<OutputT, char32_t>)
+    {
+        return k.f_utf8_to_utf32(in.data(), in.length(), out, out_cap);
+    }
+    else if constexpr(std::is_same_v<InputT, char16_t> && std::is_same_v<OutputT, char>)
+    {
+        return k.f_utf16_to_utf8(in.data(), in.length(), out, out_cap);
+    }
+    else if constexpr(std::is_same_v<InputT, OutputT>)
+    {
+        std::size_t valid(0);
+        if constexpr(std::is_same_v<InputT, char>)
+        {
+            valid = k.f_validate_utf8(in.data(), in.length());
+        }
+        else if constexpr(std::is_same_v<InputT, char16_t>)
+        {
+            valid = k.f_validate_utf16(in.data(), in.length());
+        }
+        else
+        {
+            valid = k.f_validate_utf32(in.data(), in.length(), true);
+        }
+
+        // when it does not all fit, let the scalar loop find where to
+        // stop so we do not cut a character in half
+        //
+        // with an empty input, out may be a null pointer, which memcpy()
+        // does not accept even with a size of zero
+        //
+        detail::conversion_t r;
+        if(valid <= out_cap)
+        {
+            if(valid > 0)
+            {
+                std::memcpy(out, in.data(), valid * sizeof(InputT));
+            }
+            r.f_read = valid;
+            r.f_written = valid;
+        }
+        return r;
+    }
+    else
+    {
+        return detail::conversion_t();
+    }
+}
+
+
+/** \brief Raise the exception corresponding to a failed conversion.
+ *
+ * The messages are the ones the conversion functions raised before they
+ * were implemented with transcode(). They start with the name of the
+ * public function which was called, \p function, followed by the type
+ * of the input between parenthesis where the old functions did so.
+ *
+ * \param[in] in  The input of the conversion.
+ * \param[in] result  The result of the failed conversion.
+ * \param[in] function  The name of the function, without parenthesis.
+ */
+template<typename InputT>
+[[noreturn]] void throw_transcode_error(
+      std::basic_string_view<InputT> in
+    , transcode_result_t const & result
+    , char const * function)
+{
+    std::string const name(function);
+    if(result.f_status == transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL)
+    {
+        char const * const type(std::is_same_v<InputT, char16_t>
+                        ? "(u16string)"
+                        : (std::is_same_v<InputT, char32_t> ? "(u32string)" : "()"));
+        throw libutf8_exception_overflow(name + type + ": the output buffer is too small.");
+    }
+
+    if constexpr(std::is_same_v<InputT, char32_t>)
+    {
+        throw libutf8_exception_encoding(
+                  name
+                + "(u32string): the input wide character with code "
+                + std::to_string(static_cast<std::uint32_t>(in[result.f_error_position]))
+                + " is not a valid UTF-32 character.");
+    }
+    else if constexpr(std::is_same_v<InputT, char16_t>)
+    {
+        std::size_t const pos(result.f_error_position);
+        if(is_surrogate(in[pos]) == surrogate_t::SURROGATE_LOW)
+        {
+            // 0xDC00 to 0xDFFF; introducer missing
+            //
+            throw libutf8_exception_decoding(name + "(): found a high UTF-16 surrogate without the low surrogate.");
+        }
+        if(pos + 1 >= in.length())
+        {
+            throw libutf8_exception_decoding(name + "(): the high UTF-16 surrogate is not followed by the low surrogate.");
+        }
+        if(is_surrogate(in[pos + 1]) == surrogate_t::SURROGATE_HIGH)
+        {
+            throw libutf8_exception_decoding(name + "(): found two high UTF-16 surrogates in a row.");
+        }
+        throw libutf8_exception_decoding(name + "(): found a high UTF-16 surrogate without a low surrogate afterward.");
+    }
+    else
+    {
+        throw libutf8_exception_decoding(name + "(): a UTF-8 character could not be extracted.");
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Convert a string from one encoding to another.
+ *
+ * This function is the conversion engine of the library. \p InputT and
+ * \p OutputT select the encodings: `char` is UTF-8, `char16_t` is UTF-16,
+ * `char32_t` is UTF-32, and `wchar_t` is UTF-16 or UTF-32 depending on
+ * its size. The `wchar_t` buffers are processed in place.
+ *
+ * The SIMD kernel of the pair of encodings, if any, is selected at
+ * compile time. It converts the valid part of the input and a strict
+ * scalar loop converts the rest and determines the status. Overlong
+ * sequences, surrogates, and characters over 0x10FFFF are all refused.
+ *
+ * The function stops on the first invalid character, at a character
+ * which is cut short by the end of the input, or on the first character
+ * which does not fit in the output buffer. With the
+ * error_policy_t::ERROR_POLICY_STATUS policy, the returned structure
+ * gives the status, the position of that character in \p in, and the
+ * number of code units read and written so far. With the
+ * error_policy_t::ERROR_POLICY_THROW policy, the error raises an
+ * exception instead.
+ *
+ * \exception libutf8_exception_decoding
+ * The UTF-8 or UTF-16 input is not valid (throwing policy only).
+ *
+ * \exception libutf8_exception_encoding
+ * The UTF-32 input is not valid (throwing policy only).
+ *
+ * \exception libutf8_exception_overflow
+ * The output buffer is too small (throwing policy only).
+ *
+ * \tparam InputT  The type of the input characters.
+ * \tparam OutputT  The type of the output characters.
+ * \tparam policy  How errors get reported.
+ *
+ * \param[in] in  The string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of code units available in \p out.
+ * \param[in] function  The name of the function used in the exception
+ * messages (throwing policy only).
+ *
+ * \return The status and counters of the conversion.
+ */
+template<typename InputT, typename OutputT, error_policy_t policy>
+transcode_result_t transcode(std::basic_string_view<InputT> in, OutputT * out, std::size_t out_cap, char const * function) noexcept(policy == error_policy_t::ERROR_POLICY_STATUS)
+{
+    typedef typename unit_type<InputT>::type    input_unit_t;
+    typedef typename unit_type<OutputT>::type   output_unit_t;
+
+    if constexpr(!std::is_same_v<InputT, input_unit_t>
+              || !std::is_same_v<OutputT, output_unit_t>)
+    {
+        return transcode<input_unit_t, output_unit_t, policy>(
+                  std::basic_string_view<input_unit_t>(reinterpret_cast<input_unit_t const *>(in.data()), in.length())
+                , reinterpret_cast<output_unit_t *>(out)
+                , out_cap
+                , function);
+    }
+    else
+    {
+        transcode_result_t const result(transcode_scalar(
+                  in
+                , out
+                , out_cap
+                , from_kernel(convert_simd(in, out, out_cap))));
+        if constexpr(policy == error_policy_t::ERROR_POLICY_THROW)
+        {
+            if(!result.ok())
+            {
+                throw_transcode_error(in, result, function);
+            }
+        }
+        return result;
+    }
+}
+
+
+#define LIBUTF8_TRANSCODE_INSTANTIATE(input, output) \
+    template transcode_result_t transcode<input, output, error_policy_t::ERROR_POLICY_STATUS>(std::basic_string_view<input>, output *, std::size_t, char const *) noexcept; \
+    template transcode_result_t transcode<input, output, error_policy_t::ERROR_POLICY_THROW>(std::basic_string_view<input>, output *, std::size_t, char const *)
+
+LIBUTF8_TRANSCODE_INSTANTIATE(char, char);
+LIBUTF8_TRANSCODE_INSTANTIATE(char, char16_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char, char32_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char, wchar_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char16_t, char);
+LIBUTF8_TRANSCODE_INSTANTIATE(char16_t, char16_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char16_t, char32_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char16_t, wchar_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char32_t, char);
+LIBUTF8_TRANSCODE_INSTANTIATE(char32_t, char16_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char32_t, char32_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(char32_t, wchar_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(wchar_t, char);
+LIBUTF8_TRANSCODE_INSTANTIATE(wchar_t, char16_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(wchar_t, char32_t);
+LIBUTF8_TRANSCODE_INSTANTIATE(wchar_t, wchar_t);
+
+#undef LIBUTF8_TRANSCODE_INSTANTIATE
+
+
+
+/** \brief Convert UTF-8 to UTF-16 without exceptions.
+ *
+ * This function converts \p in to UTF-16 in the \p out buffer which can
+ * hold up to \p out_cap code units. utf16_length_from_utf8() gives the
+ * size required for valid input.
+ *
+ * The function stops on the first invalid character, at a character
+ * which is cut short by the end of the input, or on the first character
+ * which does not fit in the output buffer. The returned structure gives
+ * the status, the position of that character in \p in, and the number
+ * of code units read and written so far. The characters before that
+ * position are all converted, so a caller can call the function again
+ * with the rest of the input (i.e. after skipping bad bytes or with a
+ * new buffer).
+ *
+ * \param[in] in  The UTF-8 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of code units available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf8_to_utf16(std::string_view in, char16_t * out, std::size_t out_cap) noexcept
+{
+    return transcode<char, char16_t>(in, out, out_cap);
+}
+
+
+/** \brief Convert UTF-8 to UTF-32 without exceptions.
+ *
+ * This function works like convert_utf8_to_utf16() with a UTF-32 output.
+ * u8length() gives the size required for valid input.
+ *
+ * \param[in] in  The UTF-8 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of characters available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf8_to_utf32(std::string_view in, char32_t * out, std::size_t out_cap) noexcept
+{
+    return transcode<char, char32_t>(in, out, out_cap);
+}
+
+
+/** \brief Convert UTF-16 to UTF-8 without exceptions.
+ *
+ * This function works like convert_utf8_to_utf16() with a UTF-16 input.
+ * A lone surrogate is invalid. A high surrogate at the end of \p in
+ * is truncated. utf8_length_from_utf16() gives the size required for
+ * valid input.
+ *
+ * \param[in] in  The UTF-16 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of bytes available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf16_to_utf8(std::u16string_view in, char * out, std::size_t out_cap) noexcept
+{
+    return transcode<char16_t, char>(in, out, out_cap);
+}
+
+
+/** \brief Convert UTF-16 to UTF-32 without exceptions.
+ *
+ * This function works like convert_utf16_to_utf8() with a UTF-32 output.
+ *
+ * \param[in] in  The UTF-16 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of characters available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf16_to_utf32(std::u16string_view in, char32_t * out, std::size_t out_cap) noexcept
+{
+    return transcode<char16_t, char32_t>(in, out, out_cap);
+}
+
+
+/** \brief Convert UTF-32 to UTF-8 without exceptions.
+ *
+ * This function works like convert_utf8_to_utf16() with a UTF-32 input.
+ * The surrogates and the values over 0x10FFFF are invalid.
+ * utf8_length_from_utf32() gives the size required for valid input.
+ *
+ * \param[in] in  The UTF-32 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of bytes available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf32_to_utf8(std::u32string_view in, char * out, std::size_t out_cap) noexcept
+{
+    return transcode<char32_t, char>(in, out, out_cap);
+}
+
+
+/** \brief Convert UTF-32 to UTF-16 without exceptions.
+ *
+ * This function works like convert_utf32_to_utf8() with a UTF-16 output.
+ *
+ * \param[in] in  The UTF-32 string to convert.
+ * \param[out] out  The output buffer.
+ * \param[in] out_cap  The number of code units available in \p out.
+ *
+ * \return The status and counters of the conversion.
+ */
+transcode_result_t convert_utf32_to_utf16(std::u32string_view in, char16_t * out, std::size_t out_cap) noexcept
+{
+    return transcode<char32_t, char16_t>(in, out, out_cap);
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,87 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the exception free conversion functions.
+ *
+ * The to_u8string(), to_u16string(), and to_u32string() functions throw
+ * an exception when the input is not valid. The functions declared here
+ * do the same conversions in a buffer supplied by the caller and return
+ * a status instead, so invalid input can be handled without a try/catch.
+ *
+ * All the conversions go through the transcode() template. It selects
+ * the SIMD kernel of the pair of encodings at compile time and, with
+ * the throwing policy, is also what the to_u8string(), to_u16string(),
+ * and to_u32string() functions use.
+ */
+
+// C++
+//
+#include    <cstddef>
+#include    <string_view>
+
+
+
+namespace libutf8
+{
+
+
+
+enum class transcode_status_t
+{
+    TRANSCODE_STATUS_SUCCESS,           // the whole input was converted
+    TRANSCODE_STATUS_INVALID,           // invalid sequence or code point
+    TRANSCODE_STATUS_TRUNCATED,         // input ends in the middle of a character
+    TRANSCODE_STATUS_OUTPUT_TOO_SMALL   // the next character does not fit in the output
+};
+
+
+enum class error_policy_t
+{
+    ERROR_POLICY_STATUS,                // return the status in the transcode_result_t
+    ERROR_POLICY_THROW                  // raise a libutf8 exception
+};
+
+
+struct transcode_result_t
+{
+    bool                ok() const { return f_status == transcode_status_t::TRANSCODE_STATUS_SUCCESS; }
+
+    transcode_status_t  f_status = transcode_status_t::TRANSCODE_STATUS_SUCCESS;
+    std::size_t         f_error_position = 0;   // offset of the character that stopped the conversion
+    std::size_t         f_read = 0;             // input code units converted
+    std::size_t         f_written = 0;          // output code units written
+};
+
+
+template<typename InputT, typename OutputT, error_policy_t policy = error_policy_t::ERROR_POLICY_STATUS>
+transcode_result_t  transcode(std::basic_string_view<InputT> in, OutputT * out, std::size_t out_cap, char const * function = "transcode") noexcept(policy == error_policy_t::ERROR_POLICY_STATUS);
+
+transcode_result_t  convert_utf8_to_utf16(std::string_view in, char16_t * out, std::size_t out_cap) noexcept;
+transcode_result_t  convert_utf8_to_utf32(std::string_view in, char32_t * out, std::size_t out_cap) noexcept;
+transcode_result_t  convert_utf16_to_utf8(std::u16string_view in, char * out, std::size_t out_cap) noexcept;
+transcode_result_t  convert_utf16_to_utf32(std::u16string_view in, char32_t * out, std::size_t out_cap) noexcept;
+transcode_result_t  convert_utf32_to_utf8(std::u32string_view in, char * out, std::size_t out_cap) noexcept;
+transcode_result_t  convert_utf32_to_utf16(std::u32string_view in, char16_t * out, std::size_t out_cap) noexcept;
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
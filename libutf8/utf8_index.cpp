@@ -0,0 +1,507 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Implementation of the UTF-8 index.
+ *
+ * The index is a list of checkpoints. Each checkpoint gives the byte
+ * offset, the character index, and the UTF-16 offset of one character.
+ * When built, there is one checkpoint every `step` characters, so the
+ * checkpoint of a character index is found with a division. After an
+ * update(), the checkpoints following the edit are shifted and the
+ * checkpoint is found with a binary search instead.
+ *
+ * In all cases, two consecutive checkpoints are never more than `step`
+ * characters apart, so a lookup never scans more than `step` characters
+ * with the SIMD kernels.
+ */
+
+// self
+//
+#include    "libutf8/utf8_index.h"
+
+#include    "libutf8/exception.h"
+#include    "libutf8/parallel_chunks.h"
+#include    "libutf8/simd_kernels.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace libutf8
+{
+
+
+
+/** \brief Build the index of a UTF-8 string.
+ *
+ * This constructor saves a checkpoint every \p step characters of \p str.
+ * The string is split in chunks as with the parallel functions (see
+ * \p options) and each chunk is indexed in its own thread: the first
+ * pass counts the characters and UTF-16 code units of each chunk, a
+ * prefix sum gives the position of the start of each chunk, and the
+ * second pass saves the checkpoints of each chunk.
+ *
+ * The index keeps a view of \p str, not a copy, so the string must
+ * remain valid and unchanged as long as the index is in use. After
+ * modifying the string, call update().
+ *
+ * The string is expected to be valid UTF-8. Otherwise, the characters
+ * are counted as u8length_unchecked() does.
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The \p step parameter must be at least 1.
+ *
+ * \param[in] str  The string to index.
+ * \param[in] step  The number of characters between two checkpoints.
+ * \param[in] options  The threading options.
+ */
+utf8_index::utf8_index(std::string_view str, std::size_t step, parallel_options_t const & options)
+    : f_str(str)
+    , f_step(step)
+{
+    if(f_step == 0)
+    {
+        throw libutf8_exception_invalid_parameter(
+              "utf8_index(): the step must be at least 1.");
+    }
+
+    f_checkpoints.push_back(checkpoint_t());
+
+    std::vector<detail::chunk_t> const chunks(detail::split_chunks(f_str, options));
+    if(chunks.size() == 1)
+    {
+        f_end = scan(checkpoint_t(), f_step, f_str.length(), f_checkpoints);
+        return;
+    }
+
+    detail::kernels_t const & k(detail::kernels());
+    checkpoint_vector_t starts(chunks.size() + 1);
+    detail::run_chunks(chunks.size(), options, [this, &chunks, &starts, &k](std::size_t index)
+        {
+            detail::chunk_t const & c(chunks[index]);
+            checkpoint_t & count(starts[index + 1]);
+            count.f_byte = c.f_end - c.f_start;
+            count.f_code_point = k.f_u8length_unchecked(f_str.data() + c.f_start, c.f_end - c.f_start);
+            count.f_utf16 = k.f_utf16_length_from_utf8(f_str.data() + c.f_start, c.f_end - c.f_start);
+        });
+    for(std::size_t idx(1); idx < starts.size(); ++idx)
+    {
+        starts[idx].f_byte += starts[idx - 1].f_byte;
+        starts[idx].f_code_point += starts[idx - 1].f_code_point;
+        starts[idx].f_utf16 += starts[idx - 1].f_utf16;
+    }
+
+    std::vector<checkpoint_vector_t> parts(chunks.size());
+    detail::run_chunks(chunks.size(), options, [this, &chunks, &starts, &parts](std::size_t index)
+        {
+            checkpoint_t const & start(starts[index]);
+            std::size_t const next(std::max(f_step, (start.f_code_point + f_step - 1) / f_step * f_step));
+            scan(start, next, chunks[index].f_end, parts[index]);
+        });
+    for(auto const & p : parts)
+    {
+        f_checkpoints.insert(f_checkpoints.end(), p.begin(), p.end());
+    }
+    f_end = starts.back();
+}
+
+
+/** \brief Retrieve the indexed string.
+ *
+ * \return The view of the string passed to the constructor or the last
+ * update().
+ */
+std::string_view utf8_index::str() const
+{
+    return f_str;
+}
+
+
+/** \brief Retrieve the number of characters between two checkpoints.
+ *
+ * \return The step passed to the constructor.
+ */
+std::size_t utf8_index::step() const
+{
+    return f_step;
+}
+
+
+/** \brief Retrieve the number of characters in the string.
+ *
+ * \return The same value as u8length_unchecked() of the string.
+ */
+std::size_t utf8_index::size() const
+{
+    return f_end.f_code_point;
+}
+
+
+/** \brief Retrieve the number of UTF-16 code units of the string.
+ *
+ * \return The same value as utf16_length_from_utf8() of the string.
+ */
+std::size_t utf8_index::utf16_size() const
+{
+    return f_end.f_utf16;
+}
+
+
+/** \brief Retrieve the checkpoints.
+ *
+ * The first checkpoint is always the start of the string. The other
+ * checkpoints are sorted and never more than step() characters apart.
+ *
+ * \return A reference to the checkpoints.
+ */
+utf8_index::checkpoint_vector_t const & utf8_index::checkpoints() const
+{
+    return f_checkpoints;
+}
+
+
+/** \brief Convert a character index to a byte offset.
+ *
+ * This function is the same as byte_offset_of() with at most step()
+ * characters to skip after the nearest checkpoint.
+ *
+ * \param[in] cp_index  The index of a character.
+ *
+ * \return The offset of the character in bytes or the length of the
+ * string if \p cp_index is size() or more.
+ */
+std::size_t utf8_index::byte_offset(std::size_t cp_index) const
+{
+    if(cp_index >= f_end.f_code_point)
+    {
+        return f_end.f_byte;
+    }
+
+    checkpoint_t const & c(find_code_point(cp_index));
+    return c.f_byte + detail::kernels().f_utf8_offset_of(
+                  f_str.data() + c.f_byte
+                , f_end.f_byte - c.f_byte
+                , cp_index - c.f_code_point);
+}
+
+
+/** \brief Convert a character index to a UTF-16 offset.
+ *
+ * This function returns the position the character would have once the
+ * string is converted to UTF-16. This is the position used by protocols
+ * which count characters in UTF-16 code units (i.e. JavaScript editors
+ * and the Language Server Protocol).
+ *
+ * \param[in] cp_index  The index of a character.
+ *
+ * \return The offset of the character in UTF-16 code units or
+ * utf16_size() if \p cp_index is size() or more.
+ */
+std::size_t utf8_index::utf16_offset(std::size_t cp_index) const
+{
+    if(cp_index >= f_end.f_code_point)
+    {
+        return f_end.f_utf16;
+    }
+
+    detail::kernels_t const & k(detail::kernels());
+    checkpoint_t const & c(find_code_point(cp_index));
+    char const * const start(f_str.data() + c.f_byte);
+    std::size_t const offset(k.f_utf8_offset_of(start, f_end.f_byte - c.f_byte, cp_index - c.f_code_point));
+    return c.f_utf16 + k.f_utf16_length_from_utf8(start, offset);
+}
+
+
+/** \brief Convert a byte offset to a character index.
+ *
+ * This function counts the characters which start before \p byte_offset.
+ * When \p byte_offset is in the middle of a character, the function
+ * returns the index of the next character.
+ *
+ * \param[in] byte_offset  The offset of a character in bytes.
+ *
+ * \return The index of the character or size() if \p byte_offset is the
+ * length of the string or more.
+ */
+std::size_t utf8_index::code_point_index(std::size_t byte_offset) const
+{
+    if(byte_offset >= f_end.f_byte)
+    {
+        return f_end.f_code_point;
+    }
+
+    checkpoint_t const & c(*std::prev(std::upper_bound(
+              f_checkpoints.begin()
+            , f_checkpoints.end()
+            , byte_offset
+            , [](std::size_t byte, checkpoint_t const & rhs)
+                {
+                    return byte < rhs.f_byte;
+                })));
+    return c.f_code_point + detail::kernels().f_u8length_unchecked(
+                  f_str.data() + c.f_byte
+                , byte_offset - c.f_byte);
+}
+
+
+/** \brief Convert a UTF-16 offset to a character index.
+ *
+ * This function returns the index of the character which includes the
+ * UTF-16 code unit at \p utf16_offset. When that unit is the second
+ * unit of a surrogate pair, the function returns the index of the
+ * character represented by the pair.
+ *
+ * To get the byte offset of a UTF-16 offset, call byte_offset() with the
+ * result of this function.
+ *
+ * \param[in] utf16_offset  The offset of a character in UTF-16 code units.
+ *
+ * \return The index of the character or size() if \p utf16_offset is
+ * utf16_size() or more.
+ */
+std::size_t utf8_index::code_point_from_utf16(std::size_t utf16_offset) const
+{
+    if(utf16_offset >= f_end.f_utf16)
+    {
+        return f_end.f_code_point;
+    }
+
+    checkpoint_t const & c(*std::prev(std::upper_bound(
+              f_checkpoints.begin()
+            , f_checkpoints.end()
+            , utf16_offset
+            , [](std::size_t utf16, checkpoint_t const & rhs)
+                {
+                    return utf16 < rhs.f_utf16;
+                })));
+
+    // the characters over the Basic Plane use two UTF-16 code units,
+    // their UTF-8 lead byte is 0xF0 or more
+    //
+    std::size_t cp_index(c.f_code_point);
+    std::size_t utf16(c.f_utf16);
+    for(std::size_t pos(c.f_byte); pos < f_end.f_byte; ++pos)
+    {
+        unsigned char const b(static_cast<unsigned char>(f_str[pos]));
+        if((b & 0xC0) == 0x80)
+        {
+            continue;
+        }
+        utf16 += b >= 0xF0 ? 2 : 1;
+        if(utf16 > utf16_offset)
+        {
+            break;
+        }
+        ++cp_index;
+    }
+
+    return cp_index;
+}
+
+
+/** \brief Update the index after the string was modified.
+ *
+ * This function updates the index after \p removed bytes at \p pos were
+ * replaced with \p inserted bytes. The new string is \p str. It has to
+ * be the same as the previous string except for that one edit.
+ *
+ * The checkpoints before \p pos are kept as is. The checkpoints after the
+ * removed bytes are shifted by the number of bytes, characters, and UTF-16
+ * code units added or removed. Only the bytes between the checkpoint
+ * preceding \p pos and the checkpoint following the edit are scanned, so
+ * the cost of the update depends on the size of the edit, not the size
+ * of the string.
+ *
+ * The checkpoints following the edit are not at a multiple of step()
+ * anymore, so the lookups use a binary search instead of a division.
+ * The checkpoints are still never more than step() characters apart.
+ *
+ * \exception libutf8_exception_invalid_parameter
+ * The edit has to be within the previous string and the length of \p str
+ * has to be the previous length minus \p removed plus \p inserted.
+ *
+ * \param[in] str  The modified string.
+ * \param[in] pos  The offset of the edit in bytes.
+ * \param[in] removed  The number of bytes removed at \p pos.
+ * \param[in] inserted  The number of bytes inserted at \p pos.
+ */
+void utf8_index::update(std::string_view str, std::size_t pos, std::size_t removed, std::size_t inserted)
+{
+    if(pos > f_end.f_byte
+    || removed > f_end.f_byte - pos
+    || str.length() != f_end.f_byte - removed + inserted)
+    {
+        throw libutf8_exception_invalid_parameter(
+              "utf8_index::update(): the edit does not match the length of the indexed string.");
+    }
+
+    // the last checkpoint before the edit is still valid and the
+    // checkpoints after the removed bytes only need to be shifted; the
+    // first checkpoint is always kept
+    //
+    auto const after(std::lower_bound(
+              f_checkpoints.begin() + 1
+            , f_checkpoints.end()
+            , pos
+            , [](checkpoint_t const & lhs, std::size_t byte)
+                {
+                    return lhs.f_byte < byte;
+                }));
+    std::size_t const start_idx(std::prev(after) - f_checkpoints.begin());
+    std::size_t const end_idx(std::lower_bound(
+              after
+            , f_checkpoints.end()
+            , pos + removed
+            , [](checkpoint_t const & lhs, std::size_t byte)
+                {
+                    return lhs.f_byte < byte;
+                }) - f_checkpoints.begin());
+
+    // shift the checkpoints after the edit by the number of bytes
+    //
+    checkpoint_vector_t tail(f_checkpoints.begin() + end_idx, f_checkpoints.end());
+    checkpoint_t const old_end(f_end);
+    for(auto & c : tail)
+    {
+        c.f_byte = c.f_byte - removed + inserted;
+    }
+    f_end.f_byte = str.length();
+
+    // scan the new bytes up to the first checkpoint after the edit
+    //
+    f_str = str;
+    checkpoint_t const start(f_checkpoints[start_idx]);
+    f_checkpoints.resize(start_idx + 1);
+    checkpoint_t const edit_end(scan(
+              start
+            , start.f_code_point + f_step
+            , tail.empty() ? f_end.f_byte : tail.front().f_byte
+            , f_checkpoints));
+
+    // the characters and UTF-16 code units after the edit are shifted
+    // by the difference found by the scan
+    //
+    checkpoint_t const old_edit_end(tail.empty() ? old_end : tail.front());
+    for(auto & c : tail)
+    {
+        c.f_code_point = c.f_code_point - old_edit_end.f_code_point + edit_end.f_code_point;
+        c.f_utf16 = c.f_utf16 - old_edit_end.f_utf16 + edit_end.f_utf16;
+    }
+    f_end.f_code_point = f_end.f_code_point - old_edit_end.f_code_point + edit_end.f_code_point;
+    f_end.f_utf16 = f_end.f_utf16 - old_edit_end.f_utf16 + edit_end.f_utf16;
+
+    // remove the first checkpoint after the edit if its neighbors are
+    // close enough, this way small edits do not accumulate checkpoints
+    //
+    if(!tail.empty())
+    {
+        std::size_t const next_code_point(tail.size() > 1
+                    ? tail[1].f_code_point
+                    : f_end.f_code_point);
+        if(next_code_point - f_checkpoints.back().f_code_point <= f_step)
+        {
+            tail.erase(tail.begin());
+        }
+    }
+    f_checkpoints.insert(f_checkpoints.end(), tail.begin(), tail.end());
+}
+
+
+/** \brief Find the checkpoint of a character.
+ *
+ * This function returns the last checkpoint at or before \p cp_index.
+ * Until the first update(), the checkpoint is found with a division.
+ * Otherwise, the function falls back to a binary search.
+ *
+ * \param[in] cp_index  The index of a character, less than size().
+ *
+ * \return The checkpoint to scan from.
+ */
+utf8_index::checkpoint_t const & utf8_index::find_code_point(std::size_t cp_index) const
+{
+    std::size_t const idx(cp_index / f_step);
+    if(idx < f_checkpoints.size()
+    && f_checkpoints[idx].f_code_point <= cp_index
+    && (idx + 1 == f_checkpoints.size() || f_checkpoints[idx + 1].f_code_point > cp_index))
+    {
+        return f_checkpoints[idx];
+    }
+
+    return *std::prev(std::upper_bound(
+              f_checkpoints.begin()
+            , f_checkpoints.end()
+            , cp_index
+            , [](std::size_t code_point, checkpoint_t const & rhs)
+                {
+                    return code_point < rhs.f_code_point;
+                }));
+}
+
+
+/** \brief Add the checkpoints of part of the string.
+ *
+ * This function scans the string from \p start to the byte offset
+ * \p end and adds a checkpoint to \p checkpoints at the character index
+ * \p next, `next + step`, `next + 2 * step`, etc. The search of the
+ * next checkpoint is done with the SIMD kernels.
+ *
+ * \param[in] start  The position where the scan starts.
+ * \param[in] next  The index of the character of the first checkpoint.
+ * \param[in] end  The offset in bytes where the scan ends.
+ * \param[in,out] checkpoints  The vector receiving the new checkpoints.
+ *
+ * \return The position at \p end.
+ */
+utf8_index::checkpoint_t utf8_index::scan(checkpoint_t start, std::size_t next, std::size_t end, checkpoint_vector_t & checkpoints) const
+{
+    detail::kernels_t const & k(detail::kernels());
+    checkpoint_t c(start);
+    for(;;)
+    {
+        std::size_t const offset(k.f_utf8_offset_of(f_str.data() + c.f_byte, end - c.f_byte, next - c.f_code_point));
+        if(c.f_byte + offset >= end)
+        {
+            break;
+        }
+        c.f_utf16 += k.f_utf16_length_from_utf8(f_str.data() + c.f_byte, offset);
+        c.f_byte += offset;
+        c.f_code_point = next;
+        checkpoints.push_back(c);
+        next += f_step;
+    }
+
+    c.f_code_point += k.f_u8length_unchecked(f_str.data() + c.f_byte, end - c.f_byte);
+    c.f_utf16 += k.f_utf16_length_from_utf8(f_str.data() + c.f_byte, end - c.f_byte);
+    c.f_byte = end;
+    return c;
+}
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
@@ -0,0 +1,93 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+#pragma once
+
+/** \file
+ * \brief The declarations of the UTF-8 index.
+ *
+ * The utf8_index class saves the byte offset and UTF-16 offset of one
+ * character every N characters of a large UTF-8 string. Converting a
+ * character index to a byte offset or a UTF-16 offset (and back) then
+ * only requires scanning the few characters following the nearest
+ * checkpoint instead of the whole string.
+ */
+
+// self
+//
+#include    <libutf8/parallel.h>
+
+
+// C++
+//
+#include    <string_view>
+#include    <vector>
+
+
+
+namespace libutf8
+{
+
+
+
+constexpr std::size_t       UTF8_INDEX_DEFAULT_STEP = 1024;
+
+
+class utf8_index
+{
+public:
+    struct checkpoint_t
+    {
+        std::size_t             f_byte = 0;         // offset of the character in bytes
+        std::size_t             f_code_point = 0;   // index of the character
+        std::size_t             f_utf16 = 0;        // offset of the character in UTF-16 code units
+    };
+    typedef std::vector<checkpoint_t>   checkpoint_vector_t;
+
+                                utf8_index(
+                                      std::string_view str = std::string_view()
+                                    , std::size_t step = UTF8_INDEX_DEFAULT_STEP
+                                    , parallel_options_t const & options = parallel_options_t());
+
+    std::string_view            str() const;
+    std::size_t                 step() const;
+    std::size_t                 size() const;
+    std::size_t                 utf16_size() const;
+    checkpoint_vector_t const & checkpoints() const;
+
+    std::size_t                 byte_offset(std::size_t cp_index) const;
+    std::size_t                 utf16_offset(std::size_t cp_index) const;
+    std::size_t                 code_point_index(std::size_t byte_offset) const;
+    std::size_t                 code_point_from_utf16(std::size_t utf16_offset) const;
+
+    void                        update(std::string_view str, std::size_t pos, std::size_t removed, std::size_t inserted);
+
+private:
+    checkpoint_t const &        find_code_point(std::size_t cp_index) const;
+    checkpoint_t                scan(checkpoint_t start, std::size_t next, std::size_t end, checkpoint_vector_t & checkpoints) const;
+
+    std::string_view            f_str = std::string_view();
+    std::size_t                 f_step = UTF8_INDEX_DEFAULT_STEP;
+    checkpoint_vector_t         f_checkpoints = checkpoint_vector_t();
+    checkpoint_t                f_end = checkpoint_t();
+};
+
+
+
+} // libutf8 namespace
+// vim: ts=4 sw=4 et
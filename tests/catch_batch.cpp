@@ -0,0 +1,330 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/batch.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <memory>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+// a mix of short and long strings, some of which are invalid
+//
+std::vector<std::string> random_strings(std::size_t count, bool with_errors)
+{
+    std::vector<std::string> result;
+    for(std::size_t idx(0); idx < count; ++idx)
+    {
+        std::size_t const length(rand() % 10 == 0 ? rand() % 400 : rand() % 20);
+        std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+        if(with_errors && !str.empty() && rand() % 5 == 0)
+        {
+            switch(rand() % 3)
+            {
+            case 0:
+                // invalid byte anywhere
+                //
+                str[rand() % str.length()] = '\xFF';
+                break;
+
+            case 1:
+                // character cut at the end
+                //
+                str += "\xF0\x9F\x98";
+                break;
+
+            case 2:
+                // starts with continuation bytes
+                //
+                str = "\x98\x80" + str;
+                break;
+
+            }
+        }
+        result.push_back(str);
+    }
+    return result;
+}
+
+
+std::vector<std::string_view> to_views(std::vector<std::string> const & strs)
+{
+    return std::vector<std::string_view>(strs.begin(), strs.end());
+}
+
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("batch_validate", "[batch][valid][invalid][u8]")
+{
+    CATCH_START_SECTION("batch_validate: same result as is_valid_utf8()")
+    {
+        for(int count(0); count < 50; ++count)
+        {
+            std::vector<std::string> const strs(random_strings(rand() % 1000, count % 2 == 1));
+            std::vector<std::string_view> const views(to_views(strs));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&views](libutf8::simd_t)
+                {
+                    std::unique_ptr<bool[]> valid(new bool[views.size()]);
+                    std::size_t const result(libutf8::validate_utf8_batch(views.data(), views.size(), valid.get()));
+
+                    std::size_t expected(0);
+                    for(std::size_t idx(0); idx < views.size(); ++idx)
+                    {
+                        bool const v(libutf8::is_valid_utf8(views[idx]));
+                        CATCH_REQUIRE(valid[idx] == v);
+                        expected += v;
+                    }
+                    CATCH_REQUIRE(result == expected);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("batch_validate: characters split between strings")
+    {
+        // valid once concatenated, but not one by one
+        //
+        std::string_view const views[] = { "abc\xE2", "\x82\xAC", "def", "\xE2\x82", "\xAC" };
+        bool valid[5];
+        CATCH_REQUIRE(libutf8::validate_utf8_batch(views, 5, valid) == 1);
+        CATCH_REQUIRE_FALSE(valid[0]);
+        CATCH_REQUIRE_FALSE(valid[1]);
+        CATCH_REQUIRE(valid[2]);
+        CATCH_REQUIRE_FALSE(valid[3]);
+        CATCH_REQUIRE_FALSE(valid[4]);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("batch_validate: empty strings")
+    {
+        // a default view has a null data() pointer
+        //
+        std::string_view const views[] = { std::string_view(), "abc", "", std::string_view(), "\xFF" };
+        bool valid[5];
+        CATCH_REQUIRE(libutf8::validate_utf8_batch(views, 5, valid) == 4);
+        CATCH_REQUIRE(valid[0]);
+        CATCH_REQUIRE(valid[1]);
+        CATCH_REQUIRE(valid[2]);
+        CATCH_REQUIRE(valid[3]);
+        CATCH_REQUIRE_FALSE(valid[4]);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("batch_convert", "[batch][valid][invalid][u8][u16][u32]")
+{
+    CATCH_START_SECTION("batch_convert: same result as the single string conversions")
+    {
+        for(int count(0); count < 50; ++count)
+        {
+            std::vector<std::string> const strs(random_strings(rand() % 1000, count % 2 == 1));
+            std::vector<std::string_view> const views(to_views(strs));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&views](libutf8::simd_t)
+                {
+                    std::vector<libutf8::batch_entry_t> entries(views.size());
+
+                    std::vector<char16_t> arena16(libutf8::utf16_length_from_utf8_batch(views.data(), views.size()));
+                    std::size_t const written16(libutf8::convert_utf8_to_utf16_batch(views.data(), views.size(), arena16.data(), arena16.size(), entries.data()));
+                    std::size_t offset(0);
+                    for(std::size_t idx(0); idx < views.size(); ++idx)
+                    {
+                        std::vector<char16_t> buf(views[idx].length());
+                        libutf8::transcode_result_t const r(libutf8::convert_utf8_to_utf16(views[idx], buf.data(), buf.size()));
+                        CATCH_REQUIRE(entries[idx].f_status == r.f_status);
+                        CATCH_REQUIRE(entries[idx].f_error_position == r.f_error_position);
+                        CATCH_REQUIRE(entries[idx].f_offset == offset);
+                        if(r.ok())
+                        {
+                            CATCH_REQUIRE(entries[idx].f_length == r.f_written);
+                            CATCH_REQUIRE(std::u16string_view(arena16.data() + offset, entries[idx].f_length) == std::u16string_view(buf.data(), r.f_written));
+                            offset += r.f_written;
+                        }
+                        else
+                        {
+                            CATCH_REQUIRE(entries[idx].f_length == 0);
+                        }
+                    }
+                    CATCH_REQUIRE(written16 == offset);
+
+                    std::vector<char32_t> arena32(libutf8::utf32_length_from_utf8_batch(views.data(), views.size()));
+                    std::size_t const written32(libutf8::convert_utf8_to_utf32_batch(views.data(), views.size(), arena32.data(), arena32.size(), entries.data()));
+                    offset = 0;
+                    for(std::size_t idx(0); idx < views.size(); ++idx)
+                    {
+                        std::vector<char32_t> buf(views[idx].length());
+                        libutf8::transcode_result_t const r(libutf8::convert_utf8_to_utf32(views[idx], buf.data(), buf.size()));
+                        CATCH_REQUIRE(entries[idx].f_status == r.f_status);
+                        CATCH_REQUIRE(entries[idx].f_offset == offset);
+                        if(r.ok())
+                        {
+                            CATCH_REQUIRE(std::u32string_view(arena32.data() + offset, entries[idx].f_length) == std::u32string_view(buf.data(), r.f_written));
+                            offset += r.f_written;
+                        }
+                    }
+                    CATCH_REQUIRE(written32 == offset);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("batch_convert: empty strings and surrogate pairs")
+    {
+        std::string_view const views[] = { std::string_view(), "\xF0\x9F\x98\x80!", "", "\xC3\xA9", std::string_view() };
+        libutf8::batch_entry_t entries[5];
+        char16_t arena[8];
+
+        CATCH_REQUIRE(libutf8::utf16_length_from_utf8_batch(views, 5) == 4);
+        CATCH_REQUIRE(libutf8::convert_utf8_to_utf16_batch(views, 5, arena, 8, entries) == 4);
+        CATCH_REQUIRE(std::u16string_view(arena, 4) == u"\U0001F600!\u00E9");
+
+        std::size_t const offsets[] = { 0, 0, 3, 3, 4 };
+        std::size_t const lengths[] = { 0, 3, 0, 1, 0 };
+        for(std::size_t idx(0); idx < 5; ++idx)
+        {
+            CATCH_REQUIRE(entries[idx].ok());
+            CATCH_REQUIRE(entries[idx].f_offset == offsets[idx]);
+            CATCH_REQUIRE(entries[idx].f_length == lengths[idx]);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("batch_convert: arena too small")
+    {
+        std::string_view const views[] = { "abc", "\xC3\xA9t\xC3\xA9", "\xFF", "xyz", "12" };
+        libutf8::batch_entry_t entries[5];
+        char32_t arena[8];
+
+        CATCH_REQUIRE(libutf8::convert_utf8_to_utf32_batch(views, 5, arena, 8, entries) == 6);
+        CATCH_REQUIRE(std::u32string_view(arena, 6) == U"abcété");
+
+        CATCH_REQUIRE(entries[0].ok());
+        CATCH_REQUIRE(entries[1].ok());
+        CATCH_REQUIRE(entries[1].f_offset == 3);
+        CATCH_REQUIRE(entries[1].f_length == 3);
+        CATCH_REQUIRE(entries[2].f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+        CATCH_REQUIRE(entries[2].f_error_position == 0);
+        CATCH_REQUIRE(entries[3].f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+        CATCH_REQUIRE(entries[3].f_offset == 6);
+        CATCH_REQUIRE(entries[4].f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+        CATCH_REQUIRE(entries[4].f_length == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("batch_u8casecmp", "[batch][compare][u8]")
+{
+    CATCH_START_SECTION("batch_u8casecmp: same result as u8casecmp()")
+    {
+        std::vector<std::string> lhs;
+        std::vector<std::string> rhs;
+        for(int count(0); count < 1000; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 20, rand() % 101));
+            lhs.push_back(str);
+            switch(rand() % 4)
+            {
+            case 0:
+                rhs.push_back(str);
+                break;
+
+            case 1:
+                {
+                    // same string with a different case
+                    //
+                    std::string upper(str);
+                    for(auto & c : upper)
+                    {
+                        if(c >= 'a' && c <= 'z')
+                        {
+                            c -= 'a' - 'A';
+                        }
+                    }
+                    rhs.push_back(upper);
+                }
+                break;
+
+            case 2:
+                rhs.push_back(str + SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 5, 50));
+                break;
+
+            case 3:
+                rhs.push_back(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 20, rand() % 101));
+                break;
+
+            }
+        }
+        std::vector<std::string_view> const lviews(to_views(lhs));
+        std::vector<std::string_view> const rviews(to_views(rhs));
+
+        std::vector<int> results(lhs.size());
+        libutf8::u8casecmp_batch(lviews.data(), rviews.data(), lviews.size(), results.data());
+        for(std::size_t idx(0); idx < lhs.size(); ++idx)
+        {
+            CATCH_REQUIRE(results[idx] == libutf8::u8casecmp(lhs[idx], rhs[idx]));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("batch_u8casecmp: invalid strings")
+    {
+        std::string_view const lhs[] = { "Hello", "abc\xFF" };
+        std::string_view const rhs[] = { "hELLO", "abcd" };
+        int results[2] = { 9, 9 };
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::u8casecmp_batch(lhs, rhs, 2, results)
+                , libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE(results[0] == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
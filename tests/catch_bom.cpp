@@ -20,6 +20,7 @@
 // libutf8
 //
 #include    <libutf8/base.h>
+#include    <libutf8/exception.h>
 #include    <libutf8/libutf8.h>
 
 
@@ -188,4 +189,168 @@ CATCH_TEST_CASE("bom", "[characters],[bom]")
 }
 
 
+namespace
+{
+
+
+template<typename CharT>
+std::string to_bytes(std::basic_string<CharT> const & str, bool big_endian)
+{
+    std::string result;
+    for(CharT const c : str)
+    {
+        for(std::size_t idx(0); idx < sizeof(CharT); ++idx)
+        {
+            std::size_t const shift(big_endian ? (sizeof(CharT) - 1 - idx) * 8 : idx * 8);
+            result += static_cast<char>(static_cast<char32_t>(c) >> shift);
+        }
+    }
+    return result;
+}
+
+
+
+}
+
+
+
+CATCH_TEST_CASE("decode_bytes", "[bom][u8][u16][u32]")
+{
+    CATCH_START_SECTION("decode_bytes: all encodings with and without BOM")
+    {
+        for(int count(0); count < 50; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 3000, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            struct encoding_t
+            {
+                libutf8::bom_t  f_bom = libutf8::bom_t::BOM_NONE;
+                std::string     f_bytes = std::string();
+            };
+            encoding_t const encodings[] =
+            {
+                { libutf8::bom_t::BOM_UTF8,     str },
+                { libutf8::bom_t::BOM_UTF16_LE, to_bytes(str16, false) },
+                { libutf8::bom_t::BOM_UTF16_BE, to_bytes(str16, true) },
+                { libutf8::bom_t::BOM_UTF32_LE, to_bytes(str32, false) },
+                { libutf8::bom_t::BOM_UTF32_BE, to_bytes(str32, true) },
+            };
+            std::u16string const bom16(1, static_cast<char16_t>(libutf8::BOM_CHAR));
+            std::u32string const bom32(1, libutf8::BOM_CHAR);
+            std::string const boms[] =
+            {
+                "\xEF\xBB\xBF",
+                to_bytes(bom16, false),
+                to_bytes(bom16, true),
+                to_bytes(bom32, false),
+                to_bytes(bom32, true),
+            };
+            for(std::size_t idx(0); idx < std::size(encodings); ++idx)
+            {
+                encoding_t const & e(encodings[idx]);
+
+                // add one byte in front so the code units are not aligned
+                //
+                std::string const with_bom(" " + boms[idx] + e.f_bytes);
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE(libutf8::decode_bytes(with_bom.data() + 1, with_bom.length() - 1) == str);
+                        CATCH_REQUIRE(libutf8::decode_bytes(with_bom.data() + 1, with_bom.length() - 1, e.f_bom) == str);
+                        CATCH_REQUIRE(libutf8::decode_bytes(e.f_bytes.data(), e.f_bytes.length(), e.f_bom) == str);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decode_bytes: no BOM is UTF-8")
+    {
+        CATCH_REQUIRE(libutf8::decode_bytes(nullptr, 0).empty());
+        CATCH_REQUIRE(libutf8::decode_bytes("plain", 5) == "plain");
+        CATCH_REQUIRE(libutf8::decode_bytes("\xEF\xBB\xBF", 3).empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decode_bytes: surrogate pairs at the end of a block")
+    {
+        for(std::size_t length(1000); length < 1050; ++length)
+        {
+            std::u16string str16(length, u'a');
+            str16 += u"\xD83D\xDE03 end";
+            std::string const bytes(to_bytes(str16, true));
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::decode_bytes(bytes.data(), bytes.length(), libutf8::bom_t::BOM_UTF16_BE) == libutf8::to_u8string(str16));
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decode_bytes: invalid input")
+    {
+        std::string const utf16(to_bytes(std::u16string(u"ab\xDC00" "cd"), false));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes(utf16.data(), utf16.length(), libutf8::bom_t::BOM_UTF16_LE)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-16 character at byte 4."));
+
+        std::string const truncated(to_bytes(std::u16string(u"ab\xD800"), true));
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::decode_bytes(truncated.data(), truncated.length(), libutf8::bom_t::BOM_UTF16_BE)
+                , libutf8::libutf8_exception_decoding);
+
+        std::string const utf32(to_bytes(std::u32string(U"abc\x110000"), true));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes(utf32.data(), utf32.length(), libutf8::bom_t::BOM_UTF32_BE)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-32 character at byte 12."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes(utf32.data(), utf32.length() - 1, libutf8::bom_t::BOM_UTF32_BE)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input size (15) is not a multiple of 4."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes("ok\xFF", 3)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-8 character at byte 2."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decode_bytes: the errors count the bytes of the BOM")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes("\xFF\xFE" "A\0" "\0\xD8" "B\0", 8)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-16 character at byte 4."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes("\0\0\xFE\xFF" "\0\0\0a" "\0\x11\0\0", 12)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-32 character at byte 8."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes("\xEF\xBB\xBF" "a\xFF", 5)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input includes an invalid UTF-8 character at byte 4."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::decode_bytes("\xFF\xFE" "A", 3)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: decode_bytes(): the input size (3) is not a multiple of 2."));
+    }
+    CATCH_END_SECTION()
+}
+
+
 // vim: ts=4 sw=4 et
@@ -563,6 +563,104 @@ CATCH_TEST_CASE("invalid_utf8_to_utf32", "[characters],[invalid]")
         }
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("invalid_utf8_to_utf32: Verify that overlong and too large sequences are skipped as a whole")
+    {
+        char const * invalid_sequences[] =
+        {
+            "\xC0\x80",
+            "\xC1\xBF",
+            "\xE0\x80\x80",
+            "\xE0\x9F\xBF",
+            "\xF0\x80\x80\x80",
+            "\xF0\x8F\xBF\xBF",
+            "\xF4\x90\x80\x80",
+            "\xF4\xBF\xBF\xBF",
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            std::string const str(std::string(seq) + "z");
+            char32_t back(rand());
+            char const * s(str.c_str());
+            size_t len(str.length());
+            CATCH_REQUIRE(libutf8::mbstowc(back, s, len) == -1);
+            CATCH_REQUIRE(back == libutf8::NOT_A_CHARACTER);
+            CATCH_REQUIRE(s == str.c_str() + str.length() - 1);
+            CATCH_REQUIRE(len == 1);
+            CATCH_REQUIRE(libutf8::mbstowc(back, s, len) == 1);
+            CATCH_REQUIRE(back == U'z');
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("invalid_utf8_to_utf32: Verify the number of bytes skipped on invalid sequences")
+    {
+        struct skip_t
+        {
+            char const *    f_sequence = nullptr;
+            std::size_t     f_skip = 0;
+        };
+        skip_t const skips[] =
+        {
+            { "\x80\xBF\xF5\xFFz", 4 },    // invalid introducer and what follows
+            { "\xF8\x80z", 2 },
+            { "\xE3\xFF", 2 },              // cut short by the end of the input
+            { "\xE3\x80", 2 },
+            { "\xF1\x80\xF8", 3 },
+            { "\xF1\x80\x80", 3 },
+            { "\xC2", 1 },
+            { "\xC1\xF9", 1 },              // invalid byte after the introducer
+            { "\xC0\x41", 1 },
+            { "\xE3\x80\x41", 2 },
+            { "\xF1\x80\x80\xFF", 3 },
+            { "\xE0\x80\x80z", 3 },         // complete but invalid character
+            { "\xED\xA0\x80z", 3 },
+            { "\xF4\x90\x80\x80z", 4 },
+            { "\xC1\xBF\xBFz", 2 },
+        };
+        for(auto const & skip : skips)
+        {
+            std::string const str(skip.f_sequence);
+            CATCH_REQUIRE(libutf8::utf8_invalid_length(str.c_str(), str.length()) == skip.f_skip);
+
+            char32_t back(rand());
+            char const * s(str.c_str());
+            size_t len(str.length());
+            CATCH_REQUIRE(libutf8::mbstowc(back, s, len) == -1);
+            CATCH_REQUIRE(back == libutf8::NOT_A_CHARACTER);
+            CATCH_REQUIRE(s == str.c_str() + skip.f_skip);
+            CATCH_REQUIRE(len == str.length() - skip.f_skip);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("invalid_utf8_to_utf32: Verify that mbstowc() agrees with is_valid_utf8()")
+    {
+        for(int repeat(0); repeat < 10000; ++repeat)
+        {
+            char buf[6];
+            for(auto & c : buf)
+            {
+                c = static_cast<char>(rand() % 0x80 + 0x80);
+            }
+            std::size_t const size(rand() % 5 + 1);
+            buf[size] = '\0';
+
+            char32_t back(U'\0');
+            char const * s(buf);
+            size_t len(size);
+            bool valid(true);
+            while(len > 0)
+            {
+                if(libutf8::mbstowc(back, s, len) < 0)
+                {
+                    valid = false;
+                }
+            }
+            CATCH_REQUIRE(valid == libutf8::is_valid_utf8(std::string_view(buf, size)));
+        }
+    }
+    CATCH_END_SECTION()
 }
 
 
@@ -0,0 +1,180 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/codepage.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("codepage_latin1", "[codepage][u8]")
+{
+    CATCH_START_SECTION("codepage_latin1: random strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string latin1(length, ' ');
+            std::u32string str32;
+            int const ascii(rand() % 101);
+            for(auto & c : latin1)
+            {
+                c = static_cast<char>(rand() % 100 < ascii ? rand() % 0x80 : rand() % 0x80 + 0x80);
+                str32 += static_cast<char32_t>(static_cast<unsigned char>(c));
+            }
+            std::string const str(libutf8::to_u8string(str32));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&latin1, &str](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::codepage_to_u8string(latin1, libutf8::codepage_t::CODEPAGE_ISO8859_1) == str);
+                    CATCH_REQUIRE(libutf8::u8string_to_codepage(str, libutf8::codepage_t::CODEPAGE_ISO8859_1) == latin1);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("codepage_latin1: characters over 0xFF at any position")
+    {
+        for(std::size_t pos(0); pos < 150; ++pos)
+        {
+            std::string const str(std::string(pos, 'a') + "\xC3\xA9\xE2\x82\xAC" + std::string(rand() % 70, 'b'));
+            std::string const invalid(std::string(pos, 'a') + "\xC3\xA9\xC3" + std::string(rand() % 70, 'b'));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &invalid, pos](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE_THROWS_MATCHES(
+                              libutf8::u8string_to_codepage(str, libutf8::codepage_t::CODEPAGE_ISO8859_1)
+                            , libutf8::libutf8_exception_encoding
+                            , Catch::Matchers::ExceptionMessage(
+                                      "libutf8_exception: u8string_to_codepage(): character U+20AC at position "
+                                    + std::to_string(pos + 2)
+                                    + " is not available in ISO-8859-1."));
+                    CATCH_REQUIRE_THROWS_MATCHES(
+                              libutf8::u8string_to_codepage(invalid, libutf8::codepage_t::CODEPAGE_ISO8859_1)
+                            , libutf8::libutf8_exception_decoding
+                            , Catch::Matchers::ExceptionMessage(
+                                      "libutf8_exception: u8string_to_codepage(): the input includes an invalid UTF-8 character at position "
+                                    + std::to_string(pos + 2)
+                                    + "."));
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("codepage_tables", "[codepage][u8]")
+{
+    CATCH_START_SECTION("codepage_tables: names")
+    {
+        CATCH_REQUIRE(std::string(libutf8::codepage_name(libutf8::codepage_t::CODEPAGE_ISO8859_1)) == "ISO-8859-1");
+        CATCH_REQUIRE(std::string(libutf8::codepage_name(libutf8::codepage_t::CODEPAGE_ISO8859_15)) == "ISO-8859-15");
+        CATCH_REQUIRE(std::string(libutf8::codepage_name(libutf8::codepage_t::CODEPAGE_WINDOWS_1252)) == "windows-1252");
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::codepage_name(static_cast<libutf8::codepage_t>(100))
+                , libutf8::libutf8_exception_invalid_parameter);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("codepage_tables: known characters")
+    {
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\x80 5", libutf8::codepage_t::CODEPAGE_WINDOWS_1252) == "\xE2\x82\xAC 5");
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\xA4 5", libutf8::codepage_t::CODEPAGE_ISO8859_15) == "\xE2\x82\xAC 5");
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\xA4 5", libutf8::codepage_t::CODEPAGE_ISO8859_1) == "\xC2\xA4 5");
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\xC6", libutf8::codepage_t::CODEPAGE_WINDOWS_1251) == "\xD0\x96");
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\xB9", libutf8::codepage_t::CODEPAGE_ISO8859_2) == "\xC5\xA1");
+        CATCH_REQUIRE(libutf8::codepage_to_u8string("\x9A", libutf8::codepage_t::CODEPAGE_WINDOWS_1250) == "\xC5\xA1");
+
+        CATCH_REQUIRE(libutf8::u8string_to_codepage("\xE2\x82\xAC 5", libutf8::codepage_t::CODEPAGE_WINDOWS_1252) == "\x80 5");
+        CATCH_REQUIRE(libutf8::u8string_to_codepage("\xD0\x96", libutf8::codepage_t::CODEPAGE_WINDOWS_1251) == "\xC6");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("codepage_tables: round trip of all the defined bytes")
+    {
+        libutf8::codepage_t const codepages[] =
+        {
+            libutf8::codepage_t::CODEPAGE_ISO8859_1,
+            libutf8::codepage_t::CODEPAGE_ISO8859_2,
+            libutf8::codepage_t::CODEPAGE_ISO8859_15,
+            libutf8::codepage_t::CODEPAGE_WINDOWS_1250,
+            libutf8::codepage_t::CODEPAGE_WINDOWS_1251,
+            libutf8::codepage_t::CODEPAGE_WINDOWS_1252,
+        };
+        for(auto const codepage : codepages)
+        {
+            std::string all;
+            for(int c(1); c < 256; ++c)
+            {
+                std::string const byte(1, static_cast<char>(c));
+                try
+                {
+                    std::string const str(libutf8::codepage_to_u8string(byte, codepage));
+                    CATCH_REQUIRE(libutf8::is_valid_utf8(str));
+                    CATCH_REQUIRE(libutf8::u8string_to_codepage(str, codepage) == byte);
+                    all += byte;
+                    all += "text ";
+                }
+                catch(libutf8::libutf8_exception_decoding const &)
+                {
+                    // only Windows codepages have holes
+                    //
+                    CATCH_REQUIRE(codepage >= libutf8::codepage_t::CODEPAGE_WINDOWS_1250);
+                }
+            }
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&all, codepage](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::u8string_to_codepage(libutf8::codepage_to_u8string(all, codepage), codepage) == all);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("codepage_tables: undefined bytes")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::codepage_to_u8string("abc\x81", libutf8::codepage_t::CODEPAGE_WINDOWS_1252)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: codepage_to_u8string(): byte 0x81 at position 3 is not defined in windows-1252."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::u8string_to_codepage("ab\xE2\x82\xAC", libutf8::codepage_t::CODEPAGE_ISO8859_2)
+                , libutf8::libutf8_exception_encoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: u8string_to_codepage(): character U+20AC at position 2 is not available in ISO-8859-2."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
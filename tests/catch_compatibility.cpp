@@ -0,0 +1,100 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+// the functions kept for older programs are not in the public headers
+// so we declare them here as such programs did
+//
+namespace libutf8
+{
+bool                is_valid_ascii(std::string const & str, bool ctrl);
+bool                is_valid_utf8(std::string const & str);
+bool                is_valid_utf16(std::u16string const & str);
+bool                is_valid_unicode(std::u32string const & str, bool ctrl);
+std::string         to_u8string(std::u32string const & str);
+std::string         to_u8string(std::u16string const & str);
+std::string         to_u8string(std::wstring const & str);
+std::u16string      to_u16string(std::string const & str);
+std::u32string      to_u32string(std::string const & str);
+std::size_t         u8length(std::string const & str);
+ssize_t             u16length(std::u16string const & str);
+int                 u8casecmp(std::string const & lhs, std::string const & rhs);
+bool                make_u8string_valid(std::string & str, char32_t fix_char);
+} // libutf8 namespace
+
+
+
+CATCH_TEST_CASE("compatibility", "[strings][u8][u16][u32]")
+{
+    CATCH_START_SECTION("compatibility: the std::string overloads forward to the std::string_view functions")
+    {
+        std::string const u8("ab\xC3\xA9\xF0\x9F\x98\x80");
+        std::u16string const u16(u"abé\U0001F600");
+        std::u32string const u32(U"abé\U0001F600");
+        std::wstring const w(L"abé\U0001F600");
+
+        CATCH_REQUIRE(libutf8::is_valid_ascii(std::string("abc"), true));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_ascii(u8, true));
+        CATCH_REQUIRE(libutf8::is_valid_utf8(u8));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf8(std::string("\xC0\x80")));
+        CATCH_REQUIRE(libutf8::is_valid_utf16(u16));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf16(std::u16string(1, u'\xD800')));
+        CATCH_REQUIRE(libutf8::is_valid_unicode(u32, true));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_unicode(std::u32string(U"\u0001"), false));
+
+        CATCH_REQUIRE(libutf8::to_u8string(u32) == u8);
+        CATCH_REQUIRE(libutf8::to_u8string(u16) == u8);
+        CATCH_REQUIRE(libutf8::to_u8string(w) == u8);
+        CATCH_REQUIRE(libutf8::to_u16string(u8) == u16);
+        CATCH_REQUIRE(libutf8::to_u32string(u8) == u32);
+
+        CATCH_REQUIRE(libutf8::u8length(u8) == 4);
+        CATCH_REQUIRE(libutf8::u16length(u16) == 4);
+        CATCH_REQUIRE(libutf8::u8casecmp(std::string("ABC"), std::string("abc")) == 0);
+        CATCH_REQUIRE(libutf8::u8casecmp(std::string("abc"), std::string("abd")) < 0);
+
+        // the new function has defaults for the extra parameters so we
+        // need a pointer to select the old one
+        //
+        bool (* make_valid)(std::string &, char32_t)(&libutf8::make_u8string_valid);
+        std::string bad("a\xE3\x80" "b\xFF");
+        CATCH_REQUIRE_FALSE(make_valid(bad, U'?'));
+        CATCH_REQUIRE(bad == "a?b?");
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,336 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/base.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <array>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::array<char, 4> encode(char32_t wc)
+{
+    std::array<char, 4> mb{};
+    libutf8::encode_utf8_char(mb.data(), wc);
+    return mb;
+}
+
+
+constexpr char32_t decode(std::string_view str)
+{
+    char32_t wc(U'\0');
+    libutf8::decode_utf8_char(wc, str.data(), str.length());
+    return wc;
+}
+
+
+// the following are all verified by the compiler
+//
+// the decoder with explicit ranges from the Unicode standard (Table 3-7)
+// used to verify the DFA of decode_utf8_char()
+//
+int reference_decode(char32_t & wc, char const * mb, std::size_t len)
+{
+    wc = libutf8::NOT_A_CHARACTER;
+    unsigned char const c(static_cast<unsigned char>(mb[0]));
+    if(c < 0x80)
+    {
+        wc = c;
+        return 1;
+    }
+
+    std::size_t size(0);
+    unsigned char min(0x80);
+    unsigned char max(0xBF);
+    char32_t w(0);
+    if(c >= 0xC2 && c <= 0xDF)
+    {
+        size = 2;
+        w = c & 0x1F;
+    }
+    else if(c >= 0xE0 && c <= 0xEF)
+    {
+        size = 3;
+        w = c & 0x0F;
+        if(c == 0xE0)
+        {
+            min = 0xA0;
+        }
+        else if(c == 0xED)
+        {
+            max = 0x9F;
+        }
+    }
+    else if(c >= 0xF0 && c <= 0xF4)
+    {
+        size = 4;
+        w = c & 0x07;
+        if(c == 0xF0)
+        {
+            min = 0x90;
+        }
+        else if(c == 0xF4)
+        {
+            max = 0x8F;
+        }
+    }
+    else
+    {
+        return -1;
+    }
+
+    if(len < size)
+    {
+        return -1;
+    }
+    for(std::size_t idx(1); idx < size; ++idx)
+    {
+        unsigned char const b(static_cast<unsigned char>(mb[idx]));
+        if(b < min || b > max)
+        {
+            return -1;
+        }
+        min = 0x80;
+        max = 0xBF;
+        w = (w << 6) | (b & 0x3F);
+    }
+
+    wc = w;
+    return static_cast<int>(size);
+}
+
+
+static_assert(libutf8::is_valid_unicode(U'A'));
+static_assert(libutf8::is_valid_unicode(U'\x7F'));
+static_assert(!libutf8::is_valid_unicode(U'\x7F', false));
+static_assert(!libutf8::is_valid_unicode(static_cast<char32_t>(0xD800)));
+static_assert(!libutf8::is_valid_unicode(static_cast<char32_t>(0x110000)));
+static_assert(libutf8::is_surrogate(static_cast<char32_t>(0xDBFF)) == libutf8::surrogate_t::SURROGATE_HIGH);
+static_assert(libutf8::is_surrogate(static_cast<char32_t>(0xDC00)) == libutf8::surrogate_t::SURROGATE_LOW);
+static_assert(libutf8::is_surrogate(U'\U0001F600') == libutf8::surrogate_t::SURROGATE_NO);
+
+static_assert(libutf8::utf8_char_length(U'\U0010FFFF') == 4);
+static_assert(libutf8::utf8_char_length(static_cast<char32_t>(0xDFFF)) == -1);
+static_assert(encode(U'é')[0] == '\xC3' && encode(U'é')[1] == '\xA9');
+static_assert(encode(U'€')[0] == '\xE2' && encode(U'€')[2] == '\xAC');
+static_assert(decode("\xF0\x9F\x98\x80") == U'\U0001F600');
+static_assert(decode("\xE0\x80\x80") == libutf8::NOT_A_CHARACTER);
+static_assert(libutf8::is_valid_utf8_constexpr("caf\xC3\xA9"));
+static_assert(!libutf8::is_valid_utf8_constexpr("\xED\xA0\x80"));
+static_assert(!libutf8::is_valid_utf8_constexpr("\xF4\x90\x80\x80"));
+static_assert(libutf8::utf8_maximal_subpart_length("\xE3\x80\x41", 3) == 2);
+static_assert(libutf8::utf8_maximal_subpart_length("\xE0\x80\x80", 3) == 1);
+static_assert(libutf8::utf8_maximal_subpart_length("\xF4\x8F\xBF", 3) == 3);
+static_assert(libutf8::utf8_maximal_subpart_length("\xC3\xA9z", 3) == 2);
+static_assert(libutf8::utf8_maximal_subpart_length("\x80\x80", 2) == 1);
+static_assert(libutf8::utf8_is_truncated("\xF4\x8F\xBF", 3));
+static_assert(libutf8::utf8_is_truncated("\xE3", 1));
+static_assert(!libutf8::utf8_is_truncated("\xE3\x80\x80", 3));
+static_assert(!libutf8::utf8_is_truncated("\xE0\x80", 2));
+static_assert(!libutf8::utf8_is_truncated("\x80", 1));
+static_assert(!libutf8::utf8_is_truncated("", 0));
+
+#ifdef __cpp_consteval
+using namespace libutf8::literals;
+
+static_assert("caf\xC3\xA9"_utf8 == std::string_view("caf\xC3\xA9"));
+static_assert("\xE2\x82\xAC"_utf8.length() == 3);
+#endif
+
+
+
+}
+
+
+
+CATCH_TEST_CASE("constexpr_encode", "[constexpr][u8]")
+{
+    CATCH_START_SECTION("constexpr_encode: encode_utf8_char() matches wctombs() for all code points")
+    {
+        for(char32_t wc(0); wc < 0x110100; ++wc)
+        {
+            char expected[libutf8::MBS_MIN_BUFFER_LENGTH];
+            int const expected_size(libutf8::wctombs(expected, wc, sizeof(expected)));
+
+            char mb[4] = { 'x', 'x', 'x', 'x' };
+            CATCH_REQUIRE(libutf8::utf8_char_length(wc) == expected_size);
+            CATCH_REQUIRE(libutf8::encode_utf8_char(mb, wc) == expected_size);
+            if(expected_size < 0)
+            {
+                CATCH_REQUIRE(mb[0] == 'x');
+                CATCH_REQUIRE_FALSE(libutf8::is_valid_unicode(wc));
+            }
+            else
+            {
+                CATCH_REQUIRE(std::string(mb, expected_size) == std::string(expected, expected_size));
+                CATCH_REQUIRE(libutf8::is_valid_unicode(wc));
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("constexpr_decode", "[constexpr][u8]")
+{
+    CATCH_START_SECTION("constexpr_decode: decode_utf8_char() round trip for all code points")
+    {
+        for(char32_t wc(0); wc < 0x110000; ++wc)
+        {
+            char mb[4];
+            int const size(libutf8::encode_utf8_char(mb, wc));
+            if(size < 0)
+            {
+                continue;
+            }
+
+            char32_t result(U'\0');
+            CATCH_REQUIRE(libutf8::decode_utf8_char(result, mb, size) == size);
+            CATCH_REQUIRE(result == wc);
+
+            // cut short
+            //
+            if(size > 1)
+            {
+                CATCH_REQUIRE(libutf8::decode_utf8_char(result, mb, size - 1) == -1);
+                CATCH_REQUIRE(result == libutf8::NOT_A_CHARACTER);
+            }
+        }
+
+        char32_t result(U'a');
+        CATCH_REQUIRE(libutf8::decode_utf8_char(result, "", 0) == 0);
+        CATCH_REQUIRE(result == U'\0');
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("constexpr_decode: decode_utf8_char() agrees with mbstowc() on random bytes")
+    {
+        for(int count(0); count < 100000; ++count)
+        {
+            char mb[4];
+            std::size_t const len(rand() % 4 + 1);
+            for(std::size_t idx(0); idx < len; ++idx)
+            {
+                // favor bytes which are likely to form sequences
+                //
+                mb[idx] = static_cast<char>(idx == 0 ? rand() % 0x100 : rand() % 0x50 + 0x70);
+            }
+
+            char32_t expected(U'\0');
+            char const * s(mb);
+            std::size_t l(len);
+            int const expected_size(libutf8::mbstowc(expected, s, l));
+
+            char32_t result(U'\0');
+            int const size(libutf8::decode_utf8_char(result, mb, len));
+            CATCH_REQUIRE(size == expected_size);
+            CATCH_REQUIRE(result == expected);
+            CATCH_REQUIRE(libutf8::is_valid_utf8_constexpr(std::string_view(mb, len))
+                                == libutf8::is_valid_utf8(std::string_view(mb, len)));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("constexpr_decode: decode_utf8_char() and utf8_invalid_length() agree with mbstowc() on all 1 to 4 byte prefixes")
+    {
+        // all the lead bytes followed by the bytes at the limits of
+        // each range of the DFA
+        //
+        unsigned char const following[] =
+        {
+            0x00, 0x41, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF,
+            0xC0, 0xC2, 0xE0, 0xED, 0xF0, 0xF4, 0xF5, 0xFF,
+        };
+        constexpr std::size_t count(std::size(following));
+
+        for(std::size_t len(1); len <= 4; ++len)
+        {
+            std::size_t total(256);
+            for(std::size_t idx(1); idx < len; ++idx)
+            {
+                total *= count;
+            }
+            for(std::size_t n(0); n < total; ++n)
+            {
+                char mb[4];
+                mb[0] = static_cast<char>(n % 256);
+                std::size_t rest(n / 256);
+                for(std::size_t idx(1); idx < len; ++idx)
+                {
+                    mb[idx] = static_cast<char>(following[rest % count]);
+                    rest /= count;
+                }
+
+                char32_t expected(U'\0');
+                char const * s(mb);
+                std::size_t l(len);
+                int const expected_size(libutf8::mbstowc(expected, s, l));
+
+                char32_t reference(U'\0');
+                CATCH_REQUIRE(reference_decode(reference, mb, len) == expected_size);
+                CATCH_REQUIRE(reference == expected);
+
+                char32_t result(U'\0');
+                CATCH_REQUIRE(libutf8::decode_utf8_char(result, mb, len) == expected_size);
+                CATCH_REQUIRE(result == expected);
+
+                if(expected_size < 0)
+                {
+                    CATCH_REQUIRE(libutf8::utf8_invalid_length(mb, len) == static_cast<std::size_t>(s - mb));
+                }
+                CATCH_REQUIRE(s + l == mb + len);
+
+                bool valid(true);
+                for(std::size_t pos(0); pos < len && valid; )
+                {
+                    int const size(reference_decode(reference, mb + pos, len - pos));
+                    valid = size > 0;
+                    pos += size;
+                }
+                std::string_view const str(mb, len);
+                CATCH_REQUIRE(libutf8::is_valid_utf8_constexpr(str) == valid);
+                CATCH_REQUIRE(libutf8::is_valid_utf8(str) == valid);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,200 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/decoder.h>
+
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("decoder_chunks", "[decoder][u8][u16][u32]")
+{
+    CATCH_START_SECTION("decoder_chunks: decode a stream in chunks of any size")
+    {
+        for(int count(0); count < 200; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 500, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+            std::size_t const max_chunk(rand() % 2 == 0 ? 5 : 100);
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                {
+                    libutf8::utf8_decoder decoder16;
+                    libutf8::utf8_decoder decoder32;
+                    std::u16string result16;
+                    std::u32string result32;
+                    for(std::size_t pos(0); pos < str.length(); )
+                    {
+                        std::size_t const size(std::min(rand() % max_chunk + 1, str.length() - pos));
+
+                        libutf8::transcode_result_t r(decoder16.feed(str.data() + pos, size, result16));
+                        CATCH_REQUIRE(r.ok());
+                        CATCH_REQUIRE(r.f_read == size);
+                        CATCH_REQUIRE(decoder16.pending() < 4);
+
+                        r = decoder32.feed(str.data() + pos, size, result32);
+                        CATCH_REQUIRE(r.ok());
+                        CATCH_REQUIRE(r.f_error_position == pos + size - decoder32.pending());
+
+                        pos += size;
+                        CATCH_REQUIRE(decoder32.offset() == pos);
+                    }
+                    CATCH_REQUIRE(decoder16.finish().ok());
+                    CATCH_REQUIRE(decoder32.finish().ok());
+                    CATCH_REQUIRE(result16 == str16);
+                    CATCH_REQUIRE(result32 == str32);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decoder_chunks: small output buffers")
+    {
+        std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(300, 50));
+        std::u16string const str16(libutf8::to_u16string(str));
+
+        libutf8::utf8_decoder decoder;
+        std::u16string result;
+        char16_t buf[7];
+        for(std::size_t pos(0); pos < str.length(); )
+        {
+            std::size_t const size(std::min<std::size_t>(rand() % 30 + 1, str.length() - pos));
+            std::size_t done(0);
+            for(;;)
+            {
+                libutf8::transcode_result_t const r(decoder.feed(str.data() + pos + done, size - done, buf, std::size(buf)));
+                result.append(buf, r.f_written);
+                done += r.f_read;
+                if(r.ok())
+                {
+                    break;
+                }
+                CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+            }
+            CATCH_REQUIRE(done == size);
+            pos += size;
+        }
+        CATCH_REQUIRE(decoder.finish().ok());
+        CATCH_REQUIRE(result == str16);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decoder_chunks: empty chunks while a character is pending")
+    {
+        libutf8::utf8_decoder decoder;
+        std::u32string result;
+        CATCH_REQUIRE(decoder.feed("\xE2", 1, result).ok());
+        CATCH_REQUIRE(decoder.pending() == 1);
+
+        libutf8::transcode_result_t r(decoder.feed(nullptr, 0, static_cast<char32_t *>(nullptr), 0));
+        CATCH_REQUIRE(r.ok());
+        CATCH_REQUIRE(r.f_read == 0);
+        CATCH_REQUIRE(r.f_written == 0);
+        CATCH_REQUIRE(decoder.pending() == 1);
+
+        CATCH_REQUIRE(decoder.feed("\x82", 1, result).ok());
+        r = decoder.feed(nullptr, 0, result);
+        CATCH_REQUIRE(r.ok());
+        CATCH_REQUIRE(r.f_read == 0);
+        CATCH_REQUIRE(decoder.pending() == 2);
+
+        CATCH_REQUIRE(decoder.feed("\xAC", 1, result).ok());
+        CATCH_REQUIRE(decoder.pending() == 0);
+        CATCH_REQUIRE(decoder.finish().ok());
+        CATCH_REQUIRE(result == U"\u20AC");
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("decoder_errors", "[decoder][invalid][u8]")
+{
+    CATCH_START_SECTION("decoder_errors: invalid sequence split between chunks")
+    {
+        std::string const str("0123456789\xE2\x82" "A and more");
+        for(std::size_t split(1); split < str.length(); ++split)
+        {
+            libutf8::utf8_decoder decoder;
+            std::u32string result;
+            libutf8::transcode_result_t r(decoder.feed(str.data(), split, result));
+            if(split <= 12)
+            {
+                CATCH_REQUIRE(r.ok());
+                r = decoder.feed(str.data() + split, str.length() - split, result);
+            }
+            CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+            CATCH_REQUIRE(r.f_error_position == 10);
+            CATCH_REQUIRE(result == U"0123456789");
+
+            // the error sticks until finish() or reset()
+            //
+            r = decoder.feed("more", 4, result);
+            CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+            CATCH_REQUIRE(r.f_error_position == 10);
+            CATCH_REQUIRE(r.f_read == 0);
+            CATCH_REQUIRE(r.f_written == 0);
+            CATCH_REQUIRE(result == U"0123456789");
+            CATCH_REQUIRE(decoder.finish().f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+
+            // finish() resets the decoder
+            //
+            CATCH_REQUIRE(decoder.feed("more", 4, result).ok());
+            CATCH_REQUIRE(decoder.offset() == 4);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("decoder_errors: truncated sequence at the end of the stream")
+    {
+        std::string const str("stream \xF0\x9F\x98");
+        for(std::size_t split(1); split < str.length(); ++split)
+        {
+            libutf8::utf8_decoder decoder;
+            std::u16string result;
+            CATCH_REQUIRE(decoder.feed(str.data(), split, result).ok());
+            CATCH_REQUIRE(decoder.feed(str.data() + split, str.length() - split, result).ok());
+            CATCH_REQUIRE(decoder.pending() == 3);
+            CATCH_REQUIRE(result == u"stream ");
+
+            libutf8::transcode_result_t const r(decoder.finish());
+            CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+            CATCH_REQUIRE(r.f_error_position == 7);
+            CATCH_REQUIRE(decoder.pending() == 0);
+            CATCH_REQUIRE(decoder.offset() == 0);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
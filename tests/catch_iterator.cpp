@@ -34,6 +34,7 @@
 //
 #include    <cctype>
 #include    <iostream>
+#include    <vector>
 
 
 // last include
@@ -420,4 +421,307 @@ CATCH_TEST_CASE("libutf8_iterator_invalid_string", "[iterator],[invalid]")
 
 
 
+namespace
+{
+
+constexpr std::size_t count_characters(std::string_view str)
+{
+    std::size_t result(0);
+    for(libutf8::utf8_view_iterator it(str), end(str, true); it != end; ++it)
+    {
+        ++result;
+    }
+    return result;
+}
+
+static_assert(count_characters("") == 0);
+static_assert(count_characters("caf\xC3\xA9 \xF0\x9F\x98\x80") == 6);
+static_assert(*libutf8::utf8_view_iterator("\xE2\x82\xAC") == U'\x20AC');
+
+} // no name namespace
+
+
+CATCH_TEST_CASE("libutf8_view_iterator", "[iterator]")
+{
+    CATCH_START_SECTION("libutf8_view_iterator: valid strings forward and backward")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 200, rand() % 101));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            libutf8::utf8_view_iterator it(str);
+            libutf8::utf8_view_iterator const end(str, true);
+            std::size_t pos(0);
+            std::size_t byte(0);
+            for(; it != end; ++it, ++pos)
+            {
+                CATCH_REQUIRE(pos < str32.length());
+                CATCH_REQUIRE(*it == str32[pos]);
+                CATCH_REQUIRE(it.position() == byte);
+                CATCH_REQUIRE(it.size() == static_cast<std::size_t>(libutf8::utf8_char_length(str32[pos])));
+                CATCH_REQUIRE(it.base() == str.data() + byte);
+                byte += it.size();
+            }
+            CATCH_REQUIRE(pos == str32.length());
+            CATCH_REQUIRE(it.at_end());
+            CATCH_REQUIRE(*it == libutf8::EOS);
+            CATCH_REQUIRE(it.good());
+            CATCH_REQUIRE(it - libutf8::utf8_view_iterator(str) == static_cast<std::ptrdiff_t>(str.length()));
+
+            // the post-increment at the end does not move
+            //
+            CATCH_REQUIRE(it++ == end);
+            CATCH_REQUIRE(it == end);
+
+            while(pos > 0)
+            {
+                --pos;
+                libutf8::utf8_view_iterator const previous(it--);
+                CATCH_REQUIRE(previous != it);
+                CATCH_REQUIRE(*it == str32[pos]);
+            }
+            CATCH_REQUIRE(it == libutf8::utf8_view_iterator(str));
+            --it;
+            CATCH_REQUIRE(it == libutf8::utf8_view_iterator(str));
+            CATCH_REQUIRE(it.good());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("libutf8_view_iterator: raw pointers")
+    {
+        char const buffer[] = "a\xC3\xA9z";
+        libutf8::utf8_view_iterator it(buffer, buffer + 4, buffer + 1);
+        CATCH_REQUIRE(*it == U'\xE9');
+        CATCH_REQUIRE(it.position() == 1);
+        ++it;
+        CATCH_REQUIRE(*it == U'z');
+        --it;
+        --it;
+        CATCH_REQUIRE(*it == U'a');
+        CATCH_REQUIRE(it.position() == 0);
+
+        libutf8::utf8_view_iterator const empty;
+        CATCH_REQUIRE(*empty == libutf8::EOS);
+        CATCH_REQUIRE(empty.at_end());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("libutf8_view_iterator: invalid sequences are skipped like mbstowc()")
+    {
+        for(int count(0); count < 1000; ++count)
+        {
+            // random bytes with a bias toward the UTF-8 special bytes
+            //
+            std::string str;
+            std::size_t const length(rand() % 20);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                switch(rand() % 4)
+                {
+                case 0:
+                    str += static_cast<char>(rand() % 0x80);
+                    break;
+
+                case 1:
+                    str += static_cast<char>(rand() % 0x40 + 0x80);
+                    break;
+
+                default:
+                    str += static_cast<char>(rand() % 0x40 + 0xC0);
+                    break;
+
+                }
+            }
+
+            libutf8::utf8_view_iterator it(str);
+            char const * mb(str.data());
+            std::size_t len(str.length());
+            bool good(true);
+            while(len > 0)
+            {
+                CATCH_REQUIRE(it.base() == mb);
+
+                char32_t wc(U'\0');
+                if(libutf8::mbstowc(wc, mb, len) < 0)
+                {
+                    good = false;
+                }
+                CATCH_REQUIRE(*it == wc);
+                CATCH_REQUIRE(it.good() == good);
+                CATCH_REQUIRE(it.bad() == !good);
+                ++it;
+            }
+            CATCH_REQUIRE(it.at_end());
+            CATCH_REQUIRE(it.good() == good);
+
+            it.clear();
+            CATCH_REQUIRE(it.good());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("libutf8_view_iterator: decrement undoes increment over invalid sequences")
+    {
+        std::vector<std::string> strs{
+            std::string("A\x80\x80" "B\xE3\x80\x80\x80"),
+            std::string("\xE3\x80\xF5\x80\xC1\xBF\xBFz\xF1\x80\xF8"),
+        };
+        for(int count(0); count < 1000; ++count)
+        {
+            // random bytes with a bias toward the UTF-8 special bytes
+            //
+            std::string str;
+            std::size_t const length(rand() % 30);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                switch(rand() % 4)
+                {
+                case 0:
+                    str += static_cast<char>(rand() % 0x80);
+                    break;
+
+                case 1:
+                    str += static_cast<char>(rand() % 0x40 + 0x80);
+                    break;
+
+                default:
+                    str += static_cast<char>(rand() % 0x40 + 0xC0);
+                    break;
+
+                }
+            }
+            strs.push_back(str);
+        }
+
+        for(auto const & str : strs)
+        {
+            std::vector<char const *> positions;
+            std::vector<char32_t> chars;
+            libutf8::utf8_view_iterator const begin(str);
+            libutf8::utf8_view_iterator const end(str, true);
+            for(libutf8::utf8_view_iterator it(begin); it != end; ++it)
+            {
+                positions.push_back(it.base());
+                chars.push_back(*it);
+            }
+
+            libutf8::utf8_view_iterator it(end);
+            for(std::size_t idx(positions.size()); idx > 0; --idx)
+            {
+                libutf8::utf8_view_iterator const next(it);
+                --it;
+                CATCH_REQUIRE(it.base() == positions[idx - 1]);
+                CATCH_REQUIRE(*it == chars[idx - 1]);
+
+                libutf8::utf8_view_iterator again(it);
+                ++again;
+                CATCH_REQUIRE(again == next);
+            }
+            CATCH_REQUIRE(it == begin);
+        }
+
+        // the example of the reverse view
+        //
+        std::string const str(strs[0]);
+        libutf8::utf8_view_iterator it(str, true);
+        std::vector<char32_t> reversed;
+        while(it != libutf8::utf8_view_iterator(str))
+        {
+            --it;
+            reversed.push_back(*it);
+        }
+        CATCH_REQUIRE(reversed == std::vector<char32_t>{ libutf8::NOT_A_CHARACTER, U'\u3000', U'B', libutf8::NOT_A_CHARACTER, U'A' });
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("libutf8_advance", "[iterator]")
+{
+    CATCH_START_SECTION("libutf8_advance: same position as repeated increments")
+    {
+        for(int count(0); count < 200; ++count)
+        {
+            std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 300, rand() % 101));
+            if(!str.empty() && count % 2 == 1)
+            {
+                // invalid strings use the slow path
+                //
+                str[rand() % str.length()] = '\xFF';
+            }
+            std::size_t const start(rand() % (str.length() + 1));
+            libutf8::utf8_view_iterator::difference_type const n(rand() % 400 - 100);
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, start, n](libutf8::simd_t)
+                {
+                    // utf8_iterator
+                    //
+                    libutf8::utf8_iterator it(str);
+                    for(std::size_t idx(0); idx < start && it != str.end(); ++idx)
+                    {
+                        ++it;
+                    }
+                    libutf8::utf8_iterator expected(it);
+                    for(auto idx(n); idx > 0 && expected != str.end(); --idx)
+                    {
+                        ++expected;
+                    }
+                    for(auto idx(n); idx < 0 && expected != str.begin(); ++idx)
+                    {
+                        --expected;
+                    }
+                    advance(it, n);
+                    CATCH_REQUIRE(it == expected);
+                    CATCH_REQUIRE(it.good() == expected.good());
+
+                    // utf8_view_iterator
+                    //
+                    libutf8::utf8_view_iterator vit(str);
+                    for(std::size_t idx(0); idx < start && !vit.at_end(); ++idx)
+                    {
+                        ++vit;
+                    }
+                    libutf8::utf8_view_iterator vexpected(vit);
+                    for(auto idx(n); idx > 0 && !vexpected.at_end(); --idx)
+                    {
+                        ++vexpected;
+                    }
+                    for(auto idx(n); idx < 0 && vexpected.position() > 0; ++idx)
+                    {
+                        --vexpected;
+                    }
+                    advance(vit, n);
+                    CATCH_REQUIRE(vit == vexpected);
+                    CATCH_REQUIRE(*vit == *vexpected);
+                    CATCH_REQUIRE(vit.good() == vexpected.good());
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("libutf8_advance: UTF-16 and UTF-32 views")
+    {
+        std::u16string const str16(u"a\xE9\xD83D\xDE00z");
+        libutf8::utf16_view_iterator it16(str16);
+        advance(it16, 2);
+        CATCH_REQUIRE(*it16 == U'\U0001F600');
+        advance(it16, 10);
+        CATCH_REQUIRE(it16.at_end());
+        advance(it16, -2);
+        CATCH_REQUIRE(*it16 == U'\U0001F600');
+
+        std::u32string const str32(U"abc");
+        libutf8::utf32_view_iterator it32(str32);
+        advance(it32, 2);
+        CATCH_REQUIRE(*it32 == U'c');
+        advance(it32, -5);
+        CATCH_REQUIRE(*it32 == U'a');
+    }
+    CATCH_END_SECTION()
+}
+
+
+
 // vim: ts=4 sw=4 et
@@ -33,6 +33,7 @@
 #include    <cctype>
 #include    <iostream>
 #include    <iomanip>
+#include    <vector>
 
 
 // last include
@@ -116,4 +117,87 @@ CATCH_TEST_CASE("invalid_utf16_string_length", "[strings][invalid][length][u16]"
 }
 
 
+CATCH_TEST_CASE("string_view_length", "[strings][valid][length][u8][u16]")
+{
+    CATCH_START_SECTION("string_view_length: embedded NUL characters are counted")
+    {
+        std::string const str8("a\0\xC3\xA9\0b", 6);
+        CATCH_REQUIRE(libutf8::u8length(str8) == 5);
+
+        std::u16string const str16(u"a\0\xE9\0b\xD83D\xDE00", 7);
+        CATCH_REQUIRE(libutf8::u16length(str16) == 6);
+
+        // a high surrogate followed by u'\0' is still an error
+        //
+        std::u16string const bad16(u"a\xD83D\0b", 4);
+        CATCH_REQUIRE(libutf8::u16length(bad16) == -1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_view_length: slices of a larger buffer")
+    {
+        std::string const buffer("[\xC3\xA9t\xC3\xA9]");
+        CATCH_REQUIRE(libutf8::u8length(std::string_view(buffer).substr(1, 5)) == 3);
+
+        // a surrogate pair cut in half by the end of the view
+        //
+        std::u16string const buffer16(u"x\xD83D\xDE00y");
+        CATCH_REQUIRE(libutf8::u16length(std::u16string_view(buffer16).substr(0, 2)) == -1);
+        CATCH_REQUIRE(libutf8::u16length(std::u16string_view(buffer16).substr(0, 3)) == 2);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("byte_offset_of", "[strings][valid][length][u8]")
+{
+    CATCH_START_SECTION("byte_offset_of: offset of each character")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 500, rand() % 101));
+            std::vector<std::size_t> starts;
+            for(std::size_t pos(0); pos < str.length(); ++pos)
+            {
+                if((static_cast<unsigned char>(str[pos]) & 0xC0) != 0x80)
+                {
+                    starts.push_back(pos);
+                }
+            }
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &starts](libutf8::simd_t)
+                {
+                    for(std::size_t idx(0); idx < starts.size(); ++idx)
+                    {
+                        CATCH_REQUIRE(libutf8::byte_offset_of(str, idx) == starts[idx]);
+                    }
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, starts.size()) == str.length());
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, starts.size() + 1 + rand() % 100) == str.length());
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, static_cast<std::size_t>(-1)) == str.length());
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("byte_offset_of: characters after a long ASCII run")
+    {
+        // the blocks of ASCII are skipped whole, the character is then
+        // found inside the block
+        //
+        for(std::size_t size(0); size < 200; ++size)
+        {
+            std::string const str(std::string(size, 'a') + "\xF0\x9F\x98\x80z");
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, size](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, size) == size);
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, size + 1) == size + 4);
+                    CATCH_REQUIRE(libutf8::byte_offset_of(str, size + 2) == size + 5);
+                    CATCH_REQUIRE(libutf8::byte_offset_of(std::string_view(str).substr(1), size) == size + 3);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
 // vim: ts=4 sw=4 et
@@ -21,6 +21,7 @@
 // libutf8
 //
 #include    <libutf8/libutf8.h>     // for the ostream
+#include    <libutf8/simd.h>
 
 
 // catch2
@@ -69,6 +70,66 @@ inline char32_t rand_char(bool full_range = false)
 }
 
 
+// the kernels of all the SIMD levels must return exactly the same results
+// so each test gets repeated for each level this CPU supports
+//
+template<typename F>
+void foreach_simd(F f)
+{
+    libutf8::simd_t const best(libutf8::get_best_simd());
+    for(int level(static_cast<int>(libutf8::simd_t::SIMD_NONE));
+        level <= static_cast<int>(best);
+        ++level)
+    {
+        libutf8::set_simd(static_cast<libutf8::simd_t>(level));
+        f(static_cast<libutf8::simd_t>(level));
+    }
+    libutf8::set_simd(best);
+}
+
+
+// generate a valid UTF-8 string with a mix of ASCII and longer sequences
+// (the non-ASCII characters are evenly distributed between 2, 3, and 4
+// byte sequences)
+//
+inline std::string random_utf8(std::size_t length, int ascii_percent)
+{
+    std::string result;
+    for(std::size_t idx(0); idx < length; ++idx)
+    {
+        if(rand() % 100 < ascii_percent)
+        {
+            result += static_cast<char>(rand() % 0x7F + 1);
+        }
+        else
+        {
+            char32_t wc(U'\0');
+            switch(rand() % 3)
+            {
+            case 0:
+                wc = rand() % (0x800 - 0x80) + 0x80;
+                break;
+
+            case 1:
+                do
+                {
+                    wc = rand() % (0x10000 - 0x800) + 0x800;
+                }
+                while(wc >= 0xD800 && wc <= 0xDFFF);
+                break;
+
+            default:
+                wc = random_char(character_t::CHARACTER_ZUNICODE);
+                break;
+
+            }
+            result += wc;
+        }
+    }
+    return result;
+}
+
+
 
 }
 // unittest namespace
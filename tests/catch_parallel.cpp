@@ -0,0 +1,332 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/parallel.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <atomic>
+#include    <thread>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+void require_same_result(libutf8::transcode_result_t const & expected, libutf8::transcode_result_t const & result)
+{
+    CATCH_REQUIRE(result.f_status == expected.f_status);
+    CATCH_REQUIRE(result.f_error_position == expected.f_error_position);
+    CATCH_REQUIRE(result.f_read == expected.f_read);
+    CATCH_REQUIRE(result.f_written == expected.f_written);
+}
+
+
+// corrupt a few bytes so errors also end up near the chunk boundaries
+//
+std::string random_invalid_utf8(std::size_t length)
+{
+    std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+    if(!str.empty())
+    {
+        int const count(rand() % 3 + 1);
+        for(int idx(0); idx < count; ++idx)
+        {
+            str[rand() % str.length()] = static_cast<char>(rand() % 0x40 + 0x80 + (rand() % 2) * 0x40);
+        }
+    }
+    return str;
+}
+
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("parallel_split_point", "[parallel][u8]")
+{
+    CATCH_START_SECTION("parallel_split_point: back up over continuation bytes")
+    {
+        std::string const str("a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80z");
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 0) == 0);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 1) == 1);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 2) == 1);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 3) == 3);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 4) == 3);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 5) == 3);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 6) == 6);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 7) == 6);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 8) == 6);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 9) == 6);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 10) == 10);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 11) == 11);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 100) == 11);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_split_point: too many continuation bytes")
+    {
+        std::string const str("a\x80\x80\x80\x80\x80");
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 3) == 0);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 4) == 4);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str, 5) == 5);
+        CATCH_REQUIRE(libutf8::utf8_split_point(str.substr(1), 2) == 2);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("parallel_validate", "[parallel][valid][invalid][u8]")
+{
+    CATCH_START_SECTION("parallel_validate: same result as the single threaded validation")
+    {
+        for(int count(0); count < 500; ++count)
+        {
+            bool const valid(count % 2 == 0);
+            std::string const str(valid
+                    ? SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 300, rand() % 101)
+                    : random_invalid_utf8(rand() % 300));
+
+            libutf8::parallel_options_t options;
+            options.f_threads = rand() % 8 + 1;
+            options.f_min_chunk_size = rand() % 16 + 1;
+
+            std::vector<char32_t> buf(str.length());
+            libutf8::transcode_result_t const expected(libutf8::convert_utf8_to_utf32(str, buf.data(), buf.size()));
+
+            libutf8::transcode_result_t const r(libutf8::validate_utf8_parallel(str, options));
+            CATCH_REQUIRE(r.ok() == libutf8::is_valid_utf8(str));
+            CATCH_REQUIRE(r.f_status == expected.f_status);
+            CATCH_REQUIRE(r.f_error_position == expected.f_error_position);
+            CATCH_REQUIRE(r.f_read == expected.f_read);
+            CATCH_REQUIRE(r.f_written == 0);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_validate: truncated character at the end of the input")
+    {
+        std::string const str("abcdefgh\xC3\xA9ijklmnop\xF0\x9F\x98");
+        for(std::size_t min(1); min <= str.length(); ++min)
+        {
+            libutf8::parallel_options_t options;
+            options.f_threads = 4;
+            options.f_min_chunk_size = min;
+
+            libutf8::transcode_result_t const r(libutf8::validate_utf8_parallel(str, options));
+            CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+            CATCH_REQUIRE(r.f_error_position == 18);
+            CATCH_REQUIRE(r.f_read == 18);
+
+            char32_t buf[32];
+            libutf8::transcode_result_t const c(libutf8::convert_utf8_to_utf32_parallel(str, buf, 32, options));
+            CATCH_REQUIRE(c.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+            CATCH_REQUIRE(c.f_error_position == 18);
+        }
+
+        // an invalid byte after the lead byte is not a truncation
+        //
+        libutf8::parallel_options_t options;
+        options.f_threads = 4;
+        options.f_min_chunk_size = 1;
+        CATCH_REQUIRE(libutf8::validate_utf8_parallel("abcdefgh\xF0\x9F\x41", options).f_status
+                            == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+        CATCH_REQUIRE(libutf8::validate_utf8_parallel("abcdefgh\x80", options).f_status
+                            == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("parallel_convert", "[parallel][valid][invalid][u8][u16][u32]")
+{
+    CATCH_START_SECTION("parallel_convert: same result as the single threaded conversions")
+    {
+        for(int count(0); count < 500; ++count)
+        {
+            std::string const str(count % 2 == 0
+                    ? SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 300, rand() % 101)
+                    : random_invalid_utf8(rand() % 300));
+
+            libutf8::parallel_options_t options;
+            options.f_threads = rand() % 8 + 1;
+            options.f_min_chunk_size = rand() % 16 + 1;
+
+            // also try with output buffers which are too small
+            //
+            std::size_t const cap(count % 3 == 0 ? rand() % (str.length() + 1) : str.length());
+
+            std::vector<char16_t> expected16(cap);
+            std::vector<char16_t> buf16(cap);
+            libutf8::transcode_result_t r(libutf8::convert_utf8_to_utf16_parallel(str, buf16.data(), cap, options));
+            require_same_result(libutf8::convert_utf8_to_utf16(str, expected16.data(), cap), r);
+            CATCH_REQUIRE(std::u16string_view(buf16.data(), r.f_written) == std::u16string_view(expected16.data(), r.f_written));
+
+            std::vector<char32_t> expected32(cap);
+            std::vector<char32_t> buf32(cap);
+            r = libutf8::convert_utf8_to_utf32_parallel(str, buf32.data(), cap, options);
+            require_same_result(libutf8::convert_utf8_to_utf32(str, expected32.data(), cap), r);
+            CATCH_REQUIRE(std::u32string_view(buf32.data(), r.f_written) == std::u32string_view(expected32.data(), r.f_written));
+
+            if(libutf8::is_valid_utf8(str))
+            {
+                CATCH_REQUIRE(libutf8::to_u16string_parallel(str, options) == libutf8::to_u16string(str));
+                CATCH_REQUIRE(libutf8::to_u32string_parallel(str, options) == libutf8::to_u32string(str));
+            }
+            else
+            {
+                CATCH_REQUIRE_THROWS_AS(
+                          libutf8::to_u16string_parallel(str, options)
+                        , libutf8::libutf8_exception_decoding);
+                CATCH_REQUIRE_THROWS_AS(
+                          libutf8::to_u32string_parallel(str, options)
+                        , libutf8::libutf8_exception_decoding);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_convert: truncated character at the end of a chunk")
+    {
+        // the 3 byte character is cut short and followed by a lead byte
+        // which may become the start of the next chunk
+        //
+        std::string const str("abcdefgh\xE2\x82" "\xC3\xA9" "ijklmnop");
+        for(std::size_t min(1); min <= str.length(); ++min)
+        {
+            libutf8::parallel_options_t options;
+            options.f_threads = 4;
+            options.f_min_chunk_size = min;
+
+            libutf8::transcode_result_t const r(libutf8::validate_utf8_parallel(str, options));
+            CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+            CATCH_REQUIRE(r.f_error_position == 8);
+
+            char16_t buf[32];
+            libutf8::transcode_result_t const c(libutf8::convert_utf8_to_utf16_parallel(str, buf, 32, options));
+            CATCH_REQUIRE(c.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+            CATCH_REQUIRE(c.f_error_position == 8);
+            CATCH_REQUIRE(c.f_written == 8);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_convert: user defined executor")
+    {
+        std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(1000, 50));
+
+        std::size_t calls(0);
+        std::size_t tasks(0);
+        libutf8::parallel_options_t options;
+        options.f_threads = 5;
+        options.f_min_chunk_size = 10;
+        options.f_executor = [&calls, &tasks](std::size_t count, std::function<void(std::size_t)> const & task)
+            {
+                // run the tasks backward to make sure the order does not matter
+                //
+                ++calls;
+                for(std::size_t idx(count); idx > 0; --idx)
+                {
+                    ++tasks;
+                    task(idx - 1);
+                }
+            };
+
+        CATCH_REQUIRE(libutf8::validate_utf8_parallel(str, options).ok());
+        CATCH_REQUIRE(calls == 1);
+        CATCH_REQUIRE(tasks == 5);
+
+        CATCH_REQUIRE(libutf8::to_u16string_parallel(str, options) == libutf8::to_u16string(str));
+        CATCH_REQUIRE(calls == 3);
+        CATCH_REQUIRE(tasks == 15);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_convert: the default executor is shared by concurrent calls")
+    {
+        std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(5000, 50));
+        std::u16string const str16(libutf8::to_u16string(str));
+
+        std::atomic<int> failures(0);
+        std::vector<std::thread> callers;
+        for(int idx(0); idx < 4; ++idx)
+        {
+            callers.emplace_back([&str, &str16, &failures]()
+                {
+                    for(int repeat(0); repeat < 50; ++repeat)
+                    {
+                        libutf8::parallel_options_t options;
+                        options.f_threads = repeat % 7 + 2;
+                        options.f_min_chunk_size = 100;
+                        if(libutf8::to_u16string_parallel(str, options) != str16
+                        || !libutf8::validate_utf8_parallel(str, options).ok())
+                        {
+                            ++failures;
+                        }
+                    }
+                });
+        }
+        for(auto & t : callers)
+        {
+            t.join();
+        }
+        CATCH_REQUIRE(failures == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("parallel_convert: large buffer with the default options")
+    {
+        std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(2 * 1024 * 1024, 80));
+        std::u32string const str32(libutf8::to_u32string(str));
+
+        CATCH_REQUIRE(libutf8::validate_utf8_parallel(str).ok());
+        CATCH_REQUIRE(libutf8::to_u32string_parallel(str) == str32);
+
+        std::size_t const pos(libutf8::utf8_split_point(str, str.length() - 100));
+        str[pos] = '\xFF';
+        libutf8::transcode_result_t const r(libutf8::validate_utf8_parallel(str));
+        CATCH_REQUIRE_FALSE(r.ok());
+        CATCH_REQUIRE(r.f_error_position == pos);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
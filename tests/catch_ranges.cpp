@@ -0,0 +1,237 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/ranges.h>
+
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <list>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+#ifdef __cpp_lib_ranges
+namespace
+{
+
+
+typedef decltype(std::string_view() | libutf8::views::utf8_decode)      utf8_decode_t;
+typedef decltype(std::u16string_view() | libutf8::views::utf16_decode)  utf16_decode_t;
+typedef decltype(std::u32string_view() | libutf8::views::utf32_decode)  utf32_decode_t;
+typedef decltype(utf8_decode_t() | libutf8::views::utf8_encode)         utf8_encode_t;
+typedef decltype(utf8_decode_t() | libutf8::views::utf16_encode)        utf16_encode_t;
+
+static_assert(std::ranges::bidirectional_range<utf8_decode_t>);
+static_assert(std::ranges::common_range<utf8_decode_t>);
+static_assert(std::ranges::view<utf8_decode_t>);
+static_assert(std::ranges::bidirectional_range<utf16_decode_t>);
+static_assert(std::ranges::bidirectional_range<utf32_decode_t>);
+static_assert(std::ranges::bidirectional_range<utf8_encode_t>);
+static_assert(std::ranges::common_range<utf8_encode_t>);
+static_assert(std::ranges::bidirectional_range<utf16_encode_t>);
+
+
+template<typename R>
+std::u32string to_u32(R && r)
+{
+    std::u32string result;
+    for(char32_t c : r)
+    {
+        result += c;
+    }
+    return result;
+}
+
+
+template<typename CharT, typename R>
+std::basic_string<CharT> to_units(R && r)
+{
+    std::basic_string<CharT> result;
+    for(CharT c : r)
+    {
+        result += c;
+    }
+    return result;
+}
+
+
+} // no name namespace
+#endif
+
+
+
+CATCH_TEST_CASE("ranges_decode", "[ranges][u8][u16][u32]")
+{
+#ifdef __cpp_lib_ranges
+    CATCH_START_SECTION("ranges_decode: decode views forward and in reverse")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 200, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+            std::u32string const reversed(str32.rbegin(), str32.rend());
+
+            CATCH_REQUIRE(to_u32(str | libutf8::views::utf8_decode) == str32);
+            CATCH_REQUIRE(to_u32(str16 | libutf8::views::utf16_decode) == str32);
+            CATCH_REQUIRE(to_u32(str32 | libutf8::views::utf32_decode) == str32);
+
+            CATCH_REQUIRE(to_u32(libutf8::views::utf8_decode(str) | std::views::reverse) == reversed);
+            CATCH_REQUIRE(to_u32(str16 | libutf8::views::utf16_decode | std::views::reverse) == reversed);
+            CATCH_REQUIRE(to_u32(str32 | libutf8::views::utf32_decode | std::views::reverse) == reversed);
+
+            CATCH_REQUIRE(static_cast<std::size_t>(std::ranges::distance(str | libutf8::views::utf8_decode)) == str32.length());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ranges_decode: invalid sequences")
+    {
+        std::string_view const str("a\xFF" "b\xE2\x82");
+        CATCH_REQUIRE(to_u32(str | libutf8::views::utf8_decode) == std::u32string({ U'a', libutf8::NOT_A_CHARACTER, U'b', libutf8::NOT_A_CHARACTER }));
+        CATCH_REQUIRE(to_u32(libutf8::views::utf8_decode(str) | std::views::reverse) == std::u32string({ libutf8::NOT_A_CHARACTER, U'b', libutf8::NOT_A_CHARACTER, U'a' }));
+
+        std::string_view const runs("A\x80\x80" "B\xE3\x80\x80\x80");
+        CATCH_REQUIRE(to_u32(runs | libutf8::views::utf8_decode) == std::u32string({ U'A', libutf8::NOT_A_CHARACTER, U'B', U'\u3000', libutf8::NOT_A_CHARACTER }));
+        CATCH_REQUIRE(to_u32(libutf8::views::utf8_decode(runs) | std::views::reverse) == std::u32string({ libutf8::NOT_A_CHARACTER, U'\u3000', U'B', libutf8::NOT_A_CHARACTER, U'A' }));
+
+        std::u16string const str16({ u'a', 0xDC00, 0xD83D, 0xDE00, 0xD800 });
+        CATCH_REQUIRE(to_u32(str16 | libutf8::views::utf16_decode) == std::u32string({ U'a', libutf8::NOT_A_CHARACTER, U'\U0001F600', libutf8::NOT_A_CHARACTER }));
+        CATCH_REQUIRE(to_u32(str16 | libutf8::views::utf16_decode | std::views::reverse) == std::u32string({ libutf8::NOT_A_CHARACTER, U'\U0001F600', libutf8::NOT_A_CHARACTER, U'a' }));
+
+        std::u32string const str32({ U'a', 0xD800, 0x110000, U'z' });
+        CATCH_REQUIRE(to_u32(str32 | libutf8::views::utf32_decode) == std::u32string({ U'a', libutf8::NOT_A_CHARACTER, libutf8::NOT_A_CHARACTER, U'z' }));
+    }
+    CATCH_END_SECTION()
+#endif
+}
+
+
+CATCH_TEST_CASE("ranges_encode", "[ranges][u8][u16][u32]")
+{
+#ifdef __cpp_lib_ranges
+    CATCH_START_SECTION("ranges_encode: transcode through the views")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 200, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            CATCH_REQUIRE(to_units<char>(str32 | libutf8::views::utf8_encode) == str);
+            CATCH_REQUIRE(to_units<char16_t>(str | libutf8::views::utf8_decode | libutf8::views::utf16_encode) == str16);
+            CATCH_REQUIRE(to_units<char>(str16 | libutf8::views::utf16_decode | libutf8::views::utf8_encode) == str);
+            CATCH_REQUIRE(to_units<char32_t>(str | libutf8::views::utf8_decode | libutf8::views::utf32_encode) == str32);
+
+            // encode backward
+            //
+            auto encoded(str32 | libutf8::views::utf8_encode);
+            std::string const reversed(str.rbegin(), str.rend());
+            CATCH_REQUIRE(to_units<char>(encoded | std::views::reverse) == reversed);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ranges_encode: pipeline with std::views::transform")
+    {
+        std::string_view const str("Caf\xC3\xA9 \xC3\x89T\xC3\x89");
+        auto lower(str
+                | libutf8::views::utf8_decode
+                | std::views::transform([](char32_t c)
+                    {
+                        // the Latin-1 uppercase letters without using the locale
+                        //
+                        return (c >= U'A' && c <= U'Z') || (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+                                    ? c + 0x20
+                                    : c;
+                    })
+                | libutf8::views::utf8_encode);
+        CATCH_REQUIRE(std::string(lower.begin(), lower.end()) == "caf\xC3\xA9 \xC3\xA9t\xC3\xA9");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ranges_encode: pipeline built before it gets applied")
+    {
+        auto const upper(libutf8::views::utf8_decode
+                | std::views::transform([](char32_t c)
+                    {
+                        return (c >= U'a' && c <= U'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7)
+                                    ? c - 0x20
+                                    : c;
+                    })
+                | libutf8::views::utf8_encode);
+
+        std::string_view const str("Caf\xC3\xA9 \xC3\xA9t\xC3\xA9");
+        auto result(str | upper);
+        CATCH_REQUIRE(std::string(result.begin(), result.end()) == "CAF\xC3\x89 \xC3\x89T\xC3\x89");
+        CATCH_REQUIRE(to_units<char>(upper(std::string_view("\xC3\xA0x"))) == "\xC3\x80X");
+
+        // libutf8 adaptors on both sides and on the right only
+        //
+        auto const to16(libutf8::views::utf8_decode | libutf8::views::utf16_encode);
+        CATCH_REQUIRE(to_units<char16_t>(str | to16) == u"Caf\xE9 \xE9t\xE9");
+
+        auto const reencode(std::views::reverse | libutf8::views::utf8_encode);
+        std::u32string const str32(U"ab\xE9");
+        CATCH_REQUIRE(to_units<char>(str32 | reencode) == "\xC3\xA9" "ba");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ranges_encode: forward only and non-common ranges")
+    {
+        std::list<char32_t> const chars({ U'a', U'\xE9', U'\U0001F600' });
+        CATCH_REQUIRE(to_units<char>(chars | libutf8::views::utf8_encode) == "a\xC3\xA9\xF0\x9F\x98\x80");
+
+        auto const taken(std::views::iota(0x41, 0x100) | std::views::take_while([](int c) { return c < 0xC2; }));
+        std::string expected;
+        for(char32_t c(0x41); c < 0xC2; ++c)
+        {
+            expected += libutf8::to_u8string(c);
+        }
+        CATCH_REQUIRE(to_units<char>(taken | libutf8::views::utf8_encode) == expected);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("ranges_encode: invalid characters become U+FFFD")
+    {
+        std::u32string const str32({ U'a', 0xD800, 0x110000, libutf8::NOT_A_CHARACTER });
+        CATCH_REQUIRE(to_units<char>(str32 | libutf8::views::utf8_encode) == "a\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD");
+        CATCH_REQUIRE(to_units<char16_t>(str32 | libutf8::views::utf16_encode) == std::u16string({ u'a', 0xFFFD, 0xFFFD, 0xFFFD }));
+    }
+    CATCH_END_SECTION()
+#endif
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,767 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/simd.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <iostream>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("simd_selection", "[simd]")
+{
+    CATCH_START_SECTION("simd_selection: best is the default")
+    {
+        CATCH_REQUIRE(libutf8::get_simd() == libutf8::get_best_simd());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_selection: all supported levels can be selected")
+    {
+        SNAP_CATCH2_NAMESPACE::foreach_simd([](libutf8::simd_t simd)
+            {
+                CATCH_REQUIRE(libutf8::get_simd() == simd);
+            });
+        CATCH_REQUIRE(libutf8::get_simd() == libutf8::get_best_simd());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_selection: names")
+    {
+        CATCH_REQUIRE(libutf8::simd_to_string(libutf8::simd_t::SIMD_NONE) == "none");
+        CATCH_REQUIRE(libutf8::simd_to_string(libutf8::simd_t::SIMD_SSE4_2) == "sse4.2");
+        CATCH_REQUIRE(libutf8::simd_to_string(libutf8::simd_t::SIMD_AVX2) == "avx2");
+        CATCH_REQUIRE(libutf8::simd_to_string(libutf8::simd_t::SIMD_AVX512) == "avx512");
+        CATCH_REQUIRE(libutf8::simd_to_string(static_cast<libutf8::simd_t>(100)) == "unknown");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_selection: unsupported levels are refused")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::set_simd(static_cast<libutf8::simd_t>(100))
+                , libutf8::libutf8_exception_unsupported);
+        CATCH_REQUIRE(libutf8::get_simd() == libutf8::get_best_simd());
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_ascii", "[simd][valid][ascii]")
+{
+    CATCH_START_SECTION("simd_ascii: ASCII strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string str(length, ' ');
+            for(auto & c : str)
+            {
+                c = static_cast<char>(rand() % 0x5F + 0x20);
+            }
+            std::string with_ctrl(str);
+            if(length > 0)
+            {
+                with_ctrl[rand() % length] = static_cast<char>(rand() % 2 == 0 ? rand() % 0x20 : 0x7F);
+            }
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &with_ctrl](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::is_valid_ascii(str, true));
+                    CATCH_REQUIRE(libutf8::is_valid_ascii(str, false));
+                    CATCH_REQUIRE(libutf8::is_valid_ascii(str.c_str(), false));
+                    CATCH_REQUIRE(libutf8::ascii_prefix_length(str) == str.length());
+
+                    CATCH_REQUIRE(libutf8::is_valid_ascii(with_ctrl, true));
+                    CATCH_REQUIRE(libutf8::is_valid_ascii(with_ctrl, false) == with_ctrl.empty());
+                    CATCH_REQUIRE(libutf8::ascii_prefix_length(with_ctrl) == with_ctrl.length());
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_ascii: first non-ASCII byte at any position")
+    {
+        for(std::size_t pos(0); pos < 200; ++pos)
+        {
+            std::string str(pos, 'a');
+            str += static_cast<char>(rand() % 0x80 + 0x80);
+            str += std::string(rand() % 100, rand() % 2 == 0 ? 'b' : '\xE9');
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, pos](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::ascii_prefix_length(str) == pos);
+                    CATCH_REQUIRE_FALSE(libutf8::is_valid_ascii(str, true));
+                    CATCH_REQUIRE_FALSE(libutf8::is_valid_ascii(str, false));
+                    CATCH_REQUIRE(libutf8::ascii_prefix_length(std::string_view(str.data(), pos)) == pos);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_validate_utf8", "[simd][valid][u8]")
+{
+    CATCH_START_SECTION("simd_validate_utf8: valid strings of all sizes")
+    {
+        SNAP_CATCH2_NAMESPACE::foreach_simd([](libutf8::simd_t)
+            {
+                for(std::size_t length(0); length < 300; ++length)
+                {
+                    std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+                    CATCH_REQUIRE(libutf8::is_valid_utf8(str));
+                }
+            });
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf8: one invalid byte anywhere")
+    {
+        for(int count(0); count < 2000; ++count)
+        {
+            std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 200 + 1, rand() % 101));
+            str[rand() % str.length()] = static_cast<char>(rand() % 0xFF + 1);
+
+            libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+            bool const expected(libutf8::is_valid_utf8(str));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, expected](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::is_valid_utf8(str) == expected);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf8: invalid sequences across block boundaries")
+    {
+        char const * invalid_sequences[] =
+        {
+            "\x80",                 // continuation without a lead
+            "\xC0\x80",             // overlong 2 bytes
+            "\xC1\xBF",
+            "\xE0\x80\x80",         // overlong 3 bytes
+            "\xE0\x9F\xBF",
+            "\xED\xA0\x80",         // surrogate
+            "\xED\xBF\xBF",
+            "\xF0\x80\x80\x80",     // overlong 4 bytes
+            "\xF0\x8F\xBF\xBF",
+            "\xF4\x90\x80\x80",     // too large
+            "\xF5\x80\x80\x80",
+            "\xF8\x88\x80\x80\x80", // 5 bytes
+            "\xFF",
+            "\xC3",                 // too short
+            "\xE2\x82",
+            "\xF0\x9F\x98",
+            "\xC3\xA9\xA9",         // too long
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(std::size_t pos(0); pos < 140; ++pos)
+            {
+                std::string str(pos, 'a');
+                str += seq;
+                str += std::string(rand() % 70, 'b');
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf8(str));
+                    });
+
+                // also at the very end of the string
+                //
+                str = std::string(pos, 'a');
+                str += seq;
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf8(str));
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf8: valid edge sequences across block boundaries")
+    {
+        char const * valid_sequences[] =
+        {
+            "\xC2\x80",
+            "\xDF\xBF",
+            "\xE0\xA0\x80",
+            "\xED\x9F\xBF",
+            "\xEE\x80\x80",
+            "\xEF\xBF\xBF",
+            "\xF0\x90\x80\x80",
+            "\xF4\x8F\xBF\xBF",
+        };
+        for(auto const & seq : valid_sequences)
+        {
+            for(std::size_t pos(0); pos < 140; ++pos)
+            {
+                std::string str(pos, 'a');
+                str += seq;
+                str += std::string(rand() % 70, 'b');
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE(libutf8::is_valid_utf8(str));
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_length", "[simd][length][u8][u16]")
+{
+    CATCH_START_SECTION("simd_length: UTF-8 strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::size_t const expected(libutf8::to_u32string(str).length());
+
+            // the checked version ignores the 0xF8 to 0xFF bytes
+            //
+            std::string invalid(str);
+            invalid.insert(rand() % (invalid.length() + 1), 1, static_cast<char>(rand() % 8 + 0xF8));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &invalid, expected](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::u8length(str) == expected);
+                    CATCH_REQUIRE(libutf8::u8length_unchecked(str) == expected);
+                    CATCH_REQUIRE(libutf8::u8length(invalid) == expected);
+                    CATCH_REQUIRE(libutf8::u8length_unchecked(invalid) == expected + 1);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_length: UTF-16 strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::size_t const expected(libutf8::to_u32string(str).length());
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str16, expected](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::u16length(str16) == static_cast<ssize_t>(expected));
+                    CATCH_REQUIRE(libutf8::u16length_unchecked(str16) == expected);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_length: UTF-16 surrogate errors across block boundaries")
+    {
+        std::u16string const invalid_sequences[] =
+        {
+            u"\xD800",             // high surrogate alone
+            u"\xDBFFx",
+            u"\xDC00",             // low surrogate alone
+            u"x\xDFFF",
+            u"\xDC00\xD800",       // swapped
+            u"\xD800\xD800\xDC00",
+            u"\xD800\xDC00\xDC00",
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(std::size_t pos(0); pos < 70; ++pos)
+            {
+                std::u16string str(pos, u'a');
+                str += seq;
+                str += std::u16string(rand() % 40, u'b');
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE(libutf8::u16length(str) == -1);
+                    });
+
+                // also at the very end of the string
+                //
+                str = std::u16string(pos, u'a');
+                str += seq;
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE(libutf8::u16length(str) == -1);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_length: UTF-16 surrogate pairs across block boundaries")
+    {
+        for(std::size_t pos(0); pos < 70; ++pos)
+        {
+            std::u16string str(pos, u'a');
+            str += u"\xD83D\xDE00";
+            std::u16string const end_str(str);
+            str += std::u16string(rand() % 40, u'b');
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &end_str, pos](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::u16length(str) == static_cast<ssize_t>(str.length() - 1));
+                    CATCH_REQUIRE(libutf8::u16length(end_str) == static_cast<ssize_t>(pos + 1));
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_validate_utf16_utf32", "[simd][valid][u16][u32]")
+{
+    CATCH_START_SECTION("simd_validate_utf16_utf32: valid strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str16, &str32](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::is_valid_utf16(str16));
+                    CATCH_REQUIRE(libutf8::is_valid_unicode(str32));
+                    CATCH_REQUIRE(libutf8::is_valid_unicode(str32.c_str()));
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf16_utf32: invalid UTF-16 across block boundaries")
+    {
+        std::u16string const invalid_sequences[] =
+        {
+            u"\xD800",
+            u"\xDBFFx",
+            u"\xDC00",
+            u"\xDC00\xD800",
+            u"\xD800\xD800\xDC00",
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(std::size_t pos(0); pos < 70; ++pos)
+            {
+                std::u16string str(pos, u'a');
+                str += u"\xD83D\xDE03";
+                str += seq;
+                std::u16string const at_end(str);
+                str += std::u16string(rand() % 40, u'\0');
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &at_end](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf16(str));
+                        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf16(at_end));
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf16_utf32: invalid UTF-32 and controls at any position")
+    {
+        struct char_t
+        {
+            char32_t        f_char = U'\0';
+            bool            f_valid = false;
+            bool            f_valid_ctrl = false;
+        };
+        char_t const chars[] =
+        {
+            { U'\0',                   false, true },
+            { U'\x1F',                 false, true },
+            { U'\x20',                 true,  true },
+            { U'\x7E',                 true,  true },
+            { U'\x7F',                 false, true },
+            { U'\x9F',                 false, true },
+            { U'\xA0',                 true,  true },
+            { U'\xD7FF',               true,  true },
+            { U'\xD800',               false, false },
+            { U'\xDFFF',               false, false },
+            { U'\xE000',               true,  true },
+            { U'\U0010FFFF',           true,  true },
+            { U'\x110000',             false, false },
+            { static_cast<char32_t>(-1), false, false },
+        };
+        for(auto const & c : chars)
+        {
+            for(std::size_t pos(0); pos < 70; ++pos)
+            {
+                std::u32string str(pos, U'a');
+                str += c.f_char;
+                str += std::u32string(rand() % 40, U'b');
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &c](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE(libutf8::is_valid_unicode(str, true) == c.f_valid_ctrl);
+                        CATCH_REQUIRE(libutf8::is_valid_unicode(str, false) == c.f_valid);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_validate_utf16_utf32: NUL terminated UTF-32 strings")
+    {
+        std::u32string str(100, U'a');
+        str[50] = U'\0';
+        str[60] = U'\xD800';
+        SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+            {
+                // the character pointer version stops on the NUL
+                //
+                CATCH_REQUIRE(libutf8::is_valid_unicode(str.c_str()));
+                CATCH_REQUIRE_FALSE(libutf8::is_valid_unicode(str));
+                CATCH_REQUIRE(libutf8::is_valid_unicode(static_cast<char32_t const *>(nullptr)));
+            });
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_utf8_length_from", "[simd][length][u8][u16][u32]")
+{
+    CATCH_START_SECTION("simd_utf8_length_from: UTF-16 and UTF-32 strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16, &str32](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::utf8_length_from_utf16(str16) == str.length());
+                    CATCH_REQUIRE(libutf8::utf8_length_from_utf32(str32) == str.length());
+                    CATCH_REQUIRE(libutf8::to_u8string(str16) == str);
+                    CATCH_REQUIRE(libutf8::to_u8string(str32) == str);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf8_length_from: limits")
+    {
+        std::u16string const str16(u"\x7F\x80\x7FF\x800\xD7FF\xD800\xDBFF\xDC00\xDFFF\xE000\xFFFF");
+        std::u32string const str32(U"\x7F\x80\x7FF\x800\xFFFF\x10000\x10FFFF\xFFFFFFFF");
+        SNAP_CATCH2_NAMESPACE::foreach_simd([&str16, &str32](libutf8::simd_t)
+            {
+                for(std::size_t pos(0); pos < 40; ++pos)
+                {
+                    // 1 + 2 + 2 + 3 + 3 + 4 surrogates x 2 + 3 + 3 = 25
+                    //
+                    std::u16string const s16(std::u16string(pos, u'a') + str16);
+                    CATCH_REQUIRE(libutf8::utf8_length_from_utf16(s16) == pos + 25);
+
+                    // 1 + 2 + 2 + 3 + 3 + 4 + 4 + 4 = 23
+                    //
+                    std::u32string const s32(std::u32string(pos, U'a') + str32);
+                    CATCH_REQUIRE(libutf8::utf8_length_from_utf32(s32) == pos + 23);
+                }
+            });
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_length_calculators", "[simd][length][u8][u16][u32]")
+{
+    CATCH_START_SECTION("simd_length_calculators: all the pairs on strings of all sizes")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            std::string latin1(length, ' ');
+            std::size_t high(0);
+            int const ascii(rand() % 101);
+            for(auto & c : latin1)
+            {
+                c = static_cast<char>(rand() % 100 < ascii ? rand() % 0x80 : rand() % 0x80 + 0x80);
+                high += static_cast<unsigned char>(c) >= 0x80;
+            }
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::utf16_length_from_utf32(str32) == str16.length());
+                    CATCH_REQUIRE(libutf8::utf32_length_from_utf8(str) == str32.length());
+                    CATCH_REQUIRE(libutf8::utf32_length_from_utf16(str16) == str32.length());
+                    CATCH_REQUIRE(libutf8::utf8_length_from_latin1(latin1) == length + high);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_length_calculators: limits")
+    {
+        std::u32string const str32(U"\x7F\x80\xFFFF\x10000\x10FFFF\xFFFFFFFF");
+        std::string const latin1("\x7F\x80\xFF\x00", 4);
+        SNAP_CATCH2_NAMESPACE::foreach_simd([&str32, &latin1](libutf8::simd_t)
+            {
+                for(std::size_t pos(0); pos < 70; ++pos)
+                {
+                    // 1 + 1 + 1 + 2 + 2 + 2 = 9
+                    //
+                    std::u32string const s32(std::u32string(pos, U'a') + str32);
+                    CATCH_REQUIRE(libutf8::utf16_length_from_utf32(s32) == pos + 9);
+
+                    // 1 + 2 + 2 + 1 = 6
+                    //
+                    std::string const s(std::string(pos, 'a') + latin1);
+                    CATCH_REQUIRE(libutf8::utf8_length_from_latin1(s) == pos + 6);
+                }
+            });
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("simd_utf16_transcoding", "[simd][strings][u8][u16]")
+{
+    CATCH_START_SECTION("simd_utf16_transcoding: valid strings of all sizes")
+    {
+        for(std::size_t length(0); length < 400; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+
+            libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+            std::u16string const str16(libutf8::to_u16string(str));
+            CATCH_REQUIRE(libutf8::to_u8string(str16) == str);
+            CATCH_REQUIRE(libutf8::utf16_length_from_utf8(str) == str16.length());
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::utf16_length_from_utf8(str) == str16.length());
+                    CATCH_REQUIRE(libutf8::to_u16string(str) == str16);
+                    CATCH_REQUIRE(libutf8::to_u8string(str16) == str);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf16_transcoding: all the characters")
+    {
+        std::u32string all;
+        for(char32_t wc(1); wc < 0x110000; ++wc)
+        {
+            if(wc < 0xD800 || wc > 0xDFFF)
+            {
+                all += wc;
+            }
+        }
+        libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+        std::string const str(libutf8::to_u8string(all));
+        std::u16string const str16(libutf8::to_u16string(str));
+
+        SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16](libutf8::simd_t)
+            {
+                CATCH_REQUIRE(libutf8::to_u16string(str) == str16);
+                CATCH_REQUIRE(libutf8::to_u8string(str16) == str);
+            });
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf16_transcoding: invalid UTF-8 behaves the same at all levels")
+    {
+        char const * invalid_sequences[] =
+        {
+            "\x80",
+            "\xC0\x80",             // overlong
+            "\xE0\x80\x80",
+            "\xF0\x80\x80\x80",
+            "\xED\xA0\x80",         // surrogate
+            "\xF4\x90\x80\x80",     // too large
+            "\xFF",
+            "\xE2\x82",             // too short
+            "\xC3\xA9\xA9",         // too long
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(int count(0); count < 50; ++count)
+            {
+                std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 150, rand() % 101));
+                str.insert(rand() % (str.length() + 1), seq);
+
+                libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+                bool valid(true);
+                std::u16string expected;
+                try
+                {
+                    expected = libutf8::to_u16string(str);
+                }
+                catch(libutf8::libutf8_exception_decoding const &)
+                {
+                    valid = false;
+                }
+
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &expected, valid](libutf8::simd_t)
+                    {
+                        if(valid)
+                        {
+                            CATCH_REQUIRE(libutf8::to_u16string(str) == expected);
+                        }
+                        else
+                        {
+                            CATCH_REQUIRE_THROWS_AS(libutf8::to_u16string(str), libutf8::libutf8_exception_decoding);
+                        }
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf16_transcoding: invalid surrogates at any position")
+    {
+        std::u16string const invalid_sequences[] =
+        {
+            u"\xD800",
+            u"\xDBFFx",
+            u"\xDC00",
+            u"\xDC00\xD800",
+            u"\xD800\xD800\xDC00",
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(std::size_t pos(0); pos < 70; ++pos)
+            {
+                std::u16string str(libutf8::to_u16string(SNAP_CATCH2_NAMESPACE::random_utf8(pos, rand() % 101)));
+                str += seq;
+                str += libutf8::to_u16string(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 40, rand() % 101));
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str](libutf8::simd_t)
+                    {
+                        CATCH_REQUIRE_THROWS_AS(libutf8::to_u8string(str), libutf8::libutf8_exception_decoding);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("simd_utf32_transcoding", "[simd][strings][u8][u32]")
+{
+    CATCH_START_SECTION("simd_utf32_transcoding: valid strings of all sizes")
+    {
+        for(std::size_t length(0); length < 400; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+
+            libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+            std::u32string const str32(libutf8::to_u32string(str));
+            CATCH_REQUIRE(str32.length() == libutf8::u8length(str));
+            CATCH_REQUIRE(libutf8::to_u8string(str32) == str);
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str32](libutf8::simd_t)
+                {
+                    CATCH_REQUIRE(libutf8::to_u32string(str) == str32);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf32_transcoding: all the characters")
+    {
+        std::u32string all;
+        for(char32_t wc(1); wc < 0x110000; ++wc)
+        {
+            if(wc < 0xD800 || wc > 0xDFFF)
+            {
+                all += wc;
+            }
+        }
+        std::string const str(libutf8::to_u8string(all));
+
+        SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &all](libutf8::simd_t)
+            {
+                CATCH_REQUIRE(libutf8::to_u32string(str) == all);
+            });
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("simd_utf32_transcoding: invalid UTF-8 behaves the same at all levels")
+    {
+        char const * invalid_sequences[] =
+        {
+            "\x80",
+            "\xC0\x80",             // overlong
+            "\xF0\x80\x80\x80",
+            "\xED\xA0\x80",         // surrogate
+            "\xF4\x90\x80\x80",     // too large
+            "\xFE",
+            "\xF0\x9F\x98",         // too short
+            "\xC3\xA9\xA9",         // too long
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(int count(0); count < 50; ++count)
+            {
+                std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 150, rand() % 101));
+                str.insert(rand() % (str.length() + 1), seq);
+
+                libutf8::set_simd(libutf8::simd_t::SIMD_NONE);
+                bool valid(true);
+                std::u32string expected;
+                try
+                {
+                    expected = libutf8::to_u32string(str);
+                }
+                catch(libutf8::libutf8_exception_decoding const &)
+                {
+                    valid = false;
+                }
+
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &expected, valid](libutf8::simd_t)
+                    {
+                        if(valid)
+                        {
+                            CATCH_REQUIRE(libutf8::to_u32string(str) == expected);
+                        }
+                        else
+                        {
+                            CATCH_REQUIRE_THROWS_AS(libutf8::to_u32string(str), libutf8::libutf8_exception_decoding);
+                        }
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -38,6 +38,8 @@
 #include    <cctype>
 #include    <iostream>
 #include    <iomanip>
+#include    <memory_resource>
+#include    <vector>
 
 
 // last include
@@ -547,6 +549,109 @@ CATCH_TEST_CASE("string_concatenation", "[strings][valid][u8][u32]")
         CATCH_REQUIRE(ascii_add == expected);
     }
     CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_concatenation: temporaries + char32")
+    {
+        for(int count(0); count < 1000; ++count)
+        {
+            char32_t const wc(SNAP_CATCH2_NAMESPACE::rand_char(true));
+            std::string const expected(libutf8::to_u8string(wc));
+
+            CATCH_REQUIRE(std::string("test") + wc == "test" + expected);
+            CATCH_REQUIRE(wc + std::string("test") == expected + "test");
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_concatenation: append_utf8() of characters and strings")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::u32string str32;
+            std::string expected("prefix:");
+            std::string one_by_one("prefix:");
+            std::size_t const length(rand() % 100);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                char32_t const wc(SNAP_CATCH2_NAMESPACE::rand_char(true));
+                str32 += wc;
+                expected += libutf8::to_u8string(wc);
+                CATCH_REQUIRE(&libutf8::append_utf8(one_by_one, wc) == &one_by_one);
+            }
+            CATCH_REQUIRE(one_by_one == expected);
+
+            std::string dst("prefix:");
+            CATCH_REQUIRE(&libutf8::append_utf8(dst, str32) == &dst);
+            CATCH_REQUIRE(dst == expected);
+
+            dst = "prefix:";
+            CATCH_REQUIRE(&libutf8::append_utf8(dst, libutf8::to_u16string(expected.substr(7))) == &dst);
+            CATCH_REQUIRE(dst == expected);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_concatenation: to_u8char()")
+    {
+        for(char32_t wc(0); wc < 0x110000; wc += rand() % 50 + 1)
+        {
+            if(wc >= 0xD800 && wc <= 0xDFFF)
+            {
+                continue;
+            }
+            libutf8::u8char const c(libutf8::to_u8char(wc));
+            CATCH_REQUIRE_FALSE(c.empty());
+            CATCH_REQUIRE(std::string_view(c) == libutf8::to_u8string(wc));
+            CATCH_REQUIRE(c.size() == static_cast<std::size_t>(libutf8::utf8_char_length(wc)));
+            CATCH_REQUIRE(c == libutf8::u8char(wc));
+        }
+
+        CATCH_REQUIRE(libutf8::u8char().empty());
+        CATCH_REQUIRE(libutf8::u8char(static_cast<char32_t>(0xDC00)).empty());
+        CATCH_REQUIRE(libutf8::u8char(U'a') != libutf8::u8char(U'b'));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_concatenation: invalid characters")
+    {
+        for(char32_t const wc : { static_cast<char32_t>(0xD800), static_cast<char32_t>(0xDFFF), static_cast<char32_t>(0x110000) })
+        {
+            std::string dst("keep");
+            CATCH_REQUIRE_THROWS_MATCHES(
+                      libutf8::append_utf8(dst, wc)
+                    , libutf8::libutf8_exception_encoding
+                    , Catch::Matchers::ExceptionMessage(
+                              "libutf8_exception: append_utf8(char32_t): the input wide character (\\U"
+                            + snapdev::int_to_hex(wc, false, 6)
+                            + ") is not a valid UTF-32 character."));
+            CATCH_REQUIRE(dst == "keep");
+
+            // the operators report the same error as to_u8string(char32_t)
+            //
+            std::string const message(
+                      "libutf8_exception: to_u8string(char32_t): the input wide character (\\U"
+                    + snapdev::int_to_hex(wc, false, 6)
+                    + ") is not a valid UTF-32 character.");
+            CATCH_REQUIRE_THROWS_MATCHES(libutf8::to_u8string(wc), libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE_THROWS_MATCHES(dst += wc, libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE_THROWS_MATCHES(dst + wc, libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE_THROWS_MATCHES(wc + dst, libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE_THROWS_MATCHES(std::string("x") + wc, libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE_THROWS_MATCHES(wc + std::string("x"), libutf8::libutf8_exception_encoding, Catch::Matchers::ExceptionMessage(message));
+            CATCH_REQUIRE(dst == "keep");
+
+            CATCH_REQUIRE_THROWS_AS(libutf8::to_u8char(wc), libutf8::libutf8_exception_encoding);
+
+            std::u32string const str32(std::u32string(U"abc") + wc);
+            CATCH_REQUIRE_THROWS_AS(libutf8::append_utf8(dst, str32), libutf8::libutf8_exception_encoding);
+            CATCH_REQUIRE(dst == "keep");
+        }
+
+        std::string dst("keep");
+        CATCH_REQUIRE_THROWS_AS(libutf8::append_utf8(dst, std::u16string_view(u"abc\xDC00")), libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE(dst == "keep");
+    }
+    CATCH_END_SECTION()
 }
 
 
@@ -977,4 +1082,310 @@ CATCH_TEST_CASE("compare_strings", "[compare][strings][valid][invalid][u8]")
 
 
 
+CATCH_TEST_CASE("string_view_functions", "[strings][valid][invalid][u8][u16][u32]")
+{
+    CATCH_START_SECTION("string_view_functions: embedded NUL characters are validated")
+    {
+        CATCH_REQUIRE(libutf8::is_valid_utf8(std::string("abc\0def", 7)));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf8(std::string("abc\0\xFF", 5)));
+        CATCH_REQUIRE(libutf8::is_valid_utf8("abc\0\xFF"));     // NUL terminated
+
+        CATCH_REQUIRE(libutf8::is_valid_utf16(std::u16string(u"abc\0def", 7)));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf16(std::u16string(u"abc\0\xDC00", 5)));
+
+        CATCH_REQUIRE(libutf8::is_valid_unicode(std::u32string(U"abc\0def", 7)));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_unicode(std::u32string(U"abc\0def", 7), false));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_unicode(std::u32string_view(U"abc\0\x110000", 5)));
+
+        CATCH_REQUIRE(libutf8::is_valid_ascii(std::string("abc\0def", 7)));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_ascii(std::string("abc\0def", 7), false));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_ascii(std::string("abc\0\x80", 5)));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_view_functions: embedded NUL characters are converted")
+    {
+        std::string const str8("a\0\xC3\xA9\0\xF0\x9F\x98\x80", 9);
+        std::u16string const str16(u"a\0\xE9\0\xD83D\xDE00", 6);
+        std::u32string const str32(U"a\0\xE9\0\x1F600", 5);
+
+        CATCH_REQUIRE(libutf8::to_u32string(str8) == str32);
+        CATCH_REQUIRE(libutf8::to_u16string(str8) == str16);
+        CATCH_REQUIRE(libutf8::to_u8string(str32) == str8);
+        CATCH_REQUIRE(libutf8::to_u8string(str16) == str8);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_view_functions: slices of a larger buffer")
+    {
+        std::string const buffer("<<\xC3\xA9t\xC3\xA9>>\xFF");
+        std::string_view const slice(std::string_view(buffer).substr(2, 5));
+        CATCH_REQUIRE(libutf8::is_valid_utf8(slice));
+        CATCH_REQUIRE_FALSE(libutf8::is_valid_utf8(std::string_view(buffer).substr(2, 4)));
+        CATCH_REQUIRE(libutf8::to_u32string(slice) == U"\xE9t\xE9");
+        CATCH_REQUIRE(libutf8::to_u16string(slice) == u"\xE9t\xE9");
+        CATCH_REQUIRE(libutf8::u8casecmp(slice, "\xC3\xA9T\xC3\xA9") == 0);
+        CATCH_REQUIRE(libutf8::u8casecmp(std::string_view(buffer).substr(0, 4), "<<\xC3\xA9T") < 0);
+
+        std::u32string const buffer32(U"[\xE9t\xE9]");
+        CATCH_REQUIRE(libutf8::to_u8string(std::u32string_view(buffer32).substr(1, 3)) == "\xC3\xA9t\xC3\xA9");
+
+        std::string result;
+        CATCH_REQUIRE(libutf8::make_u8string_valid(slice, result));
+        CATCH_REQUIRE(result == slice);
+        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(std::string_view(buffer).substr(5), result, U'_'));
+        CATCH_REQUIRE(result == "\xC3\xA9>>_");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("string_view_functions: the input can be the result string")
+    {
+        std::string str("abc\xFF" "def");
+        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(str, str));
+        CATCH_REQUIRE(str == "abc?def");
+        str = "\xE3\x80" "abc\xC3\xA9";
+        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(std::string_view(str).substr(0, 6), str, U'_'));
+        CATCH_REQUIRE(str == "_abc_");
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("caller_buffer_conversions", "[strings][u8][u16][u32]")
+{
+    CATCH_START_SECTION("caller_buffer_conversions: exact size buffers")
+    {
+        std::u32string const str32(U"a\xE9\x2020\x1F600\0z", 6);
+        std::u16string const str16(u"a\xE9\x2020\xD83D\xDE00\0z", 7);
+        std::string const expected("a\xC3\xA9\xE2\x80\xA0\xF0\x9F\x98\x80\0z", 12);
+
+        CATCH_REQUIRE(libutf8::utf8_length_from_utf32(str32) == 12);
+        CATCH_REQUIRE(libutf8::utf8_length_from_utf16(str16) == 12);
+
+        char buf[12];
+        CATCH_REQUIRE(libutf8::to_u8string(str32, buf, sizeof(buf)) == 12);
+        CATCH_REQUIRE(std::string(buf, 12) == expected);
+
+        memset(buf, 0, sizeof(buf));
+        CATCH_REQUIRE(libutf8::to_u8string(str16, buf, sizeof(buf)) == 12);
+        CATCH_REQUIRE(std::string(buf, 12) == expected);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("caller_buffer_conversions: buffer too small")
+    {
+        char buf[16];
+        for(std::size_t size(0); size < 12; ++size)
+        {
+            CATCH_REQUIRE_THROWS_AS(
+                      libutf8::to_u8string(std::u32string_view(U"a\xE9\x2020\x1F600\0z", 6), buf, size)
+                    , libutf8::libutf8_exception_overflow);
+            CATCH_REQUIRE_THROWS_AS(
+                      libutf8::to_u8string(std::u16string_view(u"a\xE9\x2020\xD83D\xDE00\0z", 7), buf, size)
+                    , libutf8::libutf8_exception_overflow);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("caller_buffer_conversions: invalid input")
+    {
+        char buf[16];
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::u32string_view(U"a\xD800"), buf, sizeof(buf))
+                , libutf8::libutf8_exception_encoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::u32string_view(U"a\x110000"), buf, sizeof(buf))
+                , libutf8::libutf8_exception_encoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::u16string_view(u"a\xDC00"), buf, sizeof(buf))
+                , libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::u16string_view(u"a\xD800"), buf, sizeof(buf))
+                , libutf8::libutf8_exception_decoding);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("caller_buffer_conversions: UTF-8 to UTF-16 and UTF-32")
+    {
+        std::string const str("a\xC3\xA9\xE2\x80\xA0\xF0\x9F\x98\x80\0z", 12);
+        std::u16string const expected16(u"a\xE9\x2020\xD83D\xDE00\0z", 7);
+        std::u32string const expected32(U"a\xE9\x2020\x1F600\0z", 6);
+
+        char16_t buf16[7];
+        CATCH_REQUIRE(libutf8::to_u16string(str, buf16, 7) == 7);
+        CATCH_REQUIRE(std::u16string(buf16, 7) == expected16);
+
+        char32_t buf32[12];
+        CATCH_REQUIRE(libutf8::to_u32string(str, buf32, 6) == 6);
+        CATCH_REQUIRE(std::u32string(buf32, 6) == expected32);
+        CATCH_REQUIRE(libutf8::to_u32string(str, buf32, 12) == 6);
+        CATCH_REQUIRE(std::u32string(buf32, 6) == expected32);
+
+        for(std::size_t size(0); size < 7; ++size)
+        {
+            CATCH_REQUIRE_THROWS_AS(
+                      libutf8::to_u16string(str, buf16, size)
+                    , libutf8::libutf8_exception_overflow);
+        }
+        for(std::size_t size(0); size < 6; ++size)
+        {
+            CATCH_REQUIRE_THROWS_AS(
+                      libutf8::to_u32string(str, buf32, size)
+                    , libutf8::libutf8_exception_overflow);
+        }
+
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u16string("a\xC0\x80", buf16, 7)
+                , libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u32string("a\xC0\x80", buf32, 12)
+                , libutf8::libutf8_exception_decoding);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("allocator_conversions", "[strings][u8][u16][u32]")
+{
+    CATCH_START_SECTION("allocator_conversions: results are allocated in a pmr arena")
+    {
+        // the null upstream resource makes sure nothing goes to the heap
+        //
+        char buffer[4096];
+        std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+        std::pmr::polymorphic_allocator<> const alloc(&arena);
+
+        std::u32string const str32(U"long enough to not fit in the SSO \xE9\x2020\x1F600");
+        std::string const str8(libutf8::to_u8string(str32));
+        std::u16string const str16(libutf8::to_u16string(str8));
+
+        std::pmr::string const a(libutf8::to_u8string(str32, alloc));
+        CATCH_REQUIRE(std::string_view(a) == str8);
+        CATCH_REQUIRE(a.get_allocator().resource() == &arena);
+
+        std::pmr::string const b(libutf8::to_u8string(str16, alloc));
+        CATCH_REQUIRE(std::string_view(b) == str8);
+        CATCH_REQUIRE(b.get_allocator().resource() == &arena);
+
+        std::pmr::u16string const c(libutf8::to_u16string(str8, alloc));
+        CATCH_REQUIRE(std::u16string_view(c) == str16);
+        CATCH_REQUIRE(c.get_allocator().resource() == &arena);
+
+        std::pmr::u32string const d(libutf8::to_u32string(str8, alloc));
+        CATCH_REQUIRE(std::u32string_view(d) == str32);
+        CATCH_REQUIRE(d.get_allocator().resource() == &arena);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("allocator_conversions: random strings with the standard allocator")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::u32string str32;
+            std::size_t const length(rand() % 200);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                str32 += SNAP_CATCH2_NAMESPACE::rand_char(true);
+            }
+            std::string const str8(libutf8::to_u8string(str32));
+            std::u16string const str16(libutf8::to_u16string(str8));
+
+            std::allocator<char> const alloc;
+            CATCH_REQUIRE(libutf8::to_u8string(str32, alloc) == str8);
+            CATCH_REQUIRE(libutf8::to_u8string(str16, alloc) == str8);
+            CATCH_REQUIRE(libutf8::to_u16string(str8, alloc) == str16);
+            CATCH_REQUIRE(libutf8::to_u32string(str8, alloc) == str32);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("allocator_conversions: invalid input")
+    {
+        std::allocator<char> const alloc;
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u16string("a\xF0\x9F\x98", alloc)
+                , libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u32string("a\xF0\x9F\x98", alloc)
+                , libutf8::libutf8_exception_decoding);
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::u32string_view(U"a\xD800"), alloc)
+                , libutf8::libutf8_exception_encoding);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("wstring_conversions", "[strings][wc][u8]")
+{
+    CATCH_START_SECTION("wstring_conversions: round trip random strings")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::u32string str32;
+            std::size_t const length(rand() % 200);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                str32 += SNAP_CATCH2_NAMESPACE::rand_char(true);
+            }
+            std::string const str8(libutf8::to_u8string(str32));
+
+            std::wstring expected;
+            if constexpr(sizeof(wchar_t) == 2)
+            {
+                std::u16string const str16(libutf8::to_u16string(str8));
+                expected.assign(str16.begin(), str16.end());
+            }
+            else
+            {
+                expected.assign(str32.begin(), str32.end());
+            }
+
+            CATCH_REQUIRE(libutf8::wchar_length_from_utf8(str8) == expected.length());
+            CATCH_REQUIRE(libutf8::utf8_length_from_wchar(expected) == str8.length());
+
+            std::wstring const wstr(libutf8::to_wstring(str8));
+            CATCH_REQUIRE(wstr == expected);
+            CATCH_REQUIRE(libutf8::to_u8string(wstr) == str8);
+
+            std::allocator<wchar_t> const alloc;
+            CATCH_REQUIRE(libutf8::to_wstring(str8, alloc) == expected);
+
+            std::vector<wchar_t> wbuf(expected.length() + 1);
+            CATCH_REQUIRE(libutf8::to_wstring(str8, wbuf.data(), wbuf.size()) == expected.length());
+            CATCH_REQUIRE(std::wstring_view(wbuf.data(), expected.length()) == expected);
+
+            std::vector<char> buf(str8.length() + 1);
+            CATCH_REQUIRE(libutf8::to_u8string(std::wstring_view(expected), buf.data(), buf.size()) == str8.length());
+            CATCH_REQUIRE(std::string_view(buf.data(), str8.length()) == str8);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("wstring_conversions: invalid input and small buffers")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_wstring("a\xF0\x9F\x98")
+                , libutf8::libutf8_exception_decoding);
+
+        wchar_t wbuf[2];
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_wstring("abc", wbuf, 2)
+                , libutf8::libutf8_exception_overflow);
+
+        char buf[2];
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_u8string(std::wstring_view(L"\xE9\xE9"), buf, 2)
+                , libutf8::libutf8_exception_overflow);
+
+        std::allocator<wchar_t> const alloc;
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::to_wstring("\xC0\x80", alloc)
+                , libutf8::libutf8_exception_decoding);
+    }
+    CATCH_END_SECTION()
+}
+
+
 // vim: ts=4 sw=4 et
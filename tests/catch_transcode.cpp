@@ -0,0 +1,436 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/transcode.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+CATCH_TEST_CASE("transcode_valid", "[transcode][u8][u16][u32]")
+{
+    CATCH_START_SECTION("transcode_valid: all conversions of valid strings")
+    {
+        for(std::size_t length(0); length < 300; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16, &str32](libutf8::simd_t)
+                {
+                    std::vector<char> buf8(str.length());
+                    std::vector<char16_t> buf16(str16.length());
+                    std::vector<char32_t> buf32(str32.length());
+
+                    libutf8::transcode_result_t r(libutf8::convert_utf8_to_utf16(str, buf16.data(), buf16.size()));
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(r.f_read == str.length());
+                    CATCH_REQUIRE(r.f_error_position == str.length());
+                    CATCH_REQUIRE(std::u16string(buf16.data(), r.f_written) == str16);
+
+                    r = libutf8::convert_utf8_to_utf32(str, buf32.data(), buf32.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(r.f_read == str.length());
+                    CATCH_REQUIRE(std::u32string(buf32.data(), r.f_written) == str32);
+
+                    r = libutf8::convert_utf16_to_utf8(str16, buf8.data(), buf8.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(r.f_read == str16.length());
+                    CATCH_REQUIRE(std::string(buf8.data(), r.f_written) == str);
+
+                    r = libutf8::convert_utf16_to_utf32(str16, buf32.data(), buf32.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::u32string(buf32.data(), r.f_written) == str32);
+
+                    r = libutf8::convert_utf32_to_utf8(str32, buf8.data(), buf8.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(r.f_read == str32.length());
+                    CATCH_REQUIRE(std::string(buf8.data(), r.f_written) == str);
+
+                    r = libutf8::convert_utf32_to_utf16(str32, buf16.data(), buf16.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::u16string(buf16.data(), r.f_written) == str16);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("transcode_invalid", "[transcode][invalid][u8][u16][u32]")
+{
+    CATCH_START_SECTION("transcode_invalid: invalid UTF-8 gives the position of the error")
+    {
+        struct invalid_t
+        {
+            char const *                    f_sequence = nullptr;
+            libutf8::transcode_status_t     f_status = libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID;
+        };
+        invalid_t const invalid_sequences[] =
+        {
+            { "\x80" },
+            { "\xC0\x80" },             // overlong
+            { "\xE0\x9F\xBF" },
+            { "\xF0\x8F\xBF\xBF" },
+            { "\xED\xA0\x80" },         // surrogate
+            { "\xF4\x90\x80\x80" },     // too large
+            { "\xF8\x88\x80\x80\x80" },
+            { "\xFF" },
+            { "\xE2\x82" "a" },         // too short
+        };
+        for(auto const & seq : invalid_sequences)
+        {
+            for(int count(0); count < 20; ++count)
+            {
+                std::string const start(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 150, rand() % 101));
+                std::string const str(start + seq.f_sequence + SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 70, rand() % 101));
+                std::u16string const start16(libutf8::to_u16string(start));
+                std::u32string const start32(libutf8::to_u32string(start));
+
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                    {
+                        std::vector<char16_t> buf16(str.length());
+                        libutf8::transcode_result_t r(libutf8::convert_utf8_to_utf16(str, buf16.data(), buf16.size()));
+                        CATCH_REQUIRE(r.f_status == seq.f_status);
+                        CATCH_REQUIRE(r.f_error_position == start.length());
+                        CATCH_REQUIRE(r.f_read == start.length());
+                        CATCH_REQUIRE(std::u16string(buf16.data(), r.f_written) == start16);
+
+                        std::vector<char32_t> buf32(str.length());
+                        r = libutf8::convert_utf8_to_utf32(str, buf32.data(), buf32.size());
+                        CATCH_REQUIRE(r.f_status == seq.f_status);
+                        CATCH_REQUIRE(r.f_error_position == start.length());
+                        CATCH_REQUIRE(std::u32string(buf32.data(), r.f_written) == start32);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("transcode_invalid: truncated UTF-8 at the end of the input")
+    {
+        char const * truncated_sequences[] =
+        {
+            "\xC3",
+            "\xE2\x82",
+            "\xF0\x9F\x98",
+        };
+        for(auto const & seq : truncated_sequences)
+        {
+            for(std::size_t pos(0); pos < 140; ++pos)
+            {
+                std::string const str(std::string(pos, 'a') + seq);
+                SNAP_CATCH2_NAMESPACE::foreach_simd([&str, pos](libutf8::simd_t)
+                    {
+                        std::vector<char16_t> buf16(str.length());
+                        libutf8::transcode_result_t const r(libutf8::convert_utf8_to_utf16(str, buf16.data(), buf16.size()));
+                        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+                        CATCH_REQUIRE(r.f_error_position == pos);
+                        CATCH_REQUIRE(r.f_written == pos);
+                    });
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("transcode_invalid: invalid UTF-16 and UTF-32")
+    {
+        SNAP_CATCH2_NAMESPACE::foreach_simd([](libutf8::simd_t)
+            {
+                for(std::size_t pos(0); pos < 70; ++pos)
+                {
+                    char buf8[300];
+                    char32_t buf32[300];
+
+                    std::u16string str16(pos, u'a');
+                    str16 += u"\xDC00 tail of the string";
+                    libutf8::transcode_result_t r(libutf8::convert_utf16_to_utf8(str16, buf8, sizeof(buf8)));
+                    CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+                    CATCH_REQUIRE(r.f_error_position == pos);
+                    CATCH_REQUIRE(r.f_written == pos);
+                    r = libutf8::convert_utf16_to_utf32(str16, buf32, std::size(buf32));
+                    CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+                    CATCH_REQUIRE(r.f_error_position == pos);
+
+                    str16 = std::u16string(pos, u'a') + u"\xD800";
+                    r = libutf8::convert_utf16_to_utf8(str16, buf8, sizeof(buf8));
+                    CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+                    CATCH_REQUIRE(r.f_error_position == pos);
+
+                    std::u32string str32(pos, U'a');
+                    str32 += U'\x110000';
+                    r = libutf8::convert_utf32_to_utf8(str32, buf8, sizeof(buf8));
+                    CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+                    CATCH_REQUIRE(r.f_error_position == pos);
+
+                    str32.back() = U'\xDFFF';
+                    char16_t buf16[300];
+                    r = libutf8::convert_utf32_to_utf16(str32, buf16, std::size(buf16));
+                    CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+                    CATCH_REQUIRE(r.f_error_position == pos);
+                }
+            });
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("transcode_output_too_small", "[transcode][u8][u16][u32]")
+{
+    CATCH_START_SECTION("transcode_output_too_small: convert in several small buffers")
+    {
+        for(int count(0); count < 100; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 300 + 1, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16](libutf8::simd_t)
+                {
+                    // 4 bytes is enough for any one character
+                    //
+                    std::size_t const size(rand() % 100 + 4);
+                    std::vector<char> buf8(size);
+                    std::vector<char16_t> buf16(size);
+
+                    std::u16string result16;
+                    std::string_view in(str);
+                    for(;;)
+                    {
+                        libutf8::transcode_result_t const r(libutf8::convert_utf8_to_utf16(in, buf16.data(), buf16.size()));
+                        result16.append(buf16.data(), r.f_written);
+                        in.remove_prefix(r.f_read);
+                        if(r.ok())
+                        {
+                            break;
+                        }
+                        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+                        CATCH_REQUIRE(r.f_written + 1 >= buf16.size());
+                    }
+                    CATCH_REQUIRE(result16 == str16);
+
+                    std::string result8;
+                    std::u16string_view in16(str16);
+                    for(;;)
+                    {
+                        libutf8::transcode_result_t const r(libutf8::convert_utf16_to_utf8(in16, buf8.data(), buf8.size()));
+                        result8.append(buf8.data(), r.f_written);
+                        in16.remove_prefix(r.f_read);
+                        if(r.ok())
+                        {
+                            break;
+                        }
+                        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+                        CATCH_REQUIRE(r.f_written + 3 >= buf8.size());
+                    }
+                    CATCH_REQUIRE(result8 == str);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("transcode_engine", "[transcode][u8][u16][u32]")
+{
+    CATCH_START_SECTION("transcode_engine: same encoding, wchar_t and throwing policy")
+    {
+        for(std::size_t length(0); length < 200; ++length)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+            std::wstring const wstr(str32.begin(), str32.end());
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&](libutf8::simd_t)
+                {
+                    std::vector<char> buf8(str.length());
+                    std::vector<char16_t> buf16(str16.length());
+                    std::vector<char32_t> buf32(str32.length());
+                    std::vector<wchar_t> bufw(str32.length());
+
+                    libutf8::transcode_result_t r(libutf8::transcode<char, char>(str, buf8.data(), buf8.size()));
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::string(buf8.data(), r.f_written) == str);
+
+                    r = libutf8::transcode<char16_t, char16_t>(str16, buf16.data(), buf16.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::u16string(buf16.data(), r.f_written) == str16);
+
+                    r = libutf8::transcode<char32_t, char32_t>(str32, buf32.data(), buf32.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::u32string(buf32.data(), r.f_written) == str32);
+
+                    r = libutf8::transcode<char, wchar_t>(str, bufw.data(), bufw.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::wstring(bufw.data(), r.f_written) == wstr);
+
+                    r = libutf8::transcode<wchar_t, char, libutf8::error_policy_t::ERROR_POLICY_THROW>(wstr, buf8.data(), buf8.size());
+                    CATCH_REQUIRE(std::string(buf8.data(), r.f_written) == str);
+
+                    r = libutf8::transcode<wchar_t, char16_t>(wstr, buf16.data(), buf16.size());
+                    CATCH_REQUIRE(r.ok());
+                    CATCH_REQUIRE(std::u16string(buf16.data(), r.f_written) == str16);
+
+                    r = libutf8::transcode<char16_t, char, libutf8::error_policy_t::ERROR_POLICY_THROW>(str16, buf8.data(), buf8.size());
+                    CATCH_REQUIRE(std::string(buf8.data(), r.f_written) == str);
+
+                    CATCH_REQUIRE(libutf8::to_u8string(std::wstring_view(wstr)) == str);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("transcode_engine: same encoding stops on errors and small buffers")
+    {
+        char buf8[16];
+        std::string const invalid("abc\xC3\xA9\xC0\x80z");
+        libutf8::transcode_result_t r(libutf8::transcode<char, char>(invalid, buf8, sizeof(buf8)));
+        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_INVALID);
+        CATCH_REQUIRE(r.f_error_position == 5);
+        CATCH_REQUIRE(std::string(buf8, r.f_written) == "abc\xC3\xA9");
+
+        r = libutf8::transcode<char, char>(std::string_view("abc\xC3\xA9"), buf8, 4);
+        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+        CATCH_REQUIRE(r.f_written == 3);
+
+        char16_t buf16[4];
+        r = libutf8::transcode<char16_t, char16_t>(std::u16string_view(u"a\xD83D\xDE00"), buf16, 2);
+        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_OUTPUT_TOO_SMALL);
+        CATCH_REQUIRE(r.f_written == 1);
+
+        r = libutf8::transcode<char16_t, char16_t>(std::u16string_view(u"a\xD83D"), buf16, 4);
+        CATCH_REQUIRE(r.f_status == libutf8::transcode_status_t::TRANSCODE_STATUS_TRUNCATED);
+        CATCH_REQUIRE(r.f_error_position == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("transcode_engine: throwing policy")
+    {
+        char buf8[16];
+        char16_t buf16[16];
+        char32_t buf32[16];
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (libutf8::transcode<char, char16_t, libutf8::error_policy_t::ERROR_POLICY_THROW>(std::string_view("ab\xFF"), buf16, 16))
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: transcode(): a UTF-8 character could not be extracted."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (libutf8::transcode<char16_t, char32_t, libutf8::error_policy_t::ERROR_POLICY_THROW>(std::u16string_view(u"a\xDC00"), buf32, 16))
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: transcode(): found a high UTF-16 surrogate without the low surrogate."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (libutf8::transcode<char32_t, char, libutf8::error_policy_t::ERROR_POLICY_THROW>(std::u32string_view(U"abc\x110000"), buf8, 16))
+                , libutf8::libutf8_exception_encoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: transcode(u32string): the input wide character with code 1114112 is not a valid UTF-32 character."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  (libutf8::transcode<char, char, libutf8::error_policy_t::ERROR_POLICY_THROW>(std::string_view("abcdef"), buf8, 5))
+                , libutf8::libutf8_exception_overflow
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: transcode(): the output buffer is too small."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("transcode_engine: the exceptions name the function which was called")
+    {
+        char buf8[16];
+        char16_t buf16[16];
+        char32_t buf32[16];
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u16string_view(u"a\xDC00"), buf8, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(): found a high UTF-16 surrogate without the low surrogate."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u16string_view(u"a\xD800"), buf8, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(): the high UTF-16 surrogate is not followed by the low surrogate."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u16string_view(u"a\xD800\xD800\xDC00"), buf8, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(): found two high UTF-16 surrogates in a row."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u16string_view(u"a\xD800z"), buf8, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(): found a high UTF-16 surrogate without a low surrogate afterward."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u16string_view(u"abcdef"), buf8, 5)
+                , libutf8::libutf8_exception_overflow
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(u16string): the output buffer is too small."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u32string_view(U"abcdef"), buf8, 5)
+                , libutf8::libutf8_exception_overflow
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(u32string): the output buffer is too small."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u8string(std::u32string_view(U"a\xD800"), buf8, 16)
+                , libutf8::libutf8_exception_encoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u8string(u32string): the input wide character with code 55296 is not a valid UTF-32 character."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u16string(std::string_view("ab\xFF"), buf16, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u16string(): a UTF-8 character could not be extracted."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u16string(std::string_view("abcdef"), buf16, 5)
+                , libutf8::libutf8_exception_overflow
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u16string(): the output buffer is too small."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u32string(std::string_view("ab\xFF"), buf32, 16)
+                , libutf8::libutf8_exception_decoding
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u32string(): a UTF-8 character could not be extracted."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  libutf8::to_u32string(std::string_view("abcdef"), buf32, 5)
+                , libutf8::libutf8_exception_overflow
+                , Catch::Matchers::ExceptionMessage(
+                          "libutf8_exception: to_u32string(): the output buffer is too small."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
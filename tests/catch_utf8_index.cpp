@@ -0,0 +1,279 @@
+// Copyright (c) 2013-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// libutf8
+//
+#include    <libutf8/utf8_index.h>
+
+#include    <libutf8/exception.h>
+#include    <libutf8/libutf8.h>
+
+
+// unit test
+//
+#include    "catch_main.h"
+
+
+// C++
+//
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+// check all the lookups against a character by character scan
+//
+void check_index(libutf8::utf8_index const & index, std::string const & str)
+{
+    std::vector<std::size_t> bytes;
+    std::vector<std::size_t> utf16;
+    std::size_t u(0);
+    for(std::size_t pos(0); pos < str.length(); ++pos)
+    {
+        unsigned char const c(static_cast<unsigned char>(str[pos]));
+        if((c & 0xC0) != 0x80)
+        {
+            bytes.push_back(pos);
+            utf16.push_back(u);
+            u += c >= 0xF0 ? 2 : 1;
+        }
+    }
+    std::size_t const size(bytes.size());
+    bytes.push_back(str.length());
+    utf16.push_back(u);
+
+    CATCH_REQUIRE(index.str() == str);
+    CATCH_REQUIRE(index.size() == size);
+    CATCH_REQUIRE(index.utf16_size() == u);
+
+    for(std::size_t cp(0); cp <= size + 1; ++cp)
+    {
+        std::size_t const expected(std::min(cp, size));
+        CATCH_REQUIRE(index.byte_offset(cp) == bytes[expected]);
+        CATCH_REQUIRE(index.utf16_offset(cp) == utf16[expected]);
+    }
+
+    std::size_t cp(0);
+    for(std::size_t pos(0); pos <= str.length(); ++pos)
+    {
+        CATCH_REQUIRE(index.code_point_index(pos) == cp);
+        if(pos < str.length()
+        && (static_cast<unsigned char>(str[pos]) & 0xC0) != 0x80)
+        {
+            ++cp;
+        }
+    }
+
+    cp = 0;
+    for(std::size_t unit(0); unit <= u; ++unit)
+    {
+        if(cp < size && utf16[cp + 1] <= unit)
+        {
+            ++cp;
+        }
+        CATCH_REQUIRE(index.code_point_from_utf16(unit) == cp);
+    }
+
+    // the checkpoints are sorted and never more than step() apart
+    //
+    libutf8::utf8_index::checkpoint_vector_t const & checkpoints(index.checkpoints());
+    CATCH_REQUIRE_FALSE(checkpoints.empty());
+    CATCH_REQUIRE(checkpoints[0].f_byte == 0);
+    CATCH_REQUIRE(checkpoints[0].f_code_point == 0);
+    CATCH_REQUIRE(checkpoints[0].f_utf16 == 0);
+    for(std::size_t idx(0); idx < checkpoints.size(); ++idx)
+    {
+        libutf8::utf8_index::checkpoint_t const & c(checkpoints[idx]);
+        CATCH_REQUIRE((idx == 0 || c.f_code_point < size));
+        CATCH_REQUIRE(c.f_byte == bytes[c.f_code_point]);
+        CATCH_REQUIRE(c.f_utf16 == utf16[c.f_code_point]);
+        std::size_t const next(idx + 1 < checkpoints.size()
+                    ? checkpoints[idx + 1].f_code_point
+                    : size);
+        CATCH_REQUIRE(next - c.f_code_point <= index.step());
+        if(idx + 1 < checkpoints.size())
+        {
+            CATCH_REQUIRE(next > c.f_code_point);
+        }
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+CATCH_TEST_CASE("utf8_index_build", "[index][u8][u16]")
+{
+    CATCH_START_SECTION("utf8_index_build: lookups match a scan of the string")
+    {
+        for(int count(0); count < 30; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 3000, rand() % 101));
+            std::size_t const step(rand() % 100 + 1);
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, step](libutf8::simd_t)
+                {
+                    libutf8::utf8_index const index(str, step);
+                    CATCH_REQUIRE(index.step() == step);
+                    check_index(index, str);
+
+                    // a checkpoint every step characters
+                    //
+                    libutf8::utf8_index::checkpoint_vector_t const & checkpoints(index.checkpoints());
+                    for(std::size_t idx(0); idx < checkpoints.size(); ++idx)
+                    {
+                        CATCH_REQUIRE(checkpoints[idx].f_code_point == idx * step);
+                    }
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("utf8_index_build: the parallel build gives the same checkpoints")
+    {
+        for(int count(0); count < 30; ++count)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 5000, rand() % 101));
+            std::size_t const step(rand() % 200 + 1);
+
+            libutf8::parallel_options_t options;
+            options.f_threads = rand() % 8 + 2;
+            options.f_min_chunk_size = rand() % 500 + 1;
+
+            libutf8::utf8_index const single(str, step);
+            libutf8::utf8_index const parallel(str, step, options);
+            check_index(parallel, str);
+
+            CATCH_REQUIRE(single.checkpoints().size() == parallel.checkpoints().size());
+            for(std::size_t idx(0); idx < single.checkpoints().size(); ++idx)
+            {
+                CATCH_REQUIRE(single.checkpoints()[idx].f_byte == parallel.checkpoints()[idx].f_byte);
+                CATCH_REQUIRE(single.checkpoints()[idx].f_code_point == parallel.checkpoints()[idx].f_code_point);
+                CATCH_REQUIRE(single.checkpoints()[idx].f_utf16 == parallel.checkpoints()[idx].f_utf16);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("utf8_index_build: empty string")
+    {
+        libutf8::utf8_index const index;
+        CATCH_REQUIRE(index.size() == 0);
+        CATCH_REQUIRE(index.utf16_size() == 0);
+        CATCH_REQUIRE(index.step() == libutf8::UTF8_INDEX_DEFAULT_STEP);
+        CATCH_REQUIRE(index.checkpoints().size() == 1);
+        CATCH_REQUIRE(index.byte_offset(10) == 0);
+        CATCH_REQUIRE(index.utf16_offset(10) == 0);
+        CATCH_REQUIRE(index.code_point_index(10) == 0);
+        CATCH_REQUIRE(index.code_point_from_utf16(10) == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("utf8_index_build: the step must be at least 1")
+    {
+        CATCH_REQUIRE_THROWS_AS(
+                  libutf8::utf8_index("abc", 0)
+                , libutf8::libutf8_exception_invalid_parameter);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("utf8_index_update", "[index][u8][u16]")
+{
+    CATCH_START_SECTION("utf8_index_update: random edits")
+    {
+        for(int count(0); count < 20; ++count)
+        {
+            std::string str(SNAP_CATCH2_NAMESPACE::random_utf8(rand() % 2000, rand() % 101));
+            std::size_t const step(rand() % 50 + 1);
+            libutf8::utf8_index index(str, step);
+
+            for(int edit(0); edit < 30; ++edit)
+            {
+                // edit at character boundaries
+                //
+                std::size_t const size(index.size());
+                std::size_t const start(index.byte_offset(rand() % (size + 1)));
+                std::size_t const end(index.byte_offset(index.code_point_index(start) + rand() % 20));
+                std::size_t const removed(rand() % 3 == 0 ? 0 : end - start);
+                std::string const inserted(rand() % 3 == 0
+                            ? std::string()
+                            : SNAP_CATCH2_NAMESPACE::random_utf8(rand() % (step * 3), rand() % 101));
+
+                str.replace(start, removed, inserted);
+                index.update(str, start, removed, inserted.length());
+                check_index(index, str);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("utf8_index_update: edit at the very start and the very end")
+    {
+        std::string str("\xC3\xA9t\xC3\xA9 \xF0\x9F\x98\x80");
+        libutf8::utf8_index index(str, 2);
+
+        str.insert(0, "ab");
+        index.update(str, 0, 0, 2);
+        check_index(index, str);
+
+        str += "\xE2\x82\xAC";
+        index.update(str, str.length() - 3, 0, 3);
+        check_index(index, str);
+
+        std::size_t const length(str.length());
+        str.clear();
+        index.update(str, 0, length, 0);
+        check_index(index, str);
+        CATCH_REQUIRE(index.checkpoints().size() == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("utf8_index_update: the edit must match the string")
+    {
+        std::string const str("abc");
+        libutf8::utf8_index index(str);
+        CATCH_REQUIRE_THROWS_AS(
+                  index.update("abcd", 1, 0, 2)
+                , libutf8::libutf8_exception_invalid_parameter);
+        CATCH_REQUIRE_THROWS_AS(
+                  index.update("abc", 4, 0, 0)
+                , libutf8::libutf8_exception_invalid_parameter);
+        CATCH_REQUIRE_THROWS_AS(
+                  index.update("", 1, 3, 0)
+                , libutf8::libutf8_exception_invalid_parameter);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -19,6 +19,7 @@
 
 // libutf8
 //
+#include    <libutf8/base.h>
 #include    <libutf8/exception.h>
 #include    <libutf8/libutf8.h>
 
@@ -126,4 +127,187 @@ CATCH_TEST_CASE("make_valid", "[strings][valid][u8]")
 
 
 
+CATCH_TEST_CASE("make_valid_policies", "[strings][valid][u8][u16][u32]")
+{
+    CATCH_START_SECTION("make_valid_policies: valid strings are not modified")
+    {
+        for(std::size_t length(0); length < 300; length += 7)
+        {
+            std::string const str(SNAP_CATCH2_NAMESPACE::random_utf8(length, rand() % 101));
+            std::u16string const str16(libutf8::to_u16string(str));
+            std::u32string const str32(libutf8::to_u32string(str));
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &str16, &str32](libutf8::simd_t)
+                {
+                    std::string copy(str);
+                    char const * const data(copy.data());
+                    CATCH_REQUIRE(libutf8::make_u8string_valid(copy, libutf8::REPLACEMENT_CHAR, libutf8::replacement_policy_t::REPLACEMENT_POLICY_MAXIMAL_SUBPART));
+                    CATCH_REQUIRE(copy == str);
+                    CATCH_REQUIRE(copy.data() == data);
+
+                    std::string result("previous content");
+                    CATCH_REQUIRE(libutf8::make_u8string_valid(str, result));
+                    CATCH_REQUIRE(result == str);
+
+                    std::u16string copy16(str16);
+                    CATCH_REQUIRE(libutf8::make_u16string_valid(copy16));
+                    CATCH_REQUIRE(copy16 == str16);
+
+                    std::u32string copy32(str32);
+                    CATCH_REQUIRE(libutf8::make_u32string_valid(copy32));
+                    CATCH_REQUIRE(copy32 == str32);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("make_valid_policies: UTF-8 policies")
+    {
+        struct policy_test_t
+        {
+            char const *    f_input = nullptr;
+            char const *    f_sequence = nullptr;
+            char const *    f_maximal_subpart = nullptr;
+            char const *    f_byte = nullptr;
+            char const *    f_drop = nullptr;
+        };
+        policy_test_t const tests[] =
+        {
+            // example from the Unicode standard, section 3.9
+            //
+            {
+                "a\xF1\x80\x80\xE1\x80\xC2" "b\x80" "c\x80\xBF" "d",
+                "a???b?c?d",
+                "a???b?c??d",
+                "a??????b?c??d",
+                "abcd",
+            },
+            {
+                "\xC0\xAF|\xE0\x80\xBF|\xF0\x81\x82\x41",
+                "?|?|?A",
+                "??|???|???A",
+                "??|???|???A",
+                "||A",
+            },
+            {
+                "\xED\xA0\x80|\xF4\x90\x80\x80|\xF8\x88\x80\x80\x80",
+                "?|?|?",
+                "???|????|?????",
+                "???|????|?????",
+                "||",
+            },
+            {
+                "end \xF0\x9F\x98",
+                "end ?",
+                "end ?",
+                "end ???",
+                "end ",
+            },
+        };
+        for(auto const & t : tests)
+        {
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&t](libutf8::simd_t)
+                {
+                    // also test with a long valid start so the SIMD
+                    // validator finds the first error
+                    //
+                    for(std::size_t prefix : { 0, 100 })
+                    {
+                        std::string const start(prefix, 'x');
+                        std::string result;
+                        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(start + t.f_input, result));
+                        CATCH_REQUIRE(result == start + t.f_sequence);
+                        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(start + t.f_input, result, U'?', libutf8::replacement_policy_t::REPLACEMENT_POLICY_MAXIMAL_SUBPART));
+                        CATCH_REQUIRE(result == start + t.f_maximal_subpart);
+                        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(start + t.f_input, result, U'?', libutf8::replacement_policy_t::REPLACEMENT_POLICY_BYTE));
+                        CATCH_REQUIRE(result == start + t.f_byte);
+
+                        std::string str(start + t.f_input);
+                        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid(str, U'?', libutf8::replacement_policy_t::REPLACEMENT_POLICY_DROP));
+                        CATCH_REQUIRE(str == start + t.f_drop);
+                    }
+                });
+        }
+
+        std::string result;
+        CATCH_REQUIRE_FALSE(libutf8::make_u8string_valid("\x80", result, libutf8::REPLACEMENT_CHAR, libutf8::replacement_policy_t::REPLACEMENT_POLICY_MAXIMAL_SUBPART));
+        CATCH_REQUIRE(result == "\xEF\xBF\xBD");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("make_valid_policies: the sequence policy skips the same bytes as mbstowc()")
+    {
+        for(int count(0); count < 1000; ++count)
+        {
+            std::string str;
+            std::size_t const length(rand() % 30 + 1);
+            for(std::size_t idx(0); idx < length; ++idx)
+            {
+                // favor bytes which are likely to form sequences
+                //
+                str += static_cast<char>(rand() % 4 == 0 ? rand() % 0x100 : rand() % 0x50 + 0x70);
+            }
+
+            std::string expected;
+            char const * mb(str.data());
+            std::size_t len(str.length());
+            while(len > 0)
+            {
+                char32_t wc(U'\0');
+                if(libutf8::mbstowc(wc, mb, len) < 0)
+                {
+                    expected += '?';
+                }
+                else
+                {
+                    expected += libutf8::to_u8string(wc);
+                }
+            }
+
+            SNAP_CATCH2_NAMESPACE::foreach_simd([&str, &expected](libutf8::simd_t)
+                {
+                    std::string result;
+                    CATCH_REQUIRE(libutf8::make_u8string_valid(str, result) == (expected == str));
+                    CATCH_REQUIRE(result == expected);
+                });
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("make_valid_policies: UTF-16 and UTF-32")
+    {
+        std::u16string str16(u"a\xDC00" "b\xD800\xD800\xDC00" "c\xD800");
+        std::u16string result16;
+        CATCH_REQUIRE_FALSE(libutf8::make_u16string_valid(str16, result16));
+        CATCH_REQUIRE(result16 == u"a?b?\xD800\xDC00" "c?");
+        CATCH_REQUIRE_FALSE(libutf8::make_u16string_valid(str16, result16, U'\U0001F600'));
+        CATCH_REQUIRE(result16 == u"a\xD83D\xDE00" "b\xD83D\xDE00\xD800\xDC00" "c\xD83D\xDE00");
+        CATCH_REQUIRE_FALSE(libutf8::make_u16string_valid(str16, U'?', libutf8::replacement_policy_t::REPLACEMENT_POLICY_DROP));
+        CATCH_REQUIRE(str16 == u"ab\xD800\xDC00" "c");
+
+        std::u32string str32(U"a\xD800" "b");
+        str32 += static_cast<char32_t>(0x110000);
+        std::u32string result32;
+        CATCH_REQUIRE_FALSE(libutf8::make_u32string_valid(str32, result32, libutf8::REPLACEMENT_CHAR));
+        CATCH_REQUIRE(result32 == U"a\xFFFD" "b\xFFFD");
+        CATCH_REQUIRE_THROWS_AS(libutf8::make_u32string_valid(str32, result32, static_cast<char32_t>(0xDFFF)), libutf8::libutf8_exception_invalid_parameter);
+        CATCH_REQUIRE_FALSE(libutf8::make_u32string_valid(str32, U'?', libutf8::replacement_policy_t::REPLACEMENT_POLICY_DROP));
+        CATCH_REQUIRE(str32 == U"ab");
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("make_valid_policies: the input can be the result string")
+    {
+        std::u16string str16(u"a\xDC00" "b");
+        CATCH_REQUIRE_FALSE(libutf8::make_u16string_valid(str16, str16));
+        CATCH_REQUIRE(str16 == u"a?b");
+
+        std::u32string str32(U"a\xD800" "b");
+        CATCH_REQUIRE_FALSE(libutf8::make_u32string_valid(str32, str32));
+        CATCH_REQUIRE(str32 == U"a?b");
+    }
+    CATCH_END_SECTION()
+}
+
+
+
 // vim: ts=4 sw=4 et
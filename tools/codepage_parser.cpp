@@ -0,0 +1,265 @@
+// Copyright (c) 2000-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/libutf8
+// contact@m2osw.com
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program; if not, write to the Free Software Foundation, Inc.,
+// 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+
+/** \file
+ * \brief Tool used to convert the codepage mapping files to C++ tables.
+ *
+ * This executable reads the mapping files found under `conf/codepages`
+ * (one line per byte: the byte, the Unicode character, and a comment)
+ * and generates the tables used by the codepage conversion functions.
+ *
+ * It runs at build time, before the library gets compiled, so it does
+ * not use the library.
+ */
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstdint>
+#include    <fstream>
+#include    <iomanip>
+#include    <iostream>
+#include    <sstream>
+#include    <string>
+#include    <vector>
+
+
+// C
+//
+#include    <stdlib.h>
+
+
+
+namespace
+{
+
+
+
+constexpr char32_t const    UNDEFINED = static_cast<char32_t>(-2);
+
+
+struct codepage_t
+{
+    std::string         f_name = std::string();
+    char32_t            f_to_unicode[256] = {};
+};
+
+
+/** \brief Load one mapping file.
+ *
+ * The lines starting with '#' are comments. The other lines have the
+ * byte and the character in hexadecimal separated by a tab. A byte
+ * without a character is not defined in that codepage.
+ */
+bool load(std::string const & filename, codepage_t & codepage)
+{
+    std::ifstream in(filename);
+    if(!in.is_open())
+    {
+        std::cerr << "error: could not open \"" << filename << "\".\n";
+        return false;
+    }
+
+    std::fill(codepage.f_to_unicode, codepage.f_to_unicode + 256, UNDEFINED);
+
+    std::string line;
+    for(int line_number(1); std::getline(in, line); ++line_number)
+    {
+        if(line.empty()
+        || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string byte;
+        std::string character;
+        fields >> byte >> character;
+        if(byte.empty())
+        {
+            continue;
+        }
+        unsigned long const b(std::stoul(byte, nullptr, 16));
+        if(b > 0xFF)
+        {
+            std::cerr << filename << ":" << line_number << ": error: byte " << byte << " is out of range.\n";
+            return false;
+        }
+        if(!character.empty())
+        {
+            codepage.f_to_unicode[b] = static_cast<char32_t>(std::stoul(character, nullptr, 16));
+        }
+    }
+
+    // the conversion functions copy ASCII as is
+    //
+    for(std::uint32_t b(0); b < 0x80; ++b)
+    {
+        if(codepage.f_to_unicode[b] != b)
+        {
+            std::cerr << filename << ": error: byte 0x" << std::hex << b << " is not ASCII.\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+void generate(std::ostream & out, std::vector<codepage_t> const & codepages)
+{
+    out << "// This file was generated by codepage-parser, do not edit.\n"
+        << "\n"
+        << "#include    \"libutf8/codepage_tables.h\"\n"
+        << "\n"
+        << "#include    <iterator>\n"
+        << "\n"
+        << "namespace libutf8\n"
+        << "{\n"
+        << "namespace detail\n"
+        << "{\n"
+        << "namespace\n"
+        << "{\n";
+
+    out << std::hex << std::uppercase << std::setfill('0');
+    for(std::size_t idx(0); idx < codepages.size(); ++idx)
+    {
+        std::vector<std::pair<char32_t, int>> reverse;
+        for(int b(0x80); b < 0x100; ++b)
+        {
+            if(codepages[idx].f_to_unicode[b] != UNDEFINED)
+            {
+                reverse.emplace_back(codepages[idx].f_to_unicode[b], b);
+            }
+        }
+        std::sort(reverse.begin(), reverse.end());
+
+        out << "\ncodepage_char_t const g_from_unicode_" << std::dec << idx << std::hex << "[] =\n{\n";
+        for(auto const & r : reverse)
+        {
+            out << "    { 0x" << std::setw(4) << static_cast<std::uint32_t>(r.first)
+                << ", 0x" << std::setw(2) << r.second << " },\n";
+        }
+        out << "};\n";
+    }
+    out << "\n}\n\n"
+        << "codepage_table_t const g_codepage_tables[] =\n{\n";
+    for(std::size_t idx(0); idx < codepages.size(); ++idx)
+    {
+        out << "    {\n"
+            << "        \"" << codepages[idx].f_name << "\",\n"
+            << "        {";
+        for(int b(0); b < 0x100; ++b)
+        {
+            if(b % 8 == 0)
+            {
+                out << "\n           ";
+            }
+            if(codepages[idx].f_to_unicode[b] == UNDEFINED)
+            {
+                out << " NOT_A_CHARACTER,";
+            }
+            else
+            {
+                out << " 0x" << std::setw(4) << static_cast<std::uint32_t>(codepages[idx].f_to_unicode[b]) << ",";
+            }
+        }
+        out << "\n        },\n"
+            << "        g_from_unicode_" << std::dec << idx << ",\n"
+            << "        std::size(g_from_unicode_" << idx << ")\n"
+            << std::hex << "    },\n";
+    }
+    out << "};\n\n"
+        << "std::size_t const g_codepage_tables_size = " << std::dec << codepages.size() << ";\n\n"
+        << "}\n"
+        << "}\n";
+}
+
+
+
+} // no name namespace
+
+
+
+void usage()
+{
+    std::cout << "Usage: codepage-parser <out> <name>=<mapping file> ...\n";
+    std::cout << "Where:\n";
+    std::cout << "  <out>           is the path to the C++ file to generate\n";
+    std::cout << "  <name>          is the name of the codepage (i.e. \"ISO-8859-1\")\n";
+    std::cout << "  <mapping file>  is the path to the corresponding mapping file\n";
+}
+
+
+int main(int argc, char * argv[])
+{
+    std::string output_filename;
+    std::vector<codepage_t> codepages;
+
+    for(int i(1); i < argc; ++i)
+    {
+        if(argv[i][0] == '-')
+        {
+            usage();
+            exit(1);
+        }
+        if(output_filename.empty())
+        {
+            output_filename = argv[i];
+            continue;
+        }
+
+        std::string const arg(argv[i]);
+        std::string::size_type const pos(arg.find('='));
+        if(pos == std::string::npos
+        || pos == 0)
+        {
+            std::cerr << "error: expected <name>=<mapping file>, got \"" << arg << "\".\n";
+            exit(1);
+        }
+        codepage_t codepage;
+        codepage.f_name = arg.substr(0, pos);
+        if(!load(arg.substr(pos + 1), codepage))
+        {
+            exit(1);
+        }
+        codepages.push_back(codepage);
+    }
+
+    if(output_filename.empty()
+    || codepages.empty())
+    {
+        usage();
+        exit(1);
+    }
+
+    std::ofstream out(output_filename);
+    if(!out.is_open())
+    {
+        std::cerr << "error: could not create \"" << output_filename << "\".\n";
+        exit(1);
+    }
+    generate(out, codepages);
+
+    return 0;
+}
+
+
+// vim: ts=4 sw=4 et